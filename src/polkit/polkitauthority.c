@@ -635,6 +635,41 @@ generic_async_cb (GObject      *source_obj,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static GList *
+enumerate_actions_finish_common (PolkitAuthority *authority,
+                                 GAsyncResult    *res,
+                                 GError         **error)
+{
+  GList *ret;
+  GVariant *value;
+  GVariantIter iter;
+  GVariant *child;
+  GVariant *array;
+  GAsyncResult *_res;
+
+  ret = NULL;
+
+  _res = G_ASYNC_RESULT (g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res)));
+
+  value = g_dbus_proxy_call_finish (authority->proxy, _res, error);
+  if (value == NULL)
+    goto out;
+
+  array = g_variant_get_child_value (value, 0);
+  g_variant_iter_init (&iter, array);
+  while ((child = g_variant_iter_next_value (&iter)) != NULL)
+    {
+      ret = g_list_prepend (ret, polkit_action_description_new_for_gvariant (child));
+      g_variant_unref (child);
+    }
+  ret = g_list_reverse (ret);
+  g_variant_unref (array);
+  g_variant_unref (value);
+
+ out:
+  return ret;
+}
+
 /**
  * polkit_authority_enumerate_actions:
  * @authority: A #PolkitAuthority.
@@ -690,39 +725,13 @@ polkit_authority_enumerate_actions_finish (PolkitAuthority *authority,
                                            GAsyncResult    *res,
                                            GError         **error)
 {
-  GList *ret;
-  GVariant *value;
-  GVariantIter iter;
-  GVariant *child;
-  GVariant *array;
-  GAsyncResult *_res;
-
   g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), NULL);
   g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  ret = NULL;
-
   g_warn_if_fail (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (res)) == polkit_authority_enumerate_actions);
-  _res = G_ASYNC_RESULT (g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res)));
-
-  value = g_dbus_proxy_call_finish (authority->proxy, _res, error);
-  if (value == NULL)
-    goto out;
-
-  array = g_variant_get_child_value (value, 0);
-  g_variant_iter_init (&iter, array);
-  while ((child = g_variant_iter_next_value (&iter)) != NULL)
-    {
-      ret = g_list_prepend (ret, polkit_action_description_new_for_gvariant (child));
-      g_variant_unref (child);
-    }
-  ret = g_list_reverse (ret);
-  g_variant_unref (array);
-  g_variant_unref (value);
 
- out:
-  return ret;
+  return enumerate_actions_finish_common (authority, res, error);
 }
 
 /**
@@ -763,6 +772,160 @@ polkit_authority_enumerate_actions_sync (PolkitAuthority *authority,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/**
+ * polkit_authority_enumerate_actions_with_options:
+ * @authority: A #PolkitAuthority.
+ * @options: (allow-none): A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @callback: A #GAsyncReadyCallback to call when the request is satisfied.
+ * @user_data: The data to pass to @callback.
+ *
+ * Like polkit_authority_enumerate_actions() but only retrieves the
+ * registered actions matching the filters in @options. The filters
+ * are evaluated by the authority and the actions are returned sorted
+ * by action identifier. The following keys are recognized:
+ *
+ * <variablelist>
+ *   <varlistentry>
+ *     <term><literal>action-id-prefix</literal> (<literal>s</literal>)</term>
+ *     <listitem><para>Only return actions whose identifier starts with this string.</para></listitem>
+ *   </varlistentry>
+ *   <varlistentry>
+ *     <term><literal>annotations</literal> (<literal>a{ss}</literal>)</term>
+ *     <listitem><para>Only return actions that have all of these annotations with the given values.</para></listitem>
+ *   </varlistentry>
+ *   <varlistentry>
+ *     <term><literal>start-after</literal> (<literal>s</literal>)</term>
+ *     <listitem><para>Only return actions whose identifier sorts after this identifier.</para></listitem>
+ *   </varlistentry>
+ *   <varlistentry>
+ *     <term><literal>limit</literal> (<literal>u</literal>)</term>
+ *     <listitem><para>Return at most this many actions.</para></listitem>
+ *   </varlistentry>
+ * </variablelist>
+ *
+ * To page through a large number of actions, pass the identifier of
+ * the last action of the previous result as
+ * <literal>start-after</literal> until fewer than
+ * <literal>limit</literal> actions are returned.
+ *
+ * When the operation is finished, @callback will be invoked in the
+ * <link linkend="g-main-context-push-thread-default">thread-default
+ * main loop</link> of the thread you are calling this method
+ * from. You can then call polkit_authority_enumerate_actions_with_options_finish()
+ * to get the result of the operation.
+ **/
+void
+polkit_authority_enumerate_actions_with_options (PolkitAuthority     *authority,
+                                                 GVariant            *options,
+                                                 GCancellable        *cancellable,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data)
+{
+  g_return_if_fail (POLKIT_IS_AUTHORITY (authority));
+  g_return_if_fail (options == NULL || g_variant_is_of_type (options, G_VARIANT_TYPE_VARDICT));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+  if (options != NULL)
+    {
+      g_dbus_proxy_call (authority->proxy,
+                         "EnumerateActionsWithOptions",
+                         g_variant_new ("(s@a{sv})",
+                                        "", /* TODO: use system locale */
+                                        options),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         cancellable,
+                         generic_async_cb,
+                         g_simple_async_result_new (G_OBJECT (authority),
+                                                    callback,
+                                                    user_data,
+                                                    polkit_authority_enumerate_actions_with_options));
+    }
+  else
+    {
+      g_dbus_proxy_call (authority->proxy,
+                         "EnumerateActions",
+                         g_variant_new ("(s)",
+                                        ""), /* TODO: use system locale */
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         cancellable,
+                         generic_async_cb,
+                         g_simple_async_result_new (G_OBJECT (authority),
+                                                    callback,
+                                                    user_data,
+                                                    polkit_authority_enumerate_actions_with_options));
+    }
+}
+
+/**
+ * polkit_authority_enumerate_actions_with_options_finish:
+ * @authority: A #PolkitAuthority.
+ * @res: A #GAsyncResult obtained from the callback.
+ * @error: (allow-none): Return location for error or %NULL.
+ *
+ * Finishes retrieving registered actions.
+ *
+ * Returns: (element-type Polkit.ActionDescription) (transfer full): A list of
+ * #PolkitActionDescription objects or %NULL if @error is set. The returned
+ * list should be freed with g_list_free() after each element have been freed
+ * with g_object_unref().
+ **/
+GList *
+polkit_authority_enumerate_actions_with_options_finish (PolkitAuthority *authority,
+                                                        GAsyncResult    *res,
+                                                        GError         **error)
+{
+  g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), NULL);
+  g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (res)) == polkit_authority_enumerate_actions_with_options);
+
+  return enumerate_actions_finish_common (authority, res, error);
+}
+
+/**
+ * polkit_authority_enumerate_actions_with_options_sync:
+ * @authority: A #PolkitAuthority.
+ * @options: (allow-none): A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @error: (allow-none): Return location for error or %NULL.
+ *
+ * Synchronously retrieves the registered actions matching the filters
+ * in @options - the calling thread is blocked until a reply is
+ * received. See polkit_authority_enumerate_actions_with_options() for
+ * the asynchronous version and the supported filters.
+ *
+ * Returns: (element-type Polkit.ActionDescription) (transfer full): A list of
+ * #PolkitActionDescription or %NULL if @error is set. The returned list should
+ * be freed with g_list_free() after each element have been freed with
+ * g_object_unref().
+ **/
+GList *
+polkit_authority_enumerate_actions_with_options_sync (PolkitAuthority *authority,
+                                                      GVariant        *options,
+                                                      GCancellable    *cancellable,
+                                                      GError         **error)
+{
+  GList *ret;
+  CallSyncData *data;
+
+  g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), NULL);
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  data = call_sync_new ();
+  polkit_authority_enumerate_actions_with_options (authority, options, cancellable, call_sync_cb, data);
+  call_sync_block (data);
+  ret = polkit_authority_enumerate_actions_with_options_finish (authority, data->res, error);
+  call_sync_free (data);
+
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 typedef struct
 {
   PolkitAuthority *authority;
@@ -1629,6 +1792,50 @@ polkit_authority_authentication_agent_response_sync (PolkitAuthority     *author
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static GList *
+enumerate_temporary_authorizations_finish_common (PolkitAuthority *authority,
+                                                  GAsyncResult    *res,
+                                                  GError         **error)
+{
+  GList *ret;
+  GVariant *value;
+  GVariantIter iter;
+  GVariant *child;
+  GVariant *array;
+  GAsyncResult *_res;
+
+  ret = NULL;
+
+  _res = G_ASYNC_RESULT (g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res)));
+
+  value = g_dbus_proxy_call_finish (authority->proxy, _res, error);
+  if (value == NULL)
+    goto out;
+
+  array = g_variant_get_child_value (value, 0);
+  g_variant_iter_init (&iter, array);
+  while ((child = g_variant_iter_next_value (&iter)) != NULL)
+    {
+      PolkitTemporaryAuthorization *auth;
+      auth = polkit_temporary_authorization_new_for_gvariant (child, error);
+      g_variant_unref (child);
+      if (auth == NULL)
+        {
+          g_prefix_error (error, "Error serializing return value of EnumerateTemporaryAuthorizations: ");
+          g_list_foreach (ret, (GFunc) g_object_unref, NULL);
+          g_list_free (ret);
+          goto out;
+        }
+      ret = g_list_prepend (ret, auth);
+    }
+  ret = g_list_reverse (ret);
+  g_variant_unref (array);
+  g_variant_unref (value);
+
+ out:
+  return ret;
+}
+
 /**
  * polkit_authority_enumerate_temporary_authorizations:
  * @authority: A #PolkitAuthority.
@@ -1694,48 +1901,13 @@ polkit_authority_enumerate_temporary_authorizations_finish (PolkitAuthority *aut
                                                             GAsyncResult    *res,
                                                             GError         **error)
 {
-  GList *ret;
-  GVariant *value;
-  GVariantIter iter;
-  GVariant *child;
-  GVariant *array;
-  GAsyncResult *_res;
-
   g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), NULL);
   g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-  ret = NULL;
-
   g_warn_if_fail (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (res)) == polkit_authority_enumerate_temporary_authorizations);
-  _res = G_ASYNC_RESULT (g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res)));
-
-  value = g_dbus_proxy_call_finish (authority->proxy, _res, error);
-  if (value == NULL)
-    goto out;
-
-  array = g_variant_get_child_value (value, 0);
-  g_variant_iter_init (&iter, array);
-  while ((child = g_variant_iter_next_value (&iter)) != NULL)
-    {
-      PolkitTemporaryAuthorization *auth;
-      auth = polkit_temporary_authorization_new_for_gvariant (child, error);
-      g_variant_unref (child);
-      if (auth == NULL)
-        {
-          g_prefix_error (error, "Error serializing return value of EnumerateTemporaryAuthorizations: ");
-          g_list_foreach (ret, (GFunc) g_object_unref, NULL);
-          g_list_free (ret);
-          goto out;
-        }
-      ret = g_list_prepend (ret, auth);
-    }
-  ret = g_list_reverse (ret);
-  g_variant_unref (array);
-  g_variant_unref (value);
 
- out:
-  return ret;
+  return enumerate_temporary_authorizations_finish_common (authority, res, error);
 }
 
 /**
@@ -1781,6 +1953,167 @@ polkit_authority_enumerate_temporary_authorizations_sync (PolkitAuthority     *a
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/**
+ * polkit_authority_enumerate_temporary_authorizations_with_options:
+ * @authority: A #PolkitAuthority.
+ * @subject: A #PolkitSubject, typically a #PolkitUnixSession.
+ * @options: (allow-none): A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @callback: A #GAsyncReadyCallback to call when the request is satisfied.
+ * @user_data: The data to pass to @callback.
+ *
+ * Like polkit_authority_enumerate_temporary_authorizations() but only
+ * gets the temporary authorizations for @subject matching the filters
+ * in @options. The filters are evaluated by the authority so only the
+ * matching temporary authorizations are transferred. The following
+ * keys are recognized:
+ *
+ * <variablelist>
+ *   <varlistentry>
+ *     <term><literal>action-id-prefix</literal> (<literal>s</literal>)</term>
+ *     <listitem><para>Only match temporary authorizations for actions whose identifier starts with this string.</para></listitem>
+ *   </varlistentry>
+ *   <varlistentry>
+ *     <term><literal>subject</literal> (<literal>(sa{sv})</literal>)</term>
+ *     <listitem><para>Only match temporary authorizations obtained by this subject, see polkit_subject_to_gvariant().</para></listitem>
+ *   </varlistentry>
+ *   <varlistentry>
+ *     <term><literal>max-age</literal> (<literal>t</literal>)</term>
+ *     <listitem><para>Only match temporary authorizations obtained at most this many seconds ago.</para></listitem>
+ *   </varlistentry>
+ * </variablelist>
+ *
+ * When the operation is finished, @callback will be invoked in the
+ * <link linkend="g-main-context-push-thread-default">thread-default
+ * main loop</link> of the thread you are calling this method
+ * from. You can then call
+ * polkit_authority_enumerate_temporary_authorizations_with_options_finish()
+ * to get the result of the operation.
+ **/
+void
+polkit_authority_enumerate_temporary_authorizations_with_options (PolkitAuthority     *authority,
+                                                                  PolkitSubject       *subject,
+                                                                  GVariant            *options,
+                                                                  GCancellable        *cancellable,
+                                                                  GAsyncReadyCallback  callback,
+                                                                  gpointer             user_data)
+{
+  GVariant *subject_value;
+
+  g_return_if_fail (POLKIT_IS_AUTHORITY (authority));
+  g_return_if_fail (POLKIT_IS_SUBJECT (subject));
+  g_return_if_fail (options == NULL || g_variant_is_of_type (options, G_VARIANT_TYPE_VARDICT));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  subject_value = polkit_subject_to_gvariant (subject);
+  g_variant_ref_sink (subject_value);
+  if (options != NULL)
+    {
+      g_dbus_proxy_call (authority->proxy,
+                         "EnumerateTemporaryAuthorizationsWithOptions",
+                         g_variant_new ("(@(sa{sv})@a{sv})",
+                                        subject_value,
+                                        options),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         cancellable,
+                         generic_async_cb,
+                         g_simple_async_result_new (G_OBJECT (authority),
+                                                    callback,
+                                                    user_data,
+                                                    polkit_authority_enumerate_temporary_authorizations_with_options));
+    }
+  else
+    {
+      g_dbus_proxy_call (authority->proxy,
+                         "EnumerateTemporaryAuthorizations",
+                         g_variant_new ("(@(sa{sv}))",
+                                        subject_value),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         cancellable,
+                         generic_async_cb,
+                         g_simple_async_result_new (G_OBJECT (authority),
+                                                    callback,
+                                                    user_data,
+                                                    polkit_authority_enumerate_temporary_authorizations_with_options));
+    }
+  g_variant_unref (subject_value);
+}
+
+/**
+ * polkit_authority_enumerate_temporary_authorizations_with_options_finish:
+ * @authority: A #PolkitAuthority.
+ * @res: A #GAsyncResult obtained from the callback.
+ * @error: (allow-none): Return location for error or %NULL.
+ *
+ * Finishes retrieving temporary authorizations.
+ *
+ * Returns: (element-type Polkit.TemporaryAuthorization) (transfer full): A
+ * list of #PolkitTemporaryAuthorization objects or %NULL if @error is set. The
+ * returned list should be freed with g_list_free() after each element have
+ * been freed with g_object_unref().
+ **/
+GList *
+polkit_authority_enumerate_temporary_authorizations_with_options_finish (PolkitAuthority *authority,
+                                                                         GAsyncResult    *res,
+                                                                         GError         **error)
+{
+  g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), NULL);
+  g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (res)) == polkit_authority_enumerate_temporary_authorizations_with_options);
+
+  return enumerate_temporary_authorizations_finish_common (authority, res, error);
+}
+
+/**
+ * polkit_authority_enumerate_temporary_authorizations_with_options_sync:
+ * @authority: A #PolkitAuthority.
+ * @subject: A #PolkitSubject, typically a #PolkitUnixSession.
+ * @options: (allow-none): A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @error: (allow-none): Return location for error or %NULL.
+ *
+ * Synchronously gets the temporary authorizations for @subject
+ * matching the filters in @options.
+ *
+ * The calling thread is blocked until a reply is received. See
+ * polkit_authority_enumerate_temporary_authorizations_with_options()
+ * for the asynchronous version and the supported filters.
+ *
+ * Returns: (element-type Polkit.TemporaryAuthorization) (transfer full): A
+ * list of #PolkitTemporaryAuthorization objects or %NULL if @error is set. The
+ * returned list should be freed with g_list_free() after each element have
+ * been freed with g_object_unref().
+ **/
+GList *
+polkit_authority_enumerate_temporary_authorizations_with_options_sync (PolkitAuthority     *authority,
+                                                                       PolkitSubject       *subject,
+                                                                       GVariant            *options,
+                                                                       GCancellable        *cancellable,
+                                                                       GError             **error)
+{
+  GList *ret;
+  CallSyncData *data;
+
+  g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), NULL);
+  g_return_val_if_fail (POLKIT_IS_SUBJECT (subject), NULL);
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  data = call_sync_new ();
+  polkit_authority_enumerate_temporary_authorizations_with_options (authority, subject, options, cancellable, call_sync_cb, data);
+  call_sync_block (data);
+  ret = polkit_authority_enumerate_temporary_authorizations_with_options_finish (authority, data->res, error);
+  call_sync_free (data);
+
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 /**
  * polkit_authority_revoke_temporary_authorizations:
  * @authority: A #PolkitAuthority.
@@ -1906,6 +2239,159 @@ polkit_authority_revoke_temporary_authorizations_sync (PolkitAuthority     *auth
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/**
+ * polkit_authority_revoke_temporary_authorizations_with_options:
+ * @authority: A #PolkitAuthority.
+ * @subject: The subject to revoke authorizations from, typically a #PolkitUnixSession.
+ * @options: (allow-none): A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @callback: A #GAsyncReadyCallback to call when the request is satisfied.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronously revokes the temporary authorizations for @subject
+ * matching the filters in @options. See
+ * polkit_authority_enumerate_temporary_authorizations_with_options()
+ * for the supported filters.
+ *
+ * When the operation is finished, @callback will be invoked in the
+ * <link linkend="g-main-context-push-thread-default">thread-default
+ * main loop</link> of the thread you are calling this method
+ * from. You can then call
+ * polkit_authority_revoke_temporary_authorizations_with_options_finish()
+ * to get the result of the operation.
+ **/
+void
+polkit_authority_revoke_temporary_authorizations_with_options (PolkitAuthority     *authority,
+                                                               PolkitSubject       *subject,
+                                                               GVariant            *options,
+                                                               GCancellable        *cancellable,
+                                                               GAsyncReadyCallback  callback,
+                                                               gpointer             user_data)
+{
+  GVariant *subject_value;
+
+  g_return_if_fail (POLKIT_IS_AUTHORITY (authority));
+  g_return_if_fail (POLKIT_IS_SUBJECT (subject));
+  g_return_if_fail (options == NULL || g_variant_is_of_type (options, G_VARIANT_TYPE_VARDICT));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  subject_value = polkit_subject_to_gvariant (subject);
+  g_variant_ref_sink (subject_value);
+  if (options != NULL)
+    {
+      g_dbus_proxy_call (authority->proxy,
+                         "RevokeTemporaryAuthorizationsWithOptions",
+                         g_variant_new ("(@(sa{sv})@a{sv})",
+                                        subject_value,
+                                        options),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         cancellable,
+                         generic_async_cb,
+                         g_simple_async_result_new (G_OBJECT (authority),
+                                                    callback,
+                                                    user_data,
+                                                    polkit_authority_revoke_temporary_authorizations_with_options));
+    }
+  else
+    {
+      g_dbus_proxy_call (authority->proxy,
+                         "RevokeTemporaryAuthorizations",
+                         g_variant_new ("(@(sa{sv}))",
+                                        subject_value),
+                         G_DBUS_CALL_FLAGS_NONE,
+                         -1,
+                         cancellable,
+                         generic_async_cb,
+                         g_simple_async_result_new (G_OBJECT (authority),
+                                                    callback,
+                                                    user_data,
+                                                    polkit_authority_revoke_temporary_authorizations_with_options));
+    }
+  g_variant_unref (subject_value);
+}
+
+/**
+ * polkit_authority_revoke_temporary_authorizations_with_options_finish:
+ * @authority: A #PolkitAuthority.
+ * @res: A #GAsyncResult obtained from the callback.
+ * @error: (allow-none): Return location for error or %NULL.
+ *
+ * Finishes revoking temporary authorizations.
+ *
+ * Returns: %TRUE if the matching temporary authorizations was revoked, %FALSE if error is set.
+ **/
+gboolean
+polkit_authority_revoke_temporary_authorizations_with_options_finish (PolkitAuthority *authority,
+                                                                      GAsyncResult    *res,
+                                                                      GError         **error)
+{
+  gboolean ret;
+  GVariant *value;
+  GAsyncResult *_res;
+
+  g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), FALSE);
+  g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  ret = FALSE;
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (res)) == polkit_authority_revoke_temporary_authorizations_with_options);
+  _res = G_ASYNC_RESULT (g_simple_async_result_get_op_res_gpointer (G_SIMPLE_ASYNC_RESULT (res)));
+
+  value = g_dbus_proxy_call_finish (authority->proxy, _res, error);
+  if (value == NULL)
+    goto out;
+  ret = TRUE;
+  g_variant_unref (value);
+
+ out:
+  return ret;
+}
+
+/**
+ * polkit_authority_revoke_temporary_authorizations_with_options_sync:
+ * @authority: A #PolkitAuthority.
+ * @subject: The subject to revoke authorizations from, typically a #PolkitUnixSession.
+ * @options: (allow-none): A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
+ * @cancellable: (allow-none): A #GCancellable or %NULL.
+ * @error: (allow-none): Return location for error or %NULL.
+ *
+ * Synchronously revokes the temporary authorizations for @subject
+ * matching the filters in @options.
+ *
+ * The calling thread is blocked until a reply is received. See
+ * polkit_authority_revoke_temporary_authorizations_with_options() for
+ * the asynchronous version.
+ *
+ * Returns: %TRUE if the matching temporary authorizations was revoked, %FALSE if error is set.
+ **/
+gboolean
+polkit_authority_revoke_temporary_authorizations_with_options_sync (PolkitAuthority     *authority,
+                                                                    PolkitSubject       *subject,
+                                                                    GVariant            *options,
+                                                                    GCancellable        *cancellable,
+                                                                    GError             **error)
+{
+  gboolean ret;
+  CallSyncData *data;
+
+  g_return_val_if_fail (POLKIT_IS_AUTHORITY (authority), FALSE);
+  g_return_val_if_fail (POLKIT_IS_SUBJECT (subject), FALSE);
+  g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  data = call_sync_new ();
+  polkit_authority_revoke_temporary_authorizations_with_options (authority, subject, options, cancellable, call_sync_cb, data);
+  call_sync_block (data);
+  ret = polkit_authority_revoke_temporary_authorizations_with_options_finish (authority, data->res, error);
+  call_sync_free (data);
+
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 /**
  * polkit_authority_revoke_temporary_authorization_by_id:
  * @authority: A #PolkitAuthority.
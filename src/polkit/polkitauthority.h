@@ -68,6 +68,11 @@ GList                     *polkit_authority_enumerate_actions_sync (PolkitAuthor
                                                                     GCancellable    *cancellable,
                                                                     GError         **error);
 
+GList                     *polkit_authority_enumerate_actions_with_options_sync (PolkitAuthority *authority,
+                                                                                 GVariant        *options,
+                                                                                 GCancellable    *cancellable,
+                                                                                 GError         **error);
+
 PolkitAuthorizationResult *polkit_authority_check_authorization_sync (PolkitAuthority               *authority,
                                                                       PolkitSubject                 *subject,
                                                                       const gchar                   *action_id,
@@ -108,11 +113,23 @@ GList                     *polkit_authority_enumerate_temporary_authorizations_s
                                                                                      GCancellable        *cancellable,
                                                                                      GError             **error);
 
+GList                     *polkit_authority_enumerate_temporary_authorizations_with_options_sync (PolkitAuthority     *authority,
+                                                                                                  PolkitSubject       *subject,
+                                                                                                  GVariant            *options,
+                                                                                                  GCancellable        *cancellable,
+                                                                                                  GError             **error);
+
 gboolean                   polkit_authority_revoke_temporary_authorizations_sync (PolkitAuthority     *authority,
                                                                                   PolkitSubject       *subject,
                                                                                   GCancellable        *cancellable,
                                                                                   GError             **error);
 
+gboolean                   polkit_authority_revoke_temporary_authorizations_with_options_sync (PolkitAuthority     *authority,
+                                                                                               PolkitSubject       *subject,
+                                                                                               GVariant            *options,
+                                                                                               GCancellable        *cancellable,
+                                                                                               GError             **error);
+
 gboolean                   polkit_authority_revoke_temporary_authorization_by_id_sync (PolkitAuthority     *authority,
                                                                                        const gchar         *id,
                                                                                        GCancellable        *cancellable,
@@ -129,6 +146,16 @@ GList *                    polkit_authority_enumerate_actions_finish (PolkitAuth
                                                                       GAsyncResult    *res,
                                                                       GError         **error);
 
+void                       polkit_authority_enumerate_actions_with_options (PolkitAuthority     *authority,
+                                                                            GVariant            *options,
+                                                                            GCancellable        *cancellable,
+                                                                            GAsyncReadyCallback  callback,
+                                                                            gpointer             user_data);
+
+GList *                    polkit_authority_enumerate_actions_with_options_finish (PolkitAuthority *authority,
+                                                                                   GAsyncResult    *res,
+                                                                                   GError         **error);
+
 void                       polkit_authority_check_authorization (PolkitAuthority               *authority,
                                                                  PolkitSubject                 *subject,
                                                                  const gchar                   *action_id,
@@ -200,6 +227,17 @@ GList                     *polkit_authority_enumerate_temporary_authorizations_f
                                                                                        GAsyncResult    *res,
                                                                                        GError         **error);
 
+void                       polkit_authority_enumerate_temporary_authorizations_with_options (PolkitAuthority     *authority,
+                                                                                             PolkitSubject       *subject,
+                                                                                             GVariant            *options,
+                                                                                             GCancellable        *cancellable,
+                                                                                             GAsyncReadyCallback  callback,
+                                                                                             gpointer             user_data);
+
+GList                     *polkit_authority_enumerate_temporary_authorizations_with_options_finish (PolkitAuthority *authority,
+                                                                                                    GAsyncResult    *res,
+                                                                                                    GError         **error);
+
 void                       polkit_authority_revoke_temporary_authorizations (PolkitAuthority     *authority,
                                                                              PolkitSubject       *subject,
                                                                              GCancellable        *cancellable,
@@ -210,6 +248,17 @@ gboolean                   polkit_authority_revoke_temporary_authorizations_fini
                                                                                     GAsyncResult    *res,
                                                                                     GError         **error);
 
+void                       polkit_authority_revoke_temporary_authorizations_with_options (PolkitAuthority     *authority,
+                                                                                          PolkitSubject       *subject,
+                                                                                          GVariant            *options,
+                                                                                          GCancellable        *cancellable,
+                                                                                          GAsyncReadyCallback  callback,
+                                                                                          gpointer             user_data);
+
+gboolean                   polkit_authority_revoke_temporary_authorizations_with_options_finish (PolkitAuthority *authority,
+                                                                                                 GAsyncResult    *res,
+                                                                                                 GError         **error);
+
 void                       polkit_authority_revoke_temporary_authorization_by_id (PolkitAuthority     *authority,
                                                                                   const gchar         *id,
                                                                                   GCancellable        *cancellable,
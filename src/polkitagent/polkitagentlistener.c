@@ -65,7 +65,9 @@ typedef struct
   PolkitSubject *subject;
   gchar *object_path;
 
+  /* cookie -> AuthData, for requests that have been handed to the listener */
   GHashTable *cookie_to_pending_auth;
+  guint64 next_serial;
 
   GThread *thread;
   GError *thread_initialization_error;
@@ -74,9 +76,14 @@ typedef struct
   GMainLoop *thread_loop;
 } Server;
 
+static void server_cancel_pending_auths (Server *server);
+
 static void
 server_free (Server *server)
 {
+  if (server->cookie_to_pending_auth != NULL)
+    server_cancel_pending_auths (server);
+
   if (server->is_registered)
     {
       GError *error;
@@ -133,24 +140,31 @@ server_free (Server *server)
   g_free (server);
 }
 
+static const gchar *
+server_get_locale (void)
+{
+  const gchar *locale;
+
+  locale = g_getenv ("LANG");
+  if (locale == NULL)
+    locale = "en_US.UTF-8";
+
+  return locale;
+}
+
 static gboolean
 server_register (Server   *server,
                  GError  **error)
 {
   GError *local_error;
   gboolean ret;
-  const gchar *locale;
 
   ret = FALSE;
 
-  locale = g_getenv ("LANG");
-  if (locale == NULL)
-    locale = "en_US.UTF-8";
-
   local_error = NULL;
   if (!polkit_authority_register_authentication_agent_with_options_sync (server->authority,
                                                                          server->subject,
-                                                                         locale,
+                                                                         server_get_locale (),
                                                                          server->object_path,
                                                                          server->registration_options,
                                                                          NULL,
@@ -211,6 +225,18 @@ on_notify_authority_owner (GObject    *object,
   g_free (owner);
 }
 
+static void
+server_watch_authority (Server *server)
+{
+  /* the only use of this proxy is to re-register with the polkit daemon
+   * if it jumps off the bus and comes back (which is useful for debugging)
+   */
+  server->notify_owner_handler_id = g_signal_connect (server->authority,
+                                                      "notify::owner",
+                                                      G_CALLBACK (on_notify_authority_owner),
+                                                      server);
+}
+
 static gboolean
 server_init_sync (Server        *server,
                   GCancellable  *cancellable,
@@ -228,13 +254,7 @@ server_init_sync (Server        *server,
   if (server->authority == NULL)
     goto out;
 
-  /* the only use of this proxy is to re-register with the polkit daemon
-   * if it jumps off the bus and comes back (which is useful for debugging)
-   */
-  server->notify_owner_handler_id = g_signal_connect (server->authority,
-                                                      "notify::owner",
-                                                      G_CALLBACK (on_notify_authority_owner),
-                                                      server);
+  server_watch_authority (server);
 
   ret = TRUE;
 
@@ -243,10 +263,8 @@ server_init_sync (Server        *server,
 }
 
 static Server *
-server_new (PolkitSubject  *subject,
-            const gchar    *object_path,
-            GCancellable   *cancellable,
-            GError        **error)
+server_alloc (PolkitSubject  *subject,
+              const gchar    *object_path)
 {
   Server *server;
 
@@ -254,8 +272,22 @@ server_new (PolkitSubject  *subject,
   server->subject = g_object_ref (subject);
   server->object_path = object_path != NULL ? g_strdup (object_path) :
                                               g_strdup ("/org/freedesktop/PolicyKit1/AuthenticationAgent");
+  /* keys are owned by the AuthData values */
   server->cookie_to_pending_auth = g_hash_table_new (g_str_hash, g_str_equal);
 
+  return server;
+}
+
+static Server *
+server_new (PolkitSubject  *subject,
+            const gchar    *object_path,
+            GCancellable   *cancellable,
+            GError        **error)
+{
+  Server *server;
+
+  server = server_alloc (subject, object_path);
+
   if (!server_init_sync (server, cancellable, error))
     {
       server_free (server);
@@ -364,6 +396,67 @@ server_thread_func (gpointer user_data)
   return NULL;
 }
 
+static gboolean
+server_start (Server                   *server,
+              PolkitAgentRegisterFlags  flags,
+              GError                  **error)
+{
+  GDBusNodeInfo *node_info;
+  gboolean ret;
+
+  ret = FALSE;
+
+  node_info = g_dbus_node_info_new_for_xml (auth_agent_introspection_data, error);
+  if (node_info == NULL)
+    goto out;
+  server->interface_info = g_dbus_interface_info_ref (g_dbus_node_info_lookup_interface (node_info, "org.freedesktop.PolicyKit1.AuthenticationAgent"));
+  g_dbus_node_info_unref (node_info);
+
+  if (flags & POLKIT_AGENT_REGISTER_FLAGS_RUN_IN_THREAD)
+    {
+      server->thread = g_thread_create (server_thread_func,
+                                        server,
+                                        TRUE,
+                                        error);
+      if (server->thread == NULL)
+        goto out;
+
+      /* wait for the thread to export and object (TODO: probably use a condition variable instead) */
+      while (!server->thread_initialized)
+        g_thread_yield ();
+      if (server->thread_initialization_error != NULL)
+        {
+          g_propagate_error (error, server->thread_initialization_error);
+          server->thread_initialization_error = NULL;
+          g_thread_join (server->thread);
+          server->thread = NULL;
+          goto out;
+        }
+    }
+  else
+    {
+      if (!server_export_object (server, error))
+        goto out;
+    }
+
+  ret = TRUE;
+
+ out:
+  return ret;
+}
+
+/* Stops the thread started by server_start(), if any, and frees @server */
+static void
+server_stop_and_free (Server *server)
+{
+  if (server->thread != NULL)
+    {
+      g_main_loop_quit (server->thread_loop);
+      g_thread_join (server->thread);
+    }
+  server_free (server);
+}
+
 /**
  * polkit_agent_listener_register_with_options:
  * @listener: A #PolkitAgentListener.
@@ -391,7 +484,6 @@ polkit_agent_listener_register_with_options (PolkitAgentListener      *listener,
                                              GError                  **error)
 {
   Server *server;
-  GDBusNodeInfo *node_info;
 
   g_return_val_if_fail (POLKIT_AGENT_IS_LISTENER (listener), NULL);
   g_return_val_if_fail (POLKIT_IS_SUBJECT (subject), NULL);
@@ -406,62 +498,260 @@ polkit_agent_listener_register_with_options (PolkitAgentListener      *listener,
   if (server == NULL)
     goto out;
 
-  node_info = g_dbus_node_info_new_for_xml (auth_agent_introspection_data, error);
-  if (node_info == NULL)
+  server->listener = g_object_ref (listener);
+
+  server->registration_options = options != NULL ? g_variant_ref_sink (options) : NULL;
+
+  if (!server_start (server, flags, error))
     {
       server_free (server);
       server = NULL;
       goto out;
     }
-  server->interface_info = g_dbus_interface_info_ref (g_dbus_node_info_lookup_interface (node_info, "org.freedesktop.PolicyKit1.AuthenticationAgent"));
-  g_dbus_node_info_unref (node_info);
 
-  server->listener = g_object_ref (listener);
+  if (!server_register (server, error))
+    {
+      server_stop_and_free (server);
+      server = NULL;
+      goto out;
+    }
 
-  server->registration_options = options != NULL ? g_variant_ref_sink (options) : NULL;
+ out:
+  return server;
+}
 
-  if (flags & POLKIT_AGENT_REGISTER_FLAGS_RUN_IN_THREAD)
+/* ---------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  Server *server;
+  PolkitAgentRegisterFlags flags;
+  GCancellable *cancellable;
+  gboolean started;
+} RegisterData;
+
+static void
+register_data_free (RegisterData *data)
+{
+  if (data->server != NULL)
     {
-      server->thread = g_thread_create (server_thread_func,
-                                        server,
-                                        TRUE,
-                                        error);
-      if (server->thread == NULL)
-        {
-          server_free (server);
-          server = NULL;
-          goto out;
-        }
+      if (data->started)
+        server_stop_and_free (data->server);
+      else
+        server_free (data->server);
+    }
+  if (data->cancellable != NULL)
+    g_object_unref (data->cancellable);
+  g_free (data);
+}
 
-      /* wait for the thread to export and object (TODO: probably use a condition variable instead) */
-      while (!server->thread_initialized)
-        g_thread_yield ();
-      if (server->thread_initialization_error != NULL)
-        {
-          g_propagate_error (error, server->thread_initialization_error);
-          server->thread_initialization_error = NULL;
-          g_thread_join (server->thread);
-          server_free (server);
-          goto out;
-        }
+static void
+register_complete_with_error (GSimpleAsyncResult *simple,
+                              GError             *error)
+{
+  g_simple_async_result_take_error (simple, error);
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+}
+
+static void
+on_register_agent_cb (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (user_data);
+  RegisterData *data;
+  GError *error;
+
+  data = g_simple_async_result_get_op_res_gpointer (simple);
+
+  error = NULL;
+  if (!polkit_authority_register_authentication_agent_with_options_finish (POLKIT_AUTHORITY (source_object),
+                                                                           res,
+                                                                           &error))
+    {
+      register_complete_with_error (simple, error);
+      goto out;
     }
-  else
+
+  data->server->is_registered = TRUE;
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+
+ out:
+  ;
+}
+
+static void
+on_register_authority_cb (GObject      *source_object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (user_data);
+  RegisterData *data;
+  Server *server;
+  GError *error;
+
+  data = g_simple_async_result_get_op_res_gpointer (simple);
+  server = data->server;
+
+  error = NULL;
+  server->authority = polkit_authority_get_finish (res, &error);
+  if (server->authority == NULL)
     {
-      if (!server_export_object (server, error))
-        {
-          server_free (server);
-          server = NULL;
-          goto out;
-        }
+      register_complete_with_error (simple, error);
+      goto out;
     }
 
-  if (!server_register (server, error))
+  server_watch_authority (server);
+
+  if (!server_start (server, data->flags, &error))
     {
-      server_free (server);
-      server = NULL;
+      register_complete_with_error (simple, error);
+      goto out;
+    }
+  data->started = TRUE;
+
+  polkit_authority_register_authentication_agent_with_options (server->authority,
+                                                               server->subject,
+                                                               server_get_locale (),
+                                                               server->object_path,
+                                                               server->registration_options,
+                                                               data->cancellable,
+                                                               on_register_agent_cb,
+                                                               simple);
+
+ out:
+  ;
+}
+
+static void
+on_register_bus_cb (GObject      *source_object,
+                    GAsyncResult *res,
+                    gpointer      user_data)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (user_data);
+  RegisterData *data;
+  GError *error;
+
+  data = g_simple_async_result_get_op_res_gpointer (simple);
+
+  error = NULL;
+  data->server->system_bus = g_bus_get_finish (res, &error);
+  if (data->server->system_bus == NULL)
+    {
+      register_complete_with_error (simple, error);
       goto out;
     }
 
+  polkit_authority_get_async (data->cancellable,
+                              on_register_authority_cb,
+                              simple);
+
+ out:
+  ;
+}
+
+/**
+ * polkit_agent_listener_register_with_options_async:
+ * @listener: A #PolkitAgentListener.
+ * @flags: A set of flags from the #PolkitAgentRegisterFlags enumeration.
+ * @subject: The subject to become an authentication agent for, typically a #PolkitUnixSession object.
+ * @object_path: The D-Bus object path to use for the authentication agent or %NULL for the default object path.
+ * @options: (allow-none): A #GVariant with options or %NULL.
+ * @cancellable: A #GCancellable or %NULL.
+ * @callback: A #GAsyncReadyCallback to call when the request is satisfied.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronous version of polkit_agent_listener_register_with_options().
+ *
+ * Since none of the steps block the calling thread, other requests
+ * to the PolicyKit daemon can be issued while registration is in
+ * progress. Requests sent on the same message bus connection after
+ * this function returns are handled by the daemon after the
+ * registration request.
+ *
+ * When the operation is finished, @callback will be invoked in the
+ * <link linkend="g-main-context-push-thread-default">thread-default
+ * main loop</link> of the thread you are calling this method
+ * from. You can then call
+ * polkit_agent_listener_register_with_options_finish() to get the
+ * result of the operation.
+ */
+void
+polkit_agent_listener_register_with_options_async (PolkitAgentListener      *listener,
+                                                   PolkitAgentRegisterFlags  flags,
+                                                   PolkitSubject            *subject,
+                                                   const gchar              *object_path,
+                                                   GVariant                 *options,
+                                                   GCancellable             *cancellable,
+                                                   GAsyncReadyCallback       callback,
+                                                   gpointer                  user_data)
+{
+  GSimpleAsyncResult *simple;
+  RegisterData *data;
+
+  g_return_if_fail (POLKIT_AGENT_IS_LISTENER (listener));
+  g_return_if_fail (POLKIT_IS_SUBJECT (subject));
+  g_return_if_fail (object_path == NULL || g_variant_is_object_path (object_path));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  data = g_new0 (RegisterData, 1);
+  data->server = server_alloc (subject, object_path);
+  data->server->listener = g_object_ref (listener);
+  data->server->registration_options = options != NULL ? g_variant_ref_sink (options) : NULL;
+  data->flags = flags;
+  data->cancellable = cancellable != NULL ? g_object_ref (cancellable) : NULL;
+
+  simple = g_simple_async_result_new (G_OBJECT (listener),
+                                      callback,
+                                      user_data,
+                                      polkit_agent_listener_register_with_options_async);
+  g_simple_async_result_set_op_res_gpointer (simple, data, (GDestroyNotify) register_data_free);
+
+  g_bus_get (G_BUS_TYPE_SYSTEM,
+             cancellable,
+             on_register_bus_cb,
+             simple);
+}
+
+/**
+ * polkit_agent_listener_register_with_options_finish:
+ * @listener: A #PolkitAgentListener.
+ * @res: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to polkit_agent_listener_register_with_options_async().
+ * @error: Return location for error.
+ *
+ * Finishes registering an authentication agent.
+ *
+ * Returns: (transfer full): %NULL if @error is set, otherwise a
+ * registration handle that can be used with
+ * polkit_agent_listener_unregister().
+ */
+gpointer
+polkit_agent_listener_register_with_options_finish (PolkitAgentListener  *listener,
+                                                    GAsyncResult         *res,
+                                                    GError              **error)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (res);
+  RegisterData *data;
+  Server *server;
+
+  g_return_val_if_fail (POLKIT_AGENT_IS_LISTENER (listener), NULL);
+  g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (simple) == polkit_agent_listener_register_with_options_async);
+
+  server = NULL;
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    goto out;
+
+  /* steal the server from the result */
+  data = g_simple_async_result_get_op_res_gpointer (simple);
+  server = data->server;
+  data->server = NULL;
+
  out:
   return server;
 }
@@ -517,12 +807,7 @@ void
 polkit_agent_listener_unregister (gpointer registration_handle)
 {
   Server *server = registration_handle;
-  if (server->thread != NULL)
-    {
-      g_main_loop_quit (server->thread_loop);
-      g_thread_join (server->thread);
-    }
-  server_free (server);
+  server_stop_and_free (server);
 }
 
 
@@ -572,11 +857,47 @@ polkit_agent_register_listener (PolkitAgentListener  *listener,
 typedef struct
 {
   gchar *cookie;
+  guint64 serial;
   GHashTable *cookie_to_pending_auth;
   GDBusMethodInvocation *invocation;
   GCancellable *cancellable;
 } AuthData;
 
+static gint
+auth_data_compare_serial (gconstpointer a,
+                          gconstpointer b)
+{
+  const AuthData *data_a = a;
+  const AuthData *data_b = b;
+
+  if (data_a->serial < data_b->serial)
+    return -1;
+  else if (data_a->serial > data_b->serial)
+    return 1;
+  return 0;
+}
+
+/* Cancels all authentication requests still being handled by the
+ * listener, in the order they were received. The requests themselves
+ * are completed (and removed from the hash table) when the listener
+ * invokes their callbacks.
+ */
+static void
+server_cancel_pending_auths (Server *server)
+{
+  GList *pending;
+  GList *l;
+
+  pending = g_hash_table_get_values (server->cookie_to_pending_auth);
+  pending = g_list_sort (pending, auth_data_compare_serial);
+  for (l = pending; l != NULL; l = l->next)
+    {
+      AuthData *data = l->data;
+      g_cancellable_cancel (data->cancellable);
+    }
+  g_list_free (pending);
+}
+
 static void
 auth_data_free (AuthData *data)
 {
@@ -647,6 +968,20 @@ auth_agent_handle_begin_authentication (Server                 *server,
 
   details = polkit_details_new_for_gvariant (details_gvariant);
 
+  /* Requests are handed to the listener as soon as they arrive so one
+   * slow dialog doesn't hold up the others; the cookie is what keeps
+   * them apart so it must be unique among the pending requests.
+   */
+  if (g_hash_table_lookup (server->cookie_to_pending_auth, cookie) != NULL)
+    {
+      g_dbus_method_invocation_return_error (invocation,
+                                             POLKIT_ERROR,
+                                             POLKIT_ERROR_FAILED,
+                                             "An authentication request for cookie '%s' is already pending",
+                                             cookie);
+      goto out;
+    }
+
   g_variant_iter_init (&iter, identities_gvariant);
   n = 0;
   while ((child = g_variant_iter_next_value (&iter)) != NULL)
@@ -673,10 +1008,11 @@ auth_agent_handle_begin_authentication (Server                 *server,
   data = g_new0 (AuthData, 1);
   data->cookie_to_pending_auth = g_hash_table_ref (server->cookie_to_pending_auth);
   data->cookie = g_strdup (cookie);
+  data->serial = server->next_serial++;
   data->invocation = g_object_ref (invocation);
   data->cancellable = g_cancellable_new ();
 
-  g_hash_table_insert (server->cookie_to_pending_auth, (gpointer) cookie, data);
+  g_hash_table_insert (server->cookie_to_pending_auth, data->cookie, data);
 
   polkit_agent_listener_initiate_authentication (server->listener,
                                                  action_id,
@@ -771,6 +1107,11 @@ polkit_agent_listener_class_init (PolkitAgentListenerClass *klass)
  * invoked in the <link
  * linkend="g-main-context-push-thread-default">thread-default main
  * loop</link> of the thread that this method is called from.
+ *
+ * Note that this method may be called again, with a different
+ * @cookie, before @callback has been invoked for a previous
+ * request. Each request has its own @cancellable and requests may
+ * be completed in any order.
  */
 void
 polkit_agent_listener_initiate_authentication (PolkitAgentListener  *listener,
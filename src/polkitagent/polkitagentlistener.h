@@ -142,6 +142,19 @@ gpointer  polkit_agent_listener_register_with_options           (PolkitAgentList
                                                                  GCancellable             *cancellable,
                                                                  GError                  **error);
 
+void      polkit_agent_listener_register_with_options_async     (PolkitAgentListener      *listener,
+                                                                 PolkitAgentRegisterFlags  flags,
+                                                                 PolkitSubject            *subject,
+                                                                 const gchar              *object_path,
+                                                                 GVariant                 *options,
+                                                                 GCancellable             *cancellable,
+                                                                 GAsyncReadyCallback       callback,
+                                                                 gpointer                  user_data);
+
+gpointer  polkit_agent_listener_register_with_options_finish    (PolkitAgentListener      *listener,
+                                                                 GAsyncResult             *res,
+                                                                 GError                  **error);
+
 void      polkit_agent_listener_unregister                      (gpointer                  registration_handle);
 
 G_END_DECLS
@@ -55,6 +55,8 @@
 #include <stdio.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <glib-unix.h>
+#include <gio/gunixinputstream.h>
 #include <gio/gunixoutputstream.h>
 #include <pwd.h>
 
@@ -88,13 +90,17 @@ struct _PolkitAgentSession
 
   gchar *cookie;
   PolkitIdentity *identity;
+  gchar *helper_path;
 
   GOutputStream *child_stdin;
-  int child_stdout;
+  GInputStream *child_stdout;
   GPid child_pid;
 
+  /* output from the helper that doesn't form a complete line yet */
+  GString *child_stdout_buffer;
+
   GSource *child_stdout_watch_source;
-  GIOChannel *child_stdout_channel;
+  GSource *child_watch_source;
 
   gboolean success;
   gboolean helper_is_running;
@@ -111,7 +117,8 @@ enum
 {
   PROP_0,
   PROP_IDENTITY,
-  PROP_COOKIE
+  PROP_COOKIE,
+  PROP_HELPER_PATH
 };
 
 enum
@@ -130,7 +137,6 @@ G_DEFINE_TYPE (PolkitAgentSession, polkit_agent_session, G_TYPE_OBJECT);
 static void
 polkit_agent_session_init (PolkitAgentSession *session)
 {
-  session->child_stdout = -1;
 }
 
 static void kill_helper (PolkitAgentSession *session);
@@ -146,6 +152,7 @@ polkit_agent_session_finalize (GObject *object)
   kill_helper (session);
 
   g_free (session->cookie);
+  g_free (session->helper_path);
   if (session->identity != NULL)
     g_object_unref (session->identity);
 
@@ -171,6 +178,10 @@ polkit_agent_session_get_property (GObject     *object,
       g_value_set_string (value, session->cookie);
       break;
 
+    case PROP_HELPER_PATH:
+      g_value_set_string (value, session->helper_path);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -195,6 +206,10 @@ polkit_agent_session_set_property (GObject      *object,
       session->cookie = g_value_dup_string (value);
       break;
 
+    case PROP_HELPER_PATH:
+      session->helper_path = g_value_dup_string (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -246,6 +261,25 @@ polkit_agent_session_class_init (PolkitAgentSessionClass *klass)
                                                         G_PARAM_STATIC_BLURB |
                                                         G_PARAM_STATIC_NICK));
 
+  /**
+   * PolkitAgentSession:helper-path:
+   *
+   * The path of the authentication helper to run or %NULL to use the
+   * helper that polkit was installed with. This is only useful for
+   * testing.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_HELPER_PATH,
+                                   g_param_spec_string ("helper-path",
+                                                        "Helper Path",
+                                                        "The path of the authentication helper",
+                                                        NULL,
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_READWRITE |
+                                                        G_PARAM_STATIC_NAME |
+                                                        G_PARAM_STATIC_BLURB |
+                                                        G_PARAM_STATIC_NICK));
+
   /**
    * PolkitAgentSession::request:
    * @session: A #PolkitAgentSession.
@@ -361,6 +395,35 @@ polkit_agent_session_new (PolkitIdentity *identity,
   return session;
 }
 
+static void
+on_killed_helper_exited (GPid     pid,
+                         gint     status,
+                         gpointer user_data)
+{
+  g_spawn_close_pid (pid);
+}
+
+static void
+on_helper_exited (GPid     pid,
+                  gint     status,
+                  gpointer user_data)
+{
+  PolkitAgentSession *session = POLKIT_AGENT_SESSION (user_data);
+
+  if (G_UNLIKELY (_show_debug ()))
+    g_print ("PolkitAgentSession: helper with pid %d exited\n", (gint) pid);
+
+  g_spawn_close_pid (pid);
+
+  /* The source is destroyed after this callback returns. The session is
+   * completed by the output of the helper (or the lack of it) so there
+   * is nothing else to do here.
+   */
+  g_source_unref (session->child_watch_source);
+  session->child_watch_source = NULL;
+  session->child_pid = 0;
+}
+
 static void
 kill_helper (PolkitAgentSession *session)
 {
@@ -369,10 +432,19 @@ kill_helper (PolkitAgentSession *session)
 
   if (session->child_pid > 0)
     {
-      gint status;
       //g_debug ("Sending SIGTERM to helper");
       kill (session->child_pid, SIGTERM);
-      waitpid (session->child_pid, &status, 0);
+
+      /* Don't block waiting for the helper to exit; the child watch
+       * reaps it whenever that happens, even if the session is gone by
+       * then.
+       */
+      g_source_set_callback (session->child_watch_source,
+                             (GSourceFunc) on_killed_helper_exited,
+                             NULL,
+                             NULL);
+      g_source_unref (session->child_watch_source);
+      session->child_watch_source = NULL;
       session->child_pid = 0;
     }
 
@@ -383,16 +455,13 @@ kill_helper (PolkitAgentSession *session)
       session->child_stdout_watch_source = NULL;
     }
 
-  if (session->child_stdout_channel != NULL)
-    {
-      g_io_channel_unref (session->child_stdout_channel);
-      session->child_stdout_channel = NULL;
-    }
+  /* this closes the pipe */
+  g_clear_object (&session->child_stdout);
 
-  if (session->child_stdout != -1)
+  if (session->child_stdout_buffer != NULL)
     {
-      g_warn_if_fail (close (session->child_stdout) == 0);
-      session->child_stdout = -1;
+      g_string_free (session->child_stdout_buffer, TRUE);
+      session->child_stdout_buffer = NULL;
     }
 
   g_clear_object (&session->child_stdin);
@@ -418,47 +487,11 @@ complete_session (PolkitAgentSession *session,
     }
 }
 
-static gboolean
-io_watch_have_data (GIOChannel    *channel,
-                    GIOCondition   condition,
-                    gpointer       user_data)
+static void
+handle_line (PolkitAgentSession *session,
+             const gchar        *line)
 {
-  PolkitAgentSession *session = POLKIT_AGENT_SESSION (user_data);
-  gchar *line, *unescaped;
-  GError *error;
-
-  error = NULL;
-  line = NULL;
-  unescaped = NULL;
-
-  if (!session->helper_is_running)
-    {
-      g_warning ("in io_watch_have_data() but helper is not supposed to be running");
-
-      complete_session (session, FALSE);
-      goto out;
-    }
-
-  g_io_channel_read_line (channel,
-                          &line,
-                          NULL,
-                          NULL,
-                          &error);
-  if (error != NULL || line == NULL)
-    {
-      /* In case we get just G_IO_HUP, line is NULL but error is
-         unset.*/
-      g_warning ("Error reading line from helper: %s",
-                 error ? error->message : "nothing to read");
-      g_clear_error (&error);
-
-      complete_session (session, FALSE);
-      goto out;
-    }
-
-  /* remove terminator */
-  if (strlen (line) > 0 && line[strlen (line) - 1] == '\n')
-    line[strlen (line) - 1] = '\0';
+  gchar *unescaped;
 
   unescaped = g_strcompress (line);
 
@@ -505,17 +538,86 @@ io_watch_have_data (GIOChannel    *channel,
     {
       g_warning ("Unknown line '%s' from helper", line);
       complete_session (session, FALSE);
-      goto out;
     }
 
- out:
-  g_free (line);
   g_free (unescaped);
+}
+
+static gboolean
+on_child_stdout_readable (GObject  *pollable_stream,
+                          gpointer  user_data)
+{
+  PolkitAgentSession *session = POLKIT_AGENT_SESSION (user_data);
+  gchar buf[4096];
+  gssize num_read;
+  gboolean eof;
+  gchar *newline;
+  gchar *line;
+  GError *error;
+
+  /* signal handlers may drop the last reference to session */
+  g_object_ref (session);
+
+  eof = FALSE;
+
+  if (!session->helper_is_running)
+    {
+      g_warning ("in on_child_stdout_readable() but helper is not supposed to be running");
 
-  if (condition & (G_IO_ERR | G_IO_HUP))
-    complete_session (session, FALSE);
+      complete_session (session, FALSE);
+      goto out;
+    }
+
+  /* drain the pipe - it is non-blocking so this never stalls the main loop */
+  while (TRUE)
+    {
+      error = NULL;
+      num_read = g_pollable_input_stream_read_nonblocking (G_POLLABLE_INPUT_STREAM (pollable_stream),
+                                                           buf,
+                                                           sizeof buf,
+                                                           NULL,
+                                                           &error);
+      if (num_read < 0)
+        {
+          if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_WOULD_BLOCK))
+            {
+              g_error_free (error);
+              break;
+            }
+          g_warning ("Error reading line from helper: %s", error->message);
+          g_error_free (error);
+
+          complete_session (session, FALSE);
+          goto out;
+        }
+      else if (num_read == 0)
+        {
+          eof = TRUE;
+          break;
+        }
+      g_string_append_len (session->child_stdout_buffer, buf, num_read);
+    }
+
+  /* handle all complete lines; each of them may end the session */
+  while (session->helper_is_running &&
+         (newline = memchr (session->child_stdout_buffer->str, '\n', session->child_stdout_buffer->len)) != NULL)
+    {
+      line = g_strndup (session->child_stdout_buffer->str, newline - session->child_stdout_buffer->str);
+      g_string_erase (session->child_stdout_buffer, 0, newline - session->child_stdout_buffer->str + 1);
+      handle_line (session, line);
+      g_free (line);
+    }
+
+  if (session->helper_is_running && eof)
+    {
+      g_warning ("Error reading line from helper: nothing to read");
+      complete_session (session, FALSE);
+    }
+
+ out:
+  g_object_unref (session);
 
-  /* keep the IOChannel around */
+  /* kill_helper() destroys the source when the session is over */
   return TRUE;
 }
 
@@ -567,6 +669,8 @@ polkit_agent_session_initiate (PolkitAgentSession *session)
   gchar *helper_argv[3];
   struct passwd *passwd;
   int stdin_fd = -1;
+  int stdout_fd = -1;
+  const gchar *helper_path;
 
   g_return_if_fail (POLKIT_AGENT_IS_SESSION (session));
 
@@ -596,12 +700,14 @@ polkit_agent_session_initiate (PolkitAgentSession *session)
       goto error;
     }
 
-  helper_argv[0] = PACKAGE_PREFIX "/lib/polkit-1/polkit-agent-helper-1";
+  helper_path = session->helper_path;
+  if (helper_path == NULL)
+    helper_path = PACKAGE_PREFIX "/lib/polkit-1/polkit-agent-helper-1";
+
+  helper_argv[0] = (gchar *) helper_path;
   helper_argv[1] = passwd->pw_name;
   helper_argv[2] = NULL;
 
-  session->child_stdout = -1;
-
   error = NULL;
   if (!g_spawn_async_with_pipes (NULL,
                                  (char **) helper_argv,
@@ -612,7 +718,7 @@ polkit_agent_session_initiate (PolkitAgentSession *session)
                                  NULL,
                                  &session->child_pid,
                                  &stdin_fd,
-                                 &session->child_stdout,
+                                 &stdout_fd,
                                  NULL,
                                  &error))
     {
@@ -621,6 +727,10 @@ polkit_agent_session_initiate (PolkitAgentSession *session)
       goto error;
     }
 
+  session->child_watch_source = g_child_watch_source_new (session->child_pid);
+  g_source_set_callback (session->child_watch_source, (GSourceFunc) on_helper_exited, session, NULL);
+  g_source_attach (session->child_watch_source, g_main_context_get_thread_default ());
+
   if (G_UNLIKELY (_show_debug ()))
     g_print ("PolkitAgentSession: spawned helper with pid %d\n", (gint) session->child_pid);
 
@@ -631,13 +741,18 @@ polkit_agent_session_initiate (PolkitAgentSession *session)
                                     NULL, NULL, NULL);
   (void) g_output_stream_write_all (session->child_stdin, "\n", 1, NULL, NULL, NULL);
 
-  session->child_stdout_channel = g_io_channel_unix_new (session->child_stdout);
-  session->child_stdout_watch_source = g_io_create_watch (session->child_stdout_channel,
-                                                          G_IO_IN | G_IO_ERR | G_IO_HUP);
-  g_source_set_callback (session->child_stdout_watch_source, (GSourceFunc) io_watch_have_data, session, NULL);
+  if (!g_unix_set_fd_nonblocking (stdout_fd, TRUE, &error))
+    {
+      g_warning ("Cannot make pipe from helper non-blocking: %s", error->message);
+      g_clear_error (&error);
+    }
+  session->child_stdout = g_unix_input_stream_new (stdout_fd, TRUE);
+  session->child_stdout_buffer = g_string_new (NULL);
+  session->child_stdout_watch_source = g_pollable_input_stream_create_source (G_POLLABLE_INPUT_STREAM (session->child_stdout),
+                                                                              NULL);
+  g_source_set_callback (session->child_stdout_watch_source, (GSourceFunc) on_child_stdout_readable, session, NULL);
   g_source_attach (session->child_stdout_watch_source, g_main_context_get_thread_default ());
 
-
   session->success = FALSE;
 
   session->helper_is_running = TRUE;
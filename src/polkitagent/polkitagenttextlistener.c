@@ -61,9 +61,29 @@ struct _PolkitAgentTextListener
   gulong cancel_id;
   GCancellable *cancellable;
 
+  /* requests waiting for the active session to finish, in order of arrival */
+  GQueue pending;
+  GMainContext *context;
+
+  /* opened once in initable_init() and reused for every request */
   FILE *tty;
+
+  /* for measuring the time from construction to the first prompt */
+  gint64 creation_time;
+  gboolean shown_first_prompt;
 };
 
+typedef struct
+{
+  gchar *action_id;
+  gchar *message;
+  gchar *cookie;
+  GList *identities;
+  GCancellable *cancellable;
+  gulong cancel_id;
+  GSimpleAsyncResult *simple;
+} PendingAuth;
+
 typedef struct
 {
   PolkitAgentListenerClass parent_class;
@@ -89,15 +109,39 @@ static void initable_iface_init (GInitableIface *initable_iface);
 G_DEFINE_TYPE_WITH_CODE (PolkitAgentTextListener, polkit_agent_text_listener, POLKIT_AGENT_TYPE_LISTENER,
                          G_IMPLEMENT_INTERFACE (G_TYPE_INITABLE, initable_iface_init));
 
+static void
+pending_auth_free (PendingAuth *pending)
+{
+  if (pending->cancel_id != 0)
+    g_cancellable_disconnect (pending->cancellable, pending->cancel_id);
+  g_free (pending->action_id);
+  g_free (pending->message);
+  g_free (pending->cookie);
+  g_list_free_full (pending->identities, g_object_unref);
+  if (pending->cancellable != NULL)
+    g_object_unref (pending->cancellable);
+  if (pending->simple != NULL)
+    g_object_unref (pending->simple);
+  g_free (pending);
+}
+
 static void
 polkit_agent_text_listener_init (PolkitAgentTextListener *listener)
 {
+  g_queue_init (&listener->pending);
 }
 
 static void
 polkit_agent_text_listener_finalize (GObject *object)
 {
   PolkitAgentTextListener *listener = POLKIT_AGENT_TEXT_LISTENER (object);
+  PendingAuth *pending;
+
+  while ((pending = g_queue_pop_head (&listener->pending)) != NULL)
+    pending_auth_free (pending);
+
+  if (listener->context != NULL)
+    g_main_context_unref (listener->context);
 
   if (listener->tty != NULL)
     fclose (listener->tty);
@@ -183,6 +227,14 @@ initable_init (GInitable     *initable,
       goto out;
     }
 
+  /* Don't let stdio buffer the terminal - we don't want the response
+   * lingering in a buffer and output is flushed explicitly anyway.
+   * This has to happen before any I/O on the stream.
+   */
+  setbuf (listener->tty, NULL);
+
+  listener->creation_time = g_get_monotonic_time ();
+
   ret = TRUE;
 
  out:
@@ -197,6 +249,8 @@ initable_iface_init (GInitableIface *initable_iface)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static void schedule_process_pending (PolkitAgentTextListener *listener);
+
 static void
 on_completed (PolkitAgentSession *session,
               gboolean            gained_authorization,
@@ -204,12 +258,9 @@ on_completed (PolkitAgentSession *session,
 {
   PolkitAgentTextListener *listener = POLKIT_AGENT_TEXT_LISTENER (user_data);
 
-  fprintf (listener->tty, "\x1B[1;31m");
-  if (gained_authorization)
-    fprintf (listener->tty, "==== AUTHENTICATION COMPLETE ====\n");
-  else
-    fprintf (listener->tty, "==== AUTHENTICATION FAILED ====\n");
-  fprintf (listener->tty, "\x1B[0m");
+  fprintf (listener->tty,
+           "\x1B[1;31m==== AUTHENTICATION %s ====\n\x1B[0m",
+           gained_authorization ? "COMPLETE" : "FAILED");
   fflush (listener->tty);
 
   g_simple_async_result_complete_in_idle (listener->simple);
@@ -222,6 +273,9 @@ on_completed (PolkitAgentSession *session,
   listener->simple = NULL;
   listener->active_session = NULL;
   listener->cancel_id = 0;
+
+  if (!g_queue_is_empty (&listener->pending))
+    schedule_process_pending (listener);
 }
 
 static void
@@ -237,7 +291,12 @@ on_request (PolkitAgentSession *session,
   fprintf (listener->tty, "%s", request);
   fflush (listener->tty);
 
-  setbuf (listener->tty, NULL);
+  if (!listener->shown_first_prompt)
+    {
+      listener->shown_first_prompt = TRUE;
+      g_debug ("Time to first prompt: %" G_GINT64_FORMAT " usec",
+               g_get_monotonic_time () - listener->creation_time);
+    }
 
   /* TODO: We really ought to block SIGINT and STGSTP (and probably
    *       other signals too) so we can restore the terminal (since we
@@ -439,45 +498,21 @@ choose_identity (PolkitAgentTextListener *listener,
 
 
 static void
-polkit_agent_text_listener_initiate_authentication (PolkitAgentListener  *_listener,
-                                                    const gchar          *action_id,
-                                                    const gchar          *message,
-                                                    const gchar          *icon_name,
-                                                    PolkitDetails        *details,
-                                                    const gchar          *cookie,
-                                                    GList                *identities,
-                                                    GCancellable         *cancellable,
-                                                    GAsyncReadyCallback   callback,
-                                                    gpointer              user_data)
+start_authentication (PolkitAgentTextListener *listener,
+                      const gchar             *action_id,
+                      const gchar             *message,
+                      const gchar             *cookie,
+                      GList                   *identities,
+                      GCancellable            *cancellable,
+                      GSimpleAsyncResult      *simple)
 {
-  PolkitAgentTextListener *listener = POLKIT_AGENT_TEXT_LISTENER (_listener);
-  GSimpleAsyncResult *simple;
   PolkitIdentity *identity;
 
-  simple = g_simple_async_result_new (G_OBJECT (listener),
-                                      callback,
-                                      user_data,
-                                      polkit_agent_text_listener_initiate_authentication);
-  if (listener->active_session != NULL)
-    {
-      g_simple_async_result_set_error (simple,
-                                       POLKIT_ERROR,
-                                       POLKIT_ERROR_FAILED,
-                                       "An authentication session is already underway.");
-      g_simple_async_result_complete_in_idle (simple);
-      g_object_unref (simple);
-      goto out;
-    }
-
   g_assert (g_list_length (identities) >= 1);
 
-  fprintf (listener->tty, "\x1B[1;31m");
-  fprintf (listener->tty,
-           "==== AUTHENTICATING FOR %s ====\n",
-           action_id);
-  fprintf (listener->tty, "\x1B[0m");
   fprintf (listener->tty,
-           "%s\n",
+           "\x1B[1;31m==== AUTHENTICATING FOR %s ====\n\x1B[0m%s\n",
+           action_id,
            message);
 
   /* handle multiple identies by asking which one to use */
@@ -486,9 +521,7 @@ polkit_agent_text_listener_initiate_authentication (PolkitAgentListener  *_liste
       identity = choose_identity (listener, identities);
       if (identity == NULL)
         {
-          fprintf (listener->tty, "\x1B[1;31m");
-          fprintf (listener->tty, "==== AUTHENTICATION CANCELED ====\n");
-          fprintf (listener->tty, "\x1B[0m");
+          fprintf (listener->tty, "\x1B[1;31m==== AUTHENTICATION CANCELED ====\n\x1B[0m");
           fflush (listener->tty);
           g_simple_async_result_set_error (simple,
                                            POLKIT_ERROR,
@@ -541,6 +574,146 @@ polkit_agent_text_listener_initiate_authentication (PolkitAgentListener  *_liste
   ;
 }
 
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Only one request can use the terminal at a time so requests arriving
+ * while a session is active are queued and started in order of arrival
+ * once the terminal is free. A queued request that is cancelled is
+ * completed right away without ever touching the terminal.
+ */
+
+static gboolean
+process_pending_in_idle (gpointer user_data)
+{
+  PolkitAgentTextListener *listener = POLKIT_AGENT_TEXT_LISTENER (user_data);
+  PendingAuth *pending;
+  GList *l;
+  GList *next;
+
+  /* first complete all queued requests that have been cancelled */
+  for (l = listener->pending.head; l != NULL; l = next)
+    {
+      next = l->next;
+      pending = l->data;
+      if (g_cancellable_is_cancelled (pending->cancellable))
+        {
+          g_queue_delete_link (&listener->pending, l);
+          g_simple_async_result_set_error (pending->simple,
+                                           POLKIT_ERROR,
+                                           POLKIT_ERROR_CANCELLED,
+                                           "Authentication was cancelled.");
+          g_simple_async_result_complete (pending->simple);
+          pending_auth_free (pending);
+        }
+    }
+
+  if (listener->active_session != NULL)
+    goto out;
+
+  pending = g_queue_pop_head (&listener->pending);
+  if (pending == NULL)
+    goto out;
+
+  g_cancellable_disconnect (pending->cancellable, pending->cancel_id);
+  pending->cancel_id = 0;
+
+  /* start_authentication() takes ownership of the result */
+  start_authentication (listener,
+                        pending->action_id,
+                        pending->message,
+                        pending->cookie,
+                        pending->identities,
+                        pending->cancellable,
+                        pending->simple);
+  pending->simple = NULL;
+  pending_auth_free (pending);
+
+ out:
+  return FALSE; /* remove source */
+}
+
+static void
+schedule_process_pending (PolkitAgentTextListener *listener)
+{
+  GSource *source;
+
+  source = g_idle_source_new ();
+  g_source_set_callback (source,
+                         process_pending_in_idle,
+                         g_object_ref (listener),
+                         g_object_unref);
+  g_source_attach (source, listener->context);
+  g_source_unref (source);
+}
+
+static void
+on_pending_cancelled (GCancellable *cancellable,
+                      gpointer      user_data)
+{
+  PolkitAgentTextListener *listener = POLKIT_AGENT_TEXT_LISTENER (user_data);
+  /* can't disconnect from within the handler so complete the request in idle */
+  schedule_process_pending (listener);
+}
+
+static void
+polkit_agent_text_listener_initiate_authentication (PolkitAgentListener  *_listener,
+                                                    const gchar          *action_id,
+                                                    const gchar          *message,
+                                                    const gchar          *icon_name,
+                                                    PolkitDetails        *details,
+                                                    const gchar          *cookie,
+                                                    GList                *identities,
+                                                    GCancellable         *cancellable,
+                                                    GAsyncReadyCallback   callback,
+                                                    gpointer              user_data)
+{
+  PolkitAgentTextListener *listener = POLKIT_AGENT_TEXT_LISTENER (_listener);
+  GSimpleAsyncResult *simple;
+  PendingAuth *pending;
+
+  simple = g_simple_async_result_new (G_OBJECT (listener),
+                                      callback,
+                                      user_data,
+                                      polkit_agent_text_listener_initiate_authentication);
+
+  if (listener->context == NULL)
+    listener->context = g_main_context_ref_thread_default ();
+
+  if (g_cancellable_is_cancelled (cancellable))
+    {
+      g_simple_async_result_set_error (simple,
+                                       POLKIT_ERROR,
+                                       POLKIT_ERROR_CANCELLED,
+                                       "Authentication was cancelled.");
+      g_simple_async_result_complete_in_idle (simple);
+      g_object_unref (simple);
+      goto out;
+    }
+
+  if (listener->active_session == NULL && g_queue_is_empty (&listener->pending))
+    {
+      start_authentication (listener, action_id, message, cookie, identities, cancellable, simple);
+      goto out;
+    }
+
+  pending = g_new0 (PendingAuth, 1);
+  pending->action_id = g_strdup (action_id);
+  pending->message = g_strdup (message);
+  pending->cookie = g_strdup (cookie);
+  pending->identities = g_list_copy (identities);
+  g_list_foreach (pending->identities, (GFunc) g_object_ref, NULL);
+  pending->cancellable = g_object_ref (cancellable);
+  pending->simple = simple;
+  pending->cancel_id = g_cancellable_connect (cancellable,
+                                              G_CALLBACK (on_pending_cancelled),
+                                              listener,
+                                              NULL);
+  g_queue_push_tail (&listener->pending, pending);
+
+ out:
+  ;
+}
+
 static gboolean
 polkit_agent_text_listener_initiate_authentication_finish (PolkitAgentListener  *_listener,
                                                            GAsyncResult         *res,
@@ -82,6 +82,20 @@ polkit._deleteRules = function() {
     this._ruleFuncs = [];
 };
 
+polkit.cache = {
+    get: function(key) {
+        var json = polkit._cacheGet(String(key));
+        return json === undefined ? undefined : JSON.parse(json);
+    },
+
+    set: function(key, value, ttlSeconds) {
+        var json = JSON.stringify(value);
+        if (json === undefined)
+            throw new Error("polkit.cache.set: value cannot be serialized to JSON");
+        return polkit._cacheSet(String(key), json, Number(ttlSeconds));
+    }
+};
+
 polkit.Result = {
     NO              : "no",
     YES             : "yes",
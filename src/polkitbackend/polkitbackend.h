@@ -32,7 +32,11 @@
 #include <polkitbackend/polkitbackendtypes.h>
 #include <polkitbackend/polkitbackendauthority.h>
 #include <polkitbackend/polkitbackendinteractiveauthority.h>
+#include <polkitbackend/polkitbackendjsauthority.h>
 #include <polkitbackend/polkitbackendactionlookup.h>
+#include <polkitbackend/polkitbackendwatchdog.h>
+#include <polkitbackend/polkitbackendresolver.h>
+#include <polkitbackend/polkitbackendspawner.h>
 #undef _POLKIT_BACKEND_INSIDE_POLKIT_BACKEND_H
 
 #endif /* __POLKIT_BACKEND_H */
@@ -29,6 +29,7 @@
 #include <polkit/polkitprivate.h>
 
 #include "polkitbackendactionpool.h"
+#include "polkitbackendprivate.h"
 
 /* <internal>
  * SECTION:polkitbackendactionpool
@@ -74,7 +75,7 @@ parsed_action_free (ParsedAction *action)
   g_free (action);
 }
 
-static gboolean process_policy_file (PolkitBackendActionPool *pool,
+static gboolean process_policy_file (GHashTable *parsed_actions,
                                      const gchar *xml,
                                      GError **error);
 
@@ -83,6 +84,8 @@ static void ensure_file (PolkitBackendActionPool *pool,
 
 static void ensure_all_files (PolkitBackendActionPool *pool);
 
+static void finish_preload (PolkitBackendActionPool *pool);
+
 static const gchar *_localize (GHashTable *translations,
                                const gchar *untranslated,
                                const gchar *lang);
@@ -97,12 +100,24 @@ typedef struct
   /* maps from action_id to a ParsedAction struct */
   GHashTable *parsed_actions;
 
+  /* the keys of parsed_actions in strcmp() order or %NULL if it needs to be
+   * rebuilt - used for prefix lookups and paging through the actions
+   */
+  GPtrArray *sorted_action_ids;
+
   /* maps from URI of parsed file to nothing */
   GHashTable *parsed_files;
 
   /* is TRUE only when we've read all files */
   gboolean has_loaded_all_files;
 
+  /* incremented whenever the directory changes, so preloaded files can be discarded */
+  guint generation;
+
+  /* see polkit_backend_action_pool_preload() */
+  GThread *preload_thread;
+  gpointer preload_data;
+
 } PolkitBackendActionPoolPrivate;
 
 enum
@@ -150,12 +165,17 @@ polkit_backend_action_pool_finalize (GObject *object)
   pool = POLKIT_BACKEND_ACTION_POOL (object);
   priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
 
+  finish_preload (pool);
+
   if (priv->directory != NULL)
     g_object_unref (priv->directory);
 
   if (priv->dir_monitor != NULL)
     g_object_unref (priv->dir_monitor);
 
+  if (priv->sorted_action_ids != NULL)
+    g_ptr_array_unref (priv->sorted_action_ids);
+
   if (priv->parsed_actions != NULL)
     g_hash_table_unref (priv->parsed_actions);
 
@@ -189,6 +209,20 @@ polkit_backend_action_pool_get_property (GObject     *object,
     }
 }
 
+static void
+invalidate_sorted_action_ids (PolkitBackendActionPool *pool)
+{
+  PolkitBackendActionPoolPrivate *priv;
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  if (priv->sorted_action_ids != NULL)
+    {
+      g_ptr_array_unref (priv->sorted_action_ids);
+      priv->sorted_action_ids = NULL;
+    }
+}
+
 static void
 dir_monitor_changed (GFileMonitor     *monitor,
                      GFile            *file,
@@ -225,9 +259,11 @@ dir_monitor_changed (GFileMonitor     *monitor,
           //g_debug ("match");
 
           /* now throw away all caches */
+          invalidate_sorted_action_ids (pool);
           g_hash_table_remove_all (priv->parsed_files);
           g_hash_table_remove_all (priv->parsed_actions);
           priv->has_loaded_all_files = FALSE;
+          priv->generation++;
 
           g_signal_emit_by_name (pool, "changed");
         }
@@ -345,6 +381,60 @@ polkit_backend_action_pool_new (GFile *directory)
   return pool;
 }
 
+/* Actions are conventionally defined in a file named after a prefix of
+ * their id, e.g. org.freedesktop.policykit.exec in
+ * org.freedesktop.policykit.policy. Try those files first so the first
+ * check after startup doesn't have to parse every .policy file.
+ */
+static ParsedAction *
+lookup_action (PolkitBackendActionPool *pool,
+               const gchar             *action_id)
+{
+  PolkitBackendActionPoolPrivate *priv;
+  ParsedAction *ret;
+  gchar *prefix;
+  gchar *dot;
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  ret = g_hash_table_lookup (priv->parsed_actions, action_id);
+  if (ret != NULL || priv->has_loaded_all_files)
+    goto out;
+
+  if (strchr (action_id, '/') == NULL)
+    {
+      prefix = g_strdup (action_id);
+      do
+        {
+          gchar *name;
+          GFile *file;
+
+          name = g_strdup_printf ("%s.policy", prefix);
+          file = g_file_get_child (priv->directory, name);
+          if (g_file_query_exists (file, NULL))
+            ensure_file (pool, file);
+          g_object_unref (file);
+          g_free (name);
+
+          ret = g_hash_table_lookup (priv->parsed_actions, action_id);
+          dot = strrchr (prefix, '.');
+          if (dot != NULL)
+            *dot = '\0';
+        }
+      while (ret == NULL && dot != NULL);
+      g_free (prefix);
+
+      if (ret != NULL)
+        goto out;
+    }
+
+  ensure_all_files (pool);
+  ret = g_hash_table_lookup (priv->parsed_actions, action_id);
+
+ out:
+  return ret;
+}
+
 /**
  * polkit_backend_action_pool_get_action:
  * @pool: A #PolkitBackendActionPool.
@@ -371,12 +461,9 @@ polkit_backend_action_pool_get_action (PolkitBackendActionPool *pool,
 
   priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
 
-  /* TODO: just compute the name of the expected file and ensure it's parsed */
-  ensure_all_files (pool);
-
   ret = NULL;
 
-  parsed_action = g_hash_table_lookup (priv->parsed_actions, action_id);
+  parsed_action = lookup_action (pool, action_id);
   if (parsed_action == NULL)
     {
       g_warning ("Unknown action_id '%s'", action_id);
@@ -451,22 +538,242 @@ polkit_backend_action_pool_get_all_actions (PolkitBackendActionPool *pool,
   return ret;
 }
 
-/* ---------------------------------------------------------------------------------------------------- */
+static gint
+compare_action_ids (gconstpointer a,
+                    gconstpointer b)
+{
+  return strcmp (*((const gchar **) a), *((const gchar **) b));
+}
 
 static void
-ensure_file (PolkitBackendActionPool *pool,
-             GFile *file)
+ensure_sorted_action_ids (PolkitBackendActionPool *pool)
+{
+  PolkitBackendActionPoolPrivate *priv;
+  GHashTableIter hash_iter;
+  const gchar *action_id;
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  if (priv->sorted_action_ids != NULL)
+    goto out;
+
+  priv->sorted_action_ids = g_ptr_array_sized_new (g_hash_table_size (priv->parsed_actions));
+  g_hash_table_iter_init (&hash_iter, priv->parsed_actions);
+  while (g_hash_table_iter_next (&hash_iter, (gpointer) &action_id, NULL))
+    g_ptr_array_add (priv->sorted_action_ids, (gpointer) action_id);
+  g_ptr_array_sort (priv->sorted_action_ids, compare_action_ids);
+
+ out:
+  ;
+}
+
+/* returns the index of the first action id in @ids that is >= @key (or > @key if @exclusive) */
+static guint
+sorted_action_ids_lower_bound (GPtrArray   *ids,
+                               const gchar *key,
+                               gboolean     exclusive)
+{
+  guint lo;
+  guint hi;
+
+  lo = 0;
+  hi = ids->len;
+  while (lo < hi)
+    {
+      guint mid;
+      gint cmp;
+
+      mid = lo + (hi - lo) / 2;
+      cmp = strcmp (g_ptr_array_index (ids, mid), key);
+      if (cmp < 0 || (exclusive && cmp == 0))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+
+  return lo;
+}
+
+static gboolean
+parsed_action_has_annotations (ParsedAction *parsed_action,
+                               GHashTable   *annotations)
+{
+  GHashTableIter hash_iter;
+  const gchar *key;
+  const gchar *value;
+
+  if (annotations == NULL)
+    return TRUE;
+
+  g_hash_table_iter_init (&hash_iter, annotations);
+  while (g_hash_table_iter_next (&hash_iter, (gpointer) &key, (gpointer) &value))
+    {
+      if (g_strcmp0 (g_hash_table_lookup (parsed_action->annotations, key), value) != 0)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * polkit_backend_action_pool_get_actions:
+ * @pool: A #PolkitBackendActionPool.
+ * @locale: The locale to get descriptions for or %NULL for system locale.
+ * @action_id_prefix: Only return actions whose identifier starts with this string or %NULL.
+ * @annotations: A #GHashTable of annotations (string to string) that actions must have or %NULL.
+ * @start_after: Only return actions whose identifier sorts after this identifier or %NULL.
+ * @max_actions: Maximum number of actions to return or 0 for no limit.
+ *
+ * Like polkit_backend_action_pool_get_all_actions() but only returns
+ * the actions matching the given filters, sorted by action
+ * identifier. The filters are applied before any
+ * #PolkitActionDescription object is created. Use @start_after and
+ * @max_actions to page through the actions by passing the identifier
+ * of the last action returned by the previous call.
+ *
+ * Returns: A #GList of #PolkitActionDescription objects. This list
+ *          should be freed with g_list_free() after each element have
+ *          been unreffed with g_object_unref().
+ **/
+GList *
+polkit_backend_action_pool_get_actions (PolkitBackendActionPool *pool,
+                                        const gchar             *locale,
+                                        const gchar             *action_id_prefix,
+                                        GHashTable              *annotations,
+                                        const gchar             *start_after,
+                                        guint                    max_actions)
+{
+  GList *ret;
+  PolkitBackendActionPoolPrivate *priv;
+  guint num_actions;
+  guint n;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_ACTION_POOL (pool), NULL);
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  ensure_all_files (pool);
+  ensure_sorted_action_ids (pool);
+
+  ret = NULL;
+  num_actions = 0;
+
+  n = 0;
+  if (action_id_prefix != NULL)
+    n = sorted_action_ids_lower_bound (priv->sorted_action_ids, action_id_prefix, FALSE);
+  if (start_after != NULL)
+    n = MAX (n, sorted_action_ids_lower_bound (priv->sorted_action_ids, start_after, TRUE));
+
+  for (; n < priv->sorted_action_ids->len; n++)
+    {
+      const gchar *action_id;
+      ParsedAction *parsed_action;
+      PolkitActionDescription *action_desc;
+
+      if (max_actions > 0 && num_actions == max_actions)
+        break;
+
+      action_id = g_ptr_array_index (priv->sorted_action_ids, n);
+
+      /* the ids are sorted so there are no further matches */
+      if (action_id_prefix != NULL && !g_str_has_prefix (action_id, action_id_prefix))
+        break;
+
+      parsed_action = g_hash_table_lookup (priv->parsed_actions, action_id);
+      if (!parsed_action_has_annotations (parsed_action, annotations))
+        continue;
+
+      action_desc = polkit_backend_action_pool_get_action (pool,
+                                                           action_id,
+                                                           locale);
+      if (action_desc != NULL)
+        {
+          ret = g_list_prepend (ret, action_desc);
+          num_actions++;
+        }
+    }
+
+  ret = g_list_reverse (ret);
+
+  return ret;
+}
+
+/**
+ * polkit_backend_action_pool_get_memory_usage:
+ * @pool: A #PolkitBackendActionPool.
+ * @out_num_actions: (out) (allow-none): Return location for the number of parsed actions or %NULL.
+ *
+ * Estimates how much memory the parsed actions in @pool use. This
+ * doesn't load any files so it is 0 if no action has been looked up
+ * yet.
+ *
+ * Returns: The approximate number of bytes used.
+ */
+gsize
+polkit_backend_action_pool_get_memory_usage (PolkitBackendActionPool *pool,
+                                             guint                   *out_num_actions)
 {
   PolkitBackendActionPoolPrivate *priv;
+  GHashTableIter hash_iter;
+  const gchar *key;
+  ParsedAction *parsed_action;
+  gsize ret;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_ACTION_POOL (pool), 0);
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  ret = POLKIT_BACKEND_HASH_TABLE_SIZE;
+  g_hash_table_iter_init (&hash_iter, priv->parsed_actions);
+  while (g_hash_table_iter_next (&hash_iter, (gpointer) &key, (gpointer) &parsed_action))
+    {
+      ret += POLKIT_BACKEND_HASH_NODE_SIZE + polkit_backend_string_size (key);
+      ret += sizeof (ParsedAction);
+      ret += polkit_backend_string_size (parsed_action->vendor_name);
+      ret += polkit_backend_string_size (parsed_action->vendor_url);
+      ret += polkit_backend_string_size (parsed_action->icon_name);
+      ret += polkit_backend_string_size (parsed_action->description);
+      ret += polkit_backend_string_size (parsed_action->message);
+      ret += polkit_backend_string_hash_table_size (parsed_action->localized_description);
+      ret += polkit_backend_string_hash_table_size (parsed_action->localized_message);
+      ret += polkit_backend_string_hash_table_size (parsed_action->annotations);
+    }
+
+  ret += POLKIT_BACKEND_HASH_TABLE_SIZE;
+  g_hash_table_iter_init (&hash_iter, priv->parsed_files);
+  while (g_hash_table_iter_next (&hash_iter, (gpointer) &key, NULL))
+    ret += POLKIT_BACKEND_HASH_NODE_SIZE + polkit_backend_string_size (key);
+
+  if (priv->sorted_action_ids != NULL)
+    ret += priv->sorted_action_ids->len * sizeof (gpointer);
+
+  if (out_num_actions != NULL)
+    *out_num_actions = g_hash_table_size (priv->parsed_actions);
+
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Parses @file into @parsed_actions and adds it to @parsed_files unless
+ * it is already there. This doesn't touch the pool so it can be used by
+ * the preload thread.
+ */
+static gboolean
+load_file (GHashTable *parsed_actions,
+           GHashTable *parsed_files,
+           GFile      *file)
+{
+  gboolean ret;
   gchar *contents;
   GError *error;
   gchar *uri;
 
-  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+  ret = FALSE;
 
   uri = g_file_get_uri (file);
 
-  if (g_hash_table_lookup (priv->parsed_files, uri) != NULL)
+  if (g_hash_table_lookup_extended (parsed_files, uri, NULL, NULL))
     goto out;
 
   error = NULL;
@@ -478,14 +785,16 @@ ensure_file (PolkitBackendActionPool *pool,
                              &error))
     {
       g_warning ("Error loading file with URI '%s': %s", uri, error->message);
+      g_error_free (error);
       goto out;
     }
 
-  if (!process_policy_file (pool,
+  if (!process_policy_file (parsed_actions,
                             contents,
                             &error))
     {
       g_warning ("Error parsing file with URI '%s': %s", uri, error->message);
+      g_error_free (error);
       g_free (contents);
       goto out;
     }
@@ -493,30 +802,46 @@ ensure_file (PolkitBackendActionPool *pool,
   g_free (contents);
 
   /* steal uri */
-  g_hash_table_insert (priv->parsed_files, uri, NULL);
+  g_hash_table_insert (parsed_files, uri, NULL);
   uri = NULL;
 
+  ret = TRUE;
+
  out:
   g_free (uri);
+  return ret;
 }
 
 static void
-ensure_all_files (PolkitBackendActionPool *pool)
+ensure_file (PolkitBackendActionPool *pool,
+             GFile *file)
 {
   PolkitBackendActionPoolPrivate *priv;
-  GFileEnumerator *e;
-  GFileInfo *file_info;
-  GError *error;
 
   priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
 
-  e = NULL;
+  /* parsing may replace (and free) existing actions */
+  if (load_file (priv->parsed_actions, priv->parsed_files, file))
+    invalidate_sorted_action_ids (pool);
+}
 
-  if (priv->has_loaded_all_files)
-    goto out;
+/* Parses all files in @directory not in @parsed_files yet. Like
+ * load_file(), this can be used by the preload thread.
+ */
+static gboolean
+load_all_files (GFile      *directory,
+                GHashTable *parsed_actions,
+                GHashTable *parsed_files)
+{
+  gboolean ret;
+  GFileEnumerator *e;
+  GFileInfo *file_info;
+  GError *error;
+
+  ret = FALSE;
 
   error = NULL;
-  e = g_file_enumerate_children (priv->directory,
+  e = g_file_enumerate_children (directory,
                                  "standard::name",
                                  G_FILE_QUERY_INFO_NONE,
                                  NULL,
@@ -524,6 +849,7 @@ ensure_all_files (PolkitBackendActionPool *pool)
   if (error != NULL)
     {
       g_warning ("Error enumerating files: %s", error->message);
+      g_error_free (error);
       goto out;
     }
 
@@ -537,9 +863,9 @@ ensure_all_files (PolkitBackendActionPool *pool)
         {
           GFile *file;
 
-          file = g_file_get_child (priv->directory, name);
+          file = g_file_get_child (directory, name);
 
-          ensure_file (pool, file);
+          load_file (parsed_actions, parsed_files, file);
 
           g_object_unref (file);
         }
@@ -548,12 +874,178 @@ ensure_all_files (PolkitBackendActionPool *pool)
 
     } /* for all files */
 
-  priv->has_loaded_all_files = TRUE;
+  ret = TRUE;
 
  out:
 
   if (e != NULL)
     g_object_unref (e);
+  return ret;
+}
+
+static void
+ensure_all_files (PolkitBackendActionPool *pool)
+{
+  PolkitBackendActionPoolPrivate *priv;
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  finish_preload (pool);
+
+  if (priv->has_loaded_all_files)
+    return;
+
+  invalidate_sorted_action_ids (pool);
+  if (load_all_files (priv->directory, priv->parsed_actions, priv->parsed_files))
+    priv->has_loaded_all_files = TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  GFile *directory;
+  guint generation;
+  GHashTable *parsed_actions;
+  GHashTable *parsed_files;
+  gboolean loaded;
+  GSimpleAsyncResult *simple;
+} PreloadData;
+
+static void
+preload_data_free (PreloadData *data)
+{
+  g_object_unref (data->directory);
+  g_hash_table_unref (data->parsed_actions);
+  g_hash_table_unref (data->parsed_files);
+  g_free (data);
+}
+
+static gpointer
+preload_thread_func (gpointer user_data)
+{
+  PreloadData *data = user_data;
+  GSimpleAsyncResult *simple;
+
+  data->loaded = load_all_files (data->directory, data->parsed_actions, data->parsed_files);
+
+  /* the data is owned by the pool from here on */
+  simple = data->simple;
+  data->simple = NULL;
+  g_simple_async_result_complete_in_idle (simple);
+  g_object_unref (simple);
+
+  return NULL;
+}
+
+/* Waits for the preload thread, if any, and uses what it parsed unless
+ * the directory has changed in the meantime
+ */
+static void
+finish_preload (PolkitBackendActionPool *pool)
+{
+  PolkitBackendActionPoolPrivate *priv;
+  PreloadData *data;
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  if (priv->preload_thread == NULL)
+    return;
+
+  g_thread_join (priv->preload_thread);
+  priv->preload_thread = NULL;
+  data = priv->preload_data;
+  priv->preload_data = NULL;
+
+  if (data->loaded && data->generation == priv->generation && !priv->has_loaded_all_files)
+    {
+      invalidate_sorted_action_ids (pool);
+      g_hash_table_unref (priv->parsed_actions);
+      priv->parsed_actions = g_hash_table_ref (data->parsed_actions);
+      g_hash_table_unref (priv->parsed_files);
+      priv->parsed_files = g_hash_table_ref (data->parsed_files);
+      priv->has_loaded_all_files = TRUE;
+    }
+
+  preload_data_free (data);
+}
+
+/**
+ * polkit_backend_action_pool_preload:
+ * @pool: A #PolkitBackendActionPool.
+ * @callback: A #GAsyncReadyCallback to call when done.
+ * @user_data: Data to pass to @callback.
+ *
+ * Starts parsing all action description files in a separate thread,
+ * e.g. while the daemon is connecting to the message bus. The thread
+ * parses into tables of its own which replace those of @pool once it
+ * is done. Until then, looking up an action still only parses the
+ * file named after it, if any; only lookups that need all files wait
+ * for the thread instead of parsing them again.
+ *
+ * When done, @callback is invoked in the thread-default main loop of
+ * the thread you are calling this method from. You can then call
+ * polkit_backend_action_pool_preload_finish() to get the result.
+ */
+void
+polkit_backend_action_pool_preload (PolkitBackendActionPool *pool,
+                                    GAsyncReadyCallback      callback,
+                                    gpointer                 user_data)
+{
+  PolkitBackendActionPoolPrivate *priv;
+  PreloadData *data;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_ACTION_POOL (pool));
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  g_return_if_fail (priv->preload_thread == NULL);
+
+  data = g_new0 (PreloadData, 1);
+  data->directory = g_file_dup (priv->directory);
+  data->generation = priv->generation;
+  data->parsed_actions = g_hash_table_new_full (g_str_hash,
+                                                g_str_equal,
+                                                g_free,
+                                                (GDestroyNotify) parsed_action_free);
+  data->parsed_files = g_hash_table_new_full (g_str_hash,
+                                              g_str_equal,
+                                              g_free,
+                                              NULL);
+  data->simple = g_simple_async_result_new (G_OBJECT (pool),
+                                            callback,
+                                            user_data,
+                                            polkit_backend_action_pool_preload);
+
+  priv->preload_data = data;
+  priv->preload_thread = g_thread_new ("preload-actions", preload_thread_func, data);
+}
+
+/**
+ * polkit_backend_action_pool_preload_finish:
+ * @pool: A #PolkitBackendActionPool.
+ * @res: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to polkit_backend_action_pool_preload().
+ * @out_num_actions: (out) (allow-none): Return location for the number of actions or %NULL.
+ *
+ * Finishes preloading action description files.
+ */
+void
+polkit_backend_action_pool_preload_finish (PolkitBackendActionPool *pool,
+                                           GAsyncResult            *res,
+                                           guint                   *out_num_actions)
+{
+  PolkitBackendActionPoolPrivate *priv;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_ACTION_POOL (pool));
+  g_return_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res));
+  g_warn_if_fail (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (res)) == polkit_backend_action_pool_preload);
+
+  priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pool);
+
+  finish_preload (pool);
+
+  if (out_num_actions != NULL)
+    *out_num_actions = g_hash_table_size (priv->parsed_actions);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -611,7 +1103,8 @@ typedef struct {
   char *annotate_key;
   GHashTable *annotations;
 
-  PolkitBackendActionPool *pool;
+  /* where parsed actions go, maps from action_id to a ParsedAction struct */
+  GHashTable *parsed_actions;
 } ParserData;
 
 static void
@@ -969,9 +1462,6 @@ _end (void *data, const char *el)
         gchar *vendor_url;
         gchar *icon_name;
         ParsedAction *action;
-        PolkitBackendActionPoolPrivate *priv;
-
-        priv = POLKIT_BACKEND_ACTION_POOL_GET_PRIVATE (pd->pool);
 
         vendor = pd->vendor;
         if (vendor == NULL)
@@ -1000,7 +1490,8 @@ _end (void *data, const char *el)
         action->implicit_authorization_inactive = pd->implicit_authorization_inactive;
         action->implicit_authorization_active = pd->implicit_authorization_active;
 
-        g_hash_table_insert (priv->parsed_actions, g_strdup (pd->action_id),
+        /* may replace (and free) an existing key */
+        g_hash_table_insert (pd->parsed_actions, g_strdup (pd->action_id),
                              action);
 
         /* we steal these hash tables */
@@ -1037,7 +1528,7 @@ error:
 /* ---------------------------------------------------------------------------------------------------- */
 
 static gboolean
-process_policy_file (PolkitBackendActionPool *pool,
+process_policy_file (GHashTable *parsed_actions,
                      const gchar *xml,
                      GError **error)
 {
@@ -1047,7 +1538,7 @@ process_policy_file (PolkitBackendActionPool *pool,
   /* clear parser data */
   memset (&pd, 0, sizeof (ParserData));
 
-  pd.pool = pool;
+  pd.parsed_actions = parsed_actions;
 
   pd.parser = XML_ParserCreate (NULL);
   pd.stack_depth = 0;
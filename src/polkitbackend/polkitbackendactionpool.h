@@ -67,11 +67,27 @@ GType                    polkit_backend_action_pool_get_type         (void) G_GN
 PolkitBackendActionPool *polkit_backend_action_pool_new              (GFile *directory);
 GList                   *polkit_backend_action_pool_get_all_actions  (PolkitBackendActionPool  *pool,
                                                                       const gchar              *locale);
+GList                   *polkit_backend_action_pool_get_actions      (PolkitBackendActionPool  *pool,
+                                                                      const gchar              *locale,
+                                                                      const gchar              *action_id_prefix,
+                                                                      GHashTable               *annotations,
+                                                                      const gchar              *start_after,
+                                                                      guint                     max_actions);
 
 PolkitActionDescription *polkit_backend_action_pool_get_action       (PolkitBackendActionPool  *pool,
                                                                       const gchar              *action_id,
                                                                       const gchar              *locale);
 
+gsize                    polkit_backend_action_pool_get_memory_usage (PolkitBackendActionPool  *pool,
+                                                                      guint                    *out_num_actions);
+
+void                     polkit_backend_action_pool_preload          (PolkitBackendActionPool  *pool,
+                                                                      GAsyncReadyCallback       callback,
+                                                                      gpointer                  user_data);
+void                     polkit_backend_action_pool_preload_finish   (PolkitBackendActionPool  *pool,
+                                                                      GAsyncResult             *res,
+                                                                      guint                    *out_num_actions);
+
 G_END_DECLS
 
 #endif /* __POLKIT_BACKEND_ACTION_POOL_H */
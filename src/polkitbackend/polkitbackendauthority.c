@@ -25,14 +25,20 @@
 #include <string.h>
 #include <syslog.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <unistd.h>
 
 #include <polkit/polkit.h>
 #include <polkit/polkitprivate.h>
 
 #include "polkitbackendauthority.h"
 #include "polkitbackendjsauthority.h"
+#include "polkitbackendfakesessions.h"
 
 #include "polkitbackendprivate.h"
+#include "polkitbackendprobes.h"
+#include "polkitbackendwatchdog.h"
+#include "polkitbackendresolver.h"
 
 /**
  * SECTION:polkitbackendauthority
@@ -139,9 +145,13 @@ polkit_backend_authority_get_features (PolkitBackendAuthority *authority)
  * @authority: A #PolkitBackendAuthority.
  * @caller: The system bus name that initiated the query.
  * @locale: The locale to retrieve descriptions for.
+ * @options: A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
  * @error: Return location for error or %NULL.
  *
- * Retrieves all registered actions.
+ * Retrieves all registered actions. If @options is not %NULL, only
+ * the actions matching the filters in it are returned, see the
+ * <literal>EnumerateActionsWithOptions</literal> D-Bus method for the
+ * supported keys.
  *
  * Returns: A list of #PolkitActionDescription objects or %NULL if @error is set. The returned list
  * should be freed with g_list_free() after each element have been freed with g_object_unref().
@@ -150,6 +160,7 @@ GList *
 polkit_backend_authority_enumerate_actions (PolkitBackendAuthority   *authority,
                                             PolkitSubject            *caller,
                                             const gchar              *locale,
+                                            GVariant                 *options,
                                             GError                  **error)
 {
   PolkitBackendAuthorityClass *klass;
@@ -167,7 +178,7 @@ polkit_backend_authority_enumerate_actions (PolkitBackendAuthority   *authority,
     }
   else
     {
-      return klass->enumerate_actions (authority, caller, locale, error);
+      return klass->enumerate_actions (authority, caller, locale, options, error);
     }
 }
 
@@ -386,9 +397,13 @@ polkit_backend_authority_authentication_agent_response (PolkitBackendAuthority
  * @authority: A #PolkitBackendAuthority.
  * @caller: The system bus name that initiated the query.
  * @subject: The subject to get temporary authorizations for.
+ * @options: A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
  * @error: Return location for error.
  *
- * Gets temporary authorizations for @subject.
+ * Gets temporary authorizations for @subject. If @options is not
+ * %NULL, only authorizations matching the filters in it are returned,
+ * see the <literal>EnumerateTemporaryAuthorizationsWithOptions</literal>
+ * D-Bus method for the supported keys.
  *
  * Returns: A list of #PolkitTemporaryAuthorization objects or %NULL if @error is set. The returned list
  * should be freed with g_list_free() after each element have been freed with g_object_unref().
@@ -397,6 +412,7 @@ GList *
 polkit_backend_authority_enumerate_temporary_authorizations (PolkitBackendAuthority   *authority,
                                                              PolkitSubject            *caller,
                                                              PolkitSubject            *subject,
+                                                             GVariant                 *options,
                                                              GError                  **error)
 {
   PolkitBackendAuthorityClass *klass;
@@ -413,7 +429,7 @@ polkit_backend_authority_enumerate_temporary_authorizations (PolkitBackendAuthor
     }
   else
     {
-      return klass->enumerate_temporary_authorizations (authority, caller, subject, error);
+      return klass->enumerate_temporary_authorizations (authority, caller, subject, options, error);
     }
 }
 
@@ -422,9 +438,11 @@ polkit_backend_authority_enumerate_temporary_authorizations (PolkitBackendAuthor
  * @authority: A #PolkitBackendAuthority.
  * @caller: The system bus name that initiated the query.
  * @subject: The subject to revoke temporary authorizations for.
+ * @options: A #GVariant of type <literal>a{sv}</literal> with filters or %NULL.
  * @error: Return location for error.
  *
- * Revokes temporary authorizations for @subject.
+ * Revokes temporary authorizations for @subject. If @options is not
+ * %NULL, only authorizations matching the filters in it are revoked.
  *
  * Returns: %TRUE if the operation succeeded, %FALSE if @error is set.
  **/
@@ -432,6 +450,7 @@ gboolean
 polkit_backend_authority_revoke_temporary_authorizations (PolkitBackendAuthority   *authority,
                                                           PolkitSubject            *caller,
                                                           PolkitSubject            *subject,
+                                                          GVariant                 *options,
                                                           GError                  **error)
 {
   PolkitBackendAuthorityClass *klass;
@@ -448,7 +467,7 @@ polkit_backend_authority_revoke_temporary_authorizations (PolkitBackendAuthority
     }
   else
     {
-      return klass->revoke_temporary_authorizations (authority, caller, subject, error);
+      return klass->revoke_temporary_authorizations (authority, caller, subject, options, error);
     }
 }
 
@@ -487,11 +506,63 @@ polkit_backend_authority_revoke_temporary_authorization_by_id (PolkitBackendAuth
     }
 }
 
+/**
+ * polkit_backend_authority_add_statistics:
+ * @authority: A #PolkitBackendAuthority.
+ * @builder: A #GVariantBuilder for a dictionary of type <literal>a{sv}</literal>.
+ *
+ * Adds statistics about @authority to @builder, such as the
+ * approximate number of bytes used by each subsystem. This is what
+ * the GetStatistics() D-Bus method returns and is intended for
+ * debugging and benchmarking.
+ **/
+void
+polkit_backend_authority_add_statistics (PolkitBackendAuthority *authority,
+                                         GVariantBuilder        *builder)
+{
+  PolkitBackendAuthorityClass *klass;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_AUTHORITY (authority));
+  g_return_if_fail (builder != NULL);
+
+  klass = POLKIT_BACKEND_AUTHORITY_GET_CLASS (authority);
+
+  if (klass->add_statistics != NULL)
+    klass->add_statistics (authority, builder);
+}
+
+/**
+ * polkit_backend_authority_get_idle_time:
+ * @authority: A #PolkitBackendAuthority.
+ *
+ * Gets for how long @authority has not handled any request while not
+ * holding state that would be lost if polkitd exited, such as
+ * registered authentication agents or temporary authorizations. This
+ * is used by polkitd to exit when it is not needed.
+ *
+ * Returns: The idle time in microseconds or -1 if @authority is busy.
+ **/
+gint64
+polkit_backend_authority_get_idle_time (PolkitBackendAuthority *authority)
+{
+  PolkitBackendAuthorityClass *klass;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_AUTHORITY (authority), -1);
+
+  klass = POLKIT_BACKEND_AUTHORITY_GET_CLASS (authority);
+
+  if (klass->get_idle_time == NULL)
+    return -1;
+
+  return klass->get_idle_time (authority);
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 typedef struct
 {
   guint authority_registration_id;
+  guint statistics_registration_id;
 
   GDBusNodeInfo *introspection_info;
 
@@ -514,6 +585,9 @@ server_free (Server *server)
   if (server->authority_registration_id > 0)
     g_dbus_connection_unregister_object (server->connection, server->authority_registration_id);
 
+  if (server->statistics_registration_id > 0)
+    g_dbus_connection_unregister_object (server->connection, server->statistics_registration_id);
+
   if (server->connection != NULL)
     g_object_unref (server->connection);
 
@@ -559,6 +633,11 @@ static const gchar *server_introspection_data =
   "      <arg type='s' name='locale' direction='in'/>"
   "      <arg type='a(ssssssuuua{ss})' name='action_descriptions' direction='out'/>"
   "    </method>"
+  "    <method name='EnumerateActionsWithOptions'>"
+  "      <arg type='s' name='locale' direction='in'/>"
+  "      <arg type='a{sv}' name='options' direction='in'/>"
+  "      <arg type='a(ssssssuuua{ss})' name='action_descriptions' direction='out'/>"
+  "    </method>"
   "    <method name='CheckAuthorization'>"
   "      <arg type='(sa{sv})' name='subject' direction='in'/>"
   "      <arg type='s' name='action_id' direction='in'/>"
@@ -598,9 +677,18 @@ static const gchar *server_introspection_data =
   "      <arg type='(sa{sv})' name='subject' direction='in'/>"
   "      <arg type='a(ss(sa{sv})tt)' name='temporary_authorizations' direction='out'/>"
   "    </method>"
+  "    <method name='EnumerateTemporaryAuthorizationsWithOptions'>"
+  "      <arg type='(sa{sv})' name='subject' direction='in'/>"
+  "      <arg type='a{sv}' name='options' direction='in'/>"
+  "      <arg type='a(ss(sa{sv})tt)' name='temporary_authorizations' direction='out'/>"
+  "    </method>"
   "    <method name='RevokeTemporaryAuthorizations'>"
   "      <arg type='(sa{sv})' name='subject' direction='in'/>"
   "    </method>"
+  "    <method name='RevokeTemporaryAuthorizationsWithOptions'>"
+  "      <arg type='(sa{sv})' name='subject' direction='in'/>"
+  "      <arg type='a{sv}' name='options' direction='in'/>"
+  "    </method>"
   "    <method name='RevokeTemporaryAuthorizationById'>"
   "      <arg type='s' name='id' direction='in'/>"
   "    </method>"
@@ -609,6 +697,12 @@ static const gchar *server_introspection_data =
   "    <property type='s' name='BackendVersion' access='read'/>"
   "    <property type='u' name='BackendFeatures' access='read'/>"
   "  </interface>"
+  /* For debugging and benchmarking polkitd, not a stable interface */
+  "  <interface name='org.freedesktop.PolicyKit1.Statistics'>"
+  "    <method name='GetStatistics'>"
+  "      <arg type='a{sv}' name='statistics' direction='out'/>"
+  "    </method>"
+  "  </interface>"
   "</node>";
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -624,15 +718,22 @@ server_handle_enumerate_actions (Server                 *server,
   GList *actions;
   GList *l;
   const gchar *locale;
+  GVariant *options;
 
   actions = NULL;
+  options = NULL;
 
-  g_variant_get (parameters, "(&s)", &locale);
+  /* also handles EnumerateActionsWithOptions */
+  if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("(sa{sv})")))
+    g_variant_get (parameters, "(&s@a{sv})", &locale, &options);
+  else
+    g_variant_get (parameters, "(&s)", &locale);
 
   error = NULL;
   actions = polkit_backend_authority_enumerate_actions (server->authority,
                                                         caller,
                                                         locale,
+                                                        options,
                                                         &error);
   if (error != NULL)
     {
@@ -654,6 +755,8 @@ server_handle_enumerate_actions (Server                 *server,
   g_dbus_method_invocation_return_value (invocation, g_variant_new ("(a(ssssssuuua{ss}))", &builder));
 
  out:
+  if (options != NULL)
+    g_variant_unref (options);
   g_list_foreach (actions, (GFunc) g_object_unref, NULL);
   g_list_free (actions);
 }
@@ -704,12 +807,20 @@ check_auth_cb (GObject      *source_object,
 
   if (error != NULL)
     {
+      POLKIT_PROBE4 (check_authorization__reply,
+                     g_dbus_method_invocation_get_sender (data->invocation),
+                     FALSE, FALSE, error->message);
       g_dbus_method_invocation_return_gerror (data->invocation, error);
       g_error_free (error);
     }
   else
     {
       GVariant *value;
+      POLKIT_PROBE4 (check_authorization__reply,
+                     g_dbus_method_invocation_get_sender (data->invocation),
+                     polkit_authorization_result_get_is_authorized (result),
+                     polkit_authorization_result_get_is_challenge (result),
+                     NULL);
       value = polkit_authorization_result_to_gvariant (result);
       g_variant_ref_sink (value);
       g_dbus_method_invocation_return_value (data->invocation, g_variant_new ("(@(bba{ss}))", value));
@@ -746,6 +857,11 @@ server_handle_check_authorization (Server                 *server,
                  &flags,
                  &cancellation_id);
 
+  POLKIT_PROBE3 (check_authorization__request,
+                 g_dbus_method_invocation_get_sender (invocation),
+                 action_id,
+                 flags);
+
   error = NULL;
   subject = polkit_subject_new_for_gvariant (subject_gvariant, &error);
   if (subject == NULL)
@@ -1122,15 +1238,24 @@ server_handle_enumerate_temporary_authorizations (Server                 *server
   GVariant *subject_gvariant;
   GError *error;
   PolkitSubject *subject;
+  GVariant *options;
   GList *authorizations;
   GList *l;
   GVariantBuilder builder;
 
   subject = NULL;
-
-  g_variant_get (parameters,
-                 "(@(sa{sv}))",
-                 &subject_gvariant);
+  options = NULL;
+
+  /* also handles the WithOptions variant of the method */
+  if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("((sa{sv})a{sv})")))
+    g_variant_get (parameters,
+                   "(@(sa{sv})@a{sv})",
+                   &subject_gvariant,
+                   &options);
+  else
+    g_variant_get (parameters,
+                   "(@(sa{sv}))",
+                   &subject_gvariant);
 
   error = NULL;
   subject = polkit_subject_new_for_gvariant (subject_gvariant, &error);
@@ -1146,6 +1271,7 @@ server_handle_enumerate_temporary_authorizations (Server                 *server
   authorizations = polkit_backend_authority_enumerate_temporary_authorizations (server->authority,
                                                                                 caller,
                                                                                 subject,
+                                                                                options,
                                                                                 &error);
   if (error != NULL)
     {
@@ -1169,6 +1295,9 @@ server_handle_enumerate_temporary_authorizations (Server                 *server
   g_dbus_method_invocation_return_value (invocation, g_variant_new ("(a(ss(sa{sv})tt))", &builder));
 
  out:
+  g_variant_unref (subject_gvariant);
+  if (options != NULL)
+    g_variant_unref (options);
   if (subject != NULL)
     g_object_unref (subject);
 }
@@ -1184,12 +1313,21 @@ server_handle_revoke_temporary_authorizations (Server                 *server,
   GVariant *subject_gvariant;
   GError *error;
   PolkitSubject *subject;
+  GVariant *options;
 
   subject = NULL;
-
-  g_variant_get (parameters,
-                 "(@(sa{sv}))",
-                 &subject_gvariant);
+  options = NULL;
+
+  /* also handles the WithOptions variant of the method */
+  if (g_variant_is_of_type (parameters, G_VARIANT_TYPE ("((sa{sv})a{sv})")))
+    g_variant_get (parameters,
+                   "(@(sa{sv})@a{sv})",
+                   &subject_gvariant,
+                   &options);
+  else
+    g_variant_get (parameters,
+                   "(@(sa{sv}))",
+                   &subject_gvariant);
 
   error = NULL;
   subject = polkit_subject_new_for_gvariant (subject_gvariant, &error);
@@ -1205,6 +1343,7 @@ server_handle_revoke_temporary_authorizations (Server                 *server,
   if (!polkit_backend_authority_revoke_temporary_authorizations (server->authority,
                                                                  caller,
                                                                  subject,
+                                                                 options,
                                                                  &error))
     {
       g_dbus_method_invocation_return_gerror (invocation, error);
@@ -1215,6 +1354,9 @@ server_handle_revoke_temporary_authorizations (Server                 *server,
   g_dbus_method_invocation_return_value (invocation, g_variant_new ("()"));
 
  out:
+  g_variant_unref (subject_gvariant);
+  if (options != NULL)
+    g_variant_unref (options);
   if (subject != NULL)
     g_object_unref (subject);
 }
@@ -1268,7 +1410,10 @@ server_handle_method_call (GDBusConnection        *connection,
 
   caller = polkit_system_bus_name_new (g_dbus_method_invocation_get_sender (invocation));
 
-  if (g_strcmp0 (method_name, "EnumerateActions") == 0)
+  polkit_backend_watchdog_set_activity (method_name, sender, NULL);
+
+  if (g_strcmp0 (method_name, "EnumerateActions") == 0 ||
+      g_strcmp0 (method_name, "EnumerateActionsWithOptions") == 0)
     server_handle_enumerate_actions (server, parameters, caller, invocation);
   else if (g_strcmp0 (method_name, "CheckAuthorization") == 0)
     server_handle_check_authorization (server, parameters, caller, invocation);
@@ -1284,15 +1429,87 @@ server_handle_method_call (GDBusConnection        *connection,
     server_handle_authentication_agent_response (server, parameters, caller, invocation);
   else if (g_strcmp0 (method_name, "AuthenticationAgentResponse2") == 0)
     server_handle_authentication_agent_response2 (server, parameters, caller, invocation);
-  else if (g_strcmp0 (method_name, "EnumerateTemporaryAuthorizations") == 0)
+  else if (g_strcmp0 (method_name, "EnumerateTemporaryAuthorizations") == 0 ||
+           g_strcmp0 (method_name, "EnumerateTemporaryAuthorizationsWithOptions") == 0)
     server_handle_enumerate_temporary_authorizations (server, parameters, caller, invocation);
-  else if (g_strcmp0 (method_name, "RevokeTemporaryAuthorizations") == 0)
+  else if (g_strcmp0 (method_name, "RevokeTemporaryAuthorizations") == 0 ||
+           g_strcmp0 (method_name, "RevokeTemporaryAuthorizationsWithOptions") == 0)
     server_handle_revoke_temporary_authorizations (server, parameters, caller, invocation);
   else if (g_strcmp0 (method_name, "RevokeTemporaryAuthorizationById") == 0)
     server_handle_revoke_temporary_authorization_by_id (server, parameters, caller, invocation);
   else
     g_assert_not_reached ();
 
+  polkit_backend_watchdog_clear_activity ();
+
+  g_object_unref (caller);
+}
+
+static void
+server_handle_get_statistics (Server                 *server,
+                              GVariant               *parameters,
+                              PolkitSubject          *caller,
+                              GDBusMethodInvocation  *invocation)
+{
+  GVariantBuilder builder;
+  guint threshold_msec;
+  guint64 num_stalls;
+  guint64 longest_stall_msec;
+  guint64 total_stall_msec;
+  guint64 num_lookups;
+  guint64 num_lookup_timeouts;
+  gchar *statm;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+  polkit_backend_watchdog_get_statistics (&threshold_msec,
+                                          &num_stalls,
+                                          &longest_stall_msec,
+                                          &total_stall_msec);
+  g_variant_builder_add (&builder, "{sv}", "watchdog-threshold-msec", g_variant_new_uint32 (threshold_msec));
+  g_variant_builder_add (&builder, "{sv}", "watchdog-stalls", g_variant_new_uint64 (num_stalls));
+  g_variant_builder_add (&builder, "{sv}", "watchdog-longest-stall-msec", g_variant_new_uint64 (longest_stall_msec));
+  g_variant_builder_add (&builder, "{sv}", "watchdog-total-stall-msec", g_variant_new_uint64 (total_stall_msec));
+
+  polkit_backend_resolver_get_statistics (&num_lookups, &num_lookup_timeouts);
+  g_variant_builder_add (&builder, "{sv}", "nss-lookups", g_variant_new_uint64 (num_lookups));
+  g_variant_builder_add (&builder, "{sv}", "nss-lookup-timeouts", g_variant_new_uint64 (num_lookup_timeouts));
+
+  /* to compare the estimates of the subsystems with */
+  if (g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL))
+    {
+      guint64 resident_pages;
+      if (sscanf (statm, "%*u %" G_GUINT64_FORMAT, &resident_pages) == 1)
+        g_variant_builder_add (&builder, "{sv}", "memory-resident-bytes",
+                               g_variant_new_uint64 (resident_pages * sysconf (_SC_PAGESIZE)));
+      g_free (statm);
+    }
+
+  polkit_backend_authority_add_statistics (server->authority, &builder);
+
+  g_dbus_method_invocation_return_value (invocation, g_variant_new ("(a{sv})", &builder));
+}
+
+static void
+server_handle_statistics_method_call (GDBusConnection        *connection,
+                                      const gchar            *sender,
+                                      const gchar            *object_path,
+                                      const gchar            *interface_name,
+                                      const gchar            *method_name,
+                                      GVariant               *parameters,
+                                      GDBusMethodInvocation  *invocation,
+                                      gpointer                user_data)
+{
+  Server *server = user_data;
+  PolkitSubject *caller;
+
+  caller = polkit_system_bus_name_new (g_dbus_method_invocation_get_sender (invocation));
+
+  if (g_strcmp0 (method_name, "GetStatistics") == 0)
+    server_handle_get_statistics (server, parameters, caller, invocation);
+  else
+    g_assert_not_reached ();
+
   g_object_unref (caller);
 }
 
@@ -1337,6 +1554,13 @@ static const GDBusInterfaceVTable server_vtable =
   NULL, /* server_handle_set_property */
 };
 
+static const GDBusInterfaceVTable server_statistics_vtable =
+{
+  server_handle_statistics_method_call,
+  NULL, /* server_handle_get_property */
+  NULL, /* server_handle_set_property */
+};
+
 /**
  * polkit_backend_authority_unregister:
  * @registration_id: A #gpointer obtained from polkit_backend_authority_register().
@@ -1392,6 +1616,18 @@ polkit_backend_authority_register (PolkitBackendAuthority   *authority,
       goto error;
     }
 
+  server->statistics_registration_id = g_dbus_connection_register_object (server->connection,
+                                                                          object_path,
+                                                                          g_dbus_node_info_lookup_interface (server->introspection_info, "org.freedesktop.PolicyKit1.Statistics"),
+                                                                          &server_statistics_vtable,
+                                                                          server,
+                                                                          NULL,
+                                                                          error);
+  if (server->statistics_registration_id == 0)
+    {
+      goto error;
+    }
+
   server->authority = g_object_ref (authority);
 
   server->authority_changed_id = g_signal_connect (server->authority,
@@ -1416,8 +1652,31 @@ polkit_backend_authority_register (PolkitBackendAuthority   *authority,
  */
 PolkitBackendAuthority *
 polkit_backend_authority_get (void)
+{
+  return polkit_backend_authority_get_for_dirs (NULL, NULL, NULL);
+}
+
+/**
+ * polkit_backend_authority_get_for_dirs:
+ * @actions_dir: (allow-none): Directory to load actions from or %NULL for the default.
+ * @rules_dirs: (allow-none): %NULL-terminated list of directories to load rules from or %NULL for the defaults.
+ * @fake_sessions_file: (allow-none): File describing sessions to use instead of the real ones or %NULL.
+ *
+ * Like polkit_backend_authority_get() but allows loading actions and
+ * rules from other directories than the system ones and tracking the
+ * sessions from @fake_sessions_file, see
+ * polkit_backend_fake_sessions_new_from_file(), e.g. for testing.
+ *
+ * Returns: A #PolkitBackendAuthority. Free with g_object_unref().
+ */
+PolkitBackendAuthority *
+polkit_backend_authority_get_for_dirs (const gchar         *actions_dir,
+                                       const gchar * const *rules_dirs,
+                                       const gchar         *fake_sessions_file)
 {
   PolkitBackendAuthority *authority;
+  PolkitBackendFakeSessions *fake_sessions;
+  GError *error;
 
   /* TODO: move to polkitd/main.c */
 
@@ -1433,7 +1692,30 @@ polkit_backend_authority_get (void)
            LOG_PID,
            LOG_AUTHPRIV); /* security/authorization messages (private) */
 
-  authority = POLKIT_BACKEND_AUTHORITY (g_object_new (POLKIT_BACKEND_TYPE_JS_AUTHORITY, NULL));
+  fake_sessions = NULL;
+  if (fake_sessions_file != NULL)
+    {
+      error = NULL;
+      fake_sessions = polkit_backend_fake_sessions_new_from_file (fake_sessions_file, &error);
+      if (fake_sessions == NULL)
+        {
+          g_printerr ("Error loading fake sessions from %s: %s\n", fake_sessions_file, error->message);
+          g_error_free (error);
+        }
+      else
+        {
+          g_print ("Using fake sessions from %s\n", fake_sessions_file);
+        }
+    }
+
+  authority = POLKIT_BACKEND_AUTHORITY (g_object_new (POLKIT_BACKEND_TYPE_JS_AUTHORITY,
+                                                      "actions-dir", actions_dir,
+                                                      "rules-dirs", rules_dirs,
+                                                      "fake-sessions", fake_sessions,
+                                                      NULL));
+
+  if (fake_sessions != NULL)
+    g_object_unref (fake_sessions);
 
   return authority;
 }
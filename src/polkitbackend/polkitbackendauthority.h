@@ -95,6 +95,12 @@ struct _PolkitBackendAuthority
  * authorization identified by id or %NULL if the backend doesn't support
  * the operation. See polkit_backend_authority_revoke_temporary_authorization_by_id()
  * for details.
+ * @add_statistics: Called to add statistics about the backend, e.g. how
+ * much memory it uses, or %NULL. See
+ * polkit_backend_authority_add_statistics() for details.
+ * @get_idle_time: Called to find out for how long the backend has been
+ * idle or %NULL. See polkit_backend_authority_get_idle_time() for
+ * details.
  *
  * Class structure for #PolkitBackendAuthority.
  */
@@ -115,6 +121,7 @@ struct _PolkitBackendAuthorityClass
   GList *(*enumerate_actions)  (PolkitBackendAuthority   *authority,
                                 PolkitSubject            *caller,
                                 const gchar              *locale,
+                                GVariant                 *options,
                                 GError                  **error);
 
   void (*check_authorization) (PolkitBackendAuthority        *authority,
@@ -155,11 +162,13 @@ struct _PolkitBackendAuthorityClass
   GList *(*enumerate_temporary_authorizations) (PolkitBackendAuthority   *authority,
                                                 PolkitSubject            *caller,
                                                 PolkitSubject            *subject,
+                                                GVariant                 *options,
                                                 GError                  **error);
 
   gboolean (*revoke_temporary_authorizations) (PolkitBackendAuthority   *authority,
                                                PolkitSubject            *caller,
                                                PolkitSubject            *subject,
+                                               GVariant                 *options,
                                                GError                  **error);
 
   gboolean (*revoke_temporary_authorization_by_id) (PolkitBackendAuthority   *authority,
@@ -167,6 +176,11 @@ struct _PolkitBackendAuthorityClass
                                                     const gchar              *id,
                                                     GError                  **error);
 
+  void (*add_statistics) (PolkitBackendAuthority   *authority,
+                          GVariantBuilder          *builder);
+
+  gint64 (*get_idle_time) (PolkitBackendAuthority  *authority);
+
   /*< private >*/
   /* Padding for future expansion */
   void (*_polkit_reserved1) (void);
@@ -199,8 +213,6 @@ struct _PolkitBackendAuthorityClass
   void (*_polkit_reserved28) (void);
   void (*_polkit_reserved29) (void);
   void (*_polkit_reserved30) (void);
-  void (*_polkit_reserved31) (void);
-  void (*_polkit_reserved32) (void);
 };
 
 GType    polkit_backend_authority_get_type (void) G_GNUC_CONST;
@@ -218,6 +230,7 @@ void     polkit_backend_authority_log (PolkitBackendAuthority *authority,
 GList   *polkit_backend_authority_enumerate_actions         (PolkitBackendAuthority    *authority,
                                                              PolkitSubject             *caller,
                                                              const gchar               *locale,
+                                                             GVariant                  *options,
                                                              GError                   **error);
 
 void     polkit_backend_authority_check_authorization       (PolkitBackendAuthority        *authority,
@@ -258,11 +271,13 @@ gboolean polkit_backend_authority_authentication_agent_response (PolkitBackendAu
 GList *polkit_backend_authority_enumerate_temporary_authorizations (PolkitBackendAuthority   *authority,
                                                                     PolkitSubject            *caller,
                                                                     PolkitSubject            *subject,
+                                                                    GVariant                 *options,
                                                                     GError                  **error);
 
 gboolean polkit_backend_authority_revoke_temporary_authorizations (PolkitBackendAuthority   *authority,
                                                                    PolkitSubject            *caller,
                                                                    PolkitSubject            *subject,
+                                                                   GVariant                 *options,
                                                                    GError                  **error);
 
 gboolean polkit_backend_authority_revoke_temporary_authorization_by_id (PolkitBackendAuthority   *authority,
@@ -270,10 +285,19 @@ gboolean polkit_backend_authority_revoke_temporary_authorization_by_id (PolkitBa
                                                                         const gchar              *id,
                                                                         GError                  **error);
 
+void     polkit_backend_authority_add_statistics (PolkitBackendAuthority *authority,
+                                                  GVariantBuilder        *builder);
+
+gint64   polkit_backend_authority_get_idle_time (PolkitBackendAuthority *authority);
+
 /* --- */
 
 PolkitBackendAuthority *polkit_backend_authority_get (void);
 
+PolkitBackendAuthority *polkit_backend_authority_get_for_dirs (const gchar         *actions_dir,
+                                                               const gchar * const *rules_dirs,
+                                                               const gchar         *fake_sessions_file);
+
 gpointer polkit_backend_authority_register (PolkitBackendAuthority   *authority,
                                             GDBusConnection          *connection,
                                             const gchar              *object_path,
@@ -0,0 +1,688 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include <string.h>
+
+#include <polkit/polkit.h>
+#include "polkitbackendfakesessions.h"
+
+/* <internal>
+ * SECTION:polkitbackendfakesessions
+ * @title: PolkitBackendFakeSessions
+ * @short_description: Stand-in for logind and ConsoleKit
+ *
+ * The #PolkitBackendFakeSessions class describes sessions, the seat
+ * they are on, whether they are active and which processes are in
+ * them, for tests and benchmarks running where neither logind nor
+ * ConsoleKit is available. #PolkitBackendSessionMonitor uses it
+ * instead of the real thing if one is passed in its
+ * #PolkitBackendSessionMonitor:fake-sessions property, which polkitd
+ * only does when started with <option>--fake-sessions</option>.
+ *
+ * Sessions can be set up with the API or from a key file, see
+ * polkit_backend_fake_sessions_new_from_file(). The
+ * #PolkitBackendFakeSessions::changed signal is emitted whenever
+ * something changes and, to stress whatever listens to it, at a
+ * configurable rate, see polkit_backend_fake_sessions_set_change_rate().
+ */
+
+typedef struct
+{
+  gchar *session_id;
+  guint32 uid;
+  gchar *seat;
+  gboolean is_active;
+} FakeSession;
+
+struct _PolkitBackendFakeSessions
+{
+  GObject parent_instance;
+
+  /* session id -> FakeSession */
+  GHashTable *sessions;
+
+  /* pid -> session id */
+  GHashTable *pid_to_session_id;
+
+  /* the session of processes not in pid_to_session_id, if any */
+  gchar *default_session_id;
+
+  gchar *path;
+  GFileMonitor *file_monitor;
+
+  guint change_rate;
+  guint change_timeout_id;
+  guint changes_per_timeout;
+  guint64 num_changes;
+};
+
+struct _PolkitBackendFakeSessionsClass
+{
+  GObjectClass parent_class;
+
+  void (*changed) (PolkitBackendFakeSessions *sessions);
+};
+
+enum
+{
+  CHANGED_SIGNAL,
+  LAST_SIGNAL,
+};
+
+static guint signals[LAST_SIGNAL] = {0};
+
+G_DEFINE_TYPE (PolkitBackendFakeSessions, polkit_backend_fake_sessions, G_TYPE_OBJECT);
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+fake_session_free (FakeSession *session)
+{
+  g_free (session->session_id);
+  g_free (session->seat);
+  g_free (session);
+}
+
+static void
+insert_session (PolkitBackendFakeSessions *sessions,
+                const gchar               *session_id,
+                guint32                    uid,
+                const gchar               *seat,
+                gboolean                   is_active)
+{
+  FakeSession *session;
+
+  session = g_new0 (FakeSession, 1);
+  session->session_id = g_strdup (session_id);
+  session->uid = uid;
+  session->seat = g_strdup (seat);
+  session->is_active = !!is_active;
+  g_hash_table_replace (sessions->sessions, session->session_id, session);
+}
+
+static void
+emit_changed (PolkitBackendFakeSessions *sessions)
+{
+  sessions->num_changes++;
+  g_signal_emit (sessions, signals[CHANGED_SIGNAL], 0);
+}
+
+static void
+polkit_backend_fake_sessions_init (PolkitBackendFakeSessions *sessions)
+{
+  sessions->sessions = g_hash_table_new_full (g_str_hash,
+                                              g_str_equal,
+                                              NULL,
+                                              (GDestroyNotify) fake_session_free);
+  sessions->pid_to_session_id = g_hash_table_new_full (g_direct_hash,
+                                                       g_direct_equal,
+                                                       NULL,
+                                                       g_free);
+}
+
+static void
+polkit_backend_fake_sessions_finalize (GObject *object)
+{
+  PolkitBackendFakeSessions *sessions = POLKIT_BACKEND_FAKE_SESSIONS (object);
+
+  if (sessions->change_timeout_id != 0)
+    g_source_remove (sessions->change_timeout_id);
+
+  if (sessions->file_monitor != NULL)
+    g_object_unref (sessions->file_monitor);
+
+  g_hash_table_unref (sessions->sessions);
+  g_hash_table_unref (sessions->pid_to_session_id);
+  g_free (sessions->default_session_id);
+  g_free (sessions->path);
+
+  if (G_OBJECT_CLASS (polkit_backend_fake_sessions_parent_class)->finalize != NULL)
+    G_OBJECT_CLASS (polkit_backend_fake_sessions_parent_class)->finalize (object);
+}
+
+static void
+polkit_backend_fake_sessions_class_init (PolkitBackendFakeSessionsClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->finalize = polkit_backend_fake_sessions_finalize;
+
+  /**
+   * PolkitBackendFakeSessions::changed:
+   * @sessions: A #PolkitBackendFakeSessions
+   *
+   * Emitted when something changes or a change is injected.
+   */
+  signals[CHANGED_SIGNAL] = g_signal_new ("changed",
+                                          POLKIT_BACKEND_TYPE_FAKE_SESSIONS,
+                                          G_SIGNAL_RUN_LAST,
+                                          G_STRUCT_OFFSET (PolkitBackendFakeSessionsClass, changed),
+                                          NULL,                   /* accumulator      */
+                                          NULL,                   /* accumulator data */
+                                          g_cclosure_marshal_VOID__VOID,
+                                          G_TYPE_NONE,
+                                          0);
+}
+
+/**
+ * polkit_backend_fake_sessions_new:
+ *
+ * Creates a new #PolkitBackendFakeSessions without any sessions.
+ *
+ * Returns: A #PolkitBackendFakeSessions. Free with g_object_unref().
+ */
+PolkitBackendFakeSessions *
+polkit_backend_fake_sessions_new (void)
+{
+  return POLKIT_BACKEND_FAKE_SESSIONS (g_object_new (POLKIT_BACKEND_TYPE_FAKE_SESSIONS, NULL));
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gboolean
+load_file (PolkitBackendFakeSessions  *sessions,
+           GError                    **error)
+{
+  GKeyFile *key_file;
+  gchar **groups;
+  gchar *default_session_id;
+  gint change_rate;
+  gboolean ret;
+  guint n;
+
+  ret = FALSE;
+  groups = NULL;
+  default_session_id = NULL;
+
+  key_file = g_key_file_new ();
+  if (!g_key_file_load_from_file (key_file, sessions->path, G_KEY_FILE_NONE, error))
+    goto out;
+
+  g_hash_table_remove_all (sessions->sessions);
+  g_hash_table_remove_all (sessions->pid_to_session_id);
+
+  groups = g_key_file_get_groups (key_file, NULL);
+  for (n = 0; groups[n] != NULL; n++)
+    {
+      const gchar *session_id;
+      gint *pids;
+      gsize num_pids;
+      gchar *seat;
+      gsize m;
+
+      if (!g_str_has_prefix (groups[n], "Session "))
+        continue;
+      session_id = groups[n] + strlen ("Session ");
+
+      seat = g_key_file_get_string (key_file, groups[n], "Seat", NULL);
+      insert_session (sessions,
+                      session_id,
+                      g_key_file_get_integer (key_file, groups[n], "Uid", NULL),
+                      seat,
+                      g_key_file_get_boolean (key_file, groups[n], "Active", NULL));
+      g_free (seat);
+
+      pids = g_key_file_get_integer_list (key_file, groups[n], "Pids", &num_pids, NULL);
+      for (m = 0; m < num_pids; m++)
+        g_hash_table_insert (sessions->pid_to_session_id, GINT_TO_POINTER (pids[m]), g_strdup (session_id));
+      g_free (pids);
+    }
+
+  default_session_id = g_key_file_get_string (key_file, "General", "DefaultSession", NULL);
+  g_free (sessions->default_session_id);
+  sessions->default_session_id = default_session_id;
+
+  change_rate = g_key_file_get_integer (key_file, "General", "ChangesPerSecond", NULL);
+  polkit_backend_fake_sessions_set_change_rate (sessions, MAX (change_rate, 0));
+
+  ret = TRUE;
+
+ out:
+  g_strfreev (groups);
+  g_key_file_free (key_file);
+  return ret;
+}
+
+static void
+on_file_monitor_changed (GFileMonitor     *file_monitor,
+                         GFile            *file,
+                         GFile            *other_file,
+                         GFileMonitorEvent event_type,
+                         gpointer          user_data)
+{
+  PolkitBackendFakeSessions *sessions = POLKIT_BACKEND_FAKE_SESSIONS (user_data);
+  GError *error;
+
+  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT &&
+      event_type != G_FILE_MONITOR_EVENT_CREATED)
+    return;
+
+  error = NULL;
+  if (!load_file (sessions, &error))
+    {
+      g_printerr ("Error reloading %s: %s\n", sessions->path, error->message);
+      g_error_free (error);
+      return;
+    }
+  emit_changed (sessions);
+}
+
+/**
+ * polkit_backend_fake_sessions_new_from_file:
+ * @path: A key file describing sessions.
+ * @error: Return location for error.
+ *
+ * Creates a new #PolkitBackendFakeSessions with the sessions
+ * described in @path, for example
+ *
+ * |[
+ * [General]
+ * DefaultSession=c1
+ * ChangesPerSecond=0
+ *
+ * [Session c1]
+ * Uid=1000
+ * Seat=seat0
+ * Active=true
+ * Pids=1234;5678
+ * ]|
+ *
+ * A session is local if it has a seat. Processes not listed in any
+ * session are in the session named by DefaultSession or in no session
+ * if there is none. ChangesPerSecond is passed to
+ * polkit_backend_fake_sessions_set_change_rate().
+ *
+ * The file is reloaded when it changes.
+ *
+ * Returns: A #PolkitBackendFakeSessions or %NULL if @error is set. Free with g_object_unref().
+ */
+PolkitBackendFakeSessions *
+polkit_backend_fake_sessions_new_from_file (const gchar  *path,
+                                            GError      **error)
+{
+  PolkitBackendFakeSessions *sessions;
+  GFile *file;
+
+  sessions = polkit_backend_fake_sessions_new ();
+  sessions->path = g_strdup (path);
+  if (!load_file (sessions, error))
+    {
+      g_object_unref (sessions);
+      sessions = NULL;
+      goto out;
+    }
+
+  file = g_file_new_for_path (path);
+  sessions->file_monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+  g_object_unref (file);
+  if (sessions->file_monitor != NULL)
+    g_signal_connect (sessions->file_monitor,
+                      "changed",
+                      G_CALLBACK (on_file_monitor_changed),
+                      sessions);
+
+ out:
+  return sessions;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/**
+ * polkit_backend_fake_sessions_add_session:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @session_id: The id of the session.
+ * @uid: The user of the session.
+ * @seat: The seat of the session or %NULL for a remote session.
+ * @is_active: Whether the session is active.
+ *
+ * Adds a session, replacing any session with the same id.
+ */
+void
+polkit_backend_fake_sessions_add_session (PolkitBackendFakeSessions *sessions,
+                                          const gchar               *session_id,
+                                          guint32                    uid,
+                                          const gchar               *seat,
+                                          gboolean                   is_active)
+{
+  g_return_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions));
+  g_return_if_fail (session_id != NULL);
+
+  insert_session (sessions, session_id, uid, seat, is_active);
+  emit_changed (sessions);
+}
+
+/**
+ * polkit_backend_fake_sessions_remove_session:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @session_id: The id of the session.
+ *
+ * Removes a session. Its processes are no longer in any session.
+ *
+ * Returns: %TRUE if the session existed.
+ */
+gboolean
+polkit_backend_fake_sessions_remove_session (PolkitBackendFakeSessions *sessions,
+                                             const gchar               *session_id)
+{
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), FALSE);
+
+  if (!g_hash_table_remove (sessions->sessions, session_id))
+    return FALSE;
+
+  emit_changed (sessions);
+  return TRUE;
+}
+
+/**
+ * polkit_backend_fake_sessions_set_session_active:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @session_id: The id of the session.
+ * @is_active: Whether the session is active.
+ *
+ * Activates or deactivates a session.
+ *
+ * Returns: %TRUE if the session exists.
+ */
+gboolean
+polkit_backend_fake_sessions_set_session_active (PolkitBackendFakeSessions *sessions,
+                                                 const gchar               *session_id,
+                                                 gboolean                   is_active)
+{
+  FakeSession *session;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), FALSE);
+
+  session = g_hash_table_lookup (sessions->sessions, session_id);
+  if (session == NULL)
+    return FALSE;
+
+  session->is_active = !!is_active;
+  emit_changed (sessions);
+  return TRUE;
+}
+
+/**
+ * polkit_backend_fake_sessions_add_process:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @pid: A process id.
+ * @session_id: The session @pid is in.
+ *
+ * Puts @pid in the session with id @session_id.
+ */
+void
+polkit_backend_fake_sessions_add_process (PolkitBackendFakeSessions *sessions,
+                                          gint                       pid,
+                                          const gchar               *session_id)
+{
+  g_return_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions));
+  g_return_if_fail (session_id != NULL);
+
+  g_hash_table_replace (sessions->pid_to_session_id, GINT_TO_POINTER (pid), g_strdup (session_id));
+}
+
+/**
+ * polkit_backend_fake_sessions_set_default_session:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @session_id: (allow-none): A session id or %NULL.
+ *
+ * Sets the session of all processes not added with
+ * polkit_backend_fake_sessions_add_process().
+ */
+void
+polkit_backend_fake_sessions_set_default_session (PolkitBackendFakeSessions *sessions,
+                                                  const gchar               *session_id)
+{
+  g_return_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions));
+
+  g_free (sessions->default_session_id);
+  sessions->default_session_id = g_strdup (session_id);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gboolean
+on_change_timeout (gpointer user_data)
+{
+  PolkitBackendFakeSessions *sessions = POLKIT_BACKEND_FAKE_SESSIONS (user_data);
+  guint n;
+
+  for (n = 0; n < sessions->changes_per_timeout; n++)
+    emit_changed (sessions);
+
+  return TRUE; /* keep source */
+}
+
+/**
+ * polkit_backend_fake_sessions_set_change_rate:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @changes_per_sec: Number of changes to inject per second or 0.
+ *
+ * Makes @sessions emit the #PolkitBackendFakeSessions::changed signal
+ * @changes_per_sec times per second, from the thread-default main
+ * context, without changing anything. Above 1000 per second the
+ * signals are emitted in bursts every millisecond.
+ */
+void
+polkit_backend_fake_sessions_set_change_rate (PolkitBackendFakeSessions *sessions,
+                                              guint                      changes_per_sec)
+{
+  guint interval_msec;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions));
+
+  if (changes_per_sec == sessions->change_rate)
+    return;
+
+  if (sessions->change_timeout_id != 0)
+    {
+      g_source_remove (sessions->change_timeout_id);
+      sessions->change_timeout_id = 0;
+    }
+
+  sessions->change_rate = changes_per_sec;
+  if (changes_per_sec == 0)
+    return;
+
+  if (changes_per_sec <= 1000)
+    {
+      interval_msec = 1000 / changes_per_sec;
+      sessions->changes_per_timeout = 1;
+    }
+  else
+    {
+      interval_msec = 1;
+      sessions->changes_per_timeout = changes_per_sec / 1000;
+    }
+
+  sessions->change_timeout_id = g_timeout_add (interval_msec, on_change_timeout, sessions);
+}
+
+/**
+ * polkit_backend_fake_sessions_get_num_changes:
+ * @sessions: A #PolkitBackendFakeSessions.
+ *
+ * Gets the number of times #PolkitBackendFakeSessions::changed has
+ * been emitted.
+ *
+ * Returns: The number of changes.
+ */
+guint64
+polkit_backend_fake_sessions_get_num_changes (PolkitBackendFakeSessions *sessions)
+{
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), 0);
+  return sessions->num_changes;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/**
+ * polkit_backend_fake_sessions_get_sessions:
+ * @sessions: A #PolkitBackendFakeSessions.
+ *
+ * Gets all sessions.
+ *
+ * Returns: A list of #PolkitUnixSession objects. Free with g_list_free_full() and g_object_unref().
+ */
+GList *
+polkit_backend_fake_sessions_get_sessions (PolkitBackendFakeSessions *sessions)
+{
+  GHashTableIter iter;
+  const gchar *session_id;
+  GList *ret;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), NULL);
+
+  ret = NULL;
+  g_hash_table_iter_init (&iter, sessions->sessions);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &session_id, NULL))
+    ret = g_list_prepend (ret, polkit_unix_session_new (session_id));
+
+  return ret;
+}
+
+/**
+ * polkit_backend_fake_sessions_get_session_for_subject:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @subject: A #PolkitUnixProcess or #PolkitSystemBusName.
+ * @error: Return location for error.
+ *
+ * Gets the session @subject is in, like
+ * polkit_backend_session_monitor_get_session_for_subject().
+ *
+ * Returns: A #PolkitUnixSession or %NULL if @subject is in no session or @error is set.
+ */
+PolkitSubject *
+polkit_backend_fake_sessions_get_session_for_subject (PolkitBackendFakeSessions  *sessions,
+                                                      PolkitSubject              *subject,
+                                                      GError                    **error)
+{
+  PolkitSubject *process;
+  PolkitSubject *ret;
+  const gchar *session_id;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), NULL);
+
+  ret = NULL;
+  process = NULL;
+
+  if (POLKIT_IS_UNIX_PROCESS (subject))
+    {
+      process = g_object_ref (subject);
+    }
+  else if (POLKIT_IS_SYSTEM_BUS_NAME (subject))
+    {
+      process = polkit_system_bus_name_get_process_sync (POLKIT_SYSTEM_BUS_NAME (subject), NULL, error);
+      if (process == NULL)
+        goto out;
+    }
+  else
+    {
+      g_set_error (error,
+                   POLKIT_ERROR,
+                   POLKIT_ERROR_NOT_SUPPORTED,
+                   "Cannot get session for subject of type %s",
+                   g_type_name (G_TYPE_FROM_INSTANCE (subject)));
+      goto out;
+    }
+
+  session_id = g_hash_table_lookup (sessions->pid_to_session_id,
+                                    GINT_TO_POINTER (polkit_unix_process_get_pid (POLKIT_UNIX_PROCESS (process))));
+  if (session_id == NULL)
+    session_id = sessions->default_session_id;
+
+  if (session_id != NULL && g_hash_table_lookup (sessions->sessions, session_id) != NULL)
+    ret = polkit_unix_session_new (session_id);
+
+ out:
+  if (process != NULL)
+    g_object_unref (process);
+  return ret;
+}
+
+/**
+ * polkit_backend_fake_sessions_get_session_uid:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @session_id: A session id.
+ * @out_uid: (out): Return location for the uid.
+ *
+ * Gets the user of a session.
+ *
+ * Returns: %TRUE if the session exists and @out_uid was set.
+ */
+gboolean
+polkit_backend_fake_sessions_get_session_uid (PolkitBackendFakeSessions *sessions,
+                                              const gchar               *session_id,
+                                              guint32                   *out_uid)
+{
+  FakeSession *session;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), FALSE);
+
+  session = g_hash_table_lookup (sessions->sessions, session_id);
+  if (session == NULL)
+    return FALSE;
+
+  *out_uid = session->uid;
+  return TRUE;
+}
+
+/**
+ * polkit_backend_fake_sessions_is_session_local:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @session_id: A session id.
+ *
+ * Checks whether a session is local, i.e. has a seat.
+ *
+ * Returns: %TRUE if the session exists and is local.
+ */
+gboolean
+polkit_backend_fake_sessions_is_session_local (PolkitBackendFakeSessions *sessions,
+                                               const gchar               *session_id)
+{
+  FakeSession *session;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), FALSE);
+
+  session = g_hash_table_lookup (sessions->sessions, session_id);
+  return session != NULL && session->seat != NULL;
+}
+
+/**
+ * polkit_backend_fake_sessions_is_session_active:
+ * @sessions: A #PolkitBackendFakeSessions.
+ * @session_id: A session id.
+ *
+ * Checks whether a session is active.
+ *
+ * Returns: %TRUE if the session exists and is active.
+ */
+gboolean
+polkit_backend_fake_sessions_is_session_active (PolkitBackendFakeSessions *sessions,
+                                                const gchar               *session_id)
+{
+  FakeSession *session;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_FAKE_SESSIONS (sessions), FALSE);
+
+  session = g_hash_table_lookup (sessions->sessions, session_id);
+  return session != NULL && session->is_active;
+}
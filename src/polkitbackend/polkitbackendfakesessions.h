@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#if !defined (_POLKIT_BACKEND_COMPILATION) || defined(_POLKIT_BACKEND_INSIDE_POLKIT_BACKEND_H)
+#error "This is a private header file."
+#endif
+
+#ifndef __POLKIT_BACKEND_FAKE_SESSIONS_H
+#define __POLKIT_BACKEND_FAKE_SESSIONS_H
+
+#include <glib-object.h>
+#include <polkit/polkit.h>
+#include <polkitbackend/polkitbackendtypes.h>
+
+G_BEGIN_DECLS
+
+#define POLKIT_BACKEND_TYPE_FAKE_SESSIONS         (polkit_backend_fake_sessions_get_type ())
+#define POLKIT_BACKEND_FAKE_SESSIONS(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), POLKIT_BACKEND_TYPE_FAKE_SESSIONS, PolkitBackendFakeSessions))
+#define POLKIT_BACKEND_FAKE_SESSIONS_CLASS(k)     (G_TYPE_CHECK_CLASS_CAST ((k), POLKIT_BACKEND_TYPE_FAKE_SESSIONS, PolkitBackendFakeSessionsClass))
+#define POLKIT_BACKEND_FAKE_SESSIONS_GET_CLASS(o) (G_TYPE_INSTANCE_GET_CLASS ((o), POLKIT_BACKEND_TYPE_FAKE_SESSIONS,PolkitBackendFakeSessionsClass))
+#define POLKIT_BACKEND_IS_FAKE_SESSIONS(o)        (G_TYPE_CHECK_INSTANCE_TYPE ((o), POLKIT_BACKEND_TYPE_FAKE_SESSIONS))
+#define POLKIT_BACKEND_IS_FAKE_SESSIONS_CLASS(k)  (G_TYPE_CHECK_CLASS_TYPE ((k), POLKIT_BACKEND_TYPE_FAKE_SESSIONS))
+
+typedef struct _PolkitBackendFakeSessions         PolkitBackendFakeSessions;
+typedef struct _PolkitBackendFakeSessionsClass    PolkitBackendFakeSessionsClass;
+
+GType                      polkit_backend_fake_sessions_get_type            (void) G_GNUC_CONST;
+PolkitBackendFakeSessions *polkit_backend_fake_sessions_new                 (void);
+PolkitBackendFakeSessions *polkit_backend_fake_sessions_new_from_file       (const gchar                *path,
+                                                                             GError                    **error);
+
+void                       polkit_backend_fake_sessions_add_session         (PolkitBackendFakeSessions  *sessions,
+                                                                             const gchar                *session_id,
+                                                                             guint32                     uid,
+                                                                             const gchar                *seat,
+                                                                             gboolean                    is_active);
+gboolean                   polkit_backend_fake_sessions_remove_session      (PolkitBackendFakeSessions  *sessions,
+                                                                             const gchar                *session_id);
+gboolean                   polkit_backend_fake_sessions_set_session_active  (PolkitBackendFakeSessions  *sessions,
+                                                                             const gchar                *session_id,
+                                                                             gboolean                    is_active);
+void                       polkit_backend_fake_sessions_add_process         (PolkitBackendFakeSessions  *sessions,
+                                                                             gint                        pid,
+                                                                             const gchar                *session_id);
+void                       polkit_backend_fake_sessions_set_default_session (PolkitBackendFakeSessions  *sessions,
+                                                                             const gchar                *session_id);
+void                       polkit_backend_fake_sessions_set_change_rate     (PolkitBackendFakeSessions  *sessions,
+                                                                             guint                       changes_per_sec);
+guint64                    polkit_backend_fake_sessions_get_num_changes     (PolkitBackendFakeSessions  *sessions);
+
+GList                     *polkit_backend_fake_sessions_get_sessions        (PolkitBackendFakeSessions  *sessions);
+PolkitSubject             *polkit_backend_fake_sessions_get_session_for_subject (PolkitBackendFakeSessions *sessions,
+                                                                             PolkitSubject              *subject,
+                                                                             GError                    **error);
+gboolean                   polkit_backend_fake_sessions_get_session_uid     (PolkitBackendFakeSessions  *sessions,
+                                                                             const gchar                *session_id,
+                                                                             guint32                    *out_uid);
+gboolean                   polkit_backend_fake_sessions_is_session_local    (PolkitBackendFakeSessions  *sessions,
+                                                                             const gchar                *session_id);
+gboolean                   polkit_backend_fake_sessions_is_session_active   (PolkitBackendFakeSessions  *sessions,
+                                                                             const gchar                *session_id);
+
+G_END_DECLS
+
+#endif /* __POLKIT_BACKEND_FAKE_SESSIONS_H */
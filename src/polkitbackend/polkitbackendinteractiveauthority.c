@@ -23,12 +23,9 @@
 #include <errno.h>
 #include <pwd.h>
 #include <grp.h>
-#ifdef HAVE_NETGROUP_H
-#include <netgroup.h>
-#else
-#include <netdb.h>
-#endif
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <glib/gstdio.h>
 #include <locale.h>
 
@@ -36,6 +33,10 @@
 #include "polkitbackendinteractiveauthority.h"
 #include "polkitbackendactionpool.h"
 #include "polkitbackendsessionmonitor.h"
+#include "polkitbackendprobes.h"
+#include "polkitbackendwatchdog.h"
+#include "polkitbackendresolver.h"
+#include "polkitbackendprivate.h"
 
 #include <polkit/polkitprivate.h>
 
@@ -69,6 +70,28 @@ static const gchar *temporary_authorization_store_add_authorization (TemporaryAu
 static void temporary_authorization_store_remove_authorizations_for_system_bus_name (TemporaryAuthorizationStore *store,
                                                                                      const gchar *name);
 
+static void  temporary_authorization_store_set_limit (TemporaryAuthorizationStore *store,
+                                                      gsize                        max_bytes);
+
+static gsize temporary_authorization_store_get_memory_usage (TemporaryAuthorizationStore *store,
+                                                             guint                       *out_num_authorizations,
+                                                             gsize                       *out_max_bytes,
+                                                             guint64                     *out_num_evicted);
+
+static void     temporary_authorization_store_set_file (TemporaryAuthorizationStore *store,
+                                                        const gchar                 *path);
+
+static gboolean temporary_authorization_store_save (TemporaryAuthorizationStore  *store,
+                                                    const gchar                  *path,
+                                                    GError                      **error);
+
+static gboolean temporary_authorization_store_load (TemporaryAuthorizationStore  *store,
+                                                    const gchar                  *path,
+                                                    guint                        *out_num_restored,
+                                                    GError                      **error);
+
+static gboolean temporary_authorization_store_is_saved (TemporaryAuthorizationStore *store);
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 struct AuthenticationAgent;
@@ -77,6 +100,9 @@ typedef struct AuthenticationAgent AuthenticationAgent;
 struct AuthenticationSession;
 typedef struct AuthenticationSession AuthenticationSession;
 
+struct CheckAuthorizationData;
+typedef struct CheckAuthorizationData CheckAuthorizationData;
+
 typedef void (*AuthenticationAgentCallback) (AuthenticationAgent         *agent,
                                              PolkitSubject               *subject,
                                              PolkitIdentity              *user_of_subject,
@@ -100,6 +126,7 @@ static void                authentication_agent_initiate_challenge (Authenticati
                                                                     const gchar                 *action_id,
                                                                     PolkitDetails               *details,
                                                                     PolkitSubject               *caller,
+                                                                    GList                       *user_identities,
                                                                     PolkitImplicitAuthorization  implicit_authorization,
                                                                     GCancellable                *cancellable,
                                                                     AuthenticationAgentCallback  callback,
@@ -120,6 +147,8 @@ static GList *get_authentication_sessions_initiated_by_system_bus_unique_name (P
 
 static void authentication_session_cancel (AuthenticationSession *session);
 
+static gsize authentication_agent_get_memory_usage (AuthenticationAgent *agent);
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 static void polkit_backend_interactive_authority_system_bus_name_owner_changed (PolkitBackendInteractiveAuthority   *authority,
@@ -127,9 +156,15 @@ static void polkit_backend_interactive_authority_system_bus_name_owner_changed (
                                                                                 const gchar              *old_owner,
                                                                                 const gchar              *new_owner);
 
+static void polkit_backend_interactive_authority_add_statistics (PolkitBackendAuthority *authority,
+                                                                 GVariantBuilder        *builder);
+
+static gint64 polkit_backend_interactive_authority_get_idle_time (PolkitBackendAuthority *authority);
+
 static GList *polkit_backend_interactive_authority_enumerate_actions  (PolkitBackendAuthority   *authority,
                                                                  PolkitSubject            *caller,
                                                                  const gchar              *locale,
+                                                                 GVariant                 *options,
                                                                  GError                  **error);
 
 static void polkit_backend_interactive_authority_check_authorization (PolkitBackendAuthority        *authority,
@@ -147,6 +182,25 @@ static PolkitAuthorizationResult *polkit_backend_interactive_authority_check_aut
                                                                  GAsyncResult            *res,
                                                                  GError                 **error);
 
+/* The stages of an authorization check, see polkit_backend_interactive_authority_set_log_timings() */
+typedef enum
+{
+  CHECK_STAGE_SUBJECT,
+  CHECK_STAGE_ACTION,
+  CHECK_STAGE_SESSION,
+  CHECK_STAGE_RULES,
+  CHECK_STAGE_TEMPORARY_AUTHORIZATION,
+  CHECK_STAGE_IMPLIED,
+  CHECK_STAGE_N_STAGES
+} CheckStage;
+
+typedef struct
+{
+  gint64 start_time;
+  gint64 stage_start_time;
+  gint64 usec[CHECK_STAGE_N_STAGES];
+} CheckTimings;
+
 static PolkitAuthorizationResult *check_authorization_sync (PolkitBackendAuthority         *authority,
                                                             PolkitSubject                  *caller,
                                                             PolkitSubject                  *subject,
@@ -155,6 +209,7 @@ static PolkitAuthorizationResult *check_authorization_sync (PolkitBackendAuthori
                                                             PolkitCheckAuthorizationFlags   flags,
                                                             PolkitImplicitAuthorization    *out_implicit_authorization,
                                                             gboolean                        checking_imply,
+                                                            CheckTimings                   *timings,
                                                             GError                        **error);
 
 static gboolean polkit_backend_interactive_authority_register_authentication_agent (PolkitBackendAuthority   *authority,
@@ -181,12 +236,14 @@ static gboolean polkit_backend_interactive_authority_authentication_agent_respon
 static GList *polkit_backend_interactive_authority_enumerate_temporary_authorizations (PolkitBackendAuthority   *authority,
                                                                                        PolkitSubject            *caller,
                                                                                        PolkitSubject            *subject,
+                                                                                       GVariant                 *options,
                                                                                        GError                  **error);
 
 
 static gboolean polkit_backend_interactive_authority_revoke_temporary_authorizations (PolkitBackendAuthority   *authority,
                                                                                       PolkitSubject            *caller,
                                                                                       PolkitSubject            *subject,
+                                                                                      GVariant                 *options,
                                                                                       GError                  **error);
 
 static gboolean polkit_backend_interactive_authority_revoke_temporary_authorization_by_id (PolkitBackendAuthority   *authority,
@@ -199,8 +256,10 @@ static gboolean polkit_backend_interactive_authority_revoke_temporary_authorizat
 
 typedef struct
 {
+  gchar *actions_dir;
   PolkitBackendActionPool *action_pool;
 
+  PolkitBackendFakeSessions *fake_sessions;
   PolkitBackendSessionMonitor *session_monitor;
 
   TemporaryAuthorizationStore *temporary_authorization_store;
@@ -218,11 +277,42 @@ typedef struct
   GHashTable *hash_scope_to_authentication_agent;
 
   GDBusConnection *system_bus_connection;
-  guint name_owner_changed_signal_id;
+
+  /* Maps from a unique system bus name we need to know about vanishing
+   * to a NameWatch, see watch_system_bus_name()
+   */
+  GHashTable *name_watches;
+  guint64 num_name_owner_changed_signals;
+
+  /* Unique names of callers known to have disconnected, the queue
+   * owns the strings and has the oldest name first
+   */
+  GHashTable *vanished_names;
+  GQueue vanished_names_queue;
+
+  guint64 num_checks_abandoned_vanished;
+  guint64 num_checks_abandoned_deadline;
+
+  /* the check the rules are run for, see
+   * polkit_backend_interactive_authority_lookup_user()
+   */
+  CheckAuthorizationData *running_check;
 
   guint64 agent_serial;
+
+  /* see polkit_backend_authority_get_idle_time() */
+  gint64 last_activity_time;
+
+  gboolean log_timings;
 } PolkitBackendInteractiveAuthorityPrivate;
 
+enum
+{
+  PROP_0,
+  PROP_ACTIONS_DIR,
+  PROP_FAKE_SESSIONS,
+};
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 G_DEFINE_TYPE (PolkitBackendInteractiveAuthority,
@@ -251,6 +341,24 @@ action_pool_changed (PolkitBackendActionPool *action_pool,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* Instead of receiving every NameOwnerChanged signal on the system bus
+ * we add a match rule for each unique name that something refers to:
+ * authentication agents, authentication sessions and temporary
+ * authorizations for a system bus name. Watches are reference counted
+ * and the match rule is removed once nothing refers to the name.
+ */
+typedef struct
+{
+  guint ref_count;
+  guint subscription_id;
+} NameWatch;
+
+typedef struct
+{
+  PolkitBackendInteractiveAuthority *authority;
+  gchar *name;
+} NameHasOwnerData;
+
 static void
 on_name_owner_changed_signal (GDBusConnection *connection,
                               const gchar     *sender_name,
@@ -261,10 +369,14 @@ on_name_owner_changed_signal (GDBusConnection *connection,
                               gpointer         user_data)
 {
   PolkitBackendInteractiveAuthority *authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (user_data);
+  PolkitBackendInteractiveAuthorityPrivate *priv;
   const gchar *name;
   const gchar *old_owner;
   const gchar *new_owner;
 
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  priv->num_name_owner_changed_signals++;
+
   g_variant_get (parameters,
                  "(&s&s&s)",
                  &name,
@@ -277,6 +389,172 @@ on_name_owner_changed_signal (GDBusConnection *connection,
                                                                       new_owner);
 }
 
+static void
+on_name_has_owner_cb (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  NameHasOwnerData *data = user_data;
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  GVariant *result;
+  GError *error;
+  gboolean has_owner;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (data->authority);
+
+  has_owner = TRUE;
+  error = NULL;
+  result = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &error);
+  if (result == NULL)
+    {
+      g_warning ("Error checking if %s still exists: %s", data->name, error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      g_variant_get (result, "(b)", &has_owner);
+      g_variant_unref (result);
+    }
+
+  /* the name vanished before the match rule was added so we didn't get the signal */
+  if (!has_owner && g_hash_table_lookup (priv->name_watches, data->name) != NULL)
+    {
+      polkit_backend_interactive_authority_system_bus_name_owner_changed (data->authority,
+                                                                          data->name,
+                                                                          data->name,
+                                                                          "");
+    }
+
+  g_object_unref (data->authority);
+  g_free (data->name);
+  g_free (data);
+}
+
+static void
+watch_system_bus_name (PolkitBackendInteractiveAuthority *authority,
+                       const gchar                       *name)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  NameWatch *watch;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  /* only unique names vanish for good */
+  if (priv->system_bus_connection == NULL || name == NULL || name[0] != ':')
+    return;
+
+  watch = g_hash_table_lookup (priv->name_watches, name);
+  if (watch == NULL)
+    {
+      NameHasOwnerData *data;
+
+      watch = g_new0 (NameWatch, 1);
+      watch->subscription_id =
+        g_dbus_connection_signal_subscribe (priv->system_bus_connection,
+                                            "org.freedesktop.DBus",   /* sender */
+                                            "org.freedesktop.DBus",   /* interface */
+                                            "NameOwnerChanged",       /* member */
+                                            "/org/freedesktop/DBus",  /* path */
+                                            name,                     /* arg0 */
+                                            G_DBUS_SIGNAL_FLAGS_NONE,
+                                            on_name_owner_changed_signal,
+                                            authority,
+                                            NULL); /* GDestroyNotify */
+      g_hash_table_insert (priv->name_watches, g_strdup (name), watch);
+
+      /* The bus handles our messages in order, so the reply reflects
+       * the state after the match rule was added
+       */
+      data = g_new0 (NameHasOwnerData, 1);
+      data->authority = g_object_ref (authority);
+      data->name = g_strdup (name);
+      g_dbus_connection_call (priv->system_bus_connection,
+                              "org.freedesktop.DBus",   /* bus name */
+                              "/org/freedesktop/DBus",  /* object path */
+                              "org.freedesktop.DBus",   /* interface */
+                              "NameHasOwner",           /* method */
+                              g_variant_new ("(s)", name),
+                              G_VARIANT_TYPE ("(b)"),
+                              G_DBUS_CALL_FLAGS_NONE,
+                              -1,
+                              NULL, /* GCancellable */
+                              on_name_has_owner_cb,
+                              data);
+    }
+  watch->ref_count++;
+}
+
+static void
+unwatch_system_bus_name (PolkitBackendInteractiveAuthority *authority,
+                         const gchar                       *name)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  NameWatch *watch;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  if (name == NULL || priv->name_watches == NULL)
+    return;
+
+  watch = g_hash_table_lookup (priv->name_watches, name);
+  if (watch == NULL)
+    return;
+
+  watch->ref_count--;
+  if (watch->ref_count == 0)
+    {
+      g_dbus_connection_signal_unsubscribe (priv->system_bus_connection, watch->subscription_id);
+      g_hash_table_remove (priv->name_watches, name);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Unique names are never reused so a check from a name that is known
+ * to have vanished can be abandoned without asking the bus about it.
+ * We only remember the most recent names.
+ */
+#define MAX_VANISHED_NAMES 256
+
+static void
+remember_vanished_name (PolkitBackendInteractiveAuthority *authority,
+                        const gchar                       *name)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  gchar *copy;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  if (name[0] != ':' || g_hash_table_lookup (priv->vanished_names, name) != NULL)
+    return;
+
+  copy = g_strdup (name);
+  g_hash_table_insert (priv->vanished_names, copy, copy);
+  g_queue_push_tail (&priv->vanished_names_queue, copy);
+
+  if (g_queue_get_length (&priv->vanished_names_queue) > MAX_VANISHED_NAMES)
+    {
+      copy = g_queue_pop_head (&priv->vanished_names_queue);
+      g_hash_table_remove (priv->vanished_names, copy);
+      g_free (copy);
+    }
+}
+
+static gboolean
+caller_has_vanished (PolkitBackendInteractiveAuthority *authority,
+                     PolkitSubject                     *caller)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  if (!POLKIT_IS_SYSTEM_BUS_NAME (caller))
+    return FALSE;
+
+  return g_hash_table_lookup (priv->vanished_names,
+                              polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (caller))) != NULL;
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 static void
@@ -291,7 +569,6 @@ static void
 polkit_backend_interactive_authority_init (PolkitBackendInteractiveAuthority *authority)
 {
   PolkitBackendInteractiveAuthorityPrivate *priv;
-  GFile *directory;
   GError *error;
 
   /* Force registering error domain */
@@ -299,26 +576,18 @@ polkit_backend_interactive_authority_init (PolkitBackendInteractiveAuthority *au
 
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
 
-  directory = g_file_new_for_path (PACKAGE_DATA_DIR "/polkit-1/actions");
-  priv->action_pool = polkit_backend_action_pool_new (directory);
-  g_object_unref (directory);
-  g_signal_connect (priv->action_pool,
-                    "changed",
-                    (GCallback) action_pool_changed,
-                    authority);
-
   priv->temporary_authorization_store = temporary_authorization_store_new (authority);
+  priv->last_activity_time = g_get_monotonic_time ();
 
   priv->hash_scope_to_authentication_agent = g_hash_table_new_full ((GHashFunc) polkit_subject_hash,
                                                                     (GEqualFunc) polkit_subject_equal,
                                                                     (GDestroyNotify) g_object_unref,
                                                                     (GDestroyNotify) authentication_agent_unref);
 
-  priv->session_monitor = polkit_backend_session_monitor_new ();
-  g_signal_connect (priv->session_monitor,
-                    "changed",
-                    G_CALLBACK (on_session_monitor_changed),
-                    authority);
+  priv->name_watches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  priv->vanished_names = g_hash_table_new (g_str_hash, g_str_equal);
+  g_queue_init (&priv->vanished_names_queue);
 
   error = NULL;
   priv->system_bus_connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
@@ -327,20 +596,64 @@ polkit_backend_interactive_authority_init (PolkitBackendInteractiveAuthority *au
       g_warning ("Error getting system bus: %s", error->message);
       g_error_free (error);
     }
+}
+
+static void
+polkit_backend_interactive_authority_constructed (GObject *object)
+{
+  PolkitBackendInteractiveAuthority *authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (object);
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  GFile *directory;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  if (priv->fake_sessions != NULL)
+    priv->session_monitor = polkit_backend_session_monitor_new_for_fake_sessions (priv->fake_sessions);
   else
+    priv->session_monitor = polkit_backend_session_monitor_new ();
+  g_signal_connect (priv->session_monitor,
+                    "changed",
+                    G_CALLBACK (on_session_monitor_changed),
+                    authority);
+
+  directory = g_file_new_for_path (priv->actions_dir != NULL ? priv->actions_dir :
+                                                               PACKAGE_DATA_DIR "/polkit-1/actions");
+  priv->action_pool = polkit_backend_action_pool_new (directory);
+  g_object_unref (directory);
+  g_signal_connect (priv->action_pool,
+                    "changed",
+                    (GCallback) action_pool_changed,
+                    authority);
+
+  if (G_OBJECT_CLASS (polkit_backend_interactive_authority_parent_class)->constructed != NULL)
+    G_OBJECT_CLASS (polkit_backend_interactive_authority_parent_class)->constructed (object);
+}
+
+static void
+polkit_backend_interactive_authority_set_property (GObject      *object,
+                                                   guint         prop_id,
+                                                   const GValue *value,
+                                                   GParamSpec   *pspec)
+{
+  PolkitBackendInteractiveAuthority *authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (object);
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  switch (prop_id)
     {
-      /* TODO: this is a bit inefficient */
-      priv->name_owner_changed_signal_id =
-        g_dbus_connection_signal_subscribe (priv->system_bus_connection,
-                                            "org.freedesktop.DBus",   /* sender */
-                                            "org.freedesktop.DBus",   /* interface */
-                                            "NameOwnerChanged",       /* member */
-                                            "/org/freedesktop/DBus",  /* path */
-                                            NULL,                     /* arg0 */
-                                            G_DBUS_SIGNAL_FLAGS_NONE,
-                                            on_name_owner_changed_signal,
-                                            authority,
-                                            NULL); /* GDestroyNotify */
+    case PROP_ACTIONS_DIR:
+      g_free (priv->actions_dir);
+      priv->actions_dir = g_value_dup_string (value);
+      break;
+
+    case PROP_FAKE_SESSIONS:
+      priv->fake_sessions = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
     }
 }
 
@@ -353,17 +666,33 @@ polkit_backend_interactive_authority_finalize (GObject *object)
   interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (object);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
 
-  if (priv->name_owner_changed_signal_id > 0)
-    g_dbus_connection_signal_unsubscribe (priv->system_bus_connection, priv->name_owner_changed_signal_id);
+  if (priv->name_watches != NULL)
+    {
+      GHashTableIter hash_iter;
+      NameWatch *watch;
+
+      g_hash_table_iter_init (&hash_iter, priv->name_watches);
+      while (g_hash_table_iter_next (&hash_iter, NULL, (gpointer) &watch))
+        g_dbus_connection_signal_unsubscribe (priv->system_bus_connection, watch->subscription_id);
+      g_hash_table_unref (priv->name_watches);
+      priv->name_watches = NULL;
+    }
+
+  g_hash_table_unref (priv->vanished_names);
+  g_queue_foreach (&priv->vanished_names_queue, (GFunc) g_free, NULL);
+  g_queue_clear (&priv->vanished_names_queue);
 
   if (priv->system_bus_connection != NULL)
     g_object_unref (priv->system_bus_connection);
 
   if (priv->action_pool != NULL)
     g_object_unref (priv->action_pool);
+  g_free (priv->actions_dir);
 
   if (priv->session_monitor != NULL)
     g_object_unref (priv->session_monitor);
+  if (priv->fake_sessions != NULL)
+    g_object_unref (priv->fake_sessions);
 
   temporary_authorization_store_free (priv->temporary_authorization_store);
 
@@ -399,7 +728,9 @@ polkit_backend_interactive_authority_class_init (PolkitBackendInteractiveAuthori
   gobject_class = G_OBJECT_CLASS (klass);
   authority_class = POLKIT_BACKEND_AUTHORITY_CLASS (klass);
 
-  gobject_class->finalize = polkit_backend_interactive_authority_finalize;
+  gobject_class->constructed  = polkit_backend_interactive_authority_constructed;
+  gobject_class->set_property = polkit_backend_interactive_authority_set_property;
+  gobject_class->finalize     = polkit_backend_interactive_authority_finalize;
 
   authority_class->get_name                        = polkit_backend_interactive_authority_get_name;
   authority_class->get_version                     = polkit_backend_interactive_authority_get_version;
@@ -413,29 +744,118 @@ polkit_backend_interactive_authority_class_init (PolkitBackendInteractiveAuthori
   authority_class->enumerate_temporary_authorizations = polkit_backend_interactive_authority_enumerate_temporary_authorizations;
   authority_class->revoke_temporary_authorizations = polkit_backend_interactive_authority_revoke_temporary_authorizations;
   authority_class->revoke_temporary_authorization_by_id = polkit_backend_interactive_authority_revoke_temporary_authorization_by_id;
+  authority_class->add_statistics                  = polkit_backend_interactive_authority_add_statistics;
+  authority_class->get_idle_time                   = polkit_backend_interactive_authority_get_idle_time;
 
-
+  /**
+   * PolkitBackendInteractiveAuthority:actions-dir:
+   *
+   * The directory to load action definitions from or %NULL to use
+   * the default directory.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_ACTIONS_DIR,
+                                   g_param_spec_string ("actions-dir",
+                                                        NULL,
+                                                        NULL,
+                                                        NULL,
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_WRITABLE |
+                                                        G_PARAM_STATIC_STRINGS));
+
+  /**
+   * PolkitBackendInteractiveAuthority:fake-sessions:
+   *
+   * The #PolkitBackendFakeSessions to track instead of the real
+   * sessions or %NULL. This is only meant for testing.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_FAKE_SESSIONS,
+                                   g_param_spec_object ("fake-sessions",
+                                                        NULL,
+                                                        NULL,
+                                                        POLKIT_BACKEND_TYPE_FAKE_SESSIONS,
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_WRITABLE |
+                                                        G_PARAM_STATIC_STRINGS));
 
   g_type_class_add_private (klass, sizeof (PolkitBackendInteractiveAuthorityPrivate));
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* Supported keys in @options are
+ *
+ *  - action-id-prefix (s): only return actions whose id starts with this string
+ *  - annotations (a{ss}): only return actions with all of these annotations
+ *  - start-after (s): only return actions whose id sorts after this one
+ *  - limit (u): return at most this many actions
+ *
+ * Unknown keys are ignored. Actions are returned sorted by id when
+ * @options is not %NULL so clients can page through them using
+ * start-after and limit.
+ */
 static GList *
 polkit_backend_interactive_authority_enumerate_actions (PolkitBackendAuthority   *authority,
                                                   PolkitSubject            *caller,
                                                   const gchar              *interactivee,
+                                                  GVariant                 *options,
                                                   GError                  **error)
 {
   PolkitBackendInteractiveAuthority *interactive_authority;
   PolkitBackendInteractiveAuthorityPrivate *priv;
   GList *actions;
+  const gchar *action_id_prefix;
+  const gchar *start_after;
+  GVariant *annotations_value;
+  GHashTable *annotations;
+  guint32 limit;
 
   interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
+
+  if (options == NULL)
+    {
+      actions = polkit_backend_action_pool_get_all_actions (priv->action_pool, interactivee);
+      goto out;
+    }
+
+  action_id_prefix = NULL;
+  start_after = NULL;
+  annotations = NULL;
+  limit = 0;
+
+  g_variant_lookup (options, "action-id-prefix", "&s", &action_id_prefix);
+  g_variant_lookup (options, "start-after", "&s", &start_after);
+  g_variant_lookup (options, "limit", "u", &limit);
+
+  annotations_value = g_variant_lookup_value (options, "annotations", G_VARIANT_TYPE ("a{ss}"));
+  if (annotations_value != NULL)
+    {
+      GVariantIter iter;
+      const gchar *key;
+      const gchar *value;
+
+      annotations = g_hash_table_new (g_str_hash, g_str_equal);
+      g_variant_iter_init (&iter, annotations_value);
+      while (g_variant_iter_next (&iter, "{&s&s}", &key, &value))
+        g_hash_table_insert (annotations, (gpointer) key, (gpointer) value);
+    }
 
-  actions = polkit_backend_action_pool_get_all_actions (priv->action_pool, interactivee);
+  actions = polkit_backend_action_pool_get_actions (priv->action_pool,
+                                                    interactivee,
+                                                    action_id_prefix,
+                                                    annotations,
+                                                    start_after,
+                                                    limit);
 
+  if (annotations != NULL)
+    g_hash_table_unref (annotations);
+  if (annotations_value != NULL)
+    g_variant_unref (annotations_value);
+
+ out:
   return actions;
 }
 
@@ -806,7 +1226,7 @@ may_identity_check_authorization (PolkitBackendInteractiveAuthority   *interacti
     {
       PolkitIdentity *owner_identity;
       GError *error = NULL;
-      owner_identity = polkit_identity_from_string (tokens[n], &error);
+      owner_identity = polkit_backend_resolver_identity_from_string (tokens[n], &error);
       if (owner_identity == NULL)
         {
           g_warning ("Error parsing owner identity %d of action_id %s: %s (%s, %d)",
@@ -830,72 +1250,881 @@ may_identity_check_authorization (PolkitBackendInteractiveAuthority   *interacti
   return ret;
 }
 
-static void
-polkit_backend_interactive_authority_check_authorization (PolkitBackendAuthority         *authority,
-                                                          PolkitSubject                  *caller,
-                                                          PolkitSubject                  *subject,
-                                                          const gchar                    *action_id,
-                                                          PolkitDetails                  *details,
-                                                          PolkitCheckAuthorizationFlags   flags,
-                                                          GCancellable                   *cancellable,
-                                                          GAsyncReadyCallback             callback,
-                                                          gpointer                        user_data)
+static const gchar *check_stage_names[CHECK_STAGE_N_STAGES] =
 {
-  PolkitBackendInteractiveAuthority *interactive_authority;
-  PolkitBackendInteractiveAuthorityPrivate *priv;
-  gchar *caller_str;
-  gchar *subject_str;
-  PolkitIdentity *user_of_caller;
-  PolkitIdentity *user_of_subject;
-  gchar *user_of_caller_str;
-  gchar *user_of_subject_str;
-  PolkitAuthorizationResult *result;
-  PolkitImplicitAuthorization implicit_authorization;
-  GError *error;
-  GSimpleAsyncResult *simple;
-  gboolean has_details;
-  gchar **detail_keys;
-
-  interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
-  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  "subject",
+  "action",
+  "session",
+  "rules",
+  "temporary_authorization",
+  "implied"
+};
 
-  error = NULL;
-  caller_str = NULL;
-  subject_str = NULL;
-  user_of_caller = NULL;
-  user_of_subject = NULL;
-  user_of_caller_str = NULL;
-  user_of_subject_str = NULL;
-  result = NULL;
+/* Timing is only done if timings is not NULL, so it costs nothing when
+ * it's off. A nested check for an implied action is not timed by itself
+ * but is part of the CHECK_STAGE_IMPLIED stage of the outer check.
+ *
+ * The stage is also passed to the watchdog, which is a no-op unless
+ * polkitd was started with --watchdog-threshold.
+ */
+static inline void
+check_timings_begin_stage (CheckTimings *timings,
+                           CheckStage    stage)
+{
+  polkit_backend_watchdog_set_stage (check_stage_names[stage]);
+  if (timings != NULL)
+    timings->stage_start_time = g_get_monotonic_time ();
+}
 
-  simple = g_simple_async_result_new (G_OBJECT (authority),
-                                      callback,
-                                      user_data,
-                                      polkit_backend_interactive_authority_check_authorization);
+static inline void
+check_timings_end_stage (CheckTimings *timings,
+                         CheckStage    stage)
+{
+  if (timings != NULL)
+    timings->usec[stage] += g_get_monotonic_time () - timings->stage_start_time;
+}
 
-  /* handle being called from ourselves */
-  if (caller == NULL)
-    {
-      /* TODO: this is kind of a hack */
-      GDBusConnection *system_bus;
-      system_bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, NULL);
-      caller = polkit_system_bus_name_new (g_dbus_connection_get_unique_name (system_bus));
-      g_object_unref (system_bus);
-    }
+static void
+log_check_timings (PolkitBackendInteractiveAuthority *authority,
+                   CheckTimings                      *timings,
+                   const gchar                       *caller_str,
+                   const gchar                       *subject_str,
+                   const gchar                       *action_id,
+                   PolkitAuthorizationResult         *result)
+{
+  GString *str;
+  const gchar *result_str;
+  guint n;
 
-  caller_str = polkit_subject_to_string (caller);
-  subject_str = polkit_subject_to_string (subject);
+  if (result == NULL)
+    result_str = "error";
+  else if (polkit_authorization_result_get_is_authorized (result))
+    result_str = "authorized";
+  else if (polkit_authorization_result_get_is_challenge (result))
+    result_str = "challenge";
+  else
+    result_str = "not_authorized";
+
+  /* a single line of key=value pairs so it's easy to pick apart */
+  str = g_string_new (NULL);
+  g_string_append_printf (str,
+                          "Timings: action=%s subject=%s caller=%s result=%s total_usec=%" G_GINT64_FORMAT,
+                          action_id,
+                          subject_str,
+                          caller_str,
+                          result_str,
+                          g_get_monotonic_time () - timings->start_time);
+  for (n = 0; n < CHECK_STAGE_N_STAGES; n++)
+    g_string_append_printf (str, " %s_usec=%" G_GINT64_FORMAT, check_stage_names[n], timings->usec[n]);
+
+  polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority), "%s", str->str);
+  g_string_free (str, TRUE);
+}
 
-  g_debug ("%s is inquiring whether %s is authorized for %s",
-           caller_str,
+/**
+ * polkit_backend_interactive_authority_set_log_timings:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @log_timings: Whether to log timings.
+ *
+ * If @log_timings is %TRUE, every authorization check measures the
+ * time spent resolving the subject, looking up the action and the
+ * session, evaluating rules and looking up temporary authorizations
+ * and implied actions, and logs them as a single line with
+ * polkit_backend_authority_log().
+ */
+void
+polkit_backend_interactive_authority_set_log_timings (PolkitBackendInteractiveAuthority *authority,
+                                                      gboolean                           log_timings)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_INTERACTIVE_AUTHORITY (authority));
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  priv->log_timings = !!log_timings;
+}
+
+/**
+ * polkit_backend_interactive_authority_set_temporary_authorization_limit:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @max_bytes: The approximate number of bytes temporary authorizations may use or 0 for no limit.
+ *
+ * Limits the memory used for temporary authorizations. When a new
+ * temporary authorization would exceed @max_bytes, the ones expiring
+ * first are revoked to make room for it. The default is no limit.
+ */
+void
+polkit_backend_interactive_authority_set_temporary_authorization_limit (PolkitBackendInteractiveAuthority *authority,
+                                                                        gsize                              max_bytes)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_INTERACTIVE_AUTHORITY (authority));
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  temporary_authorization_store_set_limit (priv->temporary_authorization_store, max_bytes);
+}
+
+static void
+on_actions_preloaded (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  GSimpleAsyncResult *simple = G_SIMPLE_ASYNC_RESULT (user_data);
+  guint num_actions;
+
+  polkit_backend_action_pool_preload_finish (POLKIT_BACKEND_ACTION_POOL (source_object), res, &num_actions);
+  g_simple_async_result_set_op_res_gssize (simple, num_actions);
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+}
+
+/**
+ * polkit_backend_interactive_authority_preload_actions:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @callback: A #GAsyncReadyCallback to call when done.
+ * @user_data: Data to pass to @callback.
+ *
+ * Starts parsing all action description files in a separate thread so
+ * the first request needing them doesn't have to. Requests made
+ * before it is done wait for the thread.
+ *
+ * When done, @callback is invoked in the thread-default main loop of
+ * the thread you are calling this method from. You can then call
+ * polkit_backend_interactive_authority_preload_actions_finish() to get
+ * the result.
+ */
+void
+polkit_backend_interactive_authority_preload_actions (PolkitBackendInteractiveAuthority *authority,
+                                                      GAsyncReadyCallback                callback,
+                                                      gpointer                           user_data)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  GSimpleAsyncResult *simple;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_INTERACTIVE_AUTHORITY (authority));
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  simple = g_simple_async_result_new (G_OBJECT (authority),
+                                      callback,
+                                      user_data,
+                                      polkit_backend_interactive_authority_preload_actions);
+  polkit_backend_action_pool_preload (priv->action_pool, on_actions_preloaded, simple);
+}
+
+/**
+ * polkit_backend_interactive_authority_preload_actions_finish:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @res: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to polkit_backend_interactive_authority_preload_actions().
+ *
+ * Finishes preloading action description files.
+ *
+ * Returns: The number of actions.
+ */
+guint
+polkit_backend_interactive_authority_preload_actions_finish (PolkitBackendInteractiveAuthority *authority,
+                                                             GAsyncResult                      *res)
+{
+  g_return_val_if_fail (POLKIT_BACKEND_IS_INTERACTIVE_AUTHORITY (authority), 0);
+  g_return_val_if_fail (G_IS_SIMPLE_ASYNC_RESULT (res), 0);
+  g_warn_if_fail (g_simple_async_result_get_source_tag (G_SIMPLE_ASYNC_RESULT (res)) ==
+                  polkit_backend_interactive_authority_preload_actions);
+
+  return g_simple_async_result_get_op_res_gssize (G_SIMPLE_ASYNC_RESULT (res));
+}
+
+/**
+ * polkit_backend_interactive_authority_load_temporary_authorizations:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @path: The file to load from.
+ * @out_num_restored: (out) (allow-none): Return location for the number of restored authorizations or %NULL.
+ * @error: Return location for error or %NULL.
+ *
+ * Restores the temporary authorizations written to @path by
+ * polkit_backend_interactive_authority_save_temporary_authorizations(),
+ * typically by the previous instance of the daemon. Authorizations
+ * that have expired or whose subject has vanished in the meantime are
+ * skipped.
+ *
+ * The file is only trusted if it is owned by the effective user and
+ * not writable by anyone else. It is not an error if @path does not
+ * exist.
+ *
+ * Returns: %TRUE if @path was loaded or does not exist, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_interactive_authority_load_temporary_authorizations (PolkitBackendInteractiveAuthority  *authority,
+                                                                    const gchar                        *path,
+                                                                    guint                              *out_num_restored,
+                                                                    GError                            **error)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_INTERACTIVE_AUTHORITY (authority), FALSE);
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  return temporary_authorization_store_load (priv->temporary_authorization_store, path, out_num_restored, error);
+}
+
+/**
+ * polkit_backend_interactive_authority_save_temporary_authorizations:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @path: The file to write to.
+ * @error: Return location for error or %NULL.
+ *
+ * Atomically replaces @path with the current temporary authorizations.
+ * The file is created with mode 0600.
+ *
+ * Returns: %TRUE if @path was written, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_interactive_authority_save_temporary_authorizations (PolkitBackendInteractiveAuthority  *authority,
+                                                                    const gchar                        *path,
+                                                                    GError                            **error)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  g_return_val_if_fail (POLKIT_BACKEND_IS_INTERACTIVE_AUTHORITY (authority), FALSE);
+  g_return_val_if_fail (path != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  return temporary_authorization_store_save (priv->temporary_authorization_store, path, error);
+}
+
+/**
+ * polkit_backend_interactive_authority_set_temporary_authorization_file:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @path: (allow-none): The file to keep up to date or %NULL.
+ *
+ * Rewrites @path whenever temporary authorizations are added or
+ * removed, so an instance started with <literal>--replace</literal>
+ * can pick them up at any time. Pass %NULL to stop, e.g. once
+ * another instance has taken over.
+ *
+ * While a file is set, temporary authorizations no longer keep
+ * polkit_backend_authority_get_idle_time() from reporting the
+ * authority as idle.
+ */
+void
+polkit_backend_interactive_authority_set_temporary_authorization_file (PolkitBackendInteractiveAuthority *authority,
+                                                                       const gchar                       *path)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  g_return_if_fail (POLKIT_BACKEND_IS_INTERACTIVE_AUTHORITY (authority));
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  temporary_authorization_store_set_file (priv->temporary_authorization_store, path);
+}
+
+static void
+polkit_backend_interactive_authority_add_statistics (PolkitBackendAuthority *authority,
+                                                     GVariantBuilder        *builder)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  GHashTableIter hash_iter;
+  AuthenticationAgent *agent;
+  guint num_actions;
+  guint num_authorizations;
+  guint64 num_evicted;
+  gsize max_bytes;
+  gsize bytes;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  bytes = polkit_backend_action_pool_get_memory_usage (priv->action_pool, &num_actions);
+  g_variant_builder_add (builder, "{sv}", "memory-actions-bytes", g_variant_new_uint64 (bytes));
+  g_variant_builder_add (builder, "{sv}", "actions", g_variant_new_uint32 (num_actions));
+
+  bytes = temporary_authorization_store_get_memory_usage (priv->temporary_authorization_store,
+                                                          &num_authorizations,
+                                                          &max_bytes,
+                                                          &num_evicted);
+  g_variant_builder_add (builder, "{sv}", "memory-temporary-authorizations-bytes", g_variant_new_uint64 (bytes));
+  g_variant_builder_add (builder, "{sv}", "temporary-authorizations", g_variant_new_uint32 (num_authorizations));
+  g_variant_builder_add (builder, "{sv}", "temporary-authorizations-limit-bytes",
+                         g_variant_new_uint64 (max_bytes));
+  g_variant_builder_add (builder, "{sv}", "temporary-authorizations-evicted", g_variant_new_uint64 (num_evicted));
+
+  bytes = POLKIT_BACKEND_HASH_TABLE_SIZE;
+  g_hash_table_iter_init (&hash_iter, priv->hash_scope_to_authentication_agent);
+  while (g_hash_table_iter_next (&hash_iter, NULL, (gpointer) &agent))
+    bytes += POLKIT_BACKEND_HASH_NODE_SIZE + authentication_agent_get_memory_usage (agent);
+  g_variant_builder_add (builder, "{sv}", "memory-agents-bytes", g_variant_new_uint64 (bytes));
+  g_variant_builder_add (builder, "{sv}", "agents",
+                         g_variant_new_uint32 (g_hash_table_size (priv->hash_scope_to_authentication_agent)));
+
+  g_variant_builder_add (builder, "{sv}", "name-watches", g_variant_new_uint32 (g_hash_table_size (priv->name_watches)));
+  g_variant_builder_add (builder, "{sv}", "name-owner-changed-signals",
+                         g_variant_new_uint64 (priv->num_name_owner_changed_signals));
+
+  g_variant_builder_add (builder, "{sv}", "checks-abandoned-caller-vanished",
+                         g_variant_new_uint64 (priv->num_checks_abandoned_vanished));
+  g_variant_builder_add (builder, "{sv}", "checks-abandoned-deadline",
+                         g_variant_new_uint64 (priv->num_checks_abandoned_deadline));
+}
+
+static gint64
+polkit_backend_interactive_authority_get_idle_time (PolkitBackendAuthority *authority)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  guint num_authorizations;
+  gsize max_bytes;
+  guint64 num_evicted;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  /* agents and the authentication sessions they run would be lost */
+  if (g_hash_table_size (priv->hash_scope_to_authentication_agent) > 0)
+    return -1;
+
+  /* unless they are saved for the next instance, so would temporary authorizations */
+  temporary_authorization_store_get_memory_usage (priv->temporary_authorization_store,
+                                                  &num_authorizations,
+                                                  &max_bytes,
+                                                  &num_evicted);
+  if (num_authorizations > 0 && !temporary_authorization_store_is_saved (priv->temporary_authorization_store))
+    return -1;
+
+  return g_get_monotonic_time () - priv->last_activity_time;
+}
+
+/* The caller may pass the CLOCK_MONOTONIC time in microseconds after
+ * which it is no longer interested in the result as the polkit.deadline
+ * detail. The deadline is meant for us only so it is removed from the
+ * details before they are passed on to rules or authentication agents.
+ *
+ * Returns FALSE and sets @error if the deadline is malformed. Otherwise
+ * @out_deadline is set to the deadline (or 0 if there is none) and
+ * @out_details to a reference to the remaining details (or %NULL).
+ */
+static gboolean
+take_check_deadline (PolkitDetails  *details,
+                     gint64         *out_deadline,
+                     PolkitDetails **out_details,
+                     GError        **error)
+{
+  const gchar *value;
+  gchar *endp;
+  gint64 deadline;
+  gchar **keys;
+  guint n;
+
+  *out_deadline = 0;
+  *out_details = NULL;
+
+  if (details == NULL)
+    return TRUE;
+
+  value = polkit_details_lookup (details, "polkit.deadline");
+  if (value == NULL)
+    {
+      *out_details = g_object_ref (details);
+      return TRUE;
+    }
+
+  deadline = g_ascii_strtoll (value, &endp, 10);
+  if (*value == '\0' || *endp != '\0' || deadline < 0)
+    {
+      g_set_error (error,
+                   POLKIT_ERROR,
+                   POLKIT_ERROR_FAILED,
+                   "Malformed polkit.deadline detail");
+      return FALSE;
+    }
+
+  *out_deadline = deadline;
+  *out_details = polkit_details_new ();
+  keys = polkit_details_get_keys (details);
+  for (n = 0; keys != NULL && keys[n] != NULL; n++)
+    {
+      if (g_strcmp0 (keys[n], "polkit.deadline") != 0)
+        polkit_details_insert (*out_details, keys[n], polkit_details_lookup (details, keys[n]));
+    }
+  g_strfreev (keys);
+
+  return TRUE;
+}
+
+/* Completes @simple with an error if nobody is waiting for the result anymore */
+static gboolean
+check_abandon_if_unwanted (PolkitBackendInteractiveAuthority *authority,
+                           PolkitSubject                     *caller,
+                           gint64                             deadline,
+                           GSimpleAsyncResult                *simple)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+
+  if (caller_has_vanished (authority, caller))
+    {
+      g_debug (" abandoning check, caller has disconnected");
+      priv->num_checks_abandoned_vanished++;
+      g_simple_async_result_set_error (simple,
+                                       POLKIT_ERROR,
+                                       POLKIT_ERROR_CANCELLED,
+                                       "The caller has disconnected");
+    }
+  else if (deadline > 0 && g_get_monotonic_time () >= deadline)
+    {
+      g_debug (" abandoning check, deadline has passed");
+      priv->num_checks_abandoned_deadline++;
+      g_simple_async_result_set_error (simple,
+                                       POLKIT_ERROR,
+                                       POLKIT_ERROR_CANCELLED,
+                                       "The deadline for the check has passed");
+    }
+  else
+    {
+      return FALSE;
+    }
+
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+  return TRUE;
+}
+
+/* The state of a check that is waiting for the name service, first
+ * for the user of the subject and then for the members of the groups
+ * allowed to authenticate
+ */
+struct CheckAuthorizationData
+{
+  PolkitBackendInteractiveAuthority *authority;
+  PolkitSubject *caller;
+  PolkitSubject *subject;
+  PolkitIdentity *user_of_subject;
+  gchar *action_id;
+  PolkitDetails *details;
+  PolkitCheckAuthorizationFlags flags;
+  GCancellable *cancellable;
+  GSimpleAsyncResult *simple;
+  gchar *caller_str;
+  gchar *subject_str;
+  gint64 deadline;
+  gint64 lookup_start_time;
+  CheckTimings timings_buf;
+  CheckTimings *timings;
+
+  /* the user of the subject as looked up for the rules */
+  gboolean user_resolved;
+  gchar *user_name;
+  gchar **group_names;
+  GError *user_error;
+
+  /* the challenge waiting for the identities to be expanded */
+  PolkitAuthorizationResult *result;
+  PolkitImplicitAuthorization implicit_authorization;
+  GList *identities;
+  GList *next_identity;
+  GList *user_identities;
+};
+
+static void
+check_authorization_data_free (CheckAuthorizationData *data)
+{
+  if (POLKIT_IS_SYSTEM_BUS_NAME (data->caller))
+    unwatch_system_bus_name (data->authority,
+                             polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (data->caller)));
+  g_object_unref (data->authority);
+  g_object_unref (data->caller);
+  g_object_unref (data->subject);
+  g_object_unref (data->user_of_subject);
+  g_free (data->action_id);
+  if (data->details != NULL)
+    g_object_unref (data->details);
+  if (data->cancellable != NULL)
+    g_object_unref (data->cancellable);
+  g_free (data->caller_str);
+  g_free (data->subject_str);
+  g_free (data->user_name);
+  g_strfreev (data->group_names);
+  if (data->user_error != NULL)
+    g_error_free (data->user_error);
+  if (data->result != NULL)
+    g_object_unref (data->result);
+  g_list_free_full (data->identities, g_object_unref);
+  g_list_free_full (data->user_identities, g_object_unref);
+  g_free (data);
+}
+
+static GList *get_identities_for_challenge (PolkitBackendInteractiveAuthority *authority,
+                                            PolkitSubject                     *caller,
+                                            PolkitSubject                     *subject,
+                                            PolkitIdentity                    *user_of_subject,
+                                            const gchar                       *action_id,
+                                            PolkitDetails                     *details,
+                                            PolkitImplicitAuthorization        implicit_authorization);
+
+static GList *users_to_identities (gchar      **user_names,
+                                   guint32     *uids,
+                                   const gchar *group_kind,
+                                   gboolean     include_root);
+
+/* Starts the challenge once the identities are expanded; consumes @data */
+static void
+check_authorization_begin_challenge (CheckAuthorizationData *data)
+{
+  PolkitBackendInteractiveAuthority *interactive_authority;
+  AuthenticationAgent *agent;
+  GSimpleAsyncResult *simple;
+
+  interactive_authority = data->authority;
+  simple = data->simple;
+
+  /* the lookups may have taken a while */
+  if (check_abandon_if_unwanted (interactive_authority, data->caller, data->deadline, simple))
+    goto out;
+
+  /* Fall back to uid 0 if no users are available (rhbz #834494) */
+  if (data->user_identities == NULL)
+    data->user_identities = g_list_prepend (NULL, polkit_unix_user_new (0));
+
+  agent = get_authentication_agent_for_subject (interactive_authority, data->subject);
+  if (agent == NULL)
+    {
+      /* the agent went away in the meantime */
+      g_simple_async_result_set_op_res_gpointer (simple,
+                                                 g_object_ref (data->result),
+                                                 g_object_unref);
+      g_simple_async_result_complete (simple);
+      g_object_unref (simple);
+      goto out;
+    }
+
+  g_debug (" using authentication agent for challenge");
+
+  authentication_agent_initiate_challenge (agent,
+                                           data->subject,
+                                           data->user_of_subject,
+                                           interactive_authority,
+                                           data->action_id,
+                                           data->details,
+                                           data->caller,
+                                           data->user_identities,
+                                           data->implicit_authorization,
+                                           data->cancellable,
+                                           check_authorization_challenge_cb,
+                                           simple);
+
+ out:
+  check_authorization_data_free (data);
+}
+
+static void check_authorization_expand_identities (CheckAuthorizationData *data);
+
+static void
+on_identity_expanded (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  CheckAuthorizationData *data = user_data;
+  PolkitIdentity *identity;
+  gchar **user_names;
+  guint32 *uids;
+  GError *error;
+
+  identity = POLKIT_IDENTITY (data->next_identity->data);
+
+  error = NULL;
+  if (!polkit_backend_resolver_get_members_finish (res, &user_names, &uids, &error))
+    {
+      if (POLKIT_IS_UNIX_GROUP (identity))
+        g_warning ("Error looking up group with gid %d: %s",
+                   (gint) polkit_unix_group_get_gid (POLKIT_UNIX_GROUP (identity)),
+                   error->message);
+      else
+        g_warning ("Error looking up net group with name %s: %s",
+                   polkit_unix_netgroup_get_name (POLKIT_UNIX_NETGROUP (identity)),
+                   error->message);
+      g_error_free (error);
+    }
+  else
+    {
+      if (POLKIT_IS_UNIX_GROUP (identity))
+        data->user_identities = g_list_concat (data->user_identities,
+                                               users_to_identities (user_names, uids, "group", FALSE));
+      else
+        data->user_identities = g_list_concat (data->user_identities,
+                                               users_to_identities (user_names, uids, "unix-netgroup", TRUE));
+      g_strfreev (user_names);
+      g_free (uids);
+    }
+
+  data->next_identity = data->next_identity->next;
+  check_authorization_expand_identities (data);
+}
+
+/* Expands the groups and netgroups allowed to authenticate to their
+ * users, one lookup at a time and without blocking; consumes @data
+ */
+static void
+check_authorization_expand_identities (CheckAuthorizationData *data)
+{
+  PolkitIdentity *identity;
+
+  for (; data->next_identity != NULL; data->next_identity = data->next_identity->next)
+    {
+      identity = POLKIT_IDENTITY (data->next_identity->data);
+      if (POLKIT_IS_UNIX_USER (identity))
+        {
+          data->user_identities = g_list_append (data->user_identities, g_object_ref (identity));
+        }
+      else if (POLKIT_IS_UNIX_GROUP (identity))
+        {
+          polkit_backend_resolver_get_group_members_async (polkit_unix_group_get_gid (POLKIT_UNIX_GROUP (identity)),
+                                                           on_identity_expanded,
+                                                           data);
+          return;
+        }
+      else if (POLKIT_IS_UNIX_NETGROUP (identity))
+        {
+          /* TODO: Should we match on hostname? Maybe only allow "-" as a hostname
+           * for safety. */
+          polkit_backend_resolver_get_netgroup_members_async (polkit_unix_netgroup_get_name (POLKIT_UNIX_NETGROUP (identity)),
+                                                              on_identity_expanded,
+                                                              data);
+          return;
+        }
+      else
+        {
+          g_warning ("Unsupported identity");
+        }
+    }
+
+  check_authorization_begin_challenge (data);
+}
+
+/* Does the part of the check that runs after the caller is found to be
+ * allowed to do it; completes and consumes data->simple.
+ */
+static void
+check_authorization_continue (CheckAuthorizationData *data)
+{
+  PolkitBackendInteractiveAuthority *interactive_authority;
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  PolkitAuthorizationResult *result;
+  PolkitImplicitAuthorization implicit_authorization;
+  GSimpleAsyncResult *simple;
+  GError *error;
+
+  interactive_authority = data->authority;
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  simple = data->simple;
+  error = NULL;
+
+  polkit_backend_watchdog_set_activity ("CheckAuthorization", data->caller_str, data->action_id);
+
+  /* looking up the users may have taken a while */
+  result = NULL;
+  if (check_abandon_if_unwanted (interactive_authority, data->caller, data->deadline, simple))
+    goto out;
+
+  /* the rules get the user of the subject from us */
+  priv->running_check = data;
+
+  implicit_authorization = POLKIT_IMPLICIT_AUTHORIZATION_NOT_AUTHORIZED;
+  result = check_authorization_sync (POLKIT_BACKEND_AUTHORITY (interactive_authority),
+                                     data->caller,
+                                     data->subject,
+                                     data->action_id,
+                                     data->details,
+                                     data->flags,
+                                     &implicit_authorization,
+                                     FALSE, /* checking_imply */
+                                     data->timings,
+                                     &error);
+  if (data->timings != NULL)
+    log_check_timings (interactive_authority,
+                       data->timings,
+                       data->caller_str,
+                       data->subject_str,
+                       data->action_id,
+                       result);
+  if (error != NULL)
+    {
+      g_simple_async_result_set_from_error (simple, error);
+      g_simple_async_result_complete (simple);
+      g_object_unref (simple);
+      g_error_free (error);
+      goto out;
+    }
+
+  /* Caller is up for a challenge! With light sabers! Use an authentication agent if one exists... */
+  if (polkit_authorization_result_get_is_challenge (result) &&
+      (data->flags & POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION))
+    {
+      AuthenticationAgent *agent;
+
+      agent = get_authentication_agent_for_subject (interactive_authority, data->subject);
+      if (agent != NULL)
+        {
+          /* don't pop up a dialog nobody is waiting for */
+          if (check_abandon_if_unwanted (interactive_authority, data->caller, data->deadline, simple))
+            goto out;
+
+          data->result = result;
+          result = NULL;
+          data->implicit_authorization = implicit_authorization;
+          data->identities = get_identities_for_challenge (interactive_authority,
+                                                           data->caller,
+                                                           data->subject,
+                                                           data->user_of_subject,
+                                                           data->action_id,
+                                                           data->details,
+                                                           implicit_authorization);
+          data->next_identity = data->identities;
+          priv->running_check = NULL;
+
+          /* keep going */
+          check_authorization_expand_identities (data);
+          data = NULL;
+          goto out;
+        }
+    }
+
+  /* log_result (interactive_authority, action_id, subject, caller, result); */
+
+  /* Otherwise just return the result */
+  g_simple_async_result_set_op_res_gpointer (simple,
+                                             g_object_ref (result),
+                                             g_object_unref);
+  g_simple_async_result_complete (simple);
+  g_object_unref (simple);
+
+ out:
+  priv->running_check = NULL;
+  if (result != NULL)
+    g_object_unref (result);
+  if (data != NULL)
+    check_authorization_data_free (data);
+}
+
+static void
+on_subject_user_resolved (GObject      *source_object,
+                          GAsyncResult *res,
+                          gpointer      user_data)
+{
+  CheckAuthorizationData *data = user_data;
+
+  /* failures are reported when the rules ask for the user */
+  polkit_backend_resolver_get_user_finish (res,
+                                           &data->user_name,
+                                           &data->group_names,
+                                           &data->user_error);
+  data->user_resolved = TRUE;
+
+  if (data->timings != NULL)
+    data->timings->usec[CHECK_STAGE_SUBJECT] += g_get_monotonic_time () - data->lookup_start_time;
+
+  check_authorization_continue (data);
+}
+
+static void
+polkit_backend_interactive_authority_check_authorization (PolkitBackendAuthority         *authority,
+                                                          PolkitSubject                  *caller,
+                                                          PolkitSubject                  *subject,
+                                                          const gchar                    *action_id,
+                                                          PolkitDetails                  *details,
+                                                          PolkitCheckAuthorizationFlags   flags,
+                                                          GCancellable                   *cancellable,
+                                                          GAsyncReadyCallback             callback,
+                                                          gpointer                        user_data)
+{
+  PolkitBackendInteractiveAuthority *interactive_authority;
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  gchar *caller_str;
+  gchar *subject_str;
+  PolkitIdentity *user_of_caller;
+  PolkitIdentity *user_of_subject;
+  gchar *user_of_caller_str;
+  gchar *user_of_subject_str;
+  CheckAuthorizationData *data;
+  GError *error;
+  GSimpleAsyncResult *simple;
+  gboolean has_details;
+  gchar **detail_keys;
+  gint64 deadline;
+  CheckTimings timings_buf;
+  CheckTimings *timings;
+
+  interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
+
+  timings = NULL;
+  if (priv->log_timings)
+    {
+      memset (&timings_buf, 0, sizeof timings_buf);
+      timings_buf.start_time = g_get_monotonic_time ();
+      timings = &timings_buf;
+    }
+
+  error = NULL;
+  caller_str = NULL;
+  subject_str = NULL;
+  user_of_caller = NULL;
+  user_of_subject = NULL;
+  user_of_caller_str = NULL;
+  user_of_subject_str = NULL;
+
+  simple = g_simple_async_result_new (G_OBJECT (authority),
+                                      callback,
+                                      user_data,
+                                      polkit_backend_interactive_authority_check_authorization);
+
+  /* handle being called from ourselves */
+  if (caller == NULL)
+    {
+      /* TODO: this is kind of a hack */
+      GDBusConnection *system_bus;
+      system_bus = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, NULL);
+      caller = polkit_system_bus_name_new (g_dbus_connection_get_unique_name (system_bus));
+      g_object_unref (system_bus);
+    }
+
+  caller_str = polkit_subject_to_string (caller);
+  subject_str = polkit_subject_to_string (subject);
+
+  g_debug ("%s is inquiring whether %s is authorized for %s",
+           caller_str,
            subject_str,
            action_id);
 
+  polkit_backend_watchdog_set_activity ("CheckAuthorization", caller_str, action_id);
+
+  /* from here on @details no longer contains the deadline */
+  if (!take_check_deadline (details, &deadline, &details, &error))
+    {
+      g_simple_async_result_set_from_error (simple, error);
+      g_simple_async_result_complete (simple);
+      g_object_unref (simple);
+      g_error_free (error);
+      goto out;
+    }
+
+  /* the request may have been queued for a while */
+  if (check_abandon_if_unwanted (interactive_authority, caller, deadline, simple))
+    goto out;
+
+  check_timings_begin_stage (timings, CHECK_STAGE_SUBJECT);
   user_of_caller = polkit_backend_session_monitor_get_user_for_subject (priv->session_monitor,
                                                                         caller,
                                                                         &error);
+  check_timings_end_stage (timings, CHECK_STAGE_SUBJECT);
   if (error != NULL)
     {
+      if (POLKIT_IS_SYSTEM_BUS_NAME (caller) &&
+          g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_NAME_HAS_NO_OWNER))
+        {
+          remember_vanished_name (interactive_authority,
+                                  polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (caller)));
+        }
       g_simple_async_result_set_from_error (simple, error);
       g_simple_async_result_complete (simple);
       g_object_unref (simple);
@@ -906,9 +2135,11 @@ polkit_backend_interactive_authority_check_authorization (PolkitBackendAuthority
   user_of_caller_str = polkit_identity_to_string (user_of_caller);
   g_debug (" user of caller is %s", user_of_caller_str);
 
+  check_timings_begin_stage (timings, CHECK_STAGE_SUBJECT);
   user_of_subject = polkit_backend_session_monitor_get_user_for_subject (priv->session_monitor,
                                                                          subject,
                                                                          &error);
+  check_timings_end_stage (timings, CHECK_STAGE_SUBJECT);
   if (error != NULL)
     {
       g_simple_async_result_set_from_error (simple, error);
@@ -964,71 +2195,52 @@ polkit_backend_interactive_authority_check_authorization (PolkitBackendAuthority
                                                POLKIT_ERROR_NOT_AUTHORIZED,
                                                "Only trusted callers (e.g. uid 0 or an action owner) can use CheckAuthorization() for "
                                                "subjects belonging to other identities");
-            }
-          g_simple_async_result_complete (simple);
-          g_object_unref (simple);
-          goto out;
-        }
-    }
-
-  implicit_authorization = POLKIT_IMPLICIT_AUTHORIZATION_NOT_AUTHORIZED;
-  result = check_authorization_sync (authority,
-                                     caller,
-                                     subject,
-                                     action_id,
-                                     details,
-                                     flags,
-                                     &implicit_authorization,
-                                     FALSE, /* checking_imply */
-                                     &error);
-  if (error != NULL)
-    {
-      g_simple_async_result_set_from_error (simple, error);
-      g_simple_async_result_complete (simple);
-      g_object_unref (simple);
-      g_error_free (error);
-      goto out;
-    }
-
-  /* Caller is up for a challenge! With light sabers! Use an authentication agent if one exists... */
-  if (polkit_authorization_result_get_is_challenge (result) &&
-      (flags & POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION))
-    {
-      AuthenticationAgent *agent;
-
-      agent = get_authentication_agent_for_subject (interactive_authority, subject);
-      if (agent != NULL)
-        {
-          g_object_unref (result);
-          result = NULL;
-
-          g_debug (" using authentication agent for challenge");
-
-          authentication_agent_initiate_challenge (agent,
-                                                   subject,
-                                                   user_of_subject,
-                                                   interactive_authority,
-                                                   action_id,
-                                                   details,
-                                                   caller,
-                                                   implicit_authorization,
-                                                   cancellable,
-                                                   check_authorization_challenge_cb,
-                                                   simple);
-
-          /* keep going */
+            }
+          g_simple_async_result_complete (simple);
+          g_object_unref (simple);
           goto out;
         }
     }
 
-  /* log_result (interactive_authority, action_id, subject, caller, result); */
+  data = g_new0 (CheckAuthorizationData, 1);
+  data->authority = g_object_ref (interactive_authority);
+  data->caller = g_object_ref (caller);
+  data->subject = g_object_ref (subject);
+  data->user_of_subject = g_object_ref (user_of_subject);
+  data->action_id = g_strdup (action_id);
+  data->details = details != NULL ? g_object_ref (details) : NULL;
+  data->flags = flags;
+  data->cancellable = cancellable != NULL ? g_object_ref (cancellable) : NULL;
+  data->simple = simple;
+  data->caller_str = g_strdup (caller_str);
+  data->subject_str = g_strdup (subject_str);
+  data->deadline = deadline;
+  if (timings != NULL)
+    {
+      data->timings_buf = *timings;
+      data->timings = &data->timings_buf;
+    }
 
-  /* Otherwise just return the result */
-  g_simple_async_result_set_op_res_gpointer (simple,
-                                             g_object_ref (result),
-                                             g_object_unref);
-  g_simple_async_result_complete (simple);
-  g_object_unref (simple);
+  /* notice if the caller disconnects while the check is pending */
+  if (POLKIT_IS_SYSTEM_BUS_NAME (caller))
+    watch_system_bus_name (interactive_authority,
+                           polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (caller)));
+
+  /* The rules are passed the name and groups of the user of the
+   * subject. Look them up without blocking so a slow name service
+   * only holds up the requests that are waiting for it.
+   */
+  if (POLKIT_IS_UNIX_USER (user_of_subject))
+    {
+      data->lookup_start_time = g_get_monotonic_time ();
+      polkit_backend_resolver_get_user_async (polkit_unix_user_get_uid (POLKIT_UNIX_USER (user_of_subject)),
+                                              on_subject_user_resolved,
+                                              data);
+    }
+  else
+    {
+      check_authorization_continue (data);
+    }
 
  out:
 
@@ -1043,8 +2255,8 @@ polkit_backend_interactive_authority_check_authorization (PolkitBackendAuthority
   g_free (user_of_caller_str);
   g_free (user_of_subject_str);
 
-  if (result != NULL)
-    g_object_unref (result);
+  if (details != NULL)
+    g_object_unref (details);
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -1058,6 +2270,7 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
                           PolkitCheckAuthorizationFlags   flags,
                           PolkitImplicitAuthorization    *out_implicit_authorization,
                           gboolean                        checking_imply,
+                          CheckTimings                   *timings,
                           GError                        **error)
 {
   PolkitBackendInteractiveAuthority *interactive_authority;
@@ -1072,6 +2285,7 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
   gboolean session_is_active;
   PolkitImplicitAuthorization implicit_authorization;
   const gchar *tmp_authz_id;
+  gboolean has_tmp_authz;
   GList *actions;
   GList *l;
 
@@ -1095,10 +2309,16 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
            subject_str,
            action_id);
 
+  POLKIT_PROBE3 (check_authorization__begin, subject_str, action_id, checking_imply);
+
   /* get the action description */
+  POLKIT_PROBE1 (action_lookup__begin, action_id);
+  check_timings_begin_stage (timings, CHECK_STAGE_ACTION);
   action_desc = polkit_backend_action_pool_get_action (priv->action_pool,
                                                        action_id,
                                                        NULL);
+  check_timings_end_stage (timings, CHECK_STAGE_ACTION);
+  POLKIT_PROBE2 (action_lookup__end, action_id, action_desc != NULL);
 
   if (action_desc == NULL)
     {
@@ -1111,9 +2331,13 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
     }
 
   /* every subject has a user */
+  POLKIT_PROBE1 (user_lookup__begin, subject_str);
+  check_timings_begin_stage (timings, CHECK_STAGE_SUBJECT);
   user_of_subject = polkit_backend_session_monitor_get_user_for_subject (priv->session_monitor,
                                                                          subject,
                                                                          error);
+  check_timings_end_stage (timings, CHECK_STAGE_SUBJECT);
+  POLKIT_PROBE2 (user_lookup__end, subject_str, user_of_subject != NULL);
   if (user_of_subject == NULL)
       goto out;
 
@@ -1125,6 +2349,8 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
     }
 
   /* a subject *may* be in a session */
+  POLKIT_PROBE1 (session_lookup__begin, subject_str);
+  check_timings_begin_stage (timings, CHECK_STAGE_SESSION);
   session_for_subject = polkit_backend_session_monitor_get_session_for_subject (priv->session_monitor,
                                                                                 subject,
                                                                                 NULL);
@@ -1139,6 +2365,8 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
                session_is_local,
                session_is_active);
     }
+  check_timings_end_stage (timings, CHECK_STAGE_SESSION);
+  POLKIT_PROBE3 (session_lookup__end, subject_str, session_is_local, session_is_active);
 
   /* find the implicit authorization to use; it depends on is_local and is_active */
   if (session_is_local)
@@ -1154,6 +2382,8 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
     }
 
   /* allow subclasses to rewrite implicit_authorization */
+  POLKIT_PROBE2 (rules__begin, action_id, implicit_authorization);
+  check_timings_begin_stage (timings, CHECK_STAGE_RULES);
   implicit_authorization = polkit_backend_interactive_authority_check_authorization_sync (interactive_authority,
                                                                                           caller,
                                                                                           subject,
@@ -1163,6 +2393,9 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
                                                                                           action_id,
                                                                                           details,
                                                                                           implicit_authorization);
+  check_timings_end_stage (timings, CHECK_STAGE_RULES);
+  POLKIT_PROBE2 (rules__end, action_id, implicit_authorization);
+
   /* first see if there's an implicit authorization for subject available */
   if (implicit_authorization == POLKIT_IMPLICIT_AUTHORIZATION_AUTHORIZED)
     {
@@ -1174,10 +2407,15 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
     }
 
   /* then see if there's a temporary authorization for the subject */
-  if (temporary_authorization_store_has_authorization (priv->temporary_authorization_store,
-                                                       subject,
-                                                       action_id,
-                                                       &tmp_authz_id))
+  POLKIT_PROBE1 (temporary_authorization_lookup__begin, action_id);
+  check_timings_begin_stage (timings, CHECK_STAGE_TEMPORARY_AUTHORIZATION);
+  has_tmp_authz = temporary_authorization_store_has_authorization (priv->temporary_authorization_store,
+                                                                   subject,
+                                                                   action_id,
+                                                                   &tmp_authz_id);
+  check_timings_end_stage (timings, CHECK_STAGE_TEMPORARY_AUTHORIZATION);
+  POLKIT_PROBE2 (temporary_authorization_lookup__end, action_id, has_tmp_authz);
+  if (has_tmp_authz)
     {
 
       g_debug (" is authorized (has temporary authorization)");
@@ -1194,6 +2432,8 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
    */
   if (!checking_imply)
     {
+      POLKIT_PROBE1 (implied_lookup__begin, action_id);
+      check_timings_begin_stage (timings, CHECK_STAGE_IMPLIED);
       actions = polkit_backend_action_pool_get_all_actions (priv->action_pool, NULL);
       for (l = actions; l != NULL; l = l->next)
         {
@@ -1221,12 +2461,15 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
                                                                  imply_action_id,
                                                                  details, flags,
                                                                  &implied_implicit_authorization, TRUE,
+                                                                 NULL, /* timings */
                                                                  &implied_error);
                       if (implied_result != NULL)
                         {
                           if (polkit_authorization_result_get_is_authorized (implied_result))
                             {
                               g_debug (" is authorized (implied by %s)", imply_action_id);
+                              check_timings_end_stage (timings, CHECK_STAGE_IMPLIED);
+                              POLKIT_PROBE2 (implied_lookup__end, action_id, TRUE);
                               result = implied_result;
                               /* cleanup */
                               g_strfreev (tokens);
@@ -1241,6 +2484,8 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
               g_strfreev (tokens);
             }
         }
+      check_timings_end_stage (timings, CHECK_STAGE_IMPLIED);
+      POLKIT_PROBE2 (implied_lookup__end, action_id, FALSE);
     }
 
   if (implicit_authorization != POLKIT_IMPLICIT_AUTHORIZATION_NOT_AUTHORIZED)
@@ -1266,6 +2511,12 @@ check_authorization_sync (PolkitBackendAuthority         *authority,
       g_debug (" not authorized");
     }
  out:
+  POLKIT_PROBE4 (check_authorization__end,
+                 subject_str,
+                 action_id,
+                 result != NULL && polkit_authorization_result_get_is_authorized (result),
+                 result != NULL && polkit_authorization_result_get_is_challenge (result));
+
   g_list_foreach (actions, (GFunc) g_object_unref, NULL);
   g_list_free (actions);
 
@@ -1395,6 +2646,49 @@ polkit_backend_interactive_authority_check_authorization_sync (PolkitBackendInte
   return ret;
 }
 
+/**
+ * polkit_backend_interactive_authority_lookup_user:
+ * @authority: A #PolkitBackendInteractiveAuthority.
+ * @uid: A UNIX user id.
+ * @out_user_name: (out): Return location for the user name.
+ * @out_group_names: (out): Return location for the names of the groups the user is in.
+ * @error: Return location for error or %NULL.
+ *
+ * Like polkit_backend_resolver_get_user() but while the rules are run
+ * for a check, the user of the subject is returned as it was looked
+ * up without blocking before running them.
+ *
+ * Returns: %TRUE if the user was found, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_interactive_authority_lookup_user (PolkitBackendInteractiveAuthority   *authority,
+                                                  guint32                              uid,
+                                                  gchar                              **out_user_name,
+                                                  gchar                             ***out_group_names,
+                                                  GError                             **error)
+{
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  CheckAuthorizationData *data;
+
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  data = priv->running_check;
+
+  if (data == NULL ||
+      !data->user_resolved ||
+      polkit_unix_user_get_uid (POLKIT_UNIX_USER (data->user_of_subject)) != (gint) uid)
+    return polkit_backend_resolver_get_user (uid, out_user_name, out_group_names, error);
+
+  if (data->user_error != NULL)
+    {
+      g_propagate_error (error, g_error_copy (data->user_error));
+      return FALSE;
+    }
+
+  *out_user_name = g_strdup (data->user_name);
+  *out_group_names = g_strdupv (data->group_names);
+  return TRUE;
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 struct AuthenticationSession
@@ -1530,12 +2824,21 @@ authentication_session_new (AuthenticationAgent         *agent,
                                                                  session);
     }
 
+  /* the session is cancelled if either of these vanish */
+  watch_system_bus_name (authority, session->initiated_by_system_bus_unique_name);
+  if (POLKIT_IS_SYSTEM_BUS_NAME (session->subject))
+    watch_system_bus_name (authority, polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (session->subject)));
+
   return session;
 }
 
 static void
 authentication_session_free (AuthenticationSession *session)
 {
+  unwatch_system_bus_name (session->authority, session->initiated_by_system_bus_unique_name);
+  if (POLKIT_IS_SYSTEM_BUS_NAME (session->subject))
+    unwatch_system_bus_name (session->authority, polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (session->subject)));
+
   authentication_agent_unref (session->agent);
   g_free (session->cookie);
   g_list_foreach (session->identities, (GFunc) g_object_unref, NULL);
@@ -1609,6 +2912,28 @@ authentication_agent_unref (AuthenticationAgent *agent)
     }
 }
 
+static gsize
+authentication_agent_get_memory_usage (AuthenticationAgent *agent)
+{
+  gsize ret;
+
+  ret = sizeof (AuthenticationAgent);
+  ret += polkit_backend_string_size (agent->locale);
+  ret += polkit_backend_string_size (agent->object_path);
+  ret += polkit_backend_string_size (agent->unique_system_bus_name);
+  ret += polkit_backend_string_size (agent->cookie_prefix);
+  if (agent->registration_options != NULL)
+    ret += g_variant_get_size (agent->registration_options);
+  /* the state of the Mersenne twister behind GRand */
+  ret += 625 * sizeof (guint32);
+  /* the proxy, its connection is shared */
+  if (agent->proxy != NULL)
+    ret += 2 * POLKIT_BACKEND_OBJECT_SIZE;
+  ret += g_list_length (agent->active_sessions) * (POLKIT_BACKEND_LIST_NODE_SIZE + sizeof (AuthenticationSession));
+
+  return ret;
+}
+
 static AuthenticationAgent *
 authentication_agent_new (guint64      serial,
                           PolkitSubject *scope,
@@ -1932,6 +3257,12 @@ authentication_agent_begin_cb (GDBusProxy   *proxy,
 
   session->agent->active_sessions = g_list_remove (session->agent->active_sessions, session);
 
+  POLKIT_PROBE4 (agent_challenge__end,
+                 session->cookie,
+                 session->action_id,
+                 gained_authorization,
+                 was_dismissed);
+
   session->callback (session->agent,
                      session->subject,
                      session->user_of_subject,
@@ -2172,113 +3503,88 @@ add_pid (PolkitDetails *details,
 /* ---------------------------------------------------------------------------------------------------- */
 
 static GList *
-get_users_in_group (PolkitIdentity                    *group,
-                    gboolean                           include_root)
+users_to_identities (gchar      **user_names,
+                     guint32     *uids,
+                     const gchar *group_kind,
+                     gboolean     include_root)
 {
-  gid_t gid;
-  struct group *grp;
   GList *ret;
   guint n;
 
   ret = NULL;
 
-  gid = polkit_unix_group_get_gid (POLKIT_UNIX_GROUP (group));
-  grp = getgrgid (gid);
-  if (grp == NULL)
-    {
-      g_warning ("Error looking up group with gid %d: %s", gid, g_strerror (errno));
-      goto out;
-    }
-
-  for (n = 0; grp->gr_mem != NULL && grp->gr_mem[n] != NULL; n++)
+  for (n = 0; user_names[n] != NULL; n++)
     {
-      PolkitIdentity *user;
-      GError *error;
-
-      if (!include_root && g_strcmp0 (grp->gr_mem[n], "root") == 0)
+      if (!include_root && g_strcmp0 (user_names[n], "root") == 0)
         continue;
 
-      error = NULL;
-      user = polkit_unix_user_new_for_name (grp->gr_mem[n], &error);
-      if (user == NULL)
-        {
-          g_warning ("Unknown username '%s' in group: %s", grp->gr_mem[n], error->message);
-          g_error_free (error);
-        }
+      if (uids[n] == (guint32) -1)
+        g_warning ("Unknown username '%s' in %s", user_names[n], group_kind);
       else
-        {
-          ret = g_list_prepend (ret, user);
-        }
+        ret = g_list_prepend (ret, polkit_unix_user_new (uids[n]));
     }
 
-  ret = g_list_reverse (ret);
-
- out:
-  return ret;
+  return g_list_reverse (ret);
 }
 
+/* Returns the identities allowed to authenticate, which may include
+ * groups and netgroups. Runs the admin rules if administrator
+ * authentication is required.
+ */
 static GList *
-get_users_in_net_group (PolkitIdentity                    *group,
-                        gboolean                           include_root)
+get_identities_for_challenge (PolkitBackendInteractiveAuthority *authority,
+                              PolkitSubject                     *caller,
+                              PolkitSubject                     *subject,
+                              PolkitIdentity                    *user_of_subject,
+                              const gchar                       *action_id,
+                              PolkitDetails                     *details,
+                              PolkitImplicitAuthorization        implicit_authorization)
 {
-  const gchar *name;
-  GList *ret;
-
-  ret = NULL;
-  name = polkit_unix_netgroup_get_name (POLKIT_UNIX_NETGROUP (group));
+  PolkitBackendInteractiveAuthorityPrivate *priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
+  GList *identities;
 
-#ifdef HAVE_SETNETGRENT_RETURN
-  if (setnetgrent (name) == 0)
-    {
-      g_warning ("Error looking up net group with name %s: %s", name, g_strerror (errno));
-      goto out;
-    }
-#else
-  setnetgrent (name);
-#endif
+  identities = NULL;
 
-  for (;;)
+  /* select admin user if required by the implicit authorization */
+  if (implicit_authorization == POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED ||
+      implicit_authorization == POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED_RETAINED)
     {
-#if defined(HAVE_NETBSD) || defined(HAVE_OPENBSD)
-      const char *hostname, *username, *domainname;
-#else
-      char *hostname, *username, *domainname;
-#endif
-      PolkitIdentity *user;
-      GError *error = NULL;
-
-      if (getnetgrent (&hostname, &username, &domainname) == 0)
-        break;
-
-      /* Skip NULL entries since we never want to make everyone an admin
-       * Skip "-" entries which mean "no match ever" in netgroup land */
-      if (username == NULL || g_strcmp0 (username, "-") == 0)
-        continue;
-
-      /* TODO: Should we match on hostname? Maybe only allow "-" as a hostname
-       * for safety. */
+      gboolean is_local = FALSE;
+      gboolean is_active = FALSE;
+      PolkitSubject *session_for_subject = NULL;
 
-      user = polkit_unix_user_new_for_name (username, &error);
-      if (user == NULL)
-        {
-          g_warning ("Unknown username '%s' in unix-netgroup: %s", username, error->message);
-          g_error_free (error);
-        }
-      else
+      session_for_subject = polkit_backend_session_monitor_get_session_for_subject (priv->session_monitor,
+                                                                                    subject,
+                                                                                    NULL);
+      if (session_for_subject != NULL)
         {
-          ret = g_list_prepend (ret, user);
+          is_local = polkit_backend_session_monitor_is_session_local (priv->session_monitor, session_for_subject);
+          is_active = polkit_backend_session_monitor_is_session_active (priv->session_monitor, session_for_subject);
         }
-    }
 
-  ret = g_list_reverse (ret);
+      identities = polkit_backend_interactive_authority_get_admin_identities (authority,
+                                                                              caller,
+                                                                              subject,
+                                                                              user_of_subject,
+                                                                              is_local,
+                                                                              is_active,
+                                                                              action_id,
+                                                                              details);
+      g_clear_object (&session_for_subject);
+    }
+  else
+    {
+      identities = g_list_prepend (identities, g_object_ref (user_of_subject));
+    }
 
- out:
-  endnetgrent ();
-  return ret;
+  return identities;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* @user_identities are the users who may authenticate, with groups
+ * and netgroups already expanded
+ */
 static void
 authentication_agent_initiate_challenge (AuthenticationAgent         *agent,
                                          PolkitSubject               *subject,
@@ -2287,20 +3593,18 @@ authentication_agent_initiate_challenge (AuthenticationAgent         *agent,
                                          const gchar                 *action_id,
                                          PolkitDetails               *details,
                                          PolkitSubject               *caller,
+                                         GList                       *user_identities,
                                          PolkitImplicitAuthorization  implicit_authorization,
                                          GCancellable                *cancellable,
                                          AuthenticationAgentCallback  callback,
                                          gpointer                     user_data)
 {
-  PolkitBackendInteractiveAuthorityPrivate *priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (authority);
   AuthenticationSession *session;
   GList *l;
-  GList *identities;
   gchar *localized_message;
   gchar *localized_icon_name;
   PolkitDetails *localized_details;
   GVariant *details_gvariant;
-  GList *user_identities = NULL;
   GVariantBuilder identities_builder;
   GVariant *parameters;
 
@@ -2315,67 +3619,6 @@ authentication_agent_initiate_challenge (AuthenticationAgent         *agent,
                                     &localized_icon_name,
                                     &localized_details);
 
-  identities = NULL;
-
-  /* select admin user if required by the implicit authorization */
-  if (implicit_authorization == POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED ||
-      implicit_authorization == POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED_RETAINED)
-    {
-      gboolean is_local = FALSE;
-      gboolean is_active = FALSE;
-      PolkitSubject *session_for_subject = NULL;
-
-      session_for_subject = polkit_backend_session_monitor_get_session_for_subject (priv->session_monitor,
-                                                                                    subject,
-                                                                                    NULL);
-      if (session_for_subject != NULL)
-        {
-          is_local = polkit_backend_session_monitor_is_session_local (priv->session_monitor, session_for_subject);
-          is_active = polkit_backend_session_monitor_is_session_active (priv->session_monitor, session_for_subject);
-        }
-
-      identities = polkit_backend_interactive_authority_get_admin_identities (authority,
-                                                                              caller,
-                                                                              subject,
-                                                                              user_of_subject,
-                                                                              is_local,
-                                                                              is_active,
-                                                                              action_id,
-                                                                              details);
-      g_clear_object (&session_for_subject);
-    }
-  else
-    {
-      identities = g_list_prepend (identities, g_object_ref (user_of_subject));
-    }
-
-  /* expand groups/netgroups to users */
-  user_identities = NULL;
-  for (l = identities; l != NULL; l = l->next)
-    {
-      PolkitIdentity *identity = POLKIT_IDENTITY (l->data);
-      if (POLKIT_IS_UNIX_USER (identity))
-        {
-          user_identities = g_list_append (user_identities, g_object_ref (identity));
-        }
-      else if (POLKIT_IS_UNIX_GROUP (identity))
-        {
-          user_identities = g_list_concat (user_identities, get_users_in_group (identity, FALSE));
-        }
-      else if (POLKIT_IS_UNIX_NETGROUP (identity))
-        {
-          user_identities =  g_list_concat (user_identities, get_users_in_net_group (identity, FALSE));
-        }
-      else
-        {
-          g_warning ("Unsupported identity");
-        }
-    }
-
-  /* Fall back to uid 0 if no users are available (rhbz #834494) */
-  if (user_identities == NULL)
-    user_identities = g_list_prepend (NULL, polkit_unix_user_new (0));
-
   session = authentication_session_new (agent,
                                         subject,
                                         user_of_subject,
@@ -2392,6 +3635,11 @@ authentication_agent_initiate_challenge (AuthenticationAgent         *agent,
 
   agent->active_sessions = g_list_prepend (agent->active_sessions, session);
 
+  POLKIT_PROBE3 (agent_challenge__begin,
+                 session->cookie,
+                 session->action_id,
+                 agent->unique_system_bus_name);
+
   if (localized_details == NULL)
     localized_details = polkit_details_new ();
   add_pid (localized_details, caller, "polkit.caller-pid");
@@ -2429,10 +3677,6 @@ authentication_agent_initiate_challenge (AuthenticationAgent         *agent,
                      (GAsyncReadyCallback) authentication_agent_begin_cb,
                      session);
 
-  g_list_free_full (user_identities, g_object_unref);
-  g_list_foreach (identities, (GFunc) g_object_unref, NULL);
-  g_list_free (identities);
-
   g_free (localized_message);
   g_free (localized_icon_name);
   if (localized_details != NULL)
@@ -2498,6 +3742,7 @@ polkit_backend_interactive_authority_register_authentication_agent (PolkitBacken
 
   interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
 
   if (POLKIT_IS_UNIX_SESSION (subject))
     {
@@ -2593,6 +3838,7 @@ polkit_backend_interactive_authority_register_authentication_agent (PolkitBacken
   g_hash_table_insert (priv->hash_scope_to_authentication_agent,
                        g_object_ref (subject),
                        agent);
+  watch_system_bus_name (authority, agent->unique_system_bus_name);
 
   caller_cmdline = _polkit_subject_get_cmdline (caller);
   if (caller_cmdline == NULL)
@@ -2651,6 +3897,7 @@ polkit_backend_interactive_authority_unregister_authentication_agent (PolkitBack
 
   interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
 
   ret = FALSE;
   session_for_caller = NULL;
@@ -2772,6 +4019,7 @@ polkit_backend_interactive_authority_unregister_authentication_agent (PolkitBack
   g_free (scope_str);
 
   authentication_agent_cancel_all_sessions (agent);
+  unwatch_system_bus_name (authority, agent->unique_system_bus_name);
   /* this works because we have exactly one agent per session */
   /* this frees agent... */
   g_hash_table_remove (priv->hash_scope_to_authentication_agent, agent->scope);
@@ -2810,6 +4058,7 @@ polkit_backend_interactive_authority_authentication_agent_response (PolkitBacken
 
   interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
 
   ret = FALSE;
   user_of_caller = NULL;
@@ -2903,6 +4152,8 @@ polkit_backend_interactive_authority_system_bus_name_owner_changed (PolkitBacken
       GList *sessions;
       GList *l;
 
+      remember_vanished_name (interactive_authority, name);
+
       agent = get_authentication_agent_by_unique_system_bus_name (interactive_authority, name);
       if (agent != NULL)
         {
@@ -2924,6 +4175,7 @@ polkit_backend_interactive_authority_system_bus_name_owner_changed (PolkitBacken
           g_free (scope_str);
 
           authentication_agent_cancel_all_sessions (agent);
+          unwatch_system_bus_name (interactive_authority, agent->unique_system_bus_name);
           /* this works because we have exactly one agent per session */
           /* this frees agent... */
           g_hash_table_remove (priv->hash_scope_to_authentication_agent, agent->scope);
@@ -2968,10 +4220,29 @@ typedef struct TemporaryAuthorization TemporaryAuthorization;
 struct TemporaryAuthorizationStore
 {
   GList *authorizations;
+  /* index from scope (typically a PolkitUnixSession) to a GQueue of
+   * TemporaryAuthorization objects so per-session enumeration and
+   * revocation only visits the entries for that session
+   */
+  GHashTable *scope_to_authorizations;
   PolkitBackendInteractiveAuthority *authority;
   guint64 serial;
+  /* approximate memory used by the authorizations, 0 for no limit */
+  gsize num_bytes;
+  gsize max_bytes;
+  guint64 num_evicted;
+  /* file kept up to date with the authorizations so they survive a restart, if any */
+  gchar *file;
+  guint save_id;
 };
 
+/* TODO: right now the time the temporary authorization is kept is hard-coded - we
+ *       could make it a propery on the PolkitBackendInteractiveAuthority class (so
+ *       the local authority could read it from a config file) or a vfunc
+ *       (so the local authority could read it from an annotation on the action).
+ */
+#define TEMPORARY_AUTHORIZATION_EXPIRATION_SECONDS (5 * 60)
+
 struct TemporaryAuthorization
 {
   TemporaryAuthorizationStore *store;
@@ -2988,6 +4259,17 @@ struct TemporaryAuthorization
   guint check_vanished_timeout_id;
 };
 
+/* Filter passed in the options of EnumerateTemporaryAuthorizationsWithOptions()
+ * and RevokeTemporaryAuthorizationsWithOptions()
+ */
+typedef struct
+{
+  gchar *action_id_prefix;
+  PolkitSubject *subject;
+  /* monotonic time; authorizations granted before this are filtered out */
+  gint64 granted_after;
+} TemporaryAuthorizationFilter;
+
 static void
 temporary_authorization_free (TemporaryAuthorization *authorization)
 {
@@ -3002,6 +4284,22 @@ temporary_authorization_free (TemporaryAuthorization *authorization)
   g_free (authorization);
 }
 
+static gsize
+temporary_authorization_get_size (TemporaryAuthorization *authorization)
+{
+  gsize ret;
+
+  ret = sizeof (TemporaryAuthorization);
+  ret += polkit_backend_string_size (authorization->id);
+  ret += polkit_backend_string_size (authorization->action_id);
+  /* the subject, the nodes in the list and in the queue of the scope and the timeouts */
+  ret += POLKIT_BACKEND_OBJECT_SIZE;
+  ret += 2 * POLKIT_BACKEND_LIST_NODE_SIZE;
+  ret += 2 * POLKIT_BACKEND_OBJECT_SIZE;
+
+  return ret;
+}
+
 static TemporaryAuthorizationStore *
 temporary_authorization_store_new (PolkitBackendInteractiveAuthority *authority)
 {
@@ -3010,16 +4308,139 @@ temporary_authorization_store_new (PolkitBackendInteractiveAuthority *authority)
   store = g_new0 (TemporaryAuthorizationStore, 1);
   store->authority = authority;
   store->authorizations = NULL;
+  store->scope_to_authorizations = g_hash_table_new_full ((GHashFunc) polkit_subject_hash,
+                                                          (GEqualFunc) polkit_subject_equal,
+                                                          (GDestroyNotify) g_object_unref,
+                                                          (GDestroyNotify) g_queue_free);
 
   return store;
 }
 
-static void
-temporary_authorization_store_free (TemporaryAuthorizationStore *store)
-{
-  g_list_foreach (store->authorizations, (GFunc) temporary_authorization_free, NULL);
-  g_list_free (store->authorizations);
-  g_free (store);
+static void
+temporary_authorization_store_free (TemporaryAuthorizationStore *store)
+{
+  if (store->save_id > 0)
+    g_source_remove (store->save_id);
+  g_free (store->file);
+  g_hash_table_unref (store->scope_to_authorizations);
+  g_list_foreach (store->authorizations, (GFunc) temporary_authorization_free, NULL);
+  g_list_free (store->authorizations);
+  g_free (store);
+}
+
+static gboolean
+on_save_idle (gpointer user_data)
+{
+  TemporaryAuthorizationStore *store = user_data;
+  GError *error;
+
+  store->save_id = 0;
+
+  error = NULL;
+  if (!temporary_authorization_store_save (store, store->file, &error))
+    {
+      polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (store->authority),
+                                    "Error saving temporary authorizations: %s",
+                                    error->message);
+      g_error_free (error);
+    }
+
+  /* remove source */
+  return FALSE;
+}
+
+/* Writes the file from an idle handler so a burst of changes, e.g. when
+ * a session ends, only results in a single write
+ */
+static void
+temporary_authorization_store_schedule_save (TemporaryAuthorizationStore *store)
+{
+  if (store->file == NULL || store->save_id > 0)
+    return;
+  store->save_id = g_idle_add (on_save_idle, store);
+}
+
+static void
+temporary_authorization_store_link (TemporaryAuthorizationStore *store,
+                                    TemporaryAuthorization      *authorization)
+{
+  GQueue *queue;
+
+  store->authorizations = g_list_prepend (store->authorizations, authorization);
+  store->num_bytes += temporary_authorization_get_size (authorization);
+
+  if (POLKIT_IS_SYSTEM_BUS_NAME (authorization->subject))
+    watch_system_bus_name (store->authority,
+                           polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (authorization->subject)));
+
+  queue = g_hash_table_lookup (store->scope_to_authorizations, authorization->scope);
+  if (queue == NULL)
+    {
+      queue = g_queue_new ();
+      g_hash_table_insert (store->scope_to_authorizations,
+                           g_object_ref (authorization->scope),
+                           queue);
+    }
+  g_queue_push_head (queue, authorization);
+
+  temporary_authorization_store_schedule_save (store);
+}
+
+/* Removes @authorization from @store and frees it */
+static void
+temporary_authorization_store_remove (TemporaryAuthorizationStore *store,
+                                      TemporaryAuthorization      *authorization)
+{
+  GQueue *queue;
+
+  store->authorizations = g_list_remove (store->authorizations, authorization);
+  store->num_bytes -= temporary_authorization_get_size (authorization);
+
+  if (POLKIT_IS_SYSTEM_BUS_NAME (authorization->subject))
+    unwatch_system_bus_name (store->authority,
+                             polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (authorization->subject)));
+
+  queue = g_hash_table_lookup (store->scope_to_authorizations, authorization->scope);
+  if (queue != NULL)
+    {
+      g_queue_remove (queue, authorization);
+      if (g_queue_is_empty (queue))
+        g_hash_table_remove (store->scope_to_authorizations, authorization->scope);
+    }
+
+  temporary_authorization_free (authorization);
+
+  temporary_authorization_store_schedule_save (store);
+}
+
+/* XXX: for now, prefer to store the process */
+static PolkitSubject *
+temporary_authorization_store_resolve_subject (PolkitSubject *subject)
+{
+  PolkitSubject *ret;
+
+  if (POLKIT_IS_SYSTEM_BUS_NAME (subject))
+    {
+      GError *error;
+      error = NULL;
+      ret = polkit_system_bus_name_get_process_sync (POLKIT_SYSTEM_BUS_NAME (subject),
+                                                     NULL,
+                                                     &error);
+      if (ret == NULL)
+        {
+          g_printerr ("Error getting process for system bus name `%s': %s\n",
+                      polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (subject)),
+                      error->message);
+          g_error_free (error);
+          ret = g_object_ref (subject);
+        }
+    }
+  else
+    {
+      ret = g_object_ref (subject);
+    }
+
+  return ret;
 }
 
 static gboolean
@@ -3036,27 +4457,7 @@ temporary_authorization_store_has_authorization (TemporaryAuthorizationStore *st
   g_return_val_if_fail (POLKIT_IS_SUBJECT (subject), FALSE);
   g_return_val_if_fail (action_id != NULL, FALSE);
 
-  /* XXX: for now, prefer to store the process */
-  if (POLKIT_IS_SYSTEM_BUS_NAME (subject))
-    {
-      GError *error;
-      error = NULL;
-      subject_to_use = polkit_system_bus_name_get_process_sync (POLKIT_SYSTEM_BUS_NAME (subject),
-                                                                NULL,
-                                                                &error);
-      if (subject_to_use == NULL)
-        {
-          g_printerr ("Error getting process for system bus name `%s': %s\n",
-                      polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (subject)),
-                      error->message);
-          g_error_free (error);
-          subject_to_use = g_object_ref (subject);
-        }
-    }
-  else
-    {
-      subject_to_use = g_object_ref (subject);
-    }
+  subject_to_use = temporary_authorization_store_resolve_subject (subject);
 
   ret = FALSE;
 
@@ -3082,6 +4483,7 @@ static gboolean
 on_expiration_timeout (gpointer user_data)
 {
   TemporaryAuthorization *authorization = user_data;
+  TemporaryAuthorizationStore *store = authorization->store;
   gchar *s;
 
   s = polkit_subject_to_string (authorization->subject);
@@ -3092,11 +4494,9 @@ on_expiration_timeout (gpointer user_data)
            s);
   g_free (s);
 
-  authorization->store->authorizations = g_list_remove (authorization->store->authorizations,
-                                                        authorization);
   authorization->expiration_timeout_id = 0;
-  g_signal_emit_by_name (authorization->store->authority, "changed");
-  temporary_authorization_free (authorization);
+  temporary_authorization_store_remove (store, authorization);
+  g_signal_emit_by_name (store->authority, "changed");
 
   /* remove source */
   return FALSE;
@@ -3106,6 +4506,7 @@ static gboolean
 on_unix_process_check_vanished_timeout (gpointer user_data)
 {
   TemporaryAuthorization *authorization = user_data;
+  TemporaryAuthorizationStore *store = authorization->store;
   GError *error;
 
   /* we know that this is a PolkitUnixProcess so the check is fast (no IPC involved) */
@@ -3131,172 +4532,649 @@ on_unix_process_check_vanished_timeout (gpointer user_data)
                    s);
           g_free (s);
 
-          authorization->store->authorizations = g_list_remove (authorization->store->authorizations,
-                                                                authorization);
-          g_signal_emit_by_name (authorization->store->authority, "changed");
-          temporary_authorization_free (authorization);
+          /* temporary_authorization_free() removes this source, so make sure
+           * we don't end up removing it twice
+           */
+          authorization->check_vanished_timeout_id = 0;
+          temporary_authorization_store_remove (store, authorization);
+          g_signal_emit_by_name (store->authority, "changed");
+
+          /* remove source */
+          return FALSE;
+        }
+    }
+
+  /* keep source around */
+  return TRUE;
+}
+
+static void
+temporary_authorization_store_remove_authorizations_for_system_bus_name (TemporaryAuthorizationStore *store,
+                                                                         const gchar *name)
+{
+  guint num_removed;
+  GList *l, *ll;
+
+  num_removed = 0;
+  for (l = store->authorizations; l != NULL; l = ll)
+    {
+      TemporaryAuthorization *ta = l->data;
+      gchar *s;
+
+      ll = l->next;
+
+      if (!POLKIT_IS_SYSTEM_BUS_NAME (ta->subject))
+        continue;
+
+      if (g_strcmp0 (name, polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (ta->subject))) != 0)
+        continue;
+
+
+      s = polkit_subject_to_string (ta->subject);
+      g_debug ("Removing tempoary authorization with id `%s' for action-id `%s' for subject `%s': "
+               "subject has vanished",
+               ta->id,
+               ta->action_id,
+               s);
+      g_free (s);
+
+      temporary_authorization_store_remove (store, ta);
+
+      num_removed++;
+    }
+
+  if (num_removed > 0)
+    g_signal_emit_by_name (store->authority, "changed");
+}
+
+/* Removes the authorizations expiring first until @store is below its
+ * limit, never removing @keep
+ */
+static void
+temporary_authorization_store_evict (TemporaryAuthorizationStore *store,
+                                     TemporaryAuthorization      *keep)
+{
+  guint num_evicted;
+
+  num_evicted = 0;
+  while (store->max_bytes > 0 && store->num_bytes > store->max_bytes)
+    {
+      TemporaryAuthorization *oldest;
+      GList *l;
+
+      oldest = NULL;
+      for (l = store->authorizations; l != NULL; l = l->next)
+        {
+          TemporaryAuthorization *ta = l->data;
+          if (ta != keep && (oldest == NULL || ta->time_expires < oldest->time_expires))
+            oldest = ta;
+        }
+      if (oldest == NULL)
+        break;
+
+      g_debug ("Removing tempoary authorization with id `%s' for action-id `%s': "
+               "temporary authorizations use more than %" G_GSIZE_FORMAT " bytes",
+               oldest->id,
+               oldest->action_id,
+               store->max_bytes);
+      temporary_authorization_store_remove (store, oldest);
+      num_evicted++;
+    }
+
+  if (num_evicted > 0)
+    {
+      store->num_evicted += num_evicted;
+      polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (store->authority),
+                                    "Revoked %u temporary authorizations to stay below %" G_GSIZE_FORMAT " bytes",
+                                    num_evicted,
+                                    store->max_bytes);
+    }
+}
+
+static void
+temporary_authorization_store_set_limit (TemporaryAuthorizationStore *store,
+                                         gsize                        max_bytes)
+{
+  store->max_bytes = max_bytes;
+  temporary_authorization_store_evict (store, NULL);
+}
+
+static gsize
+temporary_authorization_store_get_memory_usage (TemporaryAuthorizationStore *store,
+                                                guint                       *out_num_authorizations,
+                                                gsize                       *out_max_bytes,
+                                                guint64                     *out_num_evicted)
+{
+  *out_num_authorizations = g_list_length (store->authorizations);
+  *out_max_bytes = store->max_bytes;
+  *out_num_evicted = store->num_evicted;
+  return sizeof (TemporaryAuthorizationStore) + store->num_bytes;
+}
+
+/* Sets up the timeouts for @authorization and adds it to @store */
+static void
+temporary_authorization_store_insert (TemporaryAuthorizationStore *store,
+                                      TemporaryAuthorization      *authorization)
+{
+  gint64 remaining;
+
+  authorization->store = store;
+
+  /* g_timeout_add() is using monotonic time since 2.28 */
+  remaining = authorization->time_expires - g_get_monotonic_time ();
+  authorization->expiration_timeout_id = g_timeout_add (MAX (remaining, 0) / 1000,
+                                                        on_expiration_timeout,
+                                                        authorization);
+
+  if (POLKIT_IS_UNIX_PROCESS (authorization->subject))
+    {
+      /* For now, set up a timer to poll every two seconds - this is used to determine
+       * when the process vanishes. We want to do this so we can remove the temporary
+       * authorization - this is because we want agents to update e.g. a notification
+       * area icon saying the user has temporary authorizations (e.g. remove the icon).
+       *
+       * Ideally we'd just do
+       *
+       *   g_signal_connect (kernel, "process-exited", G_CALLBACK (on_process_exited), user_data);
+       *
+       * but that is not how things work right now (and, hey, it's not like the kernel
+       * is a GObject either!) - so we poll.
+       *
+       * TODO: On Linux, it might be possible to obtain notifications by connecting
+       *       to the netlink socket. Needs looking into.
+       */
+
+      authorization->check_vanished_timeout_id = g_timeout_add_seconds (2,
+                                                                        on_unix_process_check_vanished_timeout,
+                                                                        authorization);
+    }
+#if 0
+  else if (POLKIT_IS_SYSTEM_BUS_NAME (authorization->subject))
+    {
+      /* This is currently handled in polkit_backend_interactive_authority_system_bus_name_owner_changed()  */
+    }
+#endif
+
+
+  temporary_authorization_store_link (store, authorization);
+  temporary_authorization_store_evict (store, authorization);
+}
+
+static const gchar *
+temporary_authorization_store_add_authorization (TemporaryAuthorizationStore *store,
+                                                 PolkitSubject               *subject,
+                                                 PolkitSubject               *scope,
+                                                 const gchar                 *action_id)
+{
+  TemporaryAuthorization *authorization;
+  PolkitSubject *subject_to_use;
+
+  g_return_val_if_fail (store != NULL, NULL);
+  g_return_val_if_fail (POLKIT_IS_SUBJECT (subject), NULL);
+  g_return_val_if_fail (action_id != NULL, NULL);
+  g_return_val_if_fail (!temporary_authorization_store_has_authorization (store, subject, action_id, NULL), NULL);
+
+  subject_to_use = temporary_authorization_store_resolve_subject (subject);
+
+  authorization = g_new0 (TemporaryAuthorization, 1);
+  authorization->id = g_strdup_printf ("tmpauthz%" G_GUINT64_FORMAT, store->serial++);
+  authorization->subject = g_object_ref (subject_to_use);
+  authorization->scope = g_object_ref (scope);
+  authorization->action_id = g_strdup (action_id);
+  /* store monotonic time and convert to secs-since-epoch when returning TemporaryAuthorization structs */
+  authorization->time_granted = g_get_monotonic_time ();
+  authorization->time_expires = authorization->time_granted + TEMPORARY_AUTHORIZATION_EXPIRATION_SECONDS * G_USEC_PER_SEC;
+
+  temporary_authorization_store_insert (store, authorization);
+
+  g_object_unref (subject_to_use);
+
+  return authorization->id;
+}
+
+/* The file is a serialized GVariant of type (ua(ssssxx)) - the format
+ * version followed by the id, subject, scope and action id of each
+ * authorization and the wall-clock times it was granted and expires.
+ * Wall-clock time is used because the monotonic clock starts over on
+ * boot so a file that is not on a tmpfs would otherwise keep stale
+ * authorizations alive.
+ */
+#define TEMPORARY_AUTHORIZATION_FILE_VERSION 1
+
+static void
+temporary_authorization_store_set_file (TemporaryAuthorizationStore *store,
+                                        const gchar                 *path)
+{
+  if (store->save_id > 0)
+    {
+      g_source_remove (store->save_id);
+      store->save_id = 0;
+    }
+  g_free (store->file);
+  store->file = g_strdup (path);
+}
+
+static gboolean
+temporary_authorization_store_is_saved (TemporaryAuthorizationStore *store)
+{
+  return store->file != NULL;
+}
+
+static gboolean
+temporary_authorization_store_save (TemporaryAuthorizationStore  *store,
+                                    const gchar                  *path,
+                                    GError                      **error)
+{
+  gboolean ret = FALSE;
+  GVariantBuilder builder;
+  GVariant *value = NULL;
+  gchar *tmp_path = NULL;
+  const gchar *data;
+  gsize size;
+  gint64 offset;
+  gint fd = -1;
+  GList *l;
+
+  /* converts monotonic time to wall-clock time */
+  offset = g_get_real_time () - g_get_monotonic_time ();
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssssxx)"));
+  for (l = store->authorizations; l != NULL; l = l->next)
+    {
+      TemporaryAuthorization *ta = l->data;
+      gchar *subject_str;
+      gchar *scope_str;
+
+      /* without the start time the process can't be told apart from one reusing its pid */
+      if (POLKIT_IS_UNIX_PROCESS (ta->subject) &&
+          polkit_unix_process_get_start_time (POLKIT_UNIX_PROCESS (ta->subject)) == 0)
+        continue;
+
+      subject_str = polkit_subject_to_string (ta->subject);
+      scope_str = polkit_subject_to_string (ta->scope);
+      g_variant_builder_add (&builder, "(ssssxx)",
+                             ta->id,
+                             subject_str,
+                             scope_str,
+                             ta->action_id,
+                             ta->time_granted + offset,
+                             ta->time_expires + offset);
+      g_free (subject_str);
+      g_free (scope_str);
+    }
+  value = g_variant_ref_sink (g_variant_new ("(u@a(ssssxx))",
+                                             TEMPORARY_AUTHORIZATION_FILE_VERSION,
+                                             g_variant_builder_end (&builder)));
+
+  /* g_mkstemp() creates the file with mode 0600 */
+  tmp_path = g_strdup_printf ("%s.XXXXXX", path);
+  fd = g_mkstemp (tmp_path);
+  if (fd == -1)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Error creating %s: %s", tmp_path, g_strerror (errno));
+      g_free (tmp_path);
+      tmp_path = NULL;
+      goto out;
+    }
+
+  data = g_variant_get_data (value);
+  size = g_variant_get_size (value);
+  while (size > 0)
+    {
+      gssize num_written;
+
+      num_written = write (fd, data, size);
+      if (num_written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                       "Error writing to %s: %s", tmp_path, g_strerror (errno));
+          goto out;
         }
+      data += num_written;
+      size -= num_written;
+    }
+
+  if (close (fd) != 0)
+    {
+      fd = -1;
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Error closing %s: %s", tmp_path, g_strerror (errno));
+      goto out;
+    }
+  fd = -1;
+
+  /* atomically, so a crash never leaves a truncated file behind */
+  if (g_rename (tmp_path, path) != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Error renaming %s to %s: %s", tmp_path, path, g_strerror (errno));
+      goto out;
+    }
+
+  ret = TRUE;
+
+ out:
+  if (fd != -1)
+    close (fd);
+  if (!ret && tmp_path != NULL)
+    g_unlink (tmp_path);
+  g_free (tmp_path);
+  if (value != NULL)
+    g_variant_unref (value);
+  return ret;
+}
+
+/* Re-creates a saved authorization unless it has expired or its subject has vanished */
+static gboolean
+temporary_authorization_store_restore (TemporaryAuthorizationStore *store,
+                                       const gchar                 *id,
+                                       const gchar                 *subject_str,
+                                       const gchar                 *scope_str,
+                                       const gchar                 *action_id,
+                                       gint64                       granted,
+                                       gint64                       expires,
+                                       gint64                       now_real,
+                                       gint64                       now_monotonic)
+{
+  gboolean ret = FALSE;
+  PolkitSubject *subject = NULL;
+  PolkitSubject *scope = NULL;
+  TemporaryAuthorization *authorization;
+  gint64 lifetime;
+  GError *error = NULL;
+  GList *l;
+
+  if (expires <= now_real)
+    goto out;
+
+  subject = polkit_subject_from_string (subject_str, &error);
+  if (subject == NULL)
+    goto out;
+  scope = polkit_subject_from_string (scope_str, &error);
+  if (scope == NULL)
+    goto out;
+
+  /* For a process this checks that the pid still has the start time it had when
+   * the authorization was granted, i.e. that it has not been reused. Unique bus
+   * names are never reused.
+   */
+  if (!polkit_subject_exists_sync (subject, NULL, &error))
+    goto out;
+
+  if (temporary_authorization_store_has_authorization (store, subject, action_id, NULL))
+    goto out;
+
+  authorization = g_new0 (TemporaryAuthorization, 1);
+
+  /* keep the id so agents showing it can still revoke the authorization */
+  for (l = store->authorizations; l != NULL; l = l->next)
+    {
+      TemporaryAuthorization *ta = l->data;
+      if (g_strcmp0 (ta->id, id) == 0)
+        break;
+    }
+  if (l == NULL && g_str_has_prefix (id, "tmpauthz"))
+    {
+      authorization->id = g_strdup (id);
+      store->serial = MAX (store->serial, g_ascii_strtoull (id + strlen ("tmpauthz"), NULL, 10) + 1);
+    }
+  else
+    {
+      authorization->id = g_strdup_printf ("tmpauthz%" G_GUINT64_FORMAT, store->serial++);
+    }
+
+  authorization->subject = g_object_ref (subject);
+  authorization->scope = g_object_ref (scope);
+  authorization->action_id = g_strdup (action_id);
+
+  /* the wall-clock may have been set while we were not running, never let
+   * that extend an authorization beyond its original lifetime
+   */
+  lifetime = TEMPORARY_AUTHORIZATION_EXPIRATION_SECONDS * G_USEC_PER_SEC;
+  authorization->time_granted = now_monotonic - CLAMP (now_real - granted, 0, lifetime);
+  authorization->time_expires = now_monotonic + MIN (expires - now_real, lifetime);
+
+  temporary_authorization_store_insert (store, authorization);
+
+  ret = TRUE;
+
+ out:
+  if (error != NULL)
+    {
+      g_debug ("Not restoring temporary authorization with id `%s' for action-id `%s' for subject `%s': %s",
+               id,
+               action_id,
+               subject_str,
+               error->message);
+      g_error_free (error);
     }
-
-  /* keep source around */
-  return TRUE;
+  if (subject != NULL)
+    g_object_unref (subject);
+  if (scope != NULL)
+    g_object_unref (scope);
+  return ret;
 }
 
-static void
-temporary_authorization_store_remove_authorizations_for_system_bus_name (TemporaryAuthorizationStore *store,
-                                                                         const gchar *name)
+static gboolean
+temporary_authorization_store_load (TemporaryAuthorizationStore  *store,
+                                    const gchar                  *path,
+                                    guint                        *out_num_restored,
+                                    GError                      **error)
 {
-  guint num_removed;
-  GList *l, *ll;
-
-  num_removed = 0;
-  for (l = store->authorizations; l != NULL; l = ll)
+  gboolean ret = FALSE;
+  gchar *contents = NULL;
+  gsize length;
+  GVariant *value = NULL;
+  GVariantIter *iter = NULL;
+  struct stat statbuf;
+  guint32 version;
+  guint num_restored = 0;
+  gint64 now_real;
+  gint64 now_monotonic;
+  const gchar *id;
+  const gchar *subject_str;
+  const gchar *scope_str;
+  const gchar *action_id;
+  gint64 granted;
+  gint64 expires;
+
+  if (g_stat (path, &statbuf) != 0)
     {
-      TemporaryAuthorization *ta = l->data;
-      gchar *s;
+      /* nothing was saved, e.g. on the first start after boot */
+      if (errno == ENOENT)
+        ret = TRUE;
+      else
+        g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                     "Error statting %s: %s", path, g_strerror (errno));
+      goto out;
+    }
 
-      ll = l->next;
+  /* the file grants authorizations, so only trust it if nobody else could have written it */
+  if (statbuf.st_uid != geteuid () || (statbuf.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+    {
+      g_set_error (error, POLKIT_ERROR, POLKIT_ERROR_FAILED,
+                   "Refusing to load %s: not owned by uid %d or writable by others",
+                   path, (gint) geteuid ());
+      goto out;
+    }
 
-      if (!POLKIT_IS_SYSTEM_BUS_NAME (ta->subject))
-        continue;
+  if (!g_file_get_contents (path, &contents, &length, error))
+    goto out;
 
-      if (g_strcmp0 (name, polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (ta->subject))) != 0)
-        continue;
+  value = g_variant_ref_sink (g_variant_new_from_data (G_VARIANT_TYPE ("(ua(ssssxx))"),
+                                                       contents,
+                                                       length,
+                                                       FALSE,
+                                                       NULL,
+                                                       NULL));
+  g_variant_get (value, "(ua(ssssxx))", &version, &iter);
+  if (version != TEMPORARY_AUTHORIZATION_FILE_VERSION)
+    {
+      g_set_error (error, POLKIT_ERROR, POLKIT_ERROR_FAILED,
+                   "Unsupported version %u of %s", version, path);
+      goto out;
+    }
 
+  now_real = g_get_real_time ();
+  now_monotonic = g_get_monotonic_time ();
+  while (g_variant_iter_next (iter, "(&s&s&s&sxx)", &id, &subject_str, &scope_str, &action_id, &granted, &expires))
+    {
+      if (temporary_authorization_store_restore (store,
+                                                 id,
+                                                 subject_str,
+                                                 scope_str,
+                                                 action_id,
+                                                 granted,
+                                                 expires,
+                                                 now_real,
+                                                 now_monotonic))
+        num_restored++;
+    }
 
-      s = polkit_subject_to_string (ta->subject);
-      g_debug ("Removing tempoary authorization with id `%s' for action-id `%s' for subject `%s': "
-               "subject has vanished",
-               ta->id,
-               ta->action_id,
-               s);
-      g_free (s);
+  ret = TRUE;
 
-      store->authorizations = g_list_remove (store->authorizations, ta);
-      temporary_authorization_free (ta);
+ out:
+  if (out_num_restored != NULL)
+    *out_num_restored = num_restored;
+  if (iter != NULL)
+    g_variant_iter_free (iter);
+  if (value != NULL)
+    g_variant_unref (value);
+  g_free (contents);
+  return ret;
+}
 
-      num_removed++;
-    }
+/* ---------------------------------------------------------------------------------------------------- */
 
-  if (num_removed > 0)
-    g_signal_emit_by_name (store->authority, "changed");
+static void
+temporary_authorization_filter_clear (TemporaryAuthorizationFilter *filter)
+{
+  g_free (filter->action_id_prefix);
+  if (filter->subject != NULL)
+    g_object_unref (filter->subject);
+  memset (filter, '\0', sizeof (TemporaryAuthorizationFilter));
 }
 
-static const gchar *
-temporary_authorization_store_add_authorization (TemporaryAuthorizationStore *store,
-                                                 PolkitSubject               *subject,
-                                                 PolkitSubject               *scope,
-                                                 const gchar                 *action_id)
+/* Supported keys in @options are
+ *
+ *  - action-id-prefix (s): only match authorizations for actions starting with this string
+ *  - subject ((sa{sv})): only match authorizations obtained by this subject
+ *  - max-age (t): only match authorizations obtained at most this many seconds ago
+ *
+ * Unknown keys are ignored.
+ */
+static gboolean
+temporary_authorization_filter_init (TemporaryAuthorizationFilter  *filter,
+                                     GVariant                      *options,
+                                     GError                       **error)
 {
-  TemporaryAuthorization *authorization;
-  guint expiration_seconds;
-  PolkitSubject *subject_to_use;
+  GVariant *subject_gvariant;
+  guint64 max_age;
+  gboolean ret;
 
-  g_return_val_if_fail (store != NULL, NULL);
-  g_return_val_if_fail (POLKIT_IS_SUBJECT (subject), NULL);
-  g_return_val_if_fail (action_id != NULL, NULL);
-  g_return_val_if_fail (!temporary_authorization_store_has_authorization (store, subject, action_id, NULL), NULL);
+  ret = FALSE;
+  memset (filter, '\0', sizeof (TemporaryAuthorizationFilter));
 
-  /* XXX: for now, prefer to store the process */
-  if (POLKIT_IS_SYSTEM_BUS_NAME (subject))
+  if (options == NULL)
     {
-      GError *error;
-      error = NULL;
-      subject_to_use = polkit_system_bus_name_get_process_sync (POLKIT_SYSTEM_BUS_NAME (subject),
-                                                                NULL,
-                                                                &error);
-      if (subject_to_use == NULL)
-        {
-          g_printerr ("Error getting process for system bus name `%s': %s\n",
-                      polkit_system_bus_name_get_name (POLKIT_SYSTEM_BUS_NAME (subject)),
-                      error->message);
-          g_error_free (error);
-          subject_to_use = g_object_ref (subject);
-        }
+      ret = TRUE;
+      goto out;
     }
-  else
+
+  g_variant_lookup (options, "action-id-prefix", "s", &filter->action_id_prefix);
+
+  subject_gvariant = g_variant_lookup_value (options, "subject", G_VARIANT_TYPE ("(sa{sv})"));
+  if (subject_gvariant != NULL)
     {
-      subject_to_use = g_object_ref (subject);
+      PolkitSubject *subject;
+
+      subject = polkit_subject_new_for_gvariant (subject_gvariant, error);
+      g_variant_unref (subject_gvariant);
+      if (subject == NULL)
+        {
+          g_prefix_error (error, "Error getting subject from options: ");
+          temporary_authorization_filter_clear (filter);
+          goto out;
+        }
+      /* match what temporary_authorization_store_add_authorization() stores */
+      filter->subject = temporary_authorization_store_resolve_subject (subject);
+      g_object_unref (subject);
     }
 
-  /* TODO: right now the time the temporary authorization is kept is hard-coded - we
-   *       could make it a propery on the PolkitBackendInteractiveAuthority class (so
-   *       the local authority could read it from a config file) or a vfunc
-   *       (so the local authority could read it from an annotation on the action).
-   */
-  expiration_seconds = 5 * 60;
+  if (g_variant_lookup (options, "max-age", "t", &max_age))
+    filter->granted_after = g_get_monotonic_time () - (gint64) MIN (max_age, G_MAXINT64 / G_USEC_PER_SEC) * G_USEC_PER_SEC;
 
-  authorization = g_new0 (TemporaryAuthorization, 1);
-  authorization->id = g_strdup_printf ("tmpauthz%" G_GUINT64_FORMAT, store->serial++);
-  authorization->store = store;
-  authorization->subject = g_object_ref (subject_to_use);
-  authorization->scope = g_object_ref (scope);
-  authorization->action_id = g_strdup (action_id);
-  /* store monotonic time and convert to secs-since-epoch when returning TemporaryAuthorization structs */
-  authorization->time_granted = g_get_monotonic_time ();
-  authorization->time_expires = authorization->time_granted + expiration_seconds * G_USEC_PER_SEC;
-  /* g_timeout_add() is using monotonic time since 2.28 */
-  authorization->expiration_timeout_id = g_timeout_add (expiration_seconds * 1000,
-                                                        on_expiration_timeout,
-                                                        authorization);
+  ret = TRUE;
 
-  if (POLKIT_IS_UNIX_PROCESS (authorization->subject))
-    {
-      /* For now, set up a timer to poll every two seconds - this is used to determine
-       * when the process vanishes. We want to do this so we can remove the temporary
-       * authorization - this is because we want agents to update e.g. a notification
-       * area icon saying the user has temporary authorizations (e.g. remove the icon).
-       *
-       * Ideally we'd just do
-       *
-       *   g_signal_connect (kernel, "process-exited", G_CALLBACK (on_process_exited), user_data);
-       *
-       * but that is not how things work right now (and, hey, it's not like the kernel
-       * is a GObject either!) - so we poll.
-       *
-       * TODO: On Linux, it might be possible to obtain notifications by connecting
-       *       to the netlink socket. Needs looking into.
-       */
+ out:
+  return ret;
+}
 
-      authorization->check_vanished_timeout_id = g_timeout_add_seconds (2,
-                                                                        on_unix_process_check_vanished_timeout,
-                                                                        authorization);
-    }
-#if 0
-  else if (POLKIT_IS_SYSTEM_BUS_NAME (authorization->subject))
-    {
-      /* This is currently handled in polkit_backend_interactive_authority_system_bus_name_owner_changed()  */
-    }
-#endif
+static gboolean
+temporary_authorization_filter_matches (TemporaryAuthorizationFilter *filter,
+                                        TemporaryAuthorization       *authorization)
+{
+  if (filter->action_id_prefix != NULL &&
+      !g_str_has_prefix (authorization->action_id, filter->action_id_prefix))
+    return FALSE;
 
+  if (filter->granted_after != 0 && authorization->time_granted < filter->granted_after)
+    return FALSE;
 
-  store->authorizations = g_list_prepend (store->authorizations, authorization);
+  if (filter->subject != NULL && !polkit_subject_equal (filter->subject, authorization->subject))
+    return FALSE;
 
-  g_object_unref (subject_to_use);
+  return TRUE;
+}
 
-  return authorization->id;
+/* Returns the authorizations in @scope matching @filter, newest first. Free
+ * the list with g_list_free(), the elements are owned by @store.
+ */
+static GList *
+temporary_authorization_store_lookup (TemporaryAuthorizationStore  *store,
+                                      PolkitSubject                *scope,
+                                      TemporaryAuthorizationFilter *filter)
+{
+  GQueue *queue;
+  GList *ret;
+  GList *l;
+
+  ret = NULL;
+
+  queue = g_hash_table_lookup (store->scope_to_authorizations, scope);
+  if (queue == NULL)
+    goto out;
+
+  for (l = queue->tail; l != NULL; l = l->prev)
+    {
+      TemporaryAuthorization *ta = l->data;
+
+      if (temporary_authorization_filter_matches (filter, ta))
+        ret = g_list_prepend (ret, ta);
+    }
+
+ out:
+  return ret;
 }
 
 /* ---------------------------------------------------------------------------------------------------- */
 
-static GList *
-polkit_backend_interactive_authority_enumerate_temporary_authorizations (PolkitBackendAuthority   *authority,
-                                                                         PolkitSubject            *caller,
-                                                                         PolkitSubject            *subject,
-                                                                         GError                  **error)
+static gboolean
+check_temporary_authorization_caller (PolkitBackendInteractiveAuthority  *interactive_authority,
+                                      PolkitSubject                      *caller,
+                                      PolkitSubject                      *subject,
+                                      GError                            **error)
 {
-  PolkitBackendInteractiveAuthority *interactive_authority;
   PolkitBackendInteractiveAuthorityPrivate *priv;
   PolkitSubject *session_for_caller;
-  GList *ret;
-  GList *l;
-  gint64 monotonic_now;
-  GTimeVal real_now;
+  gboolean ret;
 
-  interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
 
-  ret = NULL;
+  ret = FALSE;
   session_for_caller = NULL;
 
   if (!POLKIT_IS_UNIX_SESSION (subject))
@@ -3329,19 +5207,55 @@ polkit_backend_interactive_authority_enumerate_temporary_authorizations (PolkitB
       goto out;
     }
 
+  ret = TRUE;
+
+ out:
+  if (session_for_caller != NULL)
+    g_object_unref (session_for_caller);
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static GList *
+polkit_backend_interactive_authority_enumerate_temporary_authorizations (PolkitBackendAuthority   *authority,
+                                                                         PolkitSubject            *caller,
+                                                                         PolkitSubject            *subject,
+                                                                         GVariant                 *options,
+                                                                         GError                  **error)
+{
+  PolkitBackendInteractiveAuthority *interactive_authority;
+  PolkitBackendInteractiveAuthorityPrivate *priv;
+  TemporaryAuthorizationFilter filter;
+  GList *matches;
+  GList *ret;
+  GList *l;
+  gint64 monotonic_now;
+  GTimeVal real_now;
+
+  interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
+  priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
+
+  ret = NULL;
+
+  if (!check_temporary_authorization_caller (interactive_authority, caller, subject, error))
+    goto out;
+
+  if (!temporary_authorization_filter_init (&filter, options, error))
+    goto out;
+
   monotonic_now = g_get_monotonic_time ();
   g_get_current_time (&real_now);
 
-  for (l = priv->temporary_authorization_store->authorizations; l != NULL; l = l->next)
+  matches = temporary_authorization_store_lookup (priv->temporary_authorization_store, subject, &filter);
+  for (l = matches; l != NULL; l = l->next)
     {
       TemporaryAuthorization *ta = l->data;
       PolkitTemporaryAuthorization *tmp_authz;
       guint64 real_granted;
       guint64 real_expires;
 
-      if (!polkit_subject_equal (ta->scope, subject))
-        continue;
-
       real_granted = (ta->time_granted - monotonic_now) / G_USEC_PER_SEC + real_now.tv_sec;
       real_expires = (ta->time_expires - monotonic_now) / G_USEC_PER_SEC + real_now.tv_sec;
 
@@ -3353,11 +5267,11 @@ polkit_backend_interactive_authority_enumerate_temporary_authorizations (PolkitB
 
       ret = g_list_prepend (ret, tmp_authz);
     }
+  g_list_free (matches);
 
- out:
-  if (session_for_caller != NULL)
-    g_object_unref (session_for_caller);
+  temporary_authorization_filter_clear (&filter);
 
+ out:
   return ret;
 }
 
@@ -3367,67 +5281,42 @@ static gboolean
 polkit_backend_interactive_authority_revoke_temporary_authorizations (PolkitBackendAuthority   *authority,
                                                                       PolkitSubject            *caller,
                                                                       PolkitSubject            *subject,
+                                                                      GVariant                 *options,
                                                                       GError                  **error)
 {
   PolkitBackendInteractiveAuthority *interactive_authority;
   PolkitBackendInteractiveAuthorityPrivate *priv;
-  PolkitSubject *session_for_caller;
+  TemporaryAuthorizationFilter filter;
   gboolean ret;
+  GList *matches;
   GList *l;
-  GList *ll;
   guint num_removed;
 
   interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
 
   ret = FALSE;
-  session_for_caller = NULL;
-
-  if (!POLKIT_IS_UNIX_SESSION (subject))
-    {
-      g_set_error (error,
-                   POLKIT_ERROR,
-                   POLKIT_ERROR_FAILED,
-                   "Can only handle PolkitUnixSession objects for now.");
-      goto out;
-    }
 
-  session_for_caller = polkit_backend_session_monitor_get_session_for_subject (priv->session_monitor,
-                                                                               caller,
-                                                                               NULL);
-  if (session_for_caller == NULL)
-    {
-      g_set_error (error,
-                   POLKIT_ERROR,
-                   POLKIT_ERROR_FAILED,
-                   "Cannot determine session the caller is in");
-      goto out;
-    }
+  if (!check_temporary_authorization_caller (interactive_authority, caller, subject, error))
+    goto out;
 
-  if (!polkit_subject_equal (session_for_caller, subject))
-    {
-      g_set_error (error,
-                   POLKIT_ERROR,
-                   POLKIT_ERROR_FAILED,
-                   "Passed session and the session the caller is in differs. They must be equal for now.");
-      goto out;
-    }
+  if (!temporary_authorization_filter_init (&filter, options, error))
+    goto out;
 
   num_removed = 0;
-  for (l = priv->temporary_authorization_store->authorizations; l != NULL; l = ll)
+  matches = temporary_authorization_store_lookup (priv->temporary_authorization_store, subject, &filter);
+  for (l = matches; l != NULL; l = l->next)
     {
       TemporaryAuthorization *ta = l->data;
 
-      ll = l->next;
-
-      if (!polkit_subject_equal (ta->scope, subject))
-        continue;
-
-      priv->temporary_authorization_store->authorizations = g_list_remove (priv->temporary_authorization_store->authorizations, ta);
-      temporary_authorization_free (ta);
+      temporary_authorization_store_remove (priv->temporary_authorization_store, ta);
 
       num_removed++;
     }
+  g_list_free (matches);
+
+  temporary_authorization_filter_clear (&filter);
 
   if (num_removed > 0)
     g_signal_emit_by_name (authority, "changed");
@@ -3435,9 +5324,6 @@ polkit_backend_interactive_authority_revoke_temporary_authorizations (PolkitBack
   ret = TRUE;
 
  out:
-  if (session_for_caller != NULL)
-    g_object_unref (session_for_caller);
-
   return ret;
 }
 
@@ -3459,6 +5345,7 @@ polkit_backend_interactive_authority_revoke_temporary_authorization_by_id (Polki
 
   interactive_authority = POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority);
   priv = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_GET_PRIVATE (interactive_authority);
+  priv->last_activity_time = g_get_monotonic_time ();
 
   ret = FALSE;
   session_for_caller = NULL;
@@ -3494,8 +5381,7 @@ polkit_backend_interactive_authority_revoke_temporary_authorization_by_id (Polki
           goto out;
         }
 
-      priv->temporary_authorization_store->authorizations = g_list_remove (priv->temporary_authorization_store->authorizations, ta);
-      temporary_authorization_free (ta);
+      temporary_authorization_store_remove (priv->temporary_authorization_store, ta);
 
       num_removed++;
     }
@@ -144,6 +144,31 @@ PolkitImplicitAuthorization polkit_backend_interactive_authority_check_authoriza
                                                           PolkitDetails                     *details,
                                                           PolkitImplicitAuthorization        implicit);
 
+gboolean polkit_backend_interactive_authority_lookup_user (PolkitBackendInteractiveAuthority   *authority,
+                                                           guint32                              uid,
+                                                           gchar                              **out_user_name,
+                                                           gchar                             ***out_group_names,
+                                                           GError                             **error);
+
+void    polkit_backend_interactive_authority_set_log_timings      (PolkitBackendInteractiveAuthority *authority,
+                                                                   gboolean                           log_timings);
+void    polkit_backend_interactive_authority_set_temporary_authorization_limit (PolkitBackendInteractiveAuthority *authority,
+                                                                                gsize                              max_bytes);
+void    polkit_backend_interactive_authority_preload_actions     (PolkitBackendInteractiveAuthority *authority,
+                                                                   GAsyncReadyCallback                callback,
+                                                                   gpointer                           user_data);
+guint   polkit_backend_interactive_authority_preload_actions_finish (PolkitBackendInteractiveAuthority *authority,
+                                                                     GAsyncResult                      *res);
+gboolean polkit_backend_interactive_authority_load_temporary_authorizations (PolkitBackendInteractiveAuthority  *authority,
+                                                                             const gchar                        *path,
+                                                                             guint                              *out_num_restored,
+                                                                             GError                            **error);
+gboolean polkit_backend_interactive_authority_save_temporary_authorizations (PolkitBackendInteractiveAuthority  *authority,
+                                                                             const gchar                        *path,
+                                                                             GError                            **error);
+void    polkit_backend_interactive_authority_set_temporary_authorization_file (PolkitBackendInteractiveAuthority *authority,
+                                                                               const gchar                       *path);
+
 G_END_DECLS
 
 #endif /* __POLKIT_BACKEND_INTERACTIVE_AUTHORITY_H */
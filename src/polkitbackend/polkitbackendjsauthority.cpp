@@ -36,6 +36,11 @@
 
 #include <polkit/polkit.h>
 #include "polkitbackendjsauthority.h"
+#include "polkitbackendprobes.h"
+#include "polkitbackendwatchdog.h"
+#include "polkitbackendresolver.h"
+#include "polkitbackendspawner.h"
+#include "polkitbackendprivate.h"
 
 #include <polkit/polkitprivate.h>
 
@@ -73,12 +78,26 @@ struct _PolkitBackendJsAuthorityPrivate
   gchar **rules_dirs;
   GFileMonitor **dir_monitors; /* NULL-terminated array of GFileMonitor instances */
 
+  /* the JS environment is set up on first use, see polkit_backend_js_authority_initialize() */
+  gboolean started;
+  gboolean initialized;
   JSRuntime *rt;
   JSContext *cx;
   JSObject *js_global;
   JSAutoCompartment *ac;
   JSObject *js_polkit;
 
+  /* see polkit_backend_js_authority_set_heap_limit() */
+  gsize heap_limit;
+  guint64 num_forced_gcs;
+
+  /* see polkit.cache in init.js, maps from key to RulesCacheEntry */
+  GHashTable *rules_cache;
+  gsize rules_cache_bytes;
+  guint64 rules_cache_hits;
+  guint64 rules_cache_misses;
+  guint64 rules_cache_evictions;
+
   GThread *runaway_killer_thread;
   GMutex rkt_init_mutex;
   GCond rkt_init_cond;
@@ -90,6 +109,12 @@ struct _PolkitBackendJsAuthorityPrivate
 
   /* A list of JSObject instances */
   GList *scripts;
+
+  /* the CompileTask instances of the rules files being compiled, see start_loading_scripts() */
+  GList *compile_tasks;
+  GMutex compile_mutex;
+  GCond compile_cond;
+  guint num_compiled_off_thread;
 };
 
 static JSBool execute_script_with_runaway_killer (PolkitBackendJsAuthority *authority,
@@ -126,6 +151,8 @@ enum
 
 static gpointer runaway_killer_thread_func (gpointer user_data);
 
+static void apply_heap_limit (PolkitBackendJsAuthority *authority);
+
 static GList *polkit_backend_js_authority_get_admin_auth_identities (PolkitBackendInteractiveAuthority *authority,
                                                                      PolkitSubject                     *caller,
                                                                      PolkitSubject                     *subject,
@@ -146,6 +173,9 @@ static PolkitImplicitAuthorization polkit_backend_js_authority_check_authorizati
                                                           PolkitDetails                     *details,
                                                           PolkitImplicitAuthorization        implicit);
 
+static void polkit_backend_js_authority_add_statistics (PolkitBackendAuthority *authority,
+                                                        GVariantBuilder        *builder);
+
 G_DEFINE_TYPE (PolkitBackendJsAuthority, polkit_backend_js_authority, POLKIT_BACKEND_TYPE_INTERACTIVE_AUTHORITY);
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -183,12 +213,16 @@ static JSClass js_polkit_class = {
 static JSBool js_polkit_log (JSContext *cx, unsigned argc, jsval *vp);
 static JSBool js_polkit_spawn (JSContext *cx, unsigned argc, jsval *vp);
 static JSBool js_polkit_user_is_in_netgroup (JSContext *cx, unsigned argc, jsval *vp);
+static JSBool js_polkit_cache_get (JSContext *cx, unsigned argc, jsval *vp);
+static JSBool js_polkit_cache_set (JSContext *cx, unsigned argc, jsval *vp);
 
 static JSFunctionSpec js_polkit_functions[] =
 {
   JS_FS("log",            js_polkit_log,            0, 0),
   JS_FS("spawn",          js_polkit_spawn,          0, 0),
   JS_FS("_userIsInNetGroup", js_polkit_user_is_in_netgroup,          0, 0),
+  JS_FS("_cacheGet",      js_polkit_cache_get,      0, 0),
+  JS_FS("_cacheSet",      js_polkit_cache_set,      0, 0),
   JS_FS_END
 };
 
@@ -206,12 +240,109 @@ static void report_error (JSContext     *cx,
                                 message);
 }
 
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* polkit.cache keeps values outside of the JS heap so they survive
+ * garbage collection. The values are JSON text, see init.js, kept as
+ * UTF-16 so they can be turned back into JS strings as is.
+ */
+
+#define RULES_CACHE_MAX_BYTES        (1024 * 1024)
+#define RULES_CACHE_MAX_ENTRY_BYTES  (64 * 1024)
+
+typedef struct
+{
+  jschar *value;
+  gsize value_len;
+  gint64 expiration_time;
+  gsize size;
+} RulesCacheEntry;
+
+static void
+rules_cache_entry_free (RulesCacheEntry *entry)
+{
+  g_free (entry->value);
+  g_free (entry);
+}
+
+static void
+rules_cache_remove (PolkitBackendJsAuthority *authority,
+                    const gchar              *key,
+                    RulesCacheEntry          *entry)
+{
+  authority->priv->rules_cache_bytes -= entry->size;
+  g_hash_table_remove (authority->priv->rules_cache, key);
+}
+
+static void
+rules_cache_clear (PolkitBackendJsAuthority *authority)
+{
+  g_hash_table_remove_all (authority->priv->rules_cache);
+  authority->priv->rules_cache_bytes = 0;
+}
+
+/* Drops expired entries and then the ones expiring first until @needed more bytes fit */
+static void
+rules_cache_make_room (PolkitBackendJsAuthority *authority,
+                       gsize                     needed)
+{
+  GHashTableIter iter;
+  const gchar *key;
+  RulesCacheEntry *entry;
+  gint64 now;
+
+  now = g_get_monotonic_time ();
+  g_hash_table_iter_init (&iter, authority->priv->rules_cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer*) &entry))
+    {
+      if (entry->expiration_time <= now)
+        {
+          authority->priv->rules_cache_bytes -= entry->size;
+          g_hash_table_iter_remove (&iter);
+        }
+    }
+
+  while (authority->priv->rules_cache_bytes + needed > RULES_CACHE_MAX_BYTES)
+    {
+      const gchar *first_key = NULL;
+      RulesCacheEntry *first = NULL;
+
+      g_hash_table_iter_init (&iter, authority->priv->rules_cache);
+      while (g_hash_table_iter_next (&iter, (gpointer*) &key, (gpointer*) &entry))
+        {
+          if (first == NULL || entry->expiration_time < first->expiration_time)
+            {
+              first_key = key;
+              first = entry;
+            }
+        }
+      if (first == NULL)
+        break;
+
+      rules_cache_remove (authority, first_key, first);
+      authority->priv->rules_cache_evictions++;
+    }
+}
+
 static void
 polkit_backend_js_authority_init (PolkitBackendJsAuthority *authority)
 {
   authority->priv = G_TYPE_INSTANCE_GET_PRIVATE (authority,
                                                  POLKIT_BACKEND_TYPE_JS_AUTHORITY,
                                                  PolkitBackendJsAuthorityPrivate);
+
+  authority->priv->rules_cache = g_hash_table_new_full (g_str_hash,
+                                                        g_str_equal,
+                                                        g_free,
+                                                        (GDestroyNotify) rules_cache_entry_free);
+
+  authority->priv->heap_limit = 8L * 1024L * 1024L;
+
+  g_mutex_init (&authority->priv->rkt_init_mutex);
+  g_cond_init (&authority->priv->rkt_init_cond);
+  g_mutex_init (&authority->priv->rkt_timeout_pending_mutex);
+  g_mutex_init (&authority->priv->compile_mutex);
+  g_cond_init (&authority->priv->compile_cond);
 }
 
 static gint
@@ -241,17 +372,62 @@ rules_file_name_cmp (const gchar *a,
   return ret;
 }
 
-/* authority->priv->cx must be within a request */
+/* A rules file being compiled, see start_loading_scripts() */
+typedef struct
+{
+  gchar *filename;
+  jschar *chars;
+  glong length;
+
+  /* protected by the mutex of the batch, set from a helper thread */
+  gboolean off_thread;
+  gboolean done;
+  JSScript *script;
+
+  GMutex *mutex;
+  GCond *cond;
+} CompileTask;
+
 static void
-load_scripts (PolkitBackendJsAuthority  *authority)
+compile_task_free (CompileTask *task)
+{
+  g_free (task->filename);
+  g_free (task->chars);
+  g_free (task);
+}
+
+/* called from a SpiderMonkey helper thread */
+static void
+on_script_compiled_off_thread (JSScript *script,
+                               void     *user_data)
+{
+  CompileTask *task = (CompileTask *) user_data;
+
+  g_mutex_lock (task->mutex);
+  task->script = script;
+  task->done = TRUE;
+  g_cond_broadcast (task->cond);
+  g_mutex_unlock (task->mutex);
+}
+
+/* Starts compiling all rules files on the helper threads of the runtime,
+ * finish_loading_scripts() then waits for and runs them one by one in
+ * the sorted order. The main loop may run in between.
+ *
+ * authority->priv->cx must be within a request
+ */
+static void
+start_loading_scripts (PolkitBackendJsAuthority  *authority)
 {
   GList *files = NULL;
+  GList *tasks = NULL;
   GList *l;
-  guint num_scripts = 0;
   GError *error = NULL;
   guint n;
 
-  files = NULL;
+  g_assert (authority->priv->compile_tasks == NULL);
+
+  POLKIT_PROBE0 (rules_load__begin);
 
   for (n = 0; authority->priv->rules_dirs != NULL && authority->priv->rules_dirs[n] != NULL; n++)
     {
@@ -286,16 +462,82 @@ load_scripts (PolkitBackendJsAuthority  *authority)
 
   files = g_list_sort (files, (GCompareFunc) rules_file_name_cmp);
 
+  authority->priv->num_compiled_off_thread = 0;
   for (l = files; l != NULL; l = l->next)
     {
-      const gchar *filename = (gchar *)l->data;
+      CompileTask *task;
+      gchar *contents;
+      gsize contents_len;
+
+      task = g_new0 (CompileTask, 1);
+      task->filename = (gchar *) l->data;
+      l->data = NULL;
+      task->mutex = &authority->priv->compile_mutex;
+      task->cond = &authority->priv->compile_cond;
+      tasks = g_list_prepend (tasks, task);
+
+      /* on errors the file is compiled on this thread later, which reports them */
+      if (!g_file_get_contents (task->filename, &contents, &contents_len, NULL))
+        continue;
+      task->chars = (jschar *) g_utf8_to_utf16 (contents, contents_len, NULL, &task->length, NULL);
+      g_free (contents);
+      if (task->chars == NULL)
+        continue;
+
+      JS::CompileOptions options(authority->priv->cx);
+      JS::RootedObject obj(authority->priv->cx, authority->priv->js_global);
+      options.setFileAndLine (task->filename, 1);
+      if (!JS::CanCompileOffThread (authority->priv->cx, options))
+        continue;
+
+      task->off_thread = JS::CompileOffThread (authority->priv->cx, obj, options,
+                                               task->chars, task->length,
+                                               on_script_compiled_off_thread, task);
+      if (task->off_thread)
+        authority->priv->num_compiled_off_thread++;
+    }
+  authority->priv->compile_tasks = g_list_reverse (tasks);
+
+  g_list_free (files);
+}
+
+/* authority->priv->cx must be within a request */
+static void
+finish_loading_scripts (PolkitBackendJsAuthority  *authority)
+{
+  GList *l;
+  guint num_scripts = 0;
+
+  for (l = authority->priv->compile_tasks; l != NULL; l = l->next)
+    {
+      CompileTask *task = (CompileTask *) l->data;
+      const gchar *filename = task->filename;
       JS::RootedScript script(authority->priv->cx);
       JS::CompileOptions options(authority->priv->cx);
       JS::RootedObject   obj(authority->priv->cx,authority->priv->js_global);
-      options.setUTF8(true);
-      script = JS::Compile (authority->priv->cx,
-                            obj, options,
-                            filename);
+
+      if (task->off_thread)
+        {
+          g_mutex_lock (task->mutex);
+          while (!task->done)
+            g_cond_wait (task->cond, task->mutex);
+          g_mutex_unlock (task->mutex);
+
+          if (task->script != NULL)
+            {
+              JS::FinishOffThreadScript (authority->priv->rt, task->script);
+              script = task->script;
+            }
+        }
+
+      /* compiling again reports the errors of off-thread compilation as well */
+      if (script == NULL)
+        {
+          options.setUTF8(true);
+          script = JS::Compile (authority->priv->cx,
+                                obj, options,
+                                filename);
+        }
 
       if (script == NULL)
         {
@@ -323,9 +565,50 @@ load_scripts (PolkitBackendJsAuthority  *authority)
     }
 
   polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
-                                "Finished loading, compiling and executing %d rules",
-                                num_scripts);
-  g_list_free_full (files, g_free);
+                                "Finished loading, compiling and executing %d rules (%d compiled in parallel)",
+                                num_scripts, authority->priv->num_compiled_off_thread);
+  POLKIT_PROBE1 (rules_load__end, num_scripts);
+  g_list_free_full (authority->priv->compile_tasks, (GDestroyNotify) compile_task_free);
+  authority->priv->compile_tasks = NULL;
+}
+
+/* Waits for the rules files still being compiled by
+ * start_loading_scripts() and throws them away without running them.
+ *
+ * authority->priv->cx must be within a request
+ */
+static void
+drain_compile_tasks (PolkitBackendJsAuthority  *authority)
+{
+  GList *l;
+
+  for (l = authority->priv->compile_tasks; l != NULL; l = l->next)
+    {
+      CompileTask *task = (CompileTask *) l->data;
+
+      if (!task->off_thread)
+        continue;
+
+      g_mutex_lock (task->mutex);
+      while (!task->done)
+        g_cond_wait (task->cond, task->mutex);
+      g_mutex_unlock (task->mutex);
+
+      /* hands the script over to the runtime, which frees it */
+      if (task->script != NULL)
+        JS::FinishOffThreadScript (authority->priv->rt, task->script);
+    }
+
+  g_list_free_full (authority->priv->compile_tasks, (GDestroyNotify) compile_task_free);
+  authority->priv->compile_tasks = NULL;
+}
+
+/* authority->priv->cx must be within a request */
+static void
+load_scripts (PolkitBackendJsAuthority  *authority)
+{
+  start_loading_scripts (authority);
+  finish_loading_scripts (authority);
 }
 
 static void
@@ -334,6 +617,11 @@ reload_scripts (PolkitBackendJsAuthority *authority)
   jsval argv[1] = {JSVAL_NULL};
   jsval rval = JSVAL_NULL;
 
+  /* the first load may not be done yet */
+  polkit_backend_js_authority_initialize (authority);
+
+  POLKIT_PROBE0 (rules_reload__begin);
+
   JS_BeginRequest (authority->priv->cx);
 
   if (!JS_CallFunctionName(authority->priv->cx,
@@ -348,6 +636,9 @@ reload_scripts (PolkitBackendJsAuthority *authority)
       goto out;
     }
 
+  /* cached values may depend on the old rules */
+  rules_cache_clear (authority);
+
   polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
                                 "Collecting garbage unconditionally...");
   JS_GC (authority->priv->rt);
@@ -358,6 +649,7 @@ reload_scripts (PolkitBackendJsAuthority *authority)
   g_signal_emit_by_name (authority, "changed");
  out:
   JS_EndRequest (authority->priv->cx);
+  POLKIT_PROBE0 (rules_reload__end);
 }
 
 static void
@@ -389,7 +681,9 @@ on_dir_monitor_changed (GFileMonitor     *monitor,
         {
           polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
                                         "Reloading rules");
+          polkit_backend_watchdog_set_activity ("ReloadRules", NULL, NULL);
           reload_scripts (authority);
+          polkit_backend_watchdog_clear_activity ();
         }
       g_free (name);
     }
@@ -440,11 +734,32 @@ static void
 polkit_backend_js_authority_constructed (GObject *object)
 {
   PolkitBackendJsAuthority *authority = POLKIT_BACKEND_JS_AUTHORITY (object);
+
+  if (authority->priv->rules_dirs == NULL)
+    {
+      authority->priv->rules_dirs = g_new0 (gchar *, 3);
+      authority->priv->rules_dirs[0] = g_strdup (PACKAGE_SYSCONF_DIR "/polkit-1/rules.d");
+      authority->priv->rules_dirs[1] = g_strdup (PACKAGE_DATA_DIR "/polkit-1/rules.d");
+    }
+
+  G_OBJECT_CLASS (polkit_backend_js_authority_parent_class)->constructed (object);
+}
+
+/* Sets up the runtime, evaluates init.js, starts the runaway killer
+ * thread and starts compiling the rules. This is not done in
+ * constructed() since many requests, e.g. checks for root or
+ * registering agents, don't need any of it and polkitd should answer
+ * them as early as possible during boot.
+ */
+static void
+setup_js (PolkitBackendJsAuthority *authority)
+{
   gboolean entered_request = FALSE;
 
   authority->priv->rt = JS_NewRuntime (8L * 1024L * 1024L, JS_USE_HELPER_THREADS);
   if (authority->priv->rt == NULL)
     goto fail;
+  apply_heap_limit (authority);
 
   authority->priv->cx = JS_NewContext (authority->priv->rt, 8192);
   if (authority->priv->cx == NULL)
@@ -505,17 +820,6 @@ polkit_backend_js_authority_constructed (GObject *object)
         goto fail;
       }
 
-    if (authority->priv->rules_dirs == NULL)
-      {
-        authority->priv->rules_dirs = g_new0 (gchar *, 3);
-        authority->priv->rules_dirs[0] = g_strdup (PACKAGE_SYSCONF_DIR "/polkit-1/rules.d");
-        authority->priv->rules_dirs[1] = g_strdup (PACKAGE_DATA_DIR "/polkit-1/rules.d");
-      }
-
-    g_mutex_init (&authority->priv->rkt_init_mutex);
-    g_cond_init (&authority->priv->rkt_init_cond);
-    g_mutex_init (&authority->priv->rkt_timeout_pending_mutex);
-
     authority->priv->runaway_killer_thread = g_thread_new ("runaway-killer-thread",
                                                            runaway_killer_thread_func,
                                                            authority);
@@ -527,13 +831,11 @@ polkit_backend_js_authority_constructed (GObject *object)
     g_mutex_unlock (&authority->priv->rkt_init_mutex);
 
     setup_file_monitors (authority);
-    load_scripts (authority);
+    start_loading_scripts (authority);
   }
   JS_EndRequest (authority->priv->cx);
   entered_request = FALSE;
 
-  G_OBJECT_CLASS (polkit_backend_js_authority_parent_class)->constructed (object);
-
   return;
 
  fail:
@@ -543,6 +845,52 @@ polkit_backend_js_authority_constructed (GObject *object)
   g_assert_not_reached ();
 }
 
+/**
+ * polkit_backend_js_authority_start_initialize:
+ * @authority: A #PolkitBackendJsAuthority.
+ *
+ * Does the part of polkit_backend_js_authority_initialize() that has
+ * to happen on the calling thread and leaves compiling the rules to
+ * helper threads, so the caller can go on with e.g. connecting to the
+ * message bus in the meantime.
+ */
+void
+polkit_backend_js_authority_start_initialize (PolkitBackendJsAuthority *authority)
+{
+  g_return_if_fail (POLKIT_BACKEND_IS_JS_AUTHORITY (authority));
+
+  if (authority->priv->started)
+    return;
+  authority->priv->started = TRUE;
+
+  setup_js (authority);
+}
+
+/**
+ * polkit_backend_js_authority_initialize:
+ * @authority: A #PolkitBackendJsAuthority.
+ *
+ * Sets up the JavaScript environment and loads the rules unless this
+ * has already happened. Otherwise this is done by the first request
+ * that needs the rules, so calling this, e.g. once the daemon is
+ * otherwise idle, keeps that request from paying for it.
+ */
+void
+polkit_backend_js_authority_initialize (PolkitBackendJsAuthority *authority)
+{
+  g_return_if_fail (POLKIT_BACKEND_IS_JS_AUTHORITY (authority));
+
+  if (authority->priv->initialized)
+    return;
+
+  polkit_backend_js_authority_start_initialize (authority);
+
+  authority->priv->initialized = TRUE;
+  JS_BeginRequest (authority->priv->cx);
+  finish_loading_scripts (authority);
+  JS_EndRequest (authority->priv->cx);
+}
+
 static void
 polkit_backend_js_authority_finalize (GObject *object)
 {
@@ -554,10 +902,13 @@ polkit_backend_js_authority_finalize (GObject *object)
   g_mutex_clear (&authority->priv->rkt_timeout_pending_mutex);
 
   /* shut down the killer thread */
-  g_assert (authority->priv->rkt_loop != NULL);
-  g_main_loop_quit (authority->priv->rkt_loop);
-  g_thread_join (authority->priv->runaway_killer_thread);
-  g_assert (authority->priv->rkt_loop == NULL);
+  if (authority->priv->runaway_killer_thread != NULL)
+    {
+      g_assert (authority->priv->rkt_loop != NULL);
+      g_main_loop_quit (authority->priv->rkt_loop);
+      g_thread_join (authority->priv->runaway_killer_thread);
+      g_assert (authority->priv->rkt_loop == NULL);
+    }
 
   for (n = 0; authority->priv->dir_monitors != NULL && authority->priv->dir_monitors[n] != NULL; n++)
     {
@@ -569,16 +920,25 @@ polkit_backend_js_authority_finalize (GObject *object)
     }
   g_free (authority->priv->dir_monitors);
   g_strfreev (authority->priv->rules_dirs);
+  g_hash_table_unref (authority->priv->rules_cache);
 
-  JS_BeginRequest (authority->priv->cx);
-  JS_RemoveObjectRoot (authority->priv->cx, &authority->priv->js_polkit);
-  delete authority->priv->ac;
-  JS_RemoveObjectRoot (authority->priv->cx, &authority->priv->js_global);
-  JS_EndRequest (authority->priv->cx);
+  if (authority->priv->started)
+    {
+      JS_BeginRequest (authority->priv->cx);
+      /* the helper threads may still be compiling rules */
+      drain_compile_tasks (authority);
+      JS_RemoveObjectRoot (authority->priv->cx, &authority->priv->js_polkit);
+      delete authority->priv->ac;
+      JS_RemoveObjectRoot (authority->priv->cx, &authority->priv->js_global);
+      JS_EndRequest (authority->priv->cx);
+
+      JS_DestroyContext (authority->priv->cx);
+      JS_DestroyRuntime (authority->priv->rt);
+      /* JS_ShutDown (); */
+    }
 
-  JS_DestroyContext (authority->priv->cx);
-  JS_DestroyRuntime (authority->priv->rt);
-  /* JS_ShutDown (); */
+  g_mutex_clear (&authority->priv->compile_mutex);
+  g_cond_clear (&authority->priv->compile_cond);
 
   G_OBJECT_CLASS (polkit_backend_js_authority_parent_class)->finalize (object);
 }
@@ -639,6 +999,7 @@ polkit_backend_js_authority_class_init (PolkitBackendJsAuthorityClass *klass)
   authority_class->get_name                             = polkit_backend_js_authority_get_name;
   authority_class->get_version                          = polkit_backend_js_authority_get_version;
   authority_class->get_features                         = polkit_backend_js_authority_get_features;
+  authority_class->add_statistics                       = polkit_backend_js_authority_add_statistics;
 
   interactive_authority_class = POLKIT_BACKEND_INTERACTIVE_AUTHORITY_CLASS (klass);
   interactive_authority_class->get_admin_identities     = polkit_backend_js_authority_get_admin_auth_identities;
@@ -743,7 +1104,9 @@ subject_to_jsval (PolkitBackendJsAuthority  *authority,
   uid_t uid;
   gchar *user_name = NULL;
   GPtrArray *groups = NULL;
-  struct passwd *passwd;
+  gchar **group_names = NULL;
+  GError *local_error = NULL;
+  guint n;
   char *seat_str = NULL;
   char *session_str = NULL;
 
@@ -793,43 +1156,22 @@ subject_to_jsval (PolkitBackendJsAuthority  *authority,
 
   groups = g_ptr_array_new_with_free_func (g_free);
 
-  passwd = getpwuid (uid);
-  if (passwd == NULL)
+  if (!polkit_backend_interactive_authority_lookup_user (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                         uid,
+                                                         &user_name,
+                                                         &group_names,
+                                                         &local_error))
     {
       user_name = g_strdup_printf ("%d", (gint) uid);
-      g_warning ("Error looking up info for uid %d: %m", (gint) uid);
+      g_warning ("Error looking up info for uid %d: %s", (gint) uid, local_error->message);
+      g_clear_error (&local_error);
     }
   else
     {
-      gid_t gids[512];
-      int num_gids = 512;
-
-      user_name = g_strdup (passwd->pw_name);
-
-      if (getgrouplist (passwd->pw_name,
-                        passwd->pw_gid,
-                        gids,
-                        &num_gids) < 0)
-        {
-          g_warning ("Error looking up groups for uid %d: %m", (gint) uid);
-        }
-      else
-        {
-          gint n;
-          for (n = 0; n < num_gids; n++)
-            {
-              struct group *group;
-              group = getgrgid (gids[n]);
-              if (group == NULL)
-                {
-                  g_ptr_array_add (groups, g_strdup_printf ("%d", (gint) gids[n]));
-                }
-              else
-                {
-                  g_ptr_array_add (groups, g_strdup (group->gr_name));
-                }
-            }
-        }
+      /* the array takes over the strings */
+      for (n = 0; group_names[n] != NULL; n++)
+        g_ptr_array_add (groups, group_names[n]);
+      g_free (group_names);
     }
 
   set_property_int32 (authority, obj, "pid", pid);
@@ -1054,6 +1396,25 @@ call_js_function_with_runaway_killer (PolkitBackendJsAuthority *authority,
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* Called after running rules. Scripts fail with an out of memory
+ * error when the heap reaches its limit, so collect garbage well
+ * before that.
+ */
+static void
+maybe_collect_garbage (PolkitBackendJsAuthority *authority)
+{
+  if (authority->priv->heap_limit > 0 &&
+      JS_GetGCParameter (authority->priv->rt, JSGC_BYTES) > authority->priv->heap_limit / 4 * 3)
+    {
+      JS_GC (authority->priv->rt);
+      authority->priv->num_forced_gcs++;
+    }
+  else
+    {
+      JS_MaybeGC (authority->priv->cx);
+    }
+}
+
 static GList *
 polkit_backend_js_authority_get_admin_auth_identities (PolkitBackendInteractiveAuthority *_authority,
                                                        PolkitSubject                     *caller,
@@ -1073,6 +1434,9 @@ polkit_backend_js_authority_get_admin_auth_identities (PolkitBackendInteractiveA
   JSString *ret_jsstr;
   gchar *ret_str = NULL;
   gchar **ret_strs = NULL;
+  gboolean ran;
+
+  polkit_backend_js_authority_initialize (authority);
 
   JS_BeginRequest (authority->priv->cx);
 
@@ -1100,11 +1464,14 @@ polkit_backend_js_authority_get_admin_auth_identities (PolkitBackendInteractiveA
       goto out;
     }
 
-  if (!call_js_function_with_runaway_killer (authority,
-                                             "_runAdminRules",
-                                             G_N_ELEMENTS (argv),
-                                             argv,
-                                             &rval))
+  POLKIT_PROBE1 (run_admin_rules__begin, action_id);
+  ran = call_js_function_with_runaway_killer (authority,
+                                              "_runAdminRules",
+                                              G_N_ELEMENTS (argv),
+                                              argv,
+                                              &rval);
+  POLKIT_PROBE2 (run_admin_rules__end, action_id, ran);
+  if (!ran)
     {
       polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
                                     "Error evaluating admin rules");
@@ -1132,12 +1499,13 @@ polkit_backend_js_authority_get_admin_auth_identities (PolkitBackendInteractiveA
       PolkitIdentity *identity;
 
       error = NULL;
-      identity = polkit_identity_from_string (identity_str, &error);
+      identity = polkit_backend_resolver_identity_from_string (identity_str, &error);
       if (identity == NULL)
         {
           polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
-                                        "Identity `%s' is not valid, ignoring",
-                                        identity_str);
+                                        "Identity `%s' is not valid, ignoring: %s",
+                                        identity_str, error->message);
+          g_clear_error (&error);
         }
       else
         {
@@ -1153,7 +1521,7 @@ polkit_backend_js_authority_get_admin_auth_identities (PolkitBackendInteractiveA
   if (ret == NULL)
     ret = g_list_prepend (ret, polkit_unix_user_new (0));
 
-  JS_MaybeGC (authority->priv->cx);
+  maybe_collect_garbage (authority);
 
   JS_EndRequest (authority->priv->cx);
 
@@ -1182,6 +1550,9 @@ polkit_backend_js_authority_check_authorization_sync (PolkitBackendInteractiveAu
   const jschar *ret_utf16;
   gchar *ret_str = NULL;
   gboolean good = FALSE;
+  gboolean ran;
+
+  polkit_backend_js_authority_initialize (authority);
 
   JS_BeginRequest (authority->priv->cx);
 
@@ -1209,11 +1580,14 @@ polkit_backend_js_authority_check_authorization_sync (PolkitBackendInteractiveAu
       goto out;
     }
 
-  if (!call_js_function_with_runaway_killer (authority,
-                                             "_runRules",
-                                             G_N_ELEMENTS (argv),
-                                             argv,
-                                             &rval))
+  POLKIT_PROBE1 (run_rules__begin, action_id);
+  ran = call_js_function_with_runaway_killer (authority,
+                                              "_runRules",
+                                              G_N_ELEMENTS (argv),
+                                              argv,
+                                              &rval);
+  POLKIT_PROBE2 (run_rules__end, action_id, ran);
+  if (!ran)
     {
       polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
                                     "Error evaluating authorization rules");
@@ -1259,7 +1633,7 @@ polkit_backend_js_authority_check_authorization_sync (PolkitBackendInteractiveAu
     ret = POLKIT_IMPLICIT_AUTHORIZATION_NOT_AUTHORIZED;
   g_free (ret_str);
 
-  JS_MaybeGC (authority->priv->cx);
+  maybe_collect_garbage (authority);
 
   JS_EndRequest (authority->priv->cx);
 
@@ -1268,6 +1642,93 @@ polkit_backend_js_authority_check_authorization_sync (PolkitBackendInteractiveAu
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/**
+ * polkit_backend_js_authority_get_gc_statistics:
+ * @authority: A #PolkitBackendJsAuthority.
+ * @out_heap_bytes: (out) (allow-none): Return location for the size of the JS heap in bytes or %NULL.
+ * @out_num_gcs: (out) (allow-none): Return location for the number of garbage collections so far or %NULL.
+ *
+ * Gets statistics about the garbage collected heap used for
+ * evaluating rules. This is intended for benchmarks and debugging.
+ */
+void
+polkit_backend_js_authority_get_gc_statistics (PolkitBackendJsAuthority *authority,
+                                               guint64                  *out_heap_bytes,
+                                               guint64                  *out_num_gcs)
+{
+  g_return_if_fail (POLKIT_BACKEND_IS_JS_AUTHORITY (authority));
+
+  if (out_heap_bytes != NULL)
+    *out_heap_bytes = authority->priv->rt != NULL ? JS_GetGCParameter (authority->priv->rt, JSGC_BYTES) : 0;
+  if (out_num_gcs != NULL)
+    *out_num_gcs = authority->priv->rt != NULL ? JS_GetGCParameter (authority->priv->rt, JSGC_NUMBER) : 0;
+}
+
+/**
+ * polkit_backend_js_authority_set_heap_limit:
+ * @authority: A #PolkitBackendJsAuthority.
+ * @max_bytes: The maximum size of the JS heap in bytes or 0 for no limit.
+ *
+ * Limits the size of the garbage collected heap used for evaluating
+ * rules. Garbage is collected unconditionally once the heap is at
+ * three quarters of @max_bytes, and scripts fail with an out of
+ * memory error when it is reached. The default is 8 MiB.
+ */
+void
+polkit_backend_js_authority_set_heap_limit (PolkitBackendJsAuthority *authority,
+                                            gsize                     max_bytes)
+{
+  g_return_if_fail (POLKIT_BACKEND_IS_JS_AUTHORITY (authority));
+
+  authority->priv->heap_limit = max_bytes;
+  if (authority->priv->rt != NULL)
+    apply_heap_limit (authority);
+}
+
+static void
+apply_heap_limit (PolkitBackendJsAuthority *authority)
+{
+  gsize max_bytes = authority->priv->heap_limit;
+
+  JS_SetGCParameter (authority->priv->rt,
+                     JSGC_MAX_BYTES,
+                     max_bytes > 0 ? MIN (max_bytes, G_MAXUINT32) : G_MAXUINT32);
+}
+
+static void
+polkit_backend_js_authority_add_statistics (PolkitBackendAuthority *_authority,
+                                            GVariantBuilder        *builder)
+{
+  PolkitBackendJsAuthority *authority = POLKIT_BACKEND_JS_AUTHORITY (_authority);
+  guint64 heap_bytes;
+  guint64 num_gcs;
+
+  POLKIT_BACKEND_AUTHORITY_CLASS (polkit_backend_js_authority_parent_class)->add_statistics (_authority, builder);
+
+  polkit_backend_js_authority_get_gc_statistics (authority, &heap_bytes, &num_gcs);
+  g_variant_builder_add (builder, "{sv}", "js-initialized",
+                         g_variant_new_boolean (authority->priv->initialized));
+  g_variant_builder_add (builder, "{sv}", "memory-js-heap-bytes", g_variant_new_uint64 (heap_bytes));
+  g_variant_builder_add (builder, "{sv}", "js-heap-limit-bytes",
+                         g_variant_new_uint64 (authority->priv->heap_limit));
+  g_variant_builder_add (builder, "{sv}", "js-gcs", g_variant_new_uint64 (num_gcs));
+  g_variant_builder_add (builder, "{sv}", "js-forced-gcs",
+                         g_variant_new_uint64 (authority->priv->num_forced_gcs));
+
+  g_variant_builder_add (builder, "{sv}", "rules-cache-entries",
+                         g_variant_new_uint32 (g_hash_table_size (authority->priv->rules_cache)));
+  g_variant_builder_add (builder, "{sv}", "memory-rules-cache-bytes",
+                         g_variant_new_uint64 (authority->priv->rules_cache_bytes));
+  g_variant_builder_add (builder, "{sv}", "rules-cache-hits",
+                         g_variant_new_uint64 (authority->priv->rules_cache_hits));
+  g_variant_builder_add (builder, "{sv}", "rules-cache-misses",
+                         g_variant_new_uint64 (authority->priv->rules_cache_misses));
+  g_variant_builder_add (builder, "{sv}", "rules-cache-evictions",
+                         g_variant_new_uint64 (authority->priv->rules_cache_evictions));
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 static JSBool
 js_polkit_log (JSContext  *cx,
                unsigned    argc,
@@ -1371,6 +1832,7 @@ js_polkit_spawn (JSContext  *cx,
   GMainContext *context = NULL;
   GMainLoop *loop = NULL;
   SpawnData data = {0};
+  gboolean spawned;
   guint n;
 
   if (!JS_ConvertArguments (cx, js_argc, JS_ARGV (cx, vp), "o", &array_object))
@@ -1403,27 +1865,42 @@ js_polkit_spawn (JSContext  *cx,
       JS_free (cx, s);
     }
 
-  context = g_main_context_new ();
-  loop = g_main_loop_new (context, FALSE);
+  if (polkit_backend_spawner_is_running ())
+    {
+      /* avoids forking polkitd with the whole JS heap mapped */
+      spawned = polkit_backend_spawner_run ((const gchar *const *) argv,
+                                            10, /* timeout_seconds */
+                                            &exit_status,
+                                            &standard_output,
+                                            &standard_error,
+                                            &error);
+    }
+  else
+    {
+      context = g_main_context_new ();
+      loop = g_main_loop_new (context, FALSE);
 
-  g_main_context_push_thread_default (context);
+      g_main_context_push_thread_default (context);
 
-  data.loop = loop;
-  utils_spawn ((const gchar *const *) argv,
-               10, /* timeout_seconds */
-               NULL, /* cancellable */
-               spawn_cb,
-               &data);
+      data.loop = loop;
+      utils_spawn ((const gchar *const *) argv,
+                   10, /* timeout_seconds */
+                   NULL, /* cancellable */
+                   spawn_cb,
+                   &data);
 
-  g_main_loop_run (loop);
+      g_main_loop_run (loop);
 
-  g_main_context_pop_thread_default (context);
+      g_main_context_pop_thread_default (context);
 
-  if (!utils_spawn_finish (data.res,
-                           &exit_status,
-                           &standard_output,
-                           &standard_error,
-                           &error))
+      spawned = utils_spawn_finish (data.res,
+                                    &exit_status,
+                                    &standard_output,
+                                    &standard_error,
+                                    &error);
+    }
+
+  if (!spawned)
     {
       JS_ReportError (cx,
                       "Error spawning helper: %s (%s, %d)",
@@ -1487,7 +1964,9 @@ js_polkit_user_is_in_netgroup (JSContext  *cx,
   JSString *netgroup_str;
   char *user;
   char *netgroup;
+  gboolean is_member = FALSE;
   JSBool is_in_netgroup = JS_FALSE;
+  GError *error = NULL;
 
   if (!JS_ConvertArguments (cx, argc, JS_ARGV (cx, vp), "SS", &user_str, &netgroup_str))
     goto out;
@@ -1495,10 +1974,12 @@ js_polkit_user_is_in_netgroup (JSContext  *cx,
   user = JS_EncodeString (cx, user_str);
   netgroup = JS_EncodeString (cx, netgroup_str);
 
-  if (innetgr (netgroup,
-               NULL,  /* host */
-               user,
-               NULL)) /* domain */
+  if (!polkit_backend_resolver_user_is_in_netgroup (user, netgroup, &is_member, &error))
+    {
+      g_warning ("Error checking if %s is in netgroup %s: %s", user, netgroup, error->message);
+      g_clear_error (&error);
+    }
+  else if (is_member)
     {
       is_in_netgroup =  JS_TRUE;
     }
@@ -1515,6 +1996,143 @@ js_polkit_user_is_in_netgroup (JSContext  *cx,
 
 
 
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gchar *
+cache_key_from_js (JSContext *cx,
+                   JSString  *key_str)
+{
+  const jschar *chars;
+  gchar *ret;
+
+  chars = JS_GetStringCharsZ (cx, key_str);
+  if (chars == NULL)
+    return NULL;
+
+  ret = g_utf16_to_utf8 (chars, -1, NULL, NULL, NULL);
+  if (ret == NULL)
+    JS_ReportError (cx, "Cache key is not valid UTF-16");
+  return ret;
+}
+
+/* authority->priv->cx must be within a request */
+static JSBool
+js_polkit_cache_get (JSContext  *cx,
+                     unsigned    argc,
+                     jsval      *vp)
+{
+  PolkitBackendJsAuthority *authority = POLKIT_BACKEND_JS_AUTHORITY (JS_GetContextPrivate (cx));
+  JSBool ret = JS_FALSE;
+  JSString *key_str;
+  JSString *value_str;
+  gchar *key = NULL;
+  RulesCacheEntry *entry;
+
+  if (!JS_ConvertArguments (cx, argc, JS_ARGV (cx, vp), "S", &key_str))
+    goto out;
+
+  key = cache_key_from_js (cx, key_str);
+  if (key == NULL)
+    goto out;
+
+  entry = (RulesCacheEntry *) g_hash_table_lookup (authority->priv->rules_cache, key);
+  if (entry != NULL && entry->expiration_time <= g_get_monotonic_time ())
+    {
+      rules_cache_remove (authority, key, entry);
+      entry = NULL;
+    }
+
+  if (entry == NULL)
+    {
+      authority->priv->rules_cache_misses++;
+      JS_SET_RVAL (cx, vp, JSVAL_VOID);  /* return undefined */
+    }
+  else
+    {
+      value_str = JS_NewUCStringCopyN (cx, entry->value, entry->value_len);
+      if (value_str == NULL)
+        goto out;
+      authority->priv->rules_cache_hits++;
+      JS_SET_RVAL (cx, vp, STRING_TO_JSVAL (value_str));
+    }
+
+  ret = JS_TRUE;
+
+ out:
+  g_free (key);
+  return ret;
+}
+
+/* authority->priv->cx must be within a request */
+static JSBool
+js_polkit_cache_set (JSContext  *cx,
+                     unsigned    argc,
+                     jsval      *vp)
+{
+  PolkitBackendJsAuthority *authority = POLKIT_BACKEND_JS_AUTHORITY (JS_GetContextPrivate (cx));
+  JSBool ret = JS_FALSE;
+  JSString *key_str;
+  JSString *value_str;
+  double ttl_seconds;
+  gchar *key = NULL;
+  const jschar *chars;
+  size_t len;
+  gsize size;
+  RulesCacheEntry *entry;
+  JSBool stored = JS_FALSE;
+
+  if (!JS_ConvertArguments (cx, argc, JS_ARGV (cx, vp), "SSd", &key_str, &value_str, &ttl_seconds))
+    goto out;
+
+  /* also catches NaN */
+  if (!(ttl_seconds > 0))
+    {
+      JS_ReportError (cx, "polkit.cache.set: ttlSeconds must be a positive number");
+      goto out;
+    }
+
+  key = cache_key_from_js (cx, key_str);
+  if (key == NULL)
+    goto out;
+
+  chars = JS_GetStringCharsAndLength (cx, value_str, &len);
+  if (chars == NULL)
+    goto out;
+
+  entry = (RulesCacheEntry *) g_hash_table_lookup (authority->priv->rules_cache, key);
+  if (entry != NULL)
+    rules_cache_remove (authority, key, entry);
+
+  size = sizeof (RulesCacheEntry) + POLKIT_BACKEND_HASH_NODE_SIZE
+    + polkit_backend_string_size (key) + len * sizeof (jschar);
+  if (size > RULES_CACHE_MAX_ENTRY_BYTES)
+    {
+      JS_ReportWarning (cx, "Not caching value for key `%s', %d bytes is too large", key, (gint) size);
+    }
+  else
+    {
+      rules_cache_make_room (authority, size);
+
+      entry = g_new0 (RulesCacheEntry, 1);
+      entry->value = (jschar *) g_memdup (chars, len * sizeof (jschar));
+      entry->value_len = len;
+      entry->expiration_time = g_get_monotonic_time ()
+        + (gint64) (MIN (ttl_seconds, (double) G_MAXINT32) * G_USEC_PER_SEC);
+      entry->size = size;
+      g_hash_table_insert (authority->priv->rules_cache, key, entry);
+      key = NULL; /* the hash table owns it */
+      authority->priv->rules_cache_bytes += size;
+      stored = JS_TRUE;
+    }
+
+  ret = JS_TRUE;
+
+  JS_SET_RVAL (cx, vp, BOOLEAN_TO_JSVAL (stored));
+ out:
+  g_free (key);
+  return ret;
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 typedef struct
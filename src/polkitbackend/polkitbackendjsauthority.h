@@ -68,6 +68,16 @@ struct _PolkitBackendJsAuthorityClass
 
 GType                   polkit_backend_js_authority_get_type (void) G_GNUC_CONST;
 
+void                    polkit_backend_js_authority_start_initialize  (PolkitBackendJsAuthority *authority);
+void                    polkit_backend_js_authority_initialize        (PolkitBackendJsAuthority *authority);
+
+void                    polkit_backend_js_authority_get_gc_statistics (PolkitBackendJsAuthority *authority,
+                                                                       guint64                  *out_heap_bytes,
+                                                                       guint64                  *out_num_gcs);
+
+void                    polkit_backend_js_authority_set_heap_limit    (PolkitBackendJsAuthority *authority,
+                                                                       gsize                     max_bytes);
+
 G_END_DECLS
 
 #endif /* __POLKIT_BACKEND_JS_AUTHORITY_H */
@@ -26,4 +26,42 @@
 #ifndef __POLKIT_BACKEND_PRIVATE_H
 #define __POLKIT_BACKEND_PRIVATE_H
 
+#include <string.h>
+#include <glib-object.h>
+
+/* Rough sizes used to account for memory, see
+ * polkit_backend_authority_add_statistics(). These don't need to be
+ * exact, only good enough to see which subsystem uses what.
+ */
+#define POLKIT_BACKEND_OBJECT_SIZE      (8 * sizeof (gpointer))
+#define POLKIT_BACKEND_HASH_TABLE_SIZE  (12 * sizeof (gpointer))
+#define POLKIT_BACKEND_HASH_NODE_SIZE   (3 * sizeof (gpointer))
+#define POLKIT_BACKEND_LIST_NODE_SIZE   (sizeof (GList))
+
+static inline gsize
+polkit_backend_string_size (const gchar *str)
+{
+  return str != NULL ? strlen (str) + 1 : 0;
+}
+
+/* for a GHashTable mapping strings to strings */
+static inline gsize
+polkit_backend_string_hash_table_size (GHashTable *hash_table)
+{
+  GHashTableIter iter;
+  const gchar *key;
+  const gchar *value;
+  gsize ret;
+
+  if (hash_table == NULL)
+    return 0;
+
+  ret = POLKIT_BACKEND_HASH_TABLE_SIZE;
+  g_hash_table_iter_init (&iter, hash_table);
+  while (g_hash_table_iter_next (&iter, (gpointer) &key, (gpointer) &value))
+    ret += POLKIT_BACKEND_HASH_NODE_SIZE + polkit_backend_string_size (key) + polkit_backend_string_size (value);
+
+  return ret;
+}
+
 #endif /* __POLKIT_BACKEND_PRIVATE_H */
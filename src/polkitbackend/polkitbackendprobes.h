@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#if !defined (_POLKIT_BACKEND_COMPILATION) || defined(_POLKIT_BACKEND_INSIDE_POLKIT_BACKEND_H)
+#error "This is a private header file."
+#endif
+
+#ifndef __POLKIT_BACKEND_PROBES_H
+#define __POLKIT_BACKEND_PROBES_H
+
+/* Static probes (USDT) for SystemTap, bpftrace and similar tools.
+ *
+ * POLKIT_PROBEn (name, ...) declares the probe polkit:name with n
+ * arguments. A probe costs a single nop when nothing is attached to
+ * it and without sys/sdt.h it compiles to nothing. The arguments are
+ * evaluated either way so only pass values that are computed anyway.
+ *
+ * Probe names use "__" between the subject and begin/end; SystemTap
+ * shows it as "-", bpftrace uses the name as is.
+ * Strings are passed as const gchar * and are only valid while the
+ * probe fires. See test/bench/tracing for example scripts.
+ */
+
+#ifdef HAVE_SYS_SDT_H
+
+#include <sys/sdt.h>
+
+#define POLKIT_PROBE0(name)                     DTRACE_PROBE (polkit, name)
+#define POLKIT_PROBE1(name, a1)                 DTRACE_PROBE1 (polkit, name, a1)
+#define POLKIT_PROBE2(name, a1, a2)             DTRACE_PROBE2 (polkit, name, a1, a2)
+#define POLKIT_PROBE3(name, a1, a2, a3)         DTRACE_PROBE3 (polkit, name, a1, a2, a3)
+#define POLKIT_PROBE4(name, a1, a2, a3, a4)     DTRACE_PROBE4 (polkit, name, a1, a2, a3, a4)
+
+#else
+
+#define POLKIT_PROBE0(name)                     do { } while (0)
+#define POLKIT_PROBE1(name, a1)                 do { (void) (a1); } while (0)
+#define POLKIT_PROBE2(name, a1, a2)             do { (void) (a1); (void) (a2); } while (0)
+#define POLKIT_PROBE3(name, a1, a2, a3)         do { (void) (a1); (void) (a2); (void) (a3); } while (0)
+#define POLKIT_PROBE4(name, a1, a2, a3, a4)     do { (void) (a1); (void) (a2); (void) (a3); (void) (a4); } while (0)
+
+#endif /* HAVE_SYS_SDT_H */
+
+#endif /* __POLKIT_BACKEND_PROBES_H */
@@ -0,0 +1,1131 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "config.h"
+#include <errno.h>
+#include <pwd.h>
+#include <grp.h>
+#ifdef HAVE_NETGROUP_H
+#include <netgroup.h>
+#else
+#include <netdb.h>
+#endif
+#include <string.h>
+#include <unistd.h>
+
+#include <polkit/polkit.h>
+#include "polkitbackendresolver.h"
+
+/**
+ * SECTION:polkitbackendresolver
+ * @title: NSS resolver
+ * @short_description: Looks up users and groups off the main loop
+ * @stability: Unstable
+ *
+ * Users, groups and netgroups may come from a network service such
+ * as LDAP, so looking them up can take arbitrarily long. The resolver
+ * does the lookups on a small pool of threads and waits for them for
+ * at most the configured timeout, see
+ * polkit_backend_resolver_set_timeout(). A lookup that doesn't finish
+ * in time fails with %G_IO_ERROR_TIMED_OUT while its thread keeps
+ * going; the pool grows by a thread for each such lookup so other
+ * lookups are not queued behind it. Requests for a lookup that is
+ * already in flight wait for that lookup instead of starting another
+ * one, unless it has already timed out for someone else, in which
+ * case they fail right away.
+ *
+ * The asynchronous variants, like
+ * polkit_backend_resolver_get_user_async(), don't block the calling
+ * thread at all.
+ *
+ * The netgroup functions use global state in the C library so
+ * netgroup lookups are serialized.
+ */
+
+#define NUM_THREADS          4
+#define MAX_EXTRA_THREADS    32
+#define DEFAULT_TIMEOUT_MSEC 5000
+
+typedef enum
+{
+  LOOKUP_USER,
+  LOOKUP_USER_BY_NAME,
+  LOOKUP_GROUP_BY_NAME,
+  LOOKUP_GROUP_MEMBERS,
+  LOOKUP_NETGROUP_MEMBERS,
+  LOOKUP_IN_NETGROUP
+} LookupKind;
+
+typedef struct
+{
+  volatile gint ref_count;
+
+  LookupKind kind;
+  gchar *key;
+  guint32 id;
+  gchar *name;
+  gchar *netgroup;
+
+  /* protected by the resolver mutex */
+  GList *waiters;
+  gboolean abandoned;
+
+  /* written by the worker thread and only read once done is set */
+  gboolean done;
+  gboolean found;
+  guint32 result_id;
+  gchar *result_name;
+  GPtrArray *result_names;
+  GArray *result_ids;
+} Lookup;
+
+/* An asynchronous request waiting for a lookup; owned by its timeout source */
+typedef struct
+{
+  Lookup *lookup;
+  GSimpleAsyncResult *simple;
+  GSource *timeout_source;
+} Waiter;
+
+typedef struct
+{
+  /* protects everything but timeout_msec, which is accessed atomically */
+  GMutex mutex;
+  /* signalled when a lookup is done */
+  GCond cond;
+
+  GThreadPool *pool;
+  /* lookups in flight, from key to Lookup */
+  GHashTable *pending;
+  /* lookups that timed out but whose thread is still running */
+  guint num_abandoned;
+
+  /* serializes setnetgrent() and friends */
+  GMutex netgroup_mutex;
+
+  gint timeout_msec;
+
+  guint64 num_lookups;
+  guint64 num_timeouts;
+} Resolver;
+
+static Resolver resolver = { .timeout_msec = DEFAULT_TIMEOUT_MSEC };
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static Lookup *
+lookup_new (LookupKind   kind,
+            guint32      id,
+            const gchar *name,
+            const gchar *netgroup)
+{
+  Lookup *lookup;
+
+  lookup = g_new0 (Lookup, 1);
+  lookup->ref_count = 1;
+  lookup->kind = kind;
+  lookup->id = id;
+  lookup->name = g_strdup (name);
+  lookup->netgroup = g_strdup (netgroup);
+  lookup->key = g_strdup_printf ("%d:%u:%s:%s",
+                                 kind,
+                                 id,
+                                 name != NULL ? name : "",
+                                 netgroup != NULL ? netgroup : "");
+  return lookup;
+}
+
+static Lookup *
+lookup_ref (Lookup *lookup)
+{
+  g_atomic_int_inc (&lookup->ref_count);
+  return lookup;
+}
+
+static void
+lookup_unref (Lookup *lookup)
+{
+  if (!g_atomic_int_dec_and_test (&lookup->ref_count))
+    return;
+
+  g_free (lookup->key);
+  g_free (lookup->name);
+  g_free (lookup->netgroup);
+  g_free (lookup->result_name);
+  if (lookup->result_names != NULL)
+    g_ptr_array_unref (lookup->result_names);
+  if (lookup->result_ids != NULL)
+    g_array_unref (lookup->result_ids);
+  g_free (lookup);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* The reentrant NSS functions store strings in a caller supplied
+ * buffer. These return the buffer, to be freed with g_free(), or NULL
+ * if there is no such entry.
+ */
+
+static gsize
+get_buffer_size (int name)
+{
+  long size;
+
+  size = sysconf (name);
+  return size > 0 ? (gsize) size : 16384;
+}
+
+static gchar *
+get_passwd_for_uid (uid_t          uid,
+                    struct passwd *pw)
+{
+  gsize size;
+
+  for (size = get_buffer_size (_SC_GETPW_R_SIZE_MAX); ; size *= 2)
+    {
+      struct passwd *result;
+      gchar *buf;
+      int rc;
+
+      buf = g_malloc (size);
+      rc = getpwuid_r (uid, pw, buf, size, &result);
+      if (rc == 0 && result != NULL)
+        return buf;
+      g_free (buf);
+      if (rc != ERANGE)
+        return NULL;
+    }
+}
+
+static gchar *
+get_passwd_for_name (const gchar   *name,
+                     struct passwd *pw)
+{
+  gsize size;
+
+  for (size = get_buffer_size (_SC_GETPW_R_SIZE_MAX); ; size *= 2)
+    {
+      struct passwd *result;
+      gchar *buf;
+      int rc;
+
+      buf = g_malloc (size);
+      rc = getpwnam_r (name, pw, buf, size, &result);
+      if (rc == 0 && result != NULL)
+        return buf;
+      g_free (buf);
+      if (rc != ERANGE)
+        return NULL;
+    }
+}
+
+static gchar *
+get_group_for_gid (gid_t         gid,
+                   struct group *gr)
+{
+  gsize size;
+
+  for (size = get_buffer_size (_SC_GETGR_R_SIZE_MAX); ; size *= 2)
+    {
+      struct group *result;
+      gchar *buf;
+      int rc;
+
+      buf = g_malloc (size);
+      rc = getgrgid_r (gid, gr, buf, size, &result);
+      if (rc == 0 && result != NULL)
+        return buf;
+      g_free (buf);
+      if (rc != ERANGE)
+        return NULL;
+    }
+}
+
+static gchar *
+get_group_for_name (const gchar  *name,
+                    struct group *gr)
+{
+  gsize size;
+
+  for (size = get_buffer_size (_SC_GETGR_R_SIZE_MAX); ; size *= 2)
+    {
+      struct group *result;
+      gchar *buf;
+      int rc;
+
+      buf = g_malloc (size);
+      rc = getgrnam_r (name, gr, buf, size, &result);
+      if (rc == 0 && result != NULL)
+        return buf;
+      g_free (buf);
+      if (rc != ERANGE)
+        return NULL;
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Looks up the uid of each user name, (guint32) -1 if unknown */
+static void
+lookup_resolve_user_names (Lookup *lookup)
+{
+  guint n;
+
+  lookup->result_ids = g_array_sized_new (FALSE, FALSE, sizeof (guint32), lookup->result_names->len);
+  for (n = 0; n < lookup->result_names->len; n++)
+    {
+      struct passwd pw;
+      gchar *buf;
+      guint32 uid;
+
+      uid = (guint32) -1;
+      buf = get_passwd_for_name (lookup->result_names->pdata[n], &pw);
+      if (buf != NULL)
+        uid = pw.pw_uid;
+      g_array_append_val (lookup->result_ids, uid);
+      g_free (buf);
+    }
+}
+
+static void
+lookup_run (Lookup *lookup)
+{
+  struct passwd pw;
+  struct group gr;
+  gchar *buf;
+  guint n;
+
+  buf = NULL;
+
+  switch (lookup->kind)
+    {
+    case LOOKUP_USER:
+      buf = get_passwd_for_uid (lookup->id, &pw);
+      if (buf == NULL)
+        break;
+
+      lookup->found = TRUE;
+      lookup->result_name = g_strdup (pw.pw_name);
+      lookup->result_names = g_ptr_array_new_with_free_func (g_free);
+      {
+        gid_t gids[512];
+        int num_gids = 512;
+
+        if (getgrouplist (pw.pw_name, pw.pw_gid, gids, &num_gids) < 0)
+          {
+            g_warning ("Error looking up groups for uid %d: %m", (gint) lookup->id);
+            break;
+          }
+
+        for (n = 0; n < (guint) num_gids; n++)
+          {
+            gchar *group_buf;
+
+            group_buf = get_group_for_gid (gids[n], &gr);
+            if (group_buf == NULL)
+              g_ptr_array_add (lookup->result_names, g_strdup_printf ("%d", (gint) gids[n]));
+            else
+              g_ptr_array_add (lookup->result_names, g_strdup (gr.gr_name));
+            g_free (group_buf);
+          }
+      }
+      break;
+
+    case LOOKUP_USER_BY_NAME:
+      buf = get_passwd_for_name (lookup->name, &pw);
+      if (buf != NULL)
+        {
+          lookup->found = TRUE;
+          lookup->result_id = pw.pw_uid;
+        }
+      break;
+
+    case LOOKUP_GROUP_BY_NAME:
+      buf = get_group_for_name (lookup->name, &gr);
+      if (buf != NULL)
+        {
+          lookup->found = TRUE;
+          lookup->result_id = gr.gr_gid;
+        }
+      break;
+
+    case LOOKUP_GROUP_MEMBERS:
+      buf = get_group_for_gid (lookup->id, &gr);
+      if (buf == NULL)
+        break;
+
+      lookup->found = TRUE;
+      lookup->result_names = g_ptr_array_new_with_free_func (g_free);
+      for (n = 0; gr.gr_mem != NULL && gr.gr_mem[n] != NULL; n++)
+        g_ptr_array_add (lookup->result_names, g_strdup (gr.gr_mem[n]));
+      lookup_resolve_user_names (lookup);
+      break;
+
+    case LOOKUP_NETGROUP_MEMBERS:
+      lookup->result_names = g_ptr_array_new_with_free_func (g_free);
+
+      g_mutex_lock (&resolver.netgroup_mutex);
+#ifdef HAVE_SETNETGRENT_RETURN
+      if (setnetgrent (lookup->netgroup) == 0)
+        {
+          endnetgrent ();
+          g_mutex_unlock (&resolver.netgroup_mutex);
+          break;
+        }
+#else
+      setnetgrent (lookup->netgroup);
+#endif
+      for (;;)
+        {
+#if defined(HAVE_NETBSD) || defined(HAVE_OPENBSD)
+          const char *hostname, *username, *domainname;
+#else
+          char *hostname, *username, *domainname;
+#endif
+          if (getnetgrent (&hostname, &username, &domainname) == 0)
+            break;
+
+          /* Skip NULL entries since we never want to make everyone an admin
+           * Skip "-" entries which mean "no match ever" in netgroup land */
+          if (username == NULL || g_strcmp0 (username, "-") == 0)
+            continue;
+
+          g_ptr_array_add (lookup->result_names, g_strdup (username));
+        }
+      endnetgrent ();
+      g_mutex_unlock (&resolver.netgroup_mutex);
+
+      lookup->found = TRUE;
+      lookup_resolve_user_names (lookup);
+      break;
+
+    case LOOKUP_IN_NETGROUP:
+      g_mutex_lock (&resolver.netgroup_mutex);
+      lookup->found = innetgr (lookup->netgroup,
+                               NULL,  /* host */
+                               lookup->name,
+                               NULL); /* domain */
+      g_mutex_unlock (&resolver.netgroup_mutex);
+      break;
+    }
+
+  g_free (buf);
+}
+
+static void
+waiter_free (Waiter *waiter)
+{
+  lookup_unref (waiter->lookup);
+  g_object_unref (waiter->simple);
+  g_free (waiter);
+}
+
+/* Must be called with the resolver mutex held */
+static void
+update_max_threads (void)
+{
+  g_thread_pool_set_max_threads (resolver.pool,
+                                 NUM_THREADS + MIN (resolver.num_abandoned, MAX_EXTRA_THREADS),
+                                 NULL);
+}
+
+/* Must be called with the resolver mutex held. Don't count the thread
+ * of a lookup nobody waits for anymore against the pool.
+ */
+static void
+lookup_abandon (Lookup *lookup)
+{
+  resolver.num_timeouts++;
+  if (lookup->abandoned)
+    return;
+
+  lookup->abandoned = TRUE;
+  resolver.num_abandoned++;
+  update_max_threads ();
+}
+
+static void
+resolver_thread_func (gpointer data,
+                      gpointer user_data)
+{
+  Lookup *lookup = data;
+  GList *l;
+
+  lookup_run (lookup);
+
+  g_mutex_lock (&resolver.mutex);
+  lookup->done = TRUE;
+  if (g_hash_table_lookup (resolver.pending, lookup->key) == lookup)
+    g_hash_table_remove (resolver.pending, lookup->key);
+  if (lookup->abandoned)
+    {
+      resolver.num_abandoned--;
+      update_max_threads ();
+    }
+  g_cond_broadcast (&resolver.cond);
+
+  for (l = lookup->waiters; l != NULL; l = l->next)
+    {
+      Waiter *waiter = l->data;
+      g_simple_async_result_set_op_res_gpointer (waiter->simple,
+                                                 lookup_ref (lookup),
+                                                 (GDestroyNotify) lookup_unref);
+      g_simple_async_result_complete_in_idle (waiter->simple);
+      /* this frees the waiter */
+      g_source_destroy (waiter->timeout_source);
+    }
+  g_list_free (lookup->waiters);
+  lookup->waiters = NULL;
+  g_mutex_unlock (&resolver.mutex);
+
+  lookup_unref (lookup);
+}
+
+/* Must be called with the resolver mutex held. Returns FALSE if the
+ * lookups can't be done on threads.
+ */
+static gboolean
+ensure_pool (void)
+{
+  GError *error;
+
+  if (resolver.pending != NULL)
+    return resolver.pool != NULL;
+
+  resolver.pending = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) lookup_unref);
+
+  error = NULL;
+  resolver.pool = g_thread_pool_new (resolver_thread_func,
+                                     NULL,
+                                     NUM_THREADS,
+                                     FALSE, /* exclusive */
+                                     &error);
+  if (resolver.pool == NULL)
+    {
+      g_warning ("Error creating resolver threads, doing lookups on the main thread: %s",
+                 error->message);
+      g_error_free (error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/* Must be called with the resolver mutex held. Takes ownership of
+ * @lookup and returns the lookup to wait for or NULL if a previous
+ * attempt of the same lookup timed out and is still stuck.
+ */
+static Lookup *
+resolver_start (Lookup *lookup)
+{
+  Lookup *other;
+
+  other = g_hash_table_lookup (resolver.pending, lookup->key);
+  if (other == NULL)
+    {
+      g_hash_table_insert (resolver.pending, lookup->key, lookup_ref (lookup));
+      g_thread_pool_push (resolver.pool, lookup_ref (lookup), NULL);
+      return lookup;
+    }
+  if (other->abandoned)
+    other = NULL;
+  else
+    lookup_ref (other);
+
+  lookup_unref (lookup);
+  return other;
+}
+
+static void
+set_timeout_error (GError **error,
+                   guint    timeout_msec)
+{
+  g_set_error (error,
+               G_IO_ERROR,
+               G_IO_ERROR_TIMED_OUT,
+               "Timed out after %u ms waiting for the name service",
+               timeout_msec);
+}
+
+/* Takes ownership of @lookup and returns a finished lookup or NULL if
+ * it timed out.
+ */
+static Lookup *
+resolver_run (Lookup  *lookup,
+              GError **error)
+{
+  gint64 end_time;
+  guint timeout_msec;
+
+  timeout_msec = (guint) g_atomic_int_get (&resolver.timeout_msec);
+
+  g_mutex_lock (&resolver.mutex);
+
+  resolver.num_lookups++;
+
+  if (!ensure_pool ())
+    {
+      g_mutex_unlock (&resolver.mutex);
+      lookup_run (lookup);
+      lookup->done = TRUE;
+      return lookup;
+    }
+
+  lookup = resolver_start (lookup);
+  if (lookup == NULL)
+    {
+      resolver.num_timeouts++;
+      g_mutex_unlock (&resolver.mutex);
+      set_timeout_error (error, timeout_msec);
+      return NULL;
+    }
+
+  end_time = g_get_monotonic_time () + timeout_msec * G_TIME_SPAN_MILLISECOND;
+  while (!lookup->done)
+    {
+      if (!g_cond_wait_until (&resolver.cond, &resolver.mutex, end_time))
+        break;
+    }
+
+  if (!lookup->done)
+    {
+      lookup_abandon (lookup);
+      g_mutex_unlock (&resolver.mutex);
+      set_timeout_error (error, timeout_msec);
+      lookup_unref (lookup);
+      return NULL;
+    }
+
+  g_mutex_unlock (&resolver.mutex);
+
+  return lookup;
+}
+
+static gboolean
+on_waiter_timeout (gpointer user_data)
+{
+  Waiter *waiter = user_data;
+  GError *error;
+  GList *l;
+
+  g_mutex_lock (&resolver.mutex);
+  l = g_list_find (waiter->lookup->waiters, waiter);
+  if (l == NULL)
+    {
+      /* the lookup finished in the meantime */
+      g_mutex_unlock (&resolver.mutex);
+      goto out;
+    }
+  waiter->lookup->waiters = g_list_delete_link (waiter->lookup->waiters, l);
+  lookup_abandon (waiter->lookup);
+  g_mutex_unlock (&resolver.mutex);
+
+  error = NULL;
+  set_timeout_error (&error, (guint) g_atomic_int_get (&resolver.timeout_msec));
+  g_simple_async_result_take_error (waiter->simple, error);
+  g_simple_async_result_complete (waiter->simple);
+
+ out:
+  return FALSE; /* remove source, this frees the waiter */
+}
+
+/* Takes ownership of @lookup and completes @simple in the thread-default
+ * main context with the finished lookup or a timeout error.
+ */
+static void
+resolver_run_async (Lookup             *lookup,
+                    GSimpleAsyncResult *simple)
+{
+  Waiter *waiter;
+  GError *error;
+  guint timeout_msec;
+
+  timeout_msec = (guint) g_atomic_int_get (&resolver.timeout_msec);
+
+  g_mutex_lock (&resolver.mutex);
+
+  resolver.num_lookups++;
+
+  if (!ensure_pool ())
+    {
+      g_mutex_unlock (&resolver.mutex);
+      lookup_run (lookup);
+      lookup->done = TRUE;
+      g_simple_async_result_set_op_res_gpointer (simple, lookup, (GDestroyNotify) lookup_unref);
+      g_simple_async_result_complete_in_idle (simple);
+      return;
+    }
+
+  lookup = resolver_start (lookup);
+  if (lookup == NULL)
+    {
+      resolver.num_timeouts++;
+      g_mutex_unlock (&resolver.mutex);
+      error = NULL;
+      set_timeout_error (&error, timeout_msec);
+      g_simple_async_result_take_error (simple, error);
+      g_simple_async_result_complete_in_idle (simple);
+      return;
+    }
+
+  waiter = g_new0 (Waiter, 1);
+  waiter->lookup = lookup;
+  waiter->simple = g_object_ref (simple);
+  waiter->timeout_source = g_timeout_source_new (timeout_msec);
+  g_source_set_callback (waiter->timeout_source,
+                         on_waiter_timeout,
+                         waiter,
+                         (GDestroyNotify) waiter_free);
+  g_source_attach (waiter->timeout_source, g_main_context_get_thread_default ());
+  g_source_unref (waiter->timeout_source);
+  lookup->waiters = g_list_prepend (lookup->waiters, waiter);
+
+  g_mutex_unlock (&resolver.mutex);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gboolean
+copy_user (Lookup    *lookup,
+           gchar    **out_user_name,
+           gchar   ***out_group_names,
+           GError   **error)
+{
+  guint n;
+
+  if (!lookup->found)
+    {
+      g_set_error (error,
+                   POLKIT_ERROR,
+                   POLKIT_ERROR_FAILED,
+                   "No UNIX user with uid %d",
+                   (gint) lookup->id);
+      return FALSE;
+    }
+
+  *out_user_name = g_strdup (lookup->result_name);
+  *out_group_names = g_new0 (gchar *, lookup->result_names->len + 1);
+  for (n = 0; n < lookup->result_names->len; n++)
+    (*out_group_names)[n] = g_strdup (lookup->result_names->pdata[n]);
+
+  return TRUE;
+}
+
+/**
+ * polkit_backend_resolver_get_user:
+ * @uid: A UNIX user id.
+ * @out_user_name: (out): Return location for the user name.
+ * @out_group_names: (out): Return location for the names of the groups the user is in.
+ * @error: Return location for error or %NULL.
+ *
+ * Looks up the name of the user with @uid and the groups it is in.
+ * Groups without a name are returned as the group id.
+ *
+ * Returns: %TRUE if the user was found, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_resolver_get_user (guint32    uid,
+                                  gchar    **out_user_name,
+                                  gchar   ***out_group_names,
+                                  GError   **error)
+{
+  Lookup *lookup;
+  gboolean ret;
+
+  lookup = resolver_run (lookup_new (LOOKUP_USER, uid, NULL, NULL), error);
+  if (lookup == NULL)
+    return FALSE;
+
+  ret = copy_user (lookup, out_user_name, out_group_names, error);
+  lookup_unref (lookup);
+  return ret;
+}
+
+/**
+ * polkit_backend_resolver_get_user_async:
+ * @uid: A UNIX user id.
+ * @callback: A #GAsyncReadyCallback to call when the lookup is done.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronously looks up the user with @uid, see
+ * polkit_backend_resolver_get_user(). The lookup times out like the
+ * synchronous one but doesn't block the calling thread.
+ *
+ * @callback is invoked in the <link
+ * linkend="g-main-context-push-thread-default">thread-default main
+ * loop</link> of the calling thread. Use
+ * polkit_backend_resolver_get_user_finish() to get the result.
+ */
+void
+polkit_backend_resolver_get_user_async (guint32              uid,
+                                        GAsyncReadyCallback  callback,
+                                        gpointer             user_data)
+{
+  GSimpleAsyncResult *simple;
+
+  simple = g_simple_async_result_new (NULL,
+                                      callback,
+                                      user_data,
+                                      polkit_backend_resolver_get_user_async);
+  resolver_run_async (lookup_new (LOOKUP_USER, uid, NULL, NULL), simple);
+  g_object_unref (simple);
+}
+
+/**
+ * polkit_backend_resolver_get_user_finish:
+ * @res: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to polkit_backend_resolver_get_user_async().
+ * @out_user_name: (out): Return location for the user name.
+ * @out_group_names: (out): Return location for the names of the groups the user is in.
+ * @error: Return location for error or %NULL.
+ *
+ * Finishes looking up a user.
+ *
+ * Returns: %TRUE if the user was found, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_resolver_get_user_finish (GAsyncResult   *res,
+                                         gchar         **out_user_name,
+                                         gchar        ***out_group_names,
+                                         GError        **error)
+{
+  GSimpleAsyncResult *simple;
+
+  simple = G_SIMPLE_ASYNC_RESULT (res);
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (simple) == polkit_backend_resolver_get_user_async);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  return copy_user (g_simple_async_result_get_op_res_gpointer (simple),
+                    out_user_name,
+                    out_group_names,
+                    error);
+}
+
+static gboolean
+copy_members (Lookup     *lookup,
+              gchar    ***out_user_names,
+              guint32   **out_uids,
+              GError    **error)
+{
+  guint n;
+
+  if (!lookup->found)
+    {
+      if (lookup->kind == LOOKUP_GROUP_MEMBERS)
+        g_set_error (error,
+                     POLKIT_ERROR,
+                     POLKIT_ERROR_FAILED,
+                     "No UNIX group with gid %d",
+                     (gint) lookup->id);
+      else
+        g_set_error (error,
+                     POLKIT_ERROR,
+                     POLKIT_ERROR_FAILED,
+                     "No net group with name %s",
+                     lookup->netgroup);
+      return FALSE;
+    }
+
+  *out_user_names = g_new0 (gchar *, lookup->result_names->len + 1);
+  for (n = 0; n < lookup->result_names->len; n++)
+    (*out_user_names)[n] = g_strdup (lookup->result_names->pdata[n]);
+  *out_uids = g_memdup (lookup->result_ids->data, lookup->result_ids->len * sizeof (guint32));
+
+  return TRUE;
+}
+
+/**
+ * polkit_backend_resolver_get_group_members:
+ * @gid: A UNIX group id.
+ * @out_user_names: (out): Return location for the names of the members.
+ * @out_uids: (out): Return location for the uids of the members.
+ * @error: Return location for error or %NULL.
+ *
+ * Looks up the members of the group with @gid. The uid of a member
+ * that is not a known user is <literal>(guint32) -1</literal>.
+ *
+ * Returns: %TRUE if the group was found, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_resolver_get_group_members (guint32    gid,
+                                           gchar   ***out_user_names,
+                                           guint32  **out_uids,
+                                           GError   **error)
+{
+  Lookup *lookup;
+  gboolean ret;
+
+  lookup = resolver_run (lookup_new (LOOKUP_GROUP_MEMBERS, gid, NULL, NULL), error);
+  if (lookup == NULL)
+    return FALSE;
+
+  ret = copy_members (lookup, out_user_names, out_uids, error);
+  lookup_unref (lookup);
+  return ret;
+}
+
+/**
+ * polkit_backend_resolver_get_group_members_async:
+ * @gid: A UNIX group id.
+ * @callback: A #GAsyncReadyCallback to call when the lookup is done.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronously looks up the members of the group with @gid, see
+ * polkit_backend_resolver_get_group_members() and
+ * polkit_backend_resolver_get_user_async().
+ *
+ * Use polkit_backend_resolver_get_members_finish() to get the result.
+ */
+void
+polkit_backend_resolver_get_group_members_async (guint32              gid,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data)
+{
+  GSimpleAsyncResult *simple;
+
+  simple = g_simple_async_result_new (NULL,
+                                      callback,
+                                      user_data,
+                                      polkit_backend_resolver_get_group_members_async);
+  resolver_run_async (lookup_new (LOOKUP_GROUP_MEMBERS, gid, NULL, NULL), simple);
+  g_object_unref (simple);
+}
+
+/**
+ * polkit_backend_resolver_get_netgroup_members:
+ * @netgroup: The name of a netgroup.
+ * @out_user_names: (out): Return location for the names of the members.
+ * @out_uids: (out): Return location for the uids of the members.
+ * @error: Return location for error or %NULL.
+ *
+ * Like polkit_backend_resolver_get_group_members() but for the users
+ * in @netgroup.
+ *
+ * Returns: %TRUE if the netgroup was found, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_resolver_get_netgroup_members (const gchar   *netgroup,
+                                              gchar       ***out_user_names,
+                                              guint32      **out_uids,
+                                              GError       **error)
+{
+  Lookup *lookup;
+  gboolean ret;
+
+  lookup = resolver_run (lookup_new (LOOKUP_NETGROUP_MEMBERS, 0, NULL, netgroup), error);
+  if (lookup == NULL)
+    return FALSE;
+
+  ret = copy_members (lookup, out_user_names, out_uids, error);
+  lookup_unref (lookup);
+  return ret;
+}
+
+/**
+ * polkit_backend_resolver_get_netgroup_members_async:
+ * @netgroup: The name of a netgroup.
+ * @callback: A #GAsyncReadyCallback to call when the lookup is done.
+ * @user_data: The data to pass to @callback.
+ *
+ * Asynchronously looks up the users in @netgroup, see
+ * polkit_backend_resolver_get_netgroup_members() and
+ * polkit_backend_resolver_get_user_async().
+ *
+ * Use polkit_backend_resolver_get_members_finish() to get the result.
+ */
+void
+polkit_backend_resolver_get_netgroup_members_async (const gchar          *netgroup,
+                                                    GAsyncReadyCallback   callback,
+                                                    gpointer              user_data)
+{
+  GSimpleAsyncResult *simple;
+
+  simple = g_simple_async_result_new (NULL,
+                                      callback,
+                                      user_data,
+                                      polkit_backend_resolver_get_netgroup_members_async);
+  resolver_run_async (lookup_new (LOOKUP_NETGROUP_MEMBERS, 0, NULL, netgroup), simple);
+  g_object_unref (simple);
+}
+
+/**
+ * polkit_backend_resolver_get_members_finish:
+ * @res: A #GAsyncResult obtained from the #GAsyncReadyCallback passed to polkit_backend_resolver_get_group_members_async() or polkit_backend_resolver_get_netgroup_members_async().
+ * @out_user_names: (out): Return location for the names of the members.
+ * @out_uids: (out): Return location for the uids of the members.
+ * @error: Return location for error or %NULL.
+ *
+ * Finishes looking up the members of a group or netgroup.
+ *
+ * Returns: %TRUE if the group was found, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_resolver_get_members_finish (GAsyncResult   *res,
+                                            gchar        ***out_user_names,
+                                            guint32       **out_uids,
+                                            GError        **error)
+{
+  GSimpleAsyncResult *simple;
+
+  simple = G_SIMPLE_ASYNC_RESULT (res);
+
+  g_warn_if_fail (g_simple_async_result_get_source_tag (simple) == polkit_backend_resolver_get_group_members_async ||
+                  g_simple_async_result_get_source_tag (simple) == polkit_backend_resolver_get_netgroup_members_async);
+
+  if (g_simple_async_result_propagate_error (simple, error))
+    return FALSE;
+
+  return copy_members (g_simple_async_result_get_op_res_gpointer (simple),
+                       out_user_names,
+                       out_uids,
+                       error);
+}
+
+/**
+ * polkit_backend_resolver_user_is_in_netgroup:
+ * @user_name: A user name.
+ * @netgroup: The name of a netgroup.
+ * @out_is_member: (out): Return location for whether the user is in @netgroup.
+ * @error: Return location for error or %NULL.
+ *
+ * Checks if @user_name is in @netgroup.
+ *
+ * Returns: %TRUE if @out_is_member was set, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_resolver_user_is_in_netgroup (const gchar  *user_name,
+                                             const gchar  *netgroup,
+                                             gboolean     *out_is_member,
+                                             GError      **error)
+{
+  Lookup *lookup;
+
+  lookup = resolver_run (lookup_new (LOOKUP_IN_NETGROUP, 0, user_name, netgroup), error);
+  if (lookup == NULL)
+    return FALSE;
+
+  *out_is_member = lookup->found;
+  lookup_unref (lookup);
+  return TRUE;
+}
+
+/**
+ * polkit_backend_resolver_identity_from_string:
+ * @str: A string obtained from polkit_identity_to_string().
+ * @error: Return location for error or %NULL.
+ *
+ * Like polkit_identity_from_string() but user and group names are
+ * looked up with the resolver.
+ *
+ * Returns: (transfer full): A #PolkitIdentity or %NULL if @error is set.
+ */
+PolkitIdentity *
+polkit_backend_resolver_identity_from_string (const gchar  *str,
+                                              GError      **error)
+{
+  PolkitIdentity *ret;
+  Lookup *lookup;
+  const gchar *name;
+  gchar *endptr;
+
+  ret = NULL;
+
+  if (g_str_has_prefix (str, "unix-user:"))
+    {
+      name = str + sizeof "unix-user:" - 1;
+      g_ascii_strtoull (name, &endptr, 10);
+      if (*endptr == '\0')
+        goto fallback;
+
+      lookup = resolver_run (lookup_new (LOOKUP_USER_BY_NAME, 0, name, NULL), error);
+      if (lookup == NULL)
+        goto out;
+      if (lookup->found)
+        ret = polkit_unix_user_new (lookup->result_id);
+      else
+        g_set_error (error,
+                     POLKIT_ERROR,
+                     POLKIT_ERROR_FAILED,
+                     "No UNIX user with name %s",
+                     name);
+      lookup_unref (lookup);
+      goto out;
+    }
+  else if (g_str_has_prefix (str, "unix-group:"))
+    {
+      name = str + sizeof "unix-group:" - 1;
+      g_ascii_strtoull (name, &endptr, 10);
+      if (*endptr == '\0')
+        goto fallback;
+
+      lookup = resolver_run (lookup_new (LOOKUP_GROUP_BY_NAME, 0, name, NULL), error);
+      if (lookup == NULL)
+        goto out;
+      if (lookup->found)
+        ret = polkit_unix_group_new (lookup->result_id);
+      else
+        g_set_error (error,
+                     POLKIT_ERROR,
+                     POLKIT_ERROR_FAILED,
+                     "No UNIX group with name %s",
+                     name);
+      lookup_unref (lookup);
+      goto out;
+    }
+
+ fallback:
+  ret = polkit_identity_from_string (str, error);
+
+ out:
+  return ret;
+}
+
+/**
+ * polkit_backend_resolver_set_timeout:
+ * @timeout_msec: The timeout in milliseconds.
+ *
+ * Sets how long to wait for a lookup. The default is 5 seconds.
+ */
+void
+polkit_backend_resolver_set_timeout (guint timeout_msec)
+{
+  g_atomic_int_set (&resolver.timeout_msec, MAX (MIN (timeout_msec, (guint) G_MAXINT), 1));
+}
+
+/**
+ * polkit_backend_resolver_get_statistics:
+ * @out_num_lookups: (out) (allow-none): Return location for the number of lookups.
+ * @out_num_timeouts: (out) (allow-none): Return location for the number of lookups that timed out.
+ *
+ * Gets statistics about the resolver.
+ */
+void
+polkit_backend_resolver_get_statistics (guint64 *out_num_lookups,
+                                        guint64 *out_num_timeouts)
+{
+  g_mutex_lock (&resolver.mutex);
+  if (out_num_lookups != NULL)
+    *out_num_lookups = resolver.num_lookups;
+  if (out_num_timeouts != NULL)
+    *out_num_timeouts = resolver.num_timeouts;
+  g_mutex_unlock (&resolver.mutex);
+}
@@ -0,0 +1,86 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#if !defined (_POLKIT_BACKEND_COMPILATION) && !defined(_POLKIT_BACKEND_INSIDE_POLKIT_BACKEND_H)
+#error "Only <polkitbackend/polkitbackend.h> can be included directly, this file may disappear or change contents."
+#endif
+
+#ifndef __POLKIT_BACKEND_RESOLVER_H
+#define __POLKIT_BACKEND_RESOLVER_H
+
+#include <glib-object.h>
+#include <polkit/polkit.h>
+#include <polkitbackend/polkitbackendtypes.h>
+
+G_BEGIN_DECLS
+
+gboolean        polkit_backend_resolver_get_user                  (guint32        uid,
+                                                                   gchar        **out_user_name,
+                                                                   gchar       ***out_group_names,
+                                                                   GError       **error);
+
+void            polkit_backend_resolver_get_user_async            (guint32              uid,
+                                                                   GAsyncReadyCallback  callback,
+                                                                   gpointer             user_data);
+
+gboolean        polkit_backend_resolver_get_user_finish           (GAsyncResult  *res,
+                                                                   gchar        **out_user_name,
+                                                                   gchar       ***out_group_names,
+                                                                   GError       **error);
+
+gboolean        polkit_backend_resolver_get_group_members         (guint32        gid,
+                                                                   gchar       ***out_user_names,
+                                                                   guint32      **out_uids,
+                                                                   GError       **error);
+
+gboolean        polkit_backend_resolver_get_netgroup_members      (const gchar   *netgroup,
+                                                                   gchar       ***out_user_names,
+                                                                   guint32      **out_uids,
+                                                                   GError       **error);
+
+void            polkit_backend_resolver_get_group_members_async   (guint32              gid,
+                                                                   GAsyncReadyCallback  callback,
+                                                                   gpointer             user_data);
+
+void            polkit_backend_resolver_get_netgroup_members_async (const gchar          *netgroup,
+                                                                    GAsyncReadyCallback   callback,
+                                                                    gpointer              user_data);
+
+gboolean        polkit_backend_resolver_get_members_finish        (GAsyncResult  *res,
+                                                                   gchar       ***out_user_names,
+                                                                   guint32      **out_uids,
+                                                                   GError       **error);
+
+gboolean        polkit_backend_resolver_user_is_in_netgroup       (const gchar   *user_name,
+                                                                   const gchar   *netgroup,
+                                                                   gboolean      *out_is_member,
+                                                                   GError       **error);
+
+PolkitIdentity *polkit_backend_resolver_identity_from_string      (const gchar   *str,
+                                                                   GError       **error);
+
+void            polkit_backend_resolver_set_timeout               (guint          timeout_msec);
+
+void            polkit_backend_resolver_get_statistics            (guint64       *out_num_lookups,
+                                                                   guint64       *out_num_timeouts);
+
+G_END_DECLS
+
+#endif /* __POLKIT_BACKEND_RESOLVER_H */
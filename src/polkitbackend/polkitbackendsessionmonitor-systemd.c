@@ -126,6 +126,9 @@ struct _PolkitBackendSessionMonitor
   GDBusConnection *system_bus;
 
   GSource *sd_source;
+
+  /* if set, used instead of logind */
+  PolkitBackendFakeSessions *fake_sessions;
 };
 
 struct _PolkitBackendSessionMonitorClass
@@ -144,6 +147,12 @@ enum
 
 static guint signals[LAST_SIGNAL] = {0};
 
+enum
+{
+  PROP_0,
+  PROP_FAKE_SESSIONS,
+};
+
 G_DEFINE_TYPE (PolkitBackendSessionMonitor, polkit_backend_session_monitor, G_TYPE_OBJECT);
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -162,6 +171,41 @@ sessions_changed (gpointer user_data)
 static void
 polkit_backend_session_monitor_init (PolkitBackendSessionMonitor *monitor)
 {
+}
+
+static void
+polkit_backend_session_monitor_set_property (GObject      *object,
+                                             guint         prop_id,
+                                             const GValue *value,
+                                             GParamSpec   *pspec)
+{
+  PolkitBackendSessionMonitor *monitor = POLKIT_BACKEND_SESSION_MONITOR (object);
+
+  switch (prop_id)
+    {
+    case PROP_FAKE_SESSIONS:
+      monitor->fake_sessions = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+on_fake_sessions_changed (PolkitBackendFakeSessions *sessions,
+                          gpointer                   user_data)
+{
+  PolkitBackendSessionMonitor *monitor = POLKIT_BACKEND_SESSION_MONITOR (user_data);
+
+  g_signal_emit (monitor, signals[CHANGED_SIGNAL], 0);
+}
+
+static void
+polkit_backend_session_monitor_constructed (GObject *object)
+{
+  PolkitBackendSessionMonitor *monitor = POLKIT_BACKEND_SESSION_MONITOR (object);
   GError *error;
 
   error = NULL;
@@ -172,9 +216,22 @@ polkit_backend_session_monitor_init (PolkitBackendSessionMonitor *monitor)
       g_error_free (error);
     }
 
-  monitor->sd_source = sd_source_new ();
-  g_source_set_callback (monitor->sd_source, sessions_changed, monitor, NULL);
-  g_source_attach (monitor->sd_source, NULL);
+  if (monitor->fake_sessions != NULL)
+    {
+      g_signal_connect (monitor->fake_sessions,
+                        "changed",
+                        G_CALLBACK (on_fake_sessions_changed),
+                        monitor);
+    }
+  else
+    {
+      monitor->sd_source = sd_source_new ();
+      g_source_set_callback (monitor->sd_source, sessions_changed, monitor, NULL);
+      g_source_attach (monitor->sd_source, NULL);
+    }
+
+  if (G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->constructed != NULL)
+    G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->constructed (object);
 }
 
 static void
@@ -191,6 +248,12 @@ polkit_backend_session_monitor_finalize (GObject *object)
       g_source_unref (monitor->sd_source);
     }
 
+  if (monitor->fake_sessions != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (monitor->fake_sessions, on_fake_sessions_changed, monitor);
+      g_object_unref (monitor->fake_sessions);
+    }
+
   if (G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->finalize != NULL)
     G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->finalize (object);
 }
@@ -202,8 +265,26 @@ polkit_backend_session_monitor_class_init (PolkitBackendSessionMonitorClass *kla
 
   gobject_class = G_OBJECT_CLASS (klass);
 
+  gobject_class->constructed = polkit_backend_session_monitor_constructed;
+  gobject_class->set_property = polkit_backend_session_monitor_set_property;
   gobject_class->finalize = polkit_backend_session_monitor_finalize;
 
+  /**
+   * PolkitBackendSessionMonitor:fake-sessions:
+   *
+   * The #PolkitBackendFakeSessions to use instead of the session
+   * tracking facility of the system or %NULL.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_FAKE_SESSIONS,
+                                   g_param_spec_object ("fake-sessions",
+                                                        "Fake sessions",
+                                                        "The sessions to use instead of the real ones",
+                                                        POLKIT_BACKEND_TYPE_FAKE_SESSIONS,
+                                                        G_PARAM_WRITABLE |
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_STATIC_STRINGS));
+
   /**
    * PolkitBackendSessionMonitor::changed:
    * @monitor: A #PolkitBackendSessionMonitor
@@ -231,11 +312,31 @@ polkit_backend_session_monitor_new (void)
   return monitor;
 }
 
+/**
+ * polkit_backend_session_monitor_new_for_fake_sessions:
+ * @sessions: A #PolkitBackendFakeSessions.
+ *
+ * Creates a session monitor tracking @sessions instead of the real
+ * sessions. This is only meant for testing.
+ *
+ * Returns: A #PolkitBackendSessionMonitor. Free with g_object_unref().
+ */
+PolkitBackendSessionMonitor *
+polkit_backend_session_monitor_new_for_fake_sessions (PolkitBackendFakeSessions *sessions)
+{
+  return POLKIT_BACKEND_SESSION_MONITOR (g_object_new (POLKIT_BACKEND_TYPE_SESSION_MONITOR,
+                                                       "fake-sessions", sessions,
+                                                       NULL));
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 GList *
 polkit_backend_session_monitor_get_sessions (PolkitBackendSessionMonitor *monitor)
 {
+  if (monitor->fake_sessions != NULL)
+    return polkit_backend_fake_sessions_get_sessions (monitor->fake_sessions);
+
   /* TODO */
   return NULL;
 }
@@ -281,8 +382,20 @@ polkit_backend_session_monitor_get_user_for_subject (PolkitBackendSessionMonitor
     }
   else if (POLKIT_IS_UNIX_SESSION (subject))
     {
-
-      if (sd_session_get_uid (polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (subject)), &uid) < 0)
+      if (monitor->fake_sessions != NULL)
+        {
+          if (!polkit_backend_fake_sessions_get_session_uid (monitor->fake_sessions,
+                                                             polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (subject)),
+                                                             &uid))
+            {
+              g_set_error (error,
+                           POLKIT_ERROR,
+                           POLKIT_ERROR_FAILED,
+                           "Error getting uid for session");
+              goto out;
+            }
+        }
+      else if (sd_session_get_uid (polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (subject)), &uid) < 0)
         {
           g_set_error (error,
                        POLKIT_ERROR,
@@ -322,6 +435,9 @@ polkit_backend_session_monitor_get_session_for_subject (PolkitBackendSessionMoni
   uid_t uid;
 #endif
 
+  if (monitor->fake_sessions != NULL)
+    return polkit_backend_fake_sessions_get_session_for_subject (monitor->fake_sessions, subject, error);
+
   if (POLKIT_IS_UNIX_PROCESS (subject))
     process = POLKIT_UNIX_PROCESS (subject); /* We already have a process */
   else if (POLKIT_IS_SYSTEM_BUS_NAME (subject))
@@ -375,6 +491,10 @@ polkit_backend_session_monitor_is_session_local (PolkitBackendSessionMonitor *mo
 {
   char *seat;
 
+  if (monitor->fake_sessions != NULL)
+    return polkit_backend_fake_sessions_is_session_local (monitor->fake_sessions,
+                                                          polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)));
+
   if (!sd_session_get_seat (polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)), &seat))
     {
       free (seat);
@@ -396,6 +516,9 @@ polkit_backend_session_monitor_is_session_active (PolkitBackendSessionMonitor *m
 
   session_id = polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session));
 
+  if (monitor->fake_sessions != NULL)
+    return polkit_backend_fake_sessions_is_session_active (monitor->fake_sessions, session_id);
+
   g_debug ("Checking whether session %s is active.", session_id);
 
   /* Check whether *any* of the user's current sessions are active. */
@@ -48,6 +48,9 @@ struct _PolkitBackendSessionMonitor
   GKeyFile *database;
   GFileMonitor *database_monitor;
   time_t database_mtime;
+
+  /* if set, used instead of ConsoleKit */
+  PolkitBackendFakeSessions *fake_sessions;
 };
 
 struct _PolkitBackendSessionMonitorClass
@@ -66,6 +69,12 @@ enum
 
 static guint signals[LAST_SIGNAL] = {0};
 
+enum
+{
+  PROP_0,
+  PROP_FAKE_SESSIONS,
+};
+
 G_DEFINE_TYPE (PolkitBackendSessionMonitor, polkit_backend_session_monitor, G_TYPE_OBJECT);
 
 /* ---------------------------------------------------------------------------------------------------- */
@@ -165,6 +174,41 @@ on_file_monitor_changed (GFileMonitor     *file_monitor,
 static void
 polkit_backend_session_monitor_init (PolkitBackendSessionMonitor *monitor)
 {
+}
+
+static void
+polkit_backend_session_monitor_set_property (GObject      *object,
+                                             guint         prop_id,
+                                             const GValue *value,
+                                             GParamSpec   *pspec)
+{
+  PolkitBackendSessionMonitor *monitor = POLKIT_BACKEND_SESSION_MONITOR (object);
+
+  switch (prop_id)
+    {
+    case PROP_FAKE_SESSIONS:
+      monitor->fake_sessions = g_value_dup_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+    }
+}
+
+static void
+on_fake_sessions_changed (PolkitBackendFakeSessions *sessions,
+                          gpointer                   user_data)
+{
+  PolkitBackendSessionMonitor *monitor = POLKIT_BACKEND_SESSION_MONITOR (user_data);
+
+  g_signal_emit (monitor, signals[CHANGED_SIGNAL], 0);
+}
+
+static void
+polkit_backend_session_monitor_constructed (GObject *object)
+{
+  PolkitBackendSessionMonitor *monitor = POLKIT_BACKEND_SESSION_MONITOR (object);
   GError *error;
   GFile *file;
 
@@ -176,6 +220,15 @@ polkit_backend_session_monitor_init (PolkitBackendSessionMonitor *monitor)
       g_error_free (error);
     }
 
+  if (monitor->fake_sessions != NULL)
+    {
+      g_signal_connect (monitor->fake_sessions,
+                        "changed",
+                        G_CALLBACK (on_fake_sessions_changed),
+                        monitor);
+      goto out;
+    }
+
   error = NULL;
   if (!ensure_database (monitor, &error))
     {
@@ -202,6 +255,10 @@ polkit_backend_session_monitor_init (PolkitBackendSessionMonitor *monitor)
                         G_CALLBACK (on_file_monitor_changed),
                         monitor);
     }
+
+ out:
+  if (G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->constructed != NULL)
+    G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->constructed (object);
 }
 
 static void
@@ -218,6 +275,12 @@ polkit_backend_session_monitor_finalize (GObject *object)
   if (monitor->database != NULL)
     g_key_file_free (monitor->database);
 
+  if (monitor->fake_sessions != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (monitor->fake_sessions, on_fake_sessions_changed, monitor);
+      g_object_unref (monitor->fake_sessions);
+    }
+
   if (G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->finalize != NULL)
     G_OBJECT_CLASS (polkit_backend_session_monitor_parent_class)->finalize (object);
 }
@@ -229,8 +292,26 @@ polkit_backend_session_monitor_class_init (PolkitBackendSessionMonitorClass *kla
 
   gobject_class = G_OBJECT_CLASS (klass);
 
+  gobject_class->constructed = polkit_backend_session_monitor_constructed;
+  gobject_class->set_property = polkit_backend_session_monitor_set_property;
   gobject_class->finalize = polkit_backend_session_monitor_finalize;
 
+  /**
+   * PolkitBackendSessionMonitor:fake-sessions:
+   *
+   * The #PolkitBackendFakeSessions to use instead of the session
+   * tracking facility of the system or %NULL.
+   */
+  g_object_class_install_property (gobject_class,
+                                   PROP_FAKE_SESSIONS,
+                                   g_param_spec_object ("fake-sessions",
+                                                        "Fake sessions",
+                                                        "The sessions to use instead of the real ones",
+                                                        POLKIT_BACKEND_TYPE_FAKE_SESSIONS,
+                                                        G_PARAM_WRITABLE |
+                                                        G_PARAM_CONSTRUCT_ONLY |
+                                                        G_PARAM_STATIC_STRINGS));
+
   /**
    * PolkitBackendSessionMonitor::changed:
    * @monitor: A #PolkitBackendSessionMonitor
@@ -258,11 +339,31 @@ polkit_backend_session_monitor_new (void)
   return monitor;
 }
 
+/**
+ * polkit_backend_session_monitor_new_for_fake_sessions:
+ * @sessions: A #PolkitBackendFakeSessions.
+ *
+ * Creates a session monitor tracking @sessions instead of the real
+ * sessions. This is only meant for testing.
+ *
+ * Returns: A #PolkitBackendSessionMonitor. Free with g_object_unref().
+ */
+PolkitBackendSessionMonitor *
+polkit_backend_session_monitor_new_for_fake_sessions (PolkitBackendFakeSessions *sessions)
+{
+  return POLKIT_BACKEND_SESSION_MONITOR (g_object_new (POLKIT_BACKEND_TYPE_SESSION_MONITOR,
+                                                       "fake-sessions", sessions,
+                                                       NULL));
+}
+
 /* ---------------------------------------------------------------------------------------------------- */
 
 GList *
 polkit_backend_session_monitor_get_sessions (PolkitBackendSessionMonitor *monitor)
 {
+  if (monitor->fake_sessions != NULL)
+    return polkit_backend_fake_sessions_get_sessions (monitor->fake_sessions);
+
   /* TODO */
   return NULL;
 }
@@ -308,6 +409,20 @@ polkit_backend_session_monitor_get_user_for_subject (PolkitBackendSessionMonitor
     {
       ret = (PolkitIdentity*)polkit_system_bus_name_get_user_sync (POLKIT_SYSTEM_BUS_NAME (subject), NULL, error);
     }
+  else if (POLKIT_IS_UNIX_SESSION (subject) && monitor->fake_sessions != NULL)
+    {
+      if (!polkit_backend_fake_sessions_get_session_uid (monitor->fake_sessions,
+                                                         polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (subject)),
+                                                         &uid))
+        {
+          g_set_error (error,
+                       POLKIT_ERROR,
+                       POLKIT_ERROR_FAILED,
+                       "Error getting uid for session");
+          goto out;
+        }
+      ret = polkit_unix_user_new (uid);
+    }
   else if (POLKIT_IS_UNIX_SESSION (subject))
     {
       if (!ensure_database (monitor, error))
@@ -353,6 +468,12 @@ polkit_backend_session_monitor_get_session_for_subject (PolkitBackendSessionMoni
 
   session = NULL;
 
+  if (monitor->fake_sessions != NULL)
+    {
+      session = polkit_backend_fake_sessions_get_session_for_subject (monitor->fake_sessions, subject, error);
+      goto out;
+    }
+
   if (POLKIT_IS_UNIX_PROCESS (subject))
     {
       const gchar *session_id;
@@ -472,6 +593,10 @@ gboolean
 polkit_backend_session_monitor_is_session_local  (PolkitBackendSessionMonitor *monitor,
                                                   PolkitSubject               *session)
 {
+  if (monitor->fake_sessions != NULL)
+    return polkit_backend_fake_sessions_is_session_local (monitor->fake_sessions,
+                                                          polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)));
+
   return get_boolean (monitor, session, "is_local");
 }
 
@@ -480,6 +605,10 @@ gboolean
 polkit_backend_session_monitor_is_session_active (PolkitBackendSessionMonitor *monitor,
                                                   PolkitSubject               *session)
 {
+  if (monitor->fake_sessions != NULL)
+    return polkit_backend_fake_sessions_is_session_active (monitor->fake_sessions,
+                                                           polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)));
+
   return get_boolean (monitor, session, "is_active");
 }
 
@@ -28,6 +28,7 @@
 
 #include <glib-object.h>
 #include <polkitbackend/polkitbackendtypes.h>
+#include <polkitbackend/polkitbackendfakesessions.h>
 
 G_BEGIN_DECLS
 
@@ -43,6 +44,7 @@ typedef struct _PolkitBackendSessionMonitorClass    PolkitBackendSessionMonitorC
 
 GType                        polkit_backend_session_monitor_get_type     (void) G_GNUC_CONST;
 PolkitBackendSessionMonitor *polkit_backend_session_monitor_new          (void);
+PolkitBackendSessionMonitor *polkit_backend_session_monitor_new_for_fake_sessions (PolkitBackendFakeSessions *sessions);
 GList                       *polkit_backend_session_monitor_get_sessions (PolkitBackendSessionMonitor *monitor);
 
 PolkitIdentity              *polkit_backend_session_monitor_get_user_for_subject (PolkitBackendSessionMonitor *monitor,
@@ -0,0 +1,734 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "config.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <gio/gio.h>
+
+#include "polkitbackendspawner.h"
+
+extern char **environ;
+
+/**
+ * SECTION:polkitbackendspawner
+ * @title: Spawn server
+ * @short_description: Runs helpers from a small pre-forked process
+ * @stability: Unstable
+ *
+ * Helpers spawned by rules used to be forked from polkitd itself,
+ * which means copying the page tables of a process with the whole
+ * JavaScript heap mapped for every polkit.spawn() call.
+ *
+ * polkit_backend_spawner_start() instead forks a spawn server while
+ * polkitd is still small and has no threads. The server receives
+ * argument vectors over a socketpair, launches them with
+ * posix_spawnp() and sends back the exit status and what the child
+ * wrote to stdout and stderr. A child that runs for longer than the
+ * timeout is sent SIGTERM, just like with the in-process spawning.
+ *
+ * Requests are handled one at a time, which is fine since rules are
+ * evaluated one at a time as well.
+ */
+
+typedef enum
+{
+  SPAWN_RESULT_EXITED,
+  SPAWN_RESULT_TIMED_OUT,
+  SPAWN_RESULT_FAILED
+} SpawnResult;
+
+/* argument vectors are tiny, anything bigger is a protocol error */
+#define MAX_REQUEST_STRING (1024 * 1024)
+
+/* time the server gets on top of the helper timeout to send its reply */
+#define REPLY_GRACE_SECONDS 5
+
+typedef struct
+{
+  GMutex mutex;
+  gint fd;
+  pid_t pid;
+} Spawner;
+
+static Spawner spawner = { .fd = -1 };
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gboolean
+write_all (gint          fd,
+           gconstpointer data,
+           gsize         len)
+{
+  const gchar *p = data;
+
+  while (len > 0)
+    {
+      ssize_t num_written;
+
+      num_written = send (fd, p, len, MSG_NOSIGNAL);
+      if (num_written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return FALSE;
+        }
+      p += num_written;
+      len -= num_written;
+    }
+
+  return TRUE;
+}
+
+static gboolean
+read_all (gint     fd,
+          gpointer data,
+          gsize    len)
+{
+  gchar *p = data;
+
+  while (len > 0)
+    {
+      ssize_t num_read;
+
+      num_read = read (fd, p, len);
+      if (num_read < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return FALSE;
+        }
+      if (num_read == 0)
+        return FALSE;
+      p += num_read;
+      len -= num_read;
+    }
+
+  return TRUE;
+}
+
+static void
+append_uint32 (GString *buf,
+               guint32  value)
+{
+  g_string_append_len (buf, (const gchar *) &value, sizeof value);
+}
+
+static void
+append_string (GString     *buf,
+               const gchar *str,
+               gsize        len)
+{
+  append_uint32 (buf, len);
+  g_string_append_len (buf, str, len);
+}
+
+static gboolean
+read_uint32 (gint     fd,
+             guint32 *out_value)
+{
+  return read_all (fd, out_value, sizeof *out_value);
+}
+
+static gchar *
+read_string (gint  fd,
+             gsize max_len)
+{
+  guint32 len;
+  gchar *str;
+
+  if (!read_uint32 (fd, &len) || len > max_len)
+    return NULL;
+
+  str = g_malloc (len + 1);
+  if (!read_all (fd, str, len))
+    {
+      g_free (str);
+      return NULL;
+    }
+  str[len] = '\0';
+
+  return str;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* everything below runs in the spawn server process */
+
+static gint sigchld_pipe[2] = { -1, -1 };
+
+static void
+server_on_sigchld (int signum)
+{
+  gint saved_errno = errno;
+
+  if (write (sigchld_pipe[1], "", 1) < 0)
+    {
+      /* the pipe is full, which already wakes up poll() */
+    }
+  errno = saved_errno;
+}
+
+static void
+set_fd_flags (gint     fd,
+              gboolean cloexec,
+              gboolean nonblock)
+{
+  if (cloexec)
+    fcntl (fd, F_SETFD, fcntl (fd, F_GETFD) | FD_CLOEXEC);
+  if (nonblock)
+    fcntl (fd, F_SETFL, fcntl (fd, F_GETFL) | O_NONBLOCK);
+}
+
+/* reads what is available from *fd, closing it and setting it to -1 at EOF */
+static void
+server_drain (gint    *fd,
+              GString *out)
+{
+  gchar buf[4096];
+
+  while (*fd != -1)
+    {
+      ssize_t num_read;
+
+      num_read = read (*fd, buf, sizeof buf);
+      if (num_read > 0)
+        {
+          g_string_append_len (out, buf, num_read);
+        }
+      else if (num_read < 0 && errno == EINTR)
+        {
+          continue;
+        }
+      else if (num_read < 0 && errno == EAGAIN)
+        {
+          break;
+        }
+      else
+        {
+          close (*fd);
+          *fd = -1;
+        }
+    }
+}
+
+static SpawnResult
+server_run (gchar   **argv,
+            guint     timeout_seconds,
+            gint     *out_value,
+            GString  *out,
+            GString  *err)
+{
+  SpawnResult result;
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  sigset_t default_signals;
+  sigset_t no_signals;
+  gint out_pipe[2] = { -1, -1 };
+  gint err_pipe[2] = { -1, -1 };
+  gint64 deadline;
+  pid_t pid;
+  gint rc;
+  gint n;
+
+  result = SPAWN_RESULT_FAILED;
+  *out_value = 0;
+
+  if (pipe (out_pipe) != 0 || pipe (err_pipe) != 0)
+    {
+      *out_value = errno;
+      goto out;
+    }
+  for (n = 0; n < 2; n++)
+    {
+      set_fd_flags (out_pipe[n], TRUE, n == 0);
+      set_fd_flags (err_pipe[n], TRUE, n == 0);
+    }
+
+  posix_spawn_file_actions_init (&actions);
+  posix_spawn_file_actions_addopen (&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+  posix_spawn_file_actions_adddup2 (&actions, out_pipe[1], STDOUT_FILENO);
+  posix_spawn_file_actions_adddup2 (&actions, err_pipe[1], STDERR_FILENO);
+
+  sigfillset (&default_signals);
+  sigdelset (&default_signals, SIGKILL);
+  sigdelset (&default_signals, SIGSTOP);
+  sigemptyset (&no_signals);
+  posix_spawnattr_init (&attr);
+  posix_spawnattr_setsigdefault (&attr, &default_signals);
+  posix_spawnattr_setsigmask (&attr, &no_signals);
+  posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+  rc = posix_spawnp (&pid, argv[0], &actions, &attr, argv, environ);
+
+  posix_spawnattr_destroy (&attr);
+  posix_spawn_file_actions_destroy (&actions);
+  close (out_pipe[1]);
+  out_pipe[1] = -1;
+  close (err_pipe[1]);
+  err_pipe[1] = -1;
+
+  if (rc != 0)
+    {
+      *out_value = rc;
+      goto out;
+    }
+
+  deadline = -1;
+  if (timeout_seconds > 0)
+    deadline = g_get_monotonic_time () + (gint64) timeout_seconds * G_USEC_PER_SEC;
+
+  while (TRUE)
+    {
+      struct pollfd fds[3];
+      gint num_fds;
+      gint wait_msec;
+      gint status;
+      gchar buf[64];
+
+      if (waitpid (pid, &status, WNOHANG) == pid)
+        {
+          /* like g_spawn_sync(), only collect what the child wrote before exiting */
+          server_drain (&out_pipe[0], out);
+          server_drain (&err_pipe[0], err);
+          *out_value = status;
+          result = SPAWN_RESULT_EXITED;
+          goto out;
+        }
+
+      wait_msec = -1;
+      if (deadline != -1)
+        {
+          gint64 now = g_get_monotonic_time ();
+          if (now >= deadline)
+            {
+              kill (pid, SIGTERM);
+              result = SPAWN_RESULT_TIMED_OUT;
+              goto out;
+            }
+          wait_msec = MIN ((deadline - now + 999) / 1000, G_MAXINT);
+        }
+
+      num_fds = 0;
+      fds[num_fds].fd = sigchld_pipe[0];
+      fds[num_fds++].events = POLLIN;
+      if (out_pipe[0] != -1)
+        {
+          fds[num_fds].fd = out_pipe[0];
+          fds[num_fds++].events = POLLIN;
+        }
+      if (err_pipe[0] != -1)
+        {
+          fds[num_fds].fd = err_pipe[0];
+          fds[num_fds++].events = POLLIN;
+        }
+
+      if (poll (fds, num_fds, wait_msec) < 0 && errno != EINTR)
+        {
+          *out_value = errno;
+          kill (pid, SIGTERM);
+          goto out;
+        }
+
+      while (read (sigchld_pipe[0], buf, sizeof buf) > 0)
+        ;
+      server_drain (&out_pipe[0], out);
+      server_drain (&err_pipe[0], err);
+    }
+
+ out:
+  for (n = 0; n < 2; n++)
+    {
+      if (out_pipe[n] != -1)
+        close (out_pipe[n]);
+      if (err_pipe[n] != -1)
+        close (err_pipe[n]);
+    }
+  return result;
+}
+
+static gboolean
+server_handle_request (gint fd)
+{
+  GString *reply;
+  GPtrArray *argv;
+  guint32 timeout_seconds;
+  guint32 argc;
+  guint32 n;
+  SpawnResult result;
+  gint value;
+  GString *out;
+  GString *err;
+  gboolean ret;
+
+  ret = FALSE;
+  argv = g_ptr_array_new_with_free_func (g_free);
+  out = g_string_new (NULL);
+  err = g_string_new (NULL);
+  reply = g_string_new (NULL);
+
+  if (!read_uint32 (fd, &timeout_seconds) || !read_uint32 (fd, &argc) || argc == 0 || argc > 4096)
+    goto out;
+  for (n = 0; n < argc; n++)
+    {
+      gchar *arg;
+
+      arg = read_string (fd, MAX_REQUEST_STRING);
+      if (arg == NULL)
+        goto out;
+      g_ptr_array_add (argv, arg);
+    }
+  g_ptr_array_add (argv, NULL);
+
+  /* children that timed out in earlier requests */
+  while (waitpid (-1, NULL, WNOHANG) > 0)
+    ;
+
+  result = server_run ((gchar **) argv->pdata, timeout_seconds, &value, out, err);
+
+  append_uint32 (reply, result);
+  append_uint32 (reply, value);
+  append_string (reply, out->str, out->len);
+  append_string (reply, err->str, err->len);
+  ret = write_all (fd, reply->str, reply->len);
+
+ out:
+  g_string_free (reply, TRUE);
+  g_string_free (err, TRUE);
+  g_string_free (out, TRUE);
+  g_ptr_array_unref (argv);
+  return ret;
+}
+
+static void
+server_main (gint fd)
+{
+  struct sigaction sa;
+  glong max_fd;
+  gint n;
+
+  /* don't keep the sockets, log connection and such of polkitd open */
+  max_fd = sysconf (_SC_OPEN_MAX);
+  if (max_fd < 0 || max_fd > 65536)
+    max_fd = 65536;
+  for (n = 3; n < max_fd; n++)
+    {
+      if (n != fd)
+        close (n);
+    }
+
+  memset (&sa, 0, sizeof sa);
+  sa.sa_handler = SIG_DFL;
+  sigaction (SIGINT, &sa, NULL);
+  sigaction (SIGTERM, &sa, NULL);
+  sigaction (SIGHUP, &sa, NULL);
+  sa.sa_handler = SIG_IGN;
+  sigaction (SIGPIPE, &sa, NULL);
+
+  if (pipe (sigchld_pipe) != 0)
+    _exit (1);
+  set_fd_flags (sigchld_pipe[0], TRUE, TRUE);
+  set_fd_flags (sigchld_pipe[1], TRUE, TRUE);
+
+  sa.sa_handler = server_on_sigchld;
+  sa.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+  sigaction (SIGCHLD, &sa, NULL);
+
+  /* polkitd went away when the socket is closed */
+  while (server_handle_request (fd))
+    ;
+
+  _exit (0);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* must be called with the mutex held */
+static void
+spawner_stop_locked (void)
+{
+  if (spawner.fd == -1)
+    return;
+
+  close (spawner.fd);
+  spawner.fd = -1;
+
+  /* the server may be waiting for a child, don't wait for it as well */
+  kill (spawner.pid, SIGTERM);
+  waitpid (spawner.pid, NULL, 0);
+  spawner.pid = 0;
+}
+
+/**
+ * polkit_backend_spawner_start:
+ * @error: Return location for error or %NULL.
+ *
+ * Forks the spawn server used by polkit_backend_spawner_run().
+ *
+ * This must be called before any threads are started since the
+ * server is forked from the calling process, and with the
+ * environment the helpers should run in.
+ *
+ * Returns: %TRUE if the spawn server was started, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_spawner_start (GError **error)
+{
+  gint fds[2];
+  pid_t pid;
+
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  g_return_val_if_fail (spawner.fd == -1, FALSE);
+
+  if (socketpair (AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+    {
+      gint errsv = errno;
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Error creating socketpair: %s",
+                   g_strerror (errsv));
+      return FALSE;
+    }
+
+  pid = fork ();
+  if (pid < 0)
+    {
+      gint errsv = errno;
+      close (fds[0]);
+      close (fds[1]);
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Error forking spawn server: %s",
+                   g_strerror (errsv));
+      return FALSE;
+    }
+
+  if (pid == 0)
+    {
+      close (fds[0]);
+      server_main (fds[1]);
+    }
+
+  close (fds[1]);
+  set_fd_flags (fds[0], TRUE, FALSE);
+
+  g_mutex_lock (&spawner.mutex);
+  spawner.fd = fds[0];
+  spawner.pid = pid;
+  g_mutex_unlock (&spawner.mutex);
+
+  return TRUE;
+}
+
+/**
+ * polkit_backend_spawner_stop:
+ *
+ * Stops the spawn server started with polkit_backend_spawner_start(),
+ * if any.
+ */
+void
+polkit_backend_spawner_stop (void)
+{
+  g_mutex_lock (&spawner.mutex);
+  spawner_stop_locked ();
+  g_mutex_unlock (&spawner.mutex);
+}
+
+/**
+ * polkit_backend_spawner_is_running:
+ *
+ * Returns: %TRUE if the spawn server is running.
+ */
+gboolean
+polkit_backend_spawner_is_running (void)
+{
+  gboolean ret;
+
+  g_mutex_lock (&spawner.mutex);
+  ret = (spawner.fd != -1);
+  g_mutex_unlock (&spawner.mutex);
+
+  return ret;
+}
+
+/**
+ * polkit_backend_spawner_run:
+ * @argv: The argument vector, searched for in <envar>PATH</envar>.
+ * @timeout_seconds: Seconds to wait for the child to exit or 0 to wait forever.
+ * @out_exit_status: (out): Return location for the wait status of the child.
+ * @out_standard_output: (out) (allow-none): Return location for what the child wrote to stdout or %NULL.
+ * @out_standard_error: (out) (allow-none): Return location for what the child wrote to stderr or %NULL.
+ * @error: Return location for error or %NULL.
+ *
+ * Runs @argv from the spawn server and waits for it to exit. The
+ * child gets <filename>/dev/null</filename> as stdin.
+ *
+ * If the child runs for longer than @timeout_seconds it is sent
+ * SIGTERM and %G_IO_ERROR_TIMED_OUT is returned. If the child could
+ * not be launched, an error in the %G_SPAWN_ERROR domain is
+ * returned. If the spawn server is not running or stops responding,
+ * an error in the %G_IO_ERROR domain is returned and the server is
+ * stopped.
+ *
+ * Returns: %TRUE if the child ran and @out_exit_status is set, %FALSE if @error is set.
+ */
+gboolean
+polkit_backend_spawner_run (const gchar *const  *argv,
+                            guint                timeout_seconds,
+                            gint                *out_exit_status,
+                            gchar              **out_standard_output,
+                            gchar              **out_standard_error,
+                            GError             **error)
+{
+  GString *request;
+  struct pollfd pfd;
+  gint wait_msec;
+  gint rc;
+  guint32 result;
+  guint32 value;
+  gchar *standard_output;
+  gchar *standard_error;
+  gboolean ret;
+  guint n;
+
+  g_return_val_if_fail (argv != NULL && argv[0] != NULL, FALSE);
+  g_return_val_if_fail (out_exit_status != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  ret = FALSE;
+  standard_output = NULL;
+  standard_error = NULL;
+
+  request = g_string_new (NULL);
+  append_uint32 (request, timeout_seconds);
+  append_uint32 (request, g_strv_length ((gchar **) argv));
+  for (n = 0; argv[n] != NULL; n++)
+    append_string (request, argv[n], strlen (argv[n]));
+
+  g_mutex_lock (&spawner.mutex);
+
+  if (spawner.fd == -1)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_NOT_CONNECTED,
+                   "The spawn server is not running");
+      goto out;
+    }
+
+  if (!write_all (spawner.fd, request->str, request->len))
+    {
+      gint errsv = errno;
+      g_set_error (error,
+                   G_IO_ERROR,
+                   g_io_error_from_errno (errsv),
+                   "Error sending request to spawn server: %s",
+                   g_strerror (errsv));
+      spawner_stop_locked ();
+      goto out;
+    }
+
+  wait_msec = -1;
+  if (timeout_seconds > 0)
+    wait_msec = MIN (((gint64) timeout_seconds + REPLY_GRACE_SECONDS) * 1000, G_MAXINT);
+  pfd.fd = spawner.fd;
+  pfd.events = POLLIN;
+  do
+    rc = poll (&pfd, 1, wait_msec);
+  while (rc < 0 && errno == EINTR);
+
+  if (rc <= 0)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_TIMED_OUT,
+                   "The spawn server did not reply in time");
+      spawner_stop_locked ();
+      goto out;
+    }
+
+  if (!read_uint32 (spawner.fd, &result) ||
+      !read_uint32 (spawner.fd, &value) ||
+      (standard_output = read_string (spawner.fd, G_MAXINT32)) == NULL ||
+      (standard_error = read_string (spawner.fd, G_MAXINT32)) == NULL)
+    {
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_BROKEN_PIPE,
+                   "Error reading reply from spawn server");
+      spawner_stop_locked ();
+      goto out;
+    }
+
+  switch (result)
+    {
+    case SPAWN_RESULT_EXITED:
+      *out_exit_status = value;
+      if (out_standard_output != NULL)
+        {
+          *out_standard_output = standard_output;
+          standard_output = NULL;
+        }
+      if (out_standard_error != NULL)
+        {
+          *out_standard_error = standard_error;
+          standard_error = NULL;
+        }
+      ret = TRUE;
+      break;
+
+    case SPAWN_RESULT_TIMED_OUT:
+      g_set_error (error,
+                   G_IO_ERROR,
+                   G_IO_ERROR_TIMED_OUT,
+                   "Timed out after %u seconds",
+                   timeout_seconds);
+      break;
+
+    default:
+      g_set_error (error,
+                   G_SPAWN_ERROR,
+                   value == ENOENT ? G_SPAWN_ERROR_NOENT :
+                   value == EACCES ? G_SPAWN_ERROR_ACCES : G_SPAWN_ERROR_FAILED,
+                   "Failed to execute child process \"%s\" (%s)",
+                   argv[0],
+                   g_strerror (value));
+      break;
+    }
+
+ out:
+  g_mutex_unlock (&spawner.mutex);
+  g_free (standard_output);
+  g_free (standard_error);
+  g_string_free (request, TRUE);
+  return ret;
+}
@@ -0,0 +1,357 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <syslog.h>
+
+#include "polkitbackendwatchdog.h"
+
+/**
+ * SECTION:polkitbackendwatchdog
+ * @title: Main loop watchdog
+ * @short_description: Detects when polkitd stops serving requests
+ * @stability: Unstable
+ *
+ * A lot of what polkitd does for a request happens synchronously on
+ * the main loop - resolving users and groups, reading /proc, looking
+ * up sessions, running rules and spawning helpers from them - so a
+ * single slow operation stalls every client.
+ *
+ * The watchdog adds a heartbeat to the main loop and runs a thread
+ * that checks it. When the heartbeat is late by more than the
+ * threshold, the thread logs what the main loop is busy with: the
+ * request being handled, its caller and action and the stage of the
+ * authorization check. Once the main loop runs again the stall is
+ * counted, see polkit_backend_watchdog_get_statistics().
+ *
+ * The activity is set from the main loop with
+ * polkit_backend_watchdog_set_activity() and
+ * polkit_backend_watchdog_set_stage(). These are cheap no-ops unless
+ * the watchdog is running.
+ */
+
+typedef struct
+{
+  /* protects everything but running */
+  GMutex mutex;
+  GCond cond;
+
+  gboolean running;
+  gboolean quit;
+
+  gboolean use_syslog;
+  GThread *thread;
+  GSource *heartbeat_source;
+
+  guint threshold_msec;
+  guint interval_msec;
+  gint64 last_heartbeat;
+  gboolean stall_reported;
+
+  /* what the main loop is doing, copied since the watchdog thread reads it */
+  gchar request[64];
+  gchar caller[128];
+  gchar action_id[256];
+  const gchar *stage;
+  gint64 activity_start;
+
+  guint64 num_stalls;
+  guint64 longest_stall_msec;
+  guint64 total_stall_msec;
+} Watchdog;
+
+static Watchdog watchdog;
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Called from the watchdog thread too, so this must not use the
+ * authority - syslog() and g_message() are safe to call from any thread
+ */
+static void
+watchdog_log (const gchar *message)
+{
+  if (watchdog.use_syslog)
+    syslog (LOG_NOTICE, "%s", message);
+  g_message ("%s", message);
+}
+
+/* must be called with the mutex held */
+static gchar *
+describe_activity (gint64 now)
+{
+  if (watchdog.request[0] == '\0')
+    return g_strdup ("outside of any request");
+
+  return g_strdup_printf ("in request=%s caller=%s action=%s stage=%s (running for %d ms)",
+                          watchdog.request,
+                          watchdog.caller[0] != '\0' ? watchdog.caller : "(none)",
+                          watchdog.action_id[0] != '\0' ? watchdog.action_id : "(none)",
+                          watchdog.stage != NULL ? watchdog.stage : "(none)",
+                          (gint) ((now - watchdog.activity_start) / 1000));
+}
+
+static gboolean
+on_heartbeat (gpointer user_data)
+{
+  gint64 now;
+  gint64 late_msec;
+  gchar *message;
+
+  message = NULL;
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&watchdog.mutex);
+  late_msec = (now - watchdog.last_heartbeat) / 1000 - watchdog.interval_msec;
+  watchdog.last_heartbeat = now;
+  if (late_msec > watchdog.threshold_msec)
+    {
+      watchdog.num_stalls++;
+      watchdog.total_stall_msec += late_msec;
+      if ((guint64) late_msec > watchdog.longest_stall_msec)
+        watchdog.longest_stall_msec = late_msec;
+
+      /* the activity that caused a stall too short for the thread to see is gone */
+      if (watchdog.stall_reported)
+        message = g_strdup_printf ("Main loop resumed after being stalled for %d ms", (gint) late_msec);
+      else
+        message = g_strdup_printf ("Main loop was stalled for %d ms", (gint) late_msec);
+    }
+  watchdog.stall_reported = FALSE;
+  g_mutex_unlock (&watchdog.mutex);
+
+  if (message != NULL)
+    {
+      watchdog_log (message);
+      g_free (message);
+    }
+
+  return TRUE; /* keep source */
+}
+
+static gpointer
+watchdog_thread_func (gpointer user_data)
+{
+  g_mutex_lock (&watchdog.mutex);
+  while (!watchdog.quit)
+    {
+      gint64 now;
+      gint64 late_msec;
+
+      g_cond_wait_until (&watchdog.cond,
+                         &watchdog.mutex,
+                         g_get_monotonic_time () + watchdog.interval_msec * G_TIME_SPAN_MILLISECOND);
+      if (watchdog.quit)
+        break;
+
+      now = g_get_monotonic_time ();
+      late_msec = (now - watchdog.last_heartbeat) / 1000 - watchdog.interval_msec;
+      if (late_msec > watchdog.threshold_msec && !watchdog.stall_reported)
+        {
+          gchar *activity;
+          gchar *message;
+
+          watchdog.stall_reported = TRUE;
+          activity = describe_activity (now);
+          message = g_strdup_printf ("Main loop stalled for %d ms %s", (gint) late_msec, activity);
+          g_free (activity);
+
+          g_mutex_unlock (&watchdog.mutex);
+          watchdog_log (message);
+          g_free (message);
+          g_mutex_lock (&watchdog.mutex);
+        }
+    }
+  g_mutex_unlock (&watchdog.mutex);
+
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/**
+ * polkit_backend_watchdog_start:
+ * @threshold_msec: How late the main loop may be, in milliseconds.
+ * @use_syslog: Whether to log to syslog in addition to g_message().
+ *
+ * Starts watching the main loop of the default #GMainContext and
+ * logging when it has not run for more than @threshold_msec.
+ *
+ * This must be called from the thread running the main loop.
+ */
+void
+polkit_backend_watchdog_start (guint    threshold_msec,
+                               gboolean use_syslog)
+{
+  g_return_if_fail (threshold_msec > 0);
+  g_return_if_fail (!watchdog.running);
+
+  g_mutex_lock (&watchdog.mutex);
+  watchdog.use_syslog = use_syslog;
+  watchdog.threshold_msec = threshold_msec;
+  watchdog.interval_msec = MAX (threshold_msec / 4, 1);
+  watchdog.last_heartbeat = g_get_monotonic_time ();
+  watchdog.stall_reported = FALSE;
+  watchdog.quit = FALSE;
+  watchdog.num_stalls = 0;
+  watchdog.longest_stall_msec = 0;
+  watchdog.total_stall_msec = 0;
+  watchdog.request[0] = '\0';
+  g_mutex_unlock (&watchdog.mutex);
+
+  /* high priority so a busy main loop isn't mistaken for a stalled one */
+  watchdog.heartbeat_source = g_timeout_source_new (watchdog.interval_msec);
+  g_source_set_priority (watchdog.heartbeat_source, G_PRIORITY_HIGH);
+  g_source_set_callback (watchdog.heartbeat_source, on_heartbeat, NULL, NULL);
+  g_source_attach (watchdog.heartbeat_source, NULL);
+
+  watchdog.thread = g_thread_new ("watchdog-thread", watchdog_thread_func, NULL);
+  watchdog.running = TRUE;
+}
+
+/**
+ * polkit_backend_watchdog_stop:
+ *
+ * Stops the watchdog started with polkit_backend_watchdog_start(). The
+ * statistics are kept.
+ */
+void
+polkit_backend_watchdog_stop (void)
+{
+  if (!watchdog.running)
+    return;
+
+  watchdog.running = FALSE;
+
+  g_mutex_lock (&watchdog.mutex);
+  watchdog.quit = TRUE;
+  g_cond_signal (&watchdog.cond);
+  g_mutex_unlock (&watchdog.mutex);
+  g_thread_join (watchdog.thread);
+  watchdog.thread = NULL;
+
+  g_source_destroy (watchdog.heartbeat_source);
+  g_source_unref (watchdog.heartbeat_source);
+  watchdog.heartbeat_source = NULL;
+}
+
+/**
+ * polkit_backend_watchdog_is_running:
+ *
+ * Returns: %TRUE if polkit_backend_watchdog_start() was called.
+ */
+gboolean
+polkit_backend_watchdog_is_running (void)
+{
+  return watchdog.running;
+}
+
+/**
+ * polkit_backend_watchdog_set_activity:
+ * @request: The request being handled, e.g. a D-Bus method name.
+ * @caller: (allow-none): The caller of the request or %NULL.
+ * @action_id: (allow-none): The action the request is for or %NULL.
+ *
+ * Sets what the main loop is doing, for the log message of a stall.
+ * This also clears the stage set with polkit_backend_watchdog_set_stage().
+ */
+void
+polkit_backend_watchdog_set_activity (const gchar *request,
+                                      const gchar *caller,
+                                      const gchar *action_id)
+{
+  g_return_if_fail (request != NULL);
+
+  if (!watchdog.running)
+    return;
+
+  g_mutex_lock (&watchdog.mutex);
+  g_strlcpy (watchdog.request, request, sizeof watchdog.request);
+  g_strlcpy (watchdog.caller, caller != NULL ? caller : "", sizeof watchdog.caller);
+  g_strlcpy (watchdog.action_id, action_id != NULL ? action_id : "", sizeof watchdog.action_id);
+  watchdog.stage = NULL;
+  watchdog.activity_start = g_get_monotonic_time ();
+  g_mutex_unlock (&watchdog.mutex);
+}
+
+/**
+ * polkit_backend_watchdog_set_stage:
+ * @stage: (allow-none): A static string naming the stage of the current request or %NULL.
+ *
+ * Sets the stage of the request set with
+ * polkit_backend_watchdog_set_activity(). The string is not copied.
+ */
+void
+polkit_backend_watchdog_set_stage (const gchar *stage)
+{
+  if (!watchdog.running)
+    return;
+
+  g_mutex_lock (&watchdog.mutex);
+  watchdog.stage = stage;
+  g_mutex_unlock (&watchdog.mutex);
+}
+
+/**
+ * polkit_backend_watchdog_clear_activity:
+ *
+ * Clears the activity set with polkit_backend_watchdog_set_activity()
+ * when the request is done.
+ */
+void
+polkit_backend_watchdog_clear_activity (void)
+{
+  if (!watchdog.running)
+    return;
+
+  g_mutex_lock (&watchdog.mutex);
+  watchdog.request[0] = '\0';
+  watchdog.stage = NULL;
+  g_mutex_unlock (&watchdog.mutex);
+}
+
+/**
+ * polkit_backend_watchdog_get_statistics:
+ * @out_threshold_msec: (out) (allow-none): Return location for the threshold or %NULL.
+ * @out_num_stalls: (out) (allow-none): Return location for the number of stalls or %NULL.
+ * @out_longest_stall_msec: (out) (allow-none): Return location for the longest stall or %NULL.
+ * @out_total_stall_msec: (out) (allow-none): Return location for the sum of all stalls or %NULL.
+ *
+ * Gets statistics about the stalls seen since the watchdog was
+ * started. A stall is only counted once the main loop runs again. The
+ * threshold is 0 if the watchdog was never started.
+ */
+void
+polkit_backend_watchdog_get_statistics (guint   *out_threshold_msec,
+                                        guint64 *out_num_stalls,
+                                        guint64 *out_longest_stall_msec,
+                                        guint64 *out_total_stall_msec)
+{
+  g_mutex_lock (&watchdog.mutex);
+  if (out_threshold_msec != NULL)
+    *out_threshold_msec = watchdog.threshold_msec;
+  if (out_num_stalls != NULL)
+    *out_num_stalls = watchdog.num_stalls;
+  if (out_longest_stall_msec != NULL)
+    *out_longest_stall_msec = watchdog.longest_stall_msec;
+  if (out_total_stall_msec != NULL)
+    *out_total_stall_msec = watchdog.total_stall_msec;
+  g_mutex_unlock (&watchdog.mutex);
+}
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#if !defined (_POLKIT_BACKEND_COMPILATION) && !defined(_POLKIT_BACKEND_INSIDE_POLKIT_BACKEND_H)
+#error "Only <polkitbackend/polkitbackend.h> can be included directly, this file may disappear or change contents."
+#endif
+
+#ifndef __POLKIT_BACKEND_WATCHDOG_H
+#define __POLKIT_BACKEND_WATCHDOG_H
+
+#include <glib-object.h>
+#include <polkitbackend/polkitbackendtypes.h>
+
+G_BEGIN_DECLS
+
+void     polkit_backend_watchdog_start           (guint        threshold_msec,
+                                                  gboolean     use_syslog);
+void     polkit_backend_watchdog_stop            (void);
+gboolean polkit_backend_watchdog_is_running      (void);
+
+void     polkit_backend_watchdog_set_activity    (const gchar *request,
+                                                  const gchar *caller,
+                                                  const gchar *action_id);
+void     polkit_backend_watchdog_set_stage       (const gchar *stage);
+void     polkit_backend_watchdog_clear_activity  (void);
+
+void     polkit_backend_watchdog_get_statistics  (guint   *out_threshold_msec,
+                                                  guint64 *out_num_stalls,
+                                                  guint64 *out_longest_stall_msec,
+                                                  guint64 *out_total_stall_msec);
+
+G_END_DECLS
+
+#endif /* __POLKIT_BACKEND_WATCHDOG_H */
@@ -34,17 +34,103 @@
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+/* /run is a tmpfs so this does not outlive a reboot */
+#define TEMPORARY_AUTHORIZATIONS_DIR  PACKAGE_LOCALSTATE_DIR "/run/polkit-1"
+#define TEMPORARY_AUTHORIZATIONS_FILE TEMPORARY_AUTHORIZATIONS_DIR "/temporary-authorizations"
+
 static PolkitBackendAuthority *authority = NULL;
 static gpointer                registration_id = NULL;
 static GMainLoop              *loop = NULL;
+static guint                   name_owner_id = 0;
 static gboolean                opt_replace = FALSE;
 static gboolean                opt_no_debug = FALSE;
+static gboolean                opt_no_change_user = FALSE;
+static gchar                  *opt_actions_dir = NULL;
+static gchar                 **opt_rules_dirs = NULL;
+static gchar                  *opt_fake_sessions = NULL;
+static gboolean                opt_log_timings = FALSE;
+static gint                    opt_watchdog_threshold = 0;
+static gint                    opt_max_js_heap = 0;
+static gint                    opt_max_temporary_authorizations = 0;
+static gint                    opt_nss_timeout = 0;
+static gint                    opt_exit_on_idle = 0;
+static gchar                  *opt_temporary_authorizations_file = NULL;
+/* whether we own the name and therefore the temporary authorizations file */
+static gboolean                owns_temporary_authorizations_file = FALSE;
 static GOptionEntry            opt_entries[] = {
   {"replace", 'r', 0, G_OPTION_ARG_NONE, &opt_replace, "Replace existing daemon", NULL},
   {"no-debug", 'n', 0, G_OPTION_ARG_NONE, &opt_no_debug, "Don't print debug information", NULL},
+  {"no-change-user", 0, 0, G_OPTION_ARG_NONE, &opt_no_change_user, "Don't switch to the " POLKITD_USER " user (for testing)", NULL},
+  {"actions-dir", 0, 0, G_OPTION_ARG_FILENAME, &opt_actions_dir, "Load actions from DIR (for testing)", "DIR"},
+  {"rules-dir", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_rules_dirs, "Load rules from DIR, can be used multiple times (for testing)", "DIR"},
+  {"fake-sessions", 0, 0, G_OPTION_ARG_FILENAME, &opt_fake_sessions, "Track the sessions described in FILE instead of the real ones (for testing)", "FILE"},
+  {"log-timings", 0, 0, G_OPTION_ARG_NONE, &opt_log_timings, "Log how long each stage of every authorization check took", NULL},
+  {"watchdog-threshold", 0, 0, G_OPTION_ARG_INT, &opt_watchdog_threshold, "Log when the main loop has not run for more than MSEC milliseconds", "MSEC"},
+  {"max-js-heap", 0, 0, G_OPTION_ARG_INT, &opt_max_js_heap, "Limit the JavaScript heap for rules to KB kilobytes", "KB"},
+  {"max-temporary-authorizations", 0, 0, G_OPTION_ARG_INT, &opt_max_temporary_authorizations, "Limit the memory for temporary authorizations to KB kilobytes", "KB"},
+  {"nss-timeout", 0, 0, G_OPTION_ARG_INT, &opt_nss_timeout, "Give up looking up a user or group after MSEC milliseconds", "MSEC"},
+  {"exit-on-idle", 0, 0, G_OPTION_ARG_INT, &opt_exit_on_idle, "Exit after SECONDS without requests or authentication agents, to be started again by D-Bus activation", "SECONDS"},
+  {"temporary-authorizations-file", 0, 0, G_OPTION_ARG_FILENAME, &opt_temporary_authorizations_file, "Keep temporary authorizations in FILE across restarts (default: " TEMPORARY_AUTHORIZATIONS_FILE ", none with --no-change-user)", "FILE"},
   {NULL }
 };
 
+/* Steps of the startup, several of which run concurrently, see startup_step_done() */
+typedef enum
+{
+  STARTUP_STEP_AUTHORITY,
+  STARTUP_STEP_BUS,
+  STARTUP_STEP_NAME,
+  STARTUP_STEP_ACTIONS,
+  STARTUP_STEP_RULES,
+  STARTUP_STEP_N_STEPS
+} StartupStep;
+
+static const gchar *startup_step_names[STARTUP_STEP_N_STEPS] =
+{
+  "authority",
+  "bus",
+  "name",
+  "actions",
+  "rules"
+};
+
+static gint64 startup_time = 0;
+static gint64 startup_step_usec[STARTUP_STEP_N_STEPS] = {0};
+
+/* Logs when each step finished relative to the start of the daemon
+ * once they are all done, as a single line of key=value pairs
+ */
+static void
+startup_step_done (StartupStep step)
+{
+  GString *str;
+  guint n;
+
+  if (startup_step_usec[step] > 0)
+    return;
+  startup_step_usec[step] = MAX (g_get_monotonic_time () - startup_time, 1);
+
+  for (n = 0; n < STARTUP_STEP_N_STEPS; n++)
+    {
+      if (startup_step_usec[n] == 0)
+        return;
+    }
+
+  str = g_string_new ("Startup timeline:");
+  for (n = 0; n < STARTUP_STEP_N_STEPS; n++)
+    g_string_append_printf (str, " %s_usec=%" G_GINT64_FORMAT, startup_step_names[n], startup_step_usec[n]);
+
+  polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority), "%s", str->str);
+  g_string_free (str, TRUE);
+}
+
+static gboolean
+on_start_rules (gpointer user_data)
+{
+  polkit_backend_js_authority_start_initialize (POLKIT_BACKEND_JS_AUTHORITY (authority));
+  return FALSE; /* remove source */
+}
+
 static void
 on_bus_acquired (GDBusConnection *connection,
                  const gchar     *name,
@@ -66,6 +152,71 @@ on_bus_acquired (GDBusConnection *connection,
       g_printerr ("Error registering authority: %s\n", error->message);
       g_error_free (error);
       g_main_loop_quit (loop); /* exit */
+      return;
+    }
+
+  startup_step_done (STARTUP_STEP_BUS);
+
+  /* The name is requested once we return; compile the rules on the
+   * helper threads of the JS runtime while waiting for the reply
+   */
+  g_idle_add (on_start_rules, NULL);
+}
+
+/* Only the instance owning the name may touch the temporary
+ * authorizations file; another instance may be running until then
+ */
+static void
+take_temporary_authorizations_file (void)
+{
+  GError *error;
+  guint num_restored;
+
+  if (opt_temporary_authorizations_file == NULL)
+    return;
+
+  error = NULL;
+  if (!polkit_backend_interactive_authority_load_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                           opt_temporary_authorizations_file,
+                                                                           &num_restored,
+                                                                           &error))
+    {
+      g_printerr ("Error loading temporary authorizations: %s\n", error->message);
+      g_clear_error (&error);
+    }
+  else if (num_restored > 0)
+    {
+      polkit_backend_authority_log (authority,
+                                    "Restored %u temporary authorizations from %s",
+                                    num_restored,
+                                    opt_temporary_authorizations_file);
+    }
+  polkit_backend_interactive_authority_set_temporary_authorization_file (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                         opt_temporary_authorizations_file);
+  owns_temporary_authorizations_file = TRUE;
+}
+
+static void
+release_temporary_authorizations_file (void)
+{
+  polkit_backend_interactive_authority_set_temporary_authorization_file (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                         NULL);
+  owns_temporary_authorizations_file = FALSE;
+}
+
+/* Writes out the temporary authorizations for the next instance */
+static void
+save_temporary_authorizations_file (void)
+{
+  GError *error;
+
+  error = NULL;
+  if (!polkit_backend_interactive_authority_save_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                           opt_temporary_authorizations_file,
+                                                                           &error))
+    {
+      g_printerr ("Error saving temporary authorizations: %s\n", error->message);
+      g_clear_error (&error);
     }
 }
 
@@ -76,9 +227,30 @@ on_name_lost (GDBusConnection *connection,
 {
   polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
                                 "Lost the name org.freedesktop.PolicyKit1 - exiting");
+  /* the instance replacing us, if any, owns the temporary authorizations file now */
+  release_temporary_authorizations_file ();
   g_main_loop_quit (loop);
 }
 
+static gboolean
+on_initialize_rules (gpointer user_data)
+{
+  polkit_backend_watchdog_set_activity ("InitializeRules", NULL, NULL);
+  polkit_backend_js_authority_initialize (POLKIT_BACKEND_JS_AUTHORITY (authority));
+  polkit_backend_watchdog_clear_activity ();
+  startup_step_done (STARTUP_STEP_RULES);
+  return FALSE; /* remove source */
+}
+
+static void
+on_actions_preloaded (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  polkit_backend_interactive_authority_preload_actions_finish (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (source_object), res);
+  startup_step_done (STARTUP_STEP_ACTIONS);
+}
+
 static void
 on_name_acquired (GDBusConnection *connection,
                   const gchar     *name,
@@ -86,6 +258,66 @@ on_name_acquired (GDBusConnection *connection,
 {
   polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
                                 "Acquired the name org.freedesktop.PolicyKit1 on the system bus");
+  startup_step_done (STARTUP_STEP_NAME);
+
+  /* an instance we replaced kept the file up to date and stops
+   * writing it as soon as it loses the name
+   */
+  take_temporary_authorizations_file ();
+
+  /* The rules are loaded by the first check needing them; unless one
+   * comes in first, load them once the calls queued up while we were
+   * starting have been answered
+   */
+  g_idle_add_full (G_PRIORITY_LOW, on_initialize_rules, NULL, NULL);
+}
+
+/* how long to keep handling calls sent before the name was released */
+#define EXIT_ON_IDLE_GRACE_MSEC 500
+
+static gboolean
+on_exit_on_idle_grace_done (gpointer user_data)
+{
+  g_main_loop_quit (loop);
+  return FALSE; /* remove source */
+}
+
+static gboolean
+on_idle_check (gpointer user_data)
+{
+  gint64 idle_usec;
+  gint64 remaining_usec;
+
+  idle_usec = polkit_backend_authority_get_idle_time (authority);
+  if (idle_usec < 0)
+    remaining_usec = (gint64) opt_exit_on_idle * G_USEC_PER_SEC;
+  else
+    remaining_usec = (gint64) opt_exit_on_idle * G_USEC_PER_SEC - idle_usec;
+
+  if (remaining_usec > 0)
+    {
+      g_timeout_add_seconds ((remaining_usec + G_USEC_PER_SEC - 1) / G_USEC_PER_SEC, on_idle_check, NULL);
+      return FALSE; /* remove source */
+    }
+
+  polkit_backend_authority_log (POLKIT_BACKEND_AUTHORITY (authority),
+                                "Exiting after being idle for %d seconds",
+                                (gint) (idle_usec / G_USEC_PER_SEC));
+
+  /* from now on the bus starts a new instance for new calls */
+  if (name_owner_id != 0)
+    {
+      g_bus_unown_name (name_owner_id);
+      name_owner_id = 0;
+    }
+  if (owns_temporary_authorizations_file)
+    {
+      save_temporary_authorizations_file ();
+      release_temporary_authorizations_file ();
+    }
+  g_timeout_add (EXIT_ON_IDLE_GRACE_MSEC, on_exit_on_idle_grace_done, NULL);
+
+  return FALSE; /* remove source */
 }
 
 static gboolean
@@ -96,6 +328,35 @@ on_sigint (gpointer user_data)
   return TRUE;
 }
 
+static gboolean
+on_sigterm (gpointer user_data)
+{
+  g_print ("Handling SIGTERM\n");
+  g_main_loop_quit (loop);
+  return TRUE;
+}
+
+/* Creates the directory for the temporary authorizations file while
+ * we are still root, owned by @pw if not %NULL
+ */
+static void
+prepare_temporary_authorizations_dir (struct passwd *pw)
+{
+  gchar *dir;
+
+  dir = g_path_get_dirname (opt_temporary_authorizations_file);
+  if (g_mkdir_with_parents (dir, 0700) != 0)
+    {
+      g_printerr ("Error creating directory %s: %m\n", dir);
+      goto out;
+    }
+  if (pw != NULL && chown (dir, pw->pw_uid, pw->pw_gid) != 0)
+    g_printerr ("Error changing owner of %s: %m\n", dir);
+
+ out:
+  g_free (dir);
+}
+
 static gboolean
 become_user (const gchar  *user,
              GError      **error)
@@ -160,14 +421,16 @@ main (int    argc,
   GError *error;
   GOptionContext *opt_context;
   gint ret;
-  guint name_owner_id;
   guint sigint_id;
+  guint sigterm_id;
+
+  startup_time = g_get_monotonic_time ();
 
   ret = 1;
   loop = NULL;
   opt_context = NULL;
-  name_owner_id = 0;
   sigint_id = 0;
+  sigterm_id = 0;
   registration_id = NULL;
 
   /* Disable remote file access from GIO. */
@@ -204,27 +467,71 @@ main (int    argc,
         }
     }
 
-  error = NULL;
-  if (!become_user (POLKITD_USER, &error))
+  /* an instance run for testing must not touch the file of the real one */
+  if (opt_temporary_authorizations_file == NULL && !opt_no_change_user)
+    opt_temporary_authorizations_file = g_strdup (TEMPORARY_AUTHORIZATIONS_FILE);
+  if (opt_temporary_authorizations_file != NULL)
+    prepare_temporary_authorizations_dir (opt_no_change_user ? NULL : getpwnam (POLKITD_USER));
+
+  if (!opt_no_change_user)
     {
-      g_printerr ("Error switcing to user %s: %s\n",
-                  POLKITD_USER, error->message);
-      g_clear_error (&error);
-      goto out;
-    }
+      error = NULL;
+      if (!become_user (POLKITD_USER, &error))
+        {
+          g_printerr ("Error switcing to user %s: %s\n",
+                      POLKITD_USER, error->message);
+          g_clear_error (&error);
+          goto out;
+        }
 
-  g_print ("Successfully changed to user %s\n", POLKITD_USER);
+      g_print ("Successfully changed to user %s\n", POLKITD_USER);
+    }
 
   if (g_getenv ("PATH") == NULL)
     g_setenv ("PATH", "/usr/bin:/bin:/usr/sbin:/sbin", TRUE);
 
-  authority = polkit_backend_authority_get ();
+  /* fork this while we are still small and have no threads, see polkit.spawn() */
+  error = NULL;
+  if (!polkit_backend_spawner_start (&error))
+    {
+      g_printerr ("Error starting spawn server, helpers are spawned directly: %s\n", error->message);
+      g_clear_error (&error);
+    }
+
+  if (opt_nss_timeout > 0)
+    polkit_backend_resolver_set_timeout (opt_nss_timeout);
+
+  authority = polkit_backend_authority_get_for_dirs (opt_actions_dir,
+                                                     (const gchar * const *) opt_rules_dirs,
+                                                     opt_fake_sessions);
+  startup_step_done (STARTUP_STEP_AUTHORITY);
+  if (opt_log_timings)
+    polkit_backend_interactive_authority_set_log_timings (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority), TRUE);
+  if (opt_max_js_heap > 0)
+    polkit_backend_js_authority_set_heap_limit (POLKIT_BACKEND_JS_AUTHORITY (authority), (gsize) opt_max_js_heap * 1024);
+  if (opt_max_temporary_authorizations > 0)
+    polkit_backend_interactive_authority_set_temporary_authorization_limit (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                            (gsize) opt_max_temporary_authorizations * 1024);
 
   loop = g_main_loop_new (NULL, FALSE);
 
+  if (opt_watchdog_threshold > 0)
+    polkit_backend_watchdog_start (opt_watchdog_threshold, TRUE);
+
+  if (opt_exit_on_idle > 0)
+    g_timeout_add_seconds (opt_exit_on_idle, on_idle_check, NULL);
+
   sigint_id = g_unix_signal_add (SIGINT,
                                  on_sigint,
                                  NULL);
+  sigterm_id = g_unix_signal_add (SIGTERM,
+                                  on_sigterm,
+                                  NULL);
+
+  /* parse the actions on a separate thread while connecting to the bus */
+  polkit_backend_interactive_authority_preload_actions (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                        on_actions_preloaded,
+                                                        NULL);
 
   name_owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
                                   "org.freedesktop.PolicyKit1",
@@ -242,9 +549,17 @@ main (int    argc,
   ret = 0;
 
   g_print ("Shutting down\n");
+
+  if (owns_temporary_authorizations_file)
+    save_temporary_authorizations_file ();
+
  out:
+  polkit_backend_watchdog_stop ();
+  polkit_backend_spawner_stop ();
   if (sigint_id > 0)
     g_source_remove (sigint_id);
+  if (sigterm_id > 0)
+    g_source_remove (sigterm_id);
   if (name_owner_id != 0)
     g_bus_unown_name (name_owner_id);
   if (registration_id != NULL)
@@ -255,6 +570,10 @@ main (int    argc,
     g_main_loop_unref (loop);
   if (opt_context != NULL)
     g_option_context_free (opt_context);
+  g_free (opt_actions_dir);
+  g_strfreev (opt_rules_dirs);
+  g_free (opt_fake_sessions);
+  g_free (opt_temporary_authorizations_file);
 
   g_print ("Exiting with code %d\n", ret);
   return ret;
@@ -25,17 +25,23 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <glib/gi18n.h>
 #include <polkit/polkit.h>
 
+/* number of actions requested from the authority at a time */
+#define ACTIONS_PER_PAGE 256
+
 static void
-print_action (PolkitActionDescription *action,
+print_action (GString                 *out,
+              PolkitActionDescription *action,
               gboolean                 opt_verbose)
 {
 
   if (!opt_verbose)
     {
-      g_print ("%s\n", polkit_action_description_get_action_id (action));
+      g_string_append (out, polkit_action_description_get_action_id (action));
+      g_string_append_c (out, '\n');
     }
   else
     {
@@ -49,20 +55,28 @@ print_action (PolkitActionDescription *action,
       vendor_url = polkit_action_description_get_vendor_url (action);
       icon_name = polkit_action_description_get_icon_name (action);
 
-      g_print ("%s:\n", polkit_action_description_get_action_id (action));
-      g_print ("  description:       %s\n", polkit_action_description_get_description (action));
-      g_print ("  message:           %s\n", polkit_action_description_get_message (action));
+      g_string_append_printf (out,
+                              "%s:\n"
+                              "  description:       %s\n"
+                              "  message:           %s\n",
+                              polkit_action_description_get_action_id (action),
+                              polkit_action_description_get_description (action),
+                              polkit_action_description_get_message (action));
       if (vendor != NULL)
-        g_print ("  vendor:            %s\n", vendor);
+        g_string_append_printf (out, "  vendor:            %s\n", vendor);
       if (vendor_url != NULL)
-        g_print ("  vendor_url:        %s\n", vendor_url);
+        g_string_append_printf (out, "  vendor_url:        %s\n", vendor_url);
 
       if (icon_name != NULL)
-        g_print ("  icon:              %s\n", icon_name);
+        g_string_append_printf (out, "  icon:              %s\n", icon_name);
 
-      g_print ("  implicit any:      %s\n", polkit_implicit_authorization_to_string (polkit_action_description_get_implicit_any (action)));
-      g_print ("  implicit inactive: %s\n", polkit_implicit_authorization_to_string (polkit_action_description_get_implicit_inactive (action)));
-      g_print ("  implicit active:   %s\n", polkit_implicit_authorization_to_string (polkit_action_description_get_implicit_active (action)));
+      g_string_append_printf (out,
+                              "  implicit any:      %s\n"
+                              "  implicit inactive: %s\n"
+                              "  implicit active:   %s\n",
+                              polkit_implicit_authorization_to_string (polkit_action_description_get_implicit_any (action)),
+                              polkit_implicit_authorization_to_string (polkit_action_description_get_implicit_inactive (action)),
+                              polkit_implicit_authorization_to_string (polkit_action_description_get_implicit_active (action)));
 
       annotation_keys = polkit_action_description_get_annotation_keys (action);
       for (n = 0; annotation_keys[n] != NULL; n++)
@@ -72,10 +86,79 @@ print_action (PolkitActionDescription *action,
 
           key = annotation_keys[n];
           value = polkit_action_description_get_annotation (action, key);
-          g_print ("  annotation:        %s -> %s\n", key, value);
+          g_string_append_printf (out, "  annotation:        %s -> %s\n", key, value);
         }
-      g_print ("\n");
+      g_string_append_c (out, '\n');
+    }
+}
+
+/* writes out everything buffered in @out - returns %FALSE on error */
+static gboolean
+flush_output (GString *out)
+{
+  gboolean ret;
+
+  ret = TRUE;
+  if (out->len > 0)
+    {
+      if (fwrite (out->str, 1, out->len, stdout) != out->len)
+        ret = FALSE;
+      g_string_truncate (out, 0);
     }
+
+  return ret;
+}
+
+static GVariant *
+build_options (const gchar         *prefix,
+               const gchar * const *annotations,
+               const gchar         *start_after,
+               GError             **error)
+{
+  GVariantBuilder builder;
+  guint n;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+
+  if (prefix != NULL)
+    g_variant_builder_add (&builder, "{sv}", "action-id-prefix", g_variant_new_string (prefix));
+
+  if (annotations != NULL && annotations[0] != NULL)
+    {
+      GVariantBuilder annotations_builder;
+
+      g_variant_builder_init (&annotations_builder, G_VARIANT_TYPE ("a{ss}"));
+      for (n = 0; annotations[n] != NULL; n++)
+        {
+          const gchar *eq;
+          gchar *key;
+
+          eq = strchr (annotations[n], '=');
+          if (eq == NULL || eq == annotations[n])
+            {
+              g_set_error (error,
+                           G_OPTION_ERROR,
+                           G_OPTION_ERROR_BAD_VALUE,
+                           _("Invalid --annotation value `%s', expected KEY=VALUE"),
+                           annotations[n]);
+              g_variant_builder_clear (&annotations_builder);
+              g_variant_builder_clear (&builder);
+              return NULL;
+            }
+
+          key = g_strndup (annotations[n], eq - annotations[n]);
+          g_variant_builder_add (&annotations_builder, "{ss}", key, eq + 1);
+          g_free (key);
+        }
+      g_variant_builder_add (&builder, "{sv}", "annotations", g_variant_builder_end (&annotations_builder));
+    }
+
+  if (start_after != NULL)
+    g_variant_builder_add (&builder, "{sv}", "start-after", g_variant_new_string (start_after));
+
+  g_variant_builder_add (&builder, "{sv}", "limit", g_variant_new_uint32 (ACTIONS_PER_PAGE));
+
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
 }
 
 static gint
@@ -86,11 +169,44 @@ action_desc_compare_by_action_id_func (PolkitActionDescription *a,
                     polkit_action_description_get_action_id (b));
 }
 
+/* Applies the filters build_options() passes to the authority - only
+ * needed for authorities without EnumerateActionsWithOptions. The
+ * annotations have already been checked by build_options().
+ */
+static gboolean
+action_matches (PolkitActionDescription *action,
+                const gchar             *prefix,
+                const gchar * const     *annotations)
+{
+  guint n;
+
+  if (prefix != NULL && !g_str_has_prefix (polkit_action_description_get_action_id (action), prefix))
+    return FALSE;
+
+  for (n = 0; annotations != NULL && annotations[n] != NULL; n++)
+    {
+      const gchar *eq;
+      gchar *key;
+      gboolean matches;
+
+      eq = strchr (annotations[n], '=');
+      key = g_strndup (annotations[n], eq - annotations[n]);
+      matches = (g_strcmp0 (polkit_action_description_get_annotation (action, key), eq + 1) == 0);
+      g_free (key);
+      if (!matches)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
 int
 main (int argc, char *argv[])
 {
   guint ret;
   gchar *opt_action_id;
+  gchar *opt_prefix;
+  gchar **opt_annotations;
   gchar *s;
   gboolean opt_show_version;
   gboolean opt_verbose;
@@ -100,6 +216,14 @@ main (int argc, char *argv[])
 	"action-id", 'a', 0, G_OPTION_ARG_STRING, &opt_action_id,
 	N_("Only output information about ACTION"), N_("ACTION")
       },
+      {
+	"prefix", 'p', 0, G_OPTION_ARG_STRING, &opt_prefix,
+	N_("Only output actions whose identifier starts with PREFIX"), N_("PREFIX")
+      },
+      {
+	"annotation", 0, 0, G_OPTION_ARG_STRING_ARRAY, &opt_annotations,
+	N_("Only output actions with annotation KEY set to VALUE"), N_("KEY=VALUE")
+      },
       {
 	"verbose", 'v', 0, G_OPTION_ARG_NONE, &opt_verbose,
 	N_("Output detailed action information"), NULL
@@ -112,14 +236,21 @@ main (int argc, char *argv[])
     };
   GOptionContext *context;
   PolkitAuthority *authority;
-  GList *l;
-  GList *actions;
+  GString *out;
+  gchar *start_after;
+  gboolean found;
+  gboolean fallback;
   GError *error;
 
   opt_action_id = NULL;
+  opt_prefix = NULL;
+  opt_annotations = NULL;
   context = NULL;
   authority = NULL;
-  actions = NULL;
+  out = NULL;
+  start_after = NULL;
+  found = FALSE;
+  fallback = FALSE;
   ret = 1;
 
   /* Disable remote file access from GIO. */
@@ -165,59 +296,127 @@ main (int argc, char *argv[])
       goto out;
     }
 
-  error = NULL;
-  actions = polkit_authority_enumerate_actions_sync (authority,
-                                                     NULL,      /* GCancellable */
-                                                     &error);
-  if (error != NULL)
+  /* Page through the matching actions (sorted by the authority) and
+   * write each page in one go - this way memory use is bounded by
+   * the page size no matter how many actions are installed.
+   *
+   * When looking for a single action, use its id as the prefix so
+   * the authority only has to send a handful of candidates.
+   *
+   * Authorities predating EnumerateActionsWithOptions get asked for
+   * all actions at once and the filters are applied here.
+   */
+  out = g_string_sized_new (8192);
+  while (TRUE)
     {
-      g_printerr ("Error enumerating actions: %s\n", error->message);
-      g_error_free (error);
-      goto out;
-    }
+      GVariant *enumerate_options;
+      GList *actions;
+      GList *l;
+      guint num_actions;
+
+      error = NULL;
+      enumerate_options = build_options (opt_action_id != NULL ? opt_action_id : opt_prefix,
+                                         (const gchar * const *) opt_annotations,
+                                         start_after,
+                                         &error);
+      if (enumerate_options == NULL)
+        {
+          g_printerr ("%s: %s\n", g_get_prgname (), error->message);
+          g_error_free (error);
+          goto out;
+        }
 
-  if (opt_action_id != NULL)
-    {
+      actions = polkit_authority_enumerate_actions_with_options_sync (authority,
+                                                                      enumerate_options,
+                                                                      NULL,      /* GCancellable */
+                                                                      &error);
+      g_variant_unref (enumerate_options);
+      if (error != NULL && start_after == NULL &&
+          g_error_matches (error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+        {
+          g_clear_error (&error);
+          actions = polkit_authority_enumerate_actions_sync (authority,
+                                                             NULL,      /* GCancellable */
+                                                             &error);
+          actions = g_list_sort (actions,
+                                 (GCompareFunc) action_desc_compare_by_action_id_func);
+          fallback = TRUE;
+        }
+      if (error != NULL)
+        {
+          g_printerr ("Error enumerating actions: %s\n", error->message);
+          g_error_free (error);
+          goto out;
+        }
+
+      num_actions = 0;
       for (l = actions; l != NULL; l = l->next)
         {
           PolkitActionDescription *action = POLKIT_ACTION_DESCRIPTION (l->data);
           const gchar *id;
 
           id = polkit_action_description_get_action_id (action);
+          num_actions++;
+
+          if (fallback && !action_matches (action,
+                                           opt_action_id != NULL ? opt_action_id : opt_prefix,
+                                           (const gchar * const *) opt_annotations))
+            continue;
 
-          if (g_strcmp0 (id, opt_action_id) == 0)
+          if (opt_action_id != NULL)
             {
-              print_action (action, opt_verbose);
-              break;
+              if (g_strcmp0 (id, opt_action_id) == 0)
+                {
+                  print_action (out, action, opt_verbose);
+                  found = TRUE;
+                }
+            }
+          else
+            {
+              print_action (out, action, opt_verbose);
+            }
+
+          if (l->next == NULL)
+            {
+              g_free (start_after);
+              start_after = g_strdup (id);
             }
         }
+      g_list_foreach (actions, (GFunc) g_object_unref, NULL);
+      g_list_free (actions);
 
-      if (l == NULL)
+      if (!flush_output (out))
         {
-          g_printerr ("No action with action id %s\n", opt_action_id);
+          g_printerr ("Error writing output\n");
           goto out;
         }
+
+      if (found || fallback || num_actions < ACTIONS_PER_PAGE)
+        break;
     }
-  else
-    {
-      actions = g_list_sort (actions,
-                             (GCompareFunc) action_desc_compare_by_action_id_func);
 
-      for (l = actions; l != NULL; l = l->next)
-        {
-          PolkitActionDescription *action = POLKIT_ACTION_DESCRIPTION (l->data);
+  if (opt_action_id != NULL && !found)
+    {
+      g_printerr ("No action with action id %s\n", opt_action_id);
+      goto out;
+    }
 
-          print_action (action, opt_verbose);
-        }
+  if (fflush (stdout) != 0)
+    {
+      g_printerr ("Error writing output\n");
+      goto out;
     }
 
   ret = 0;
 
  out:
-  g_list_foreach (actions, (GFunc) g_object_unref, NULL);
-  g_list_free (actions);
+  if (out != NULL)
+    g_string_free (out, TRUE);
+  g_free (start_after);
 
   g_free (opt_action_id);
+  g_free (opt_prefix);
+  g_strfreev (opt_annotations);
 
   if (authority != NULL)
     g_object_unref (authority);
@@ -226,4 +425,3 @@ main (int argc, char *argv[])
 
   return ret;
 }
-
@@ -45,6 +45,7 @@ help (void)
 "  -d, --details=KEY VALUE            Add (KEY, VALUE) to information about the action\n"
 "  --enable-internal-agent            Use an internal authentication agent if necessary\n"
 "  --list-temp                        List temporary authorizations for current session\n"
+"                                     (restricted by --action-id and --process if given)\n"
 "  -p, --process=PID[,START_TIME,UID] Check authorization of specified process\n"
 "  --revoke-temp                      Revoke all temporary authorizations for current session\n"
 "  -s, --system-bus-name=BUS_NAME     Check authorization of owner of BUS_NAME\n"
@@ -200,16 +201,35 @@ _polkit_subject_get_cmdline (PolkitSubject *subject)
 }
 
 static gint
-do_list_or_revoke_temp_authz (gboolean revoke)
+do_list_or_revoke_temp_authz (gboolean       revoke,
+                              const gchar   *action_id_prefix,
+                              PolkitSubject *subject)
 {
   gint ret;
   PolkitAuthority *authority;
   PolkitSubject *session;
+  GVariant *options;
   GError *error;
 
   ret = 1;
   authority = NULL;
   session = NULL;
+  options = NULL;
+
+  /* let the authority do the filtering instead of fetching everything */
+  if (action_id_prefix != NULL || subject != NULL)
+    {
+      GVariantBuilder builder;
+
+      g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+      if (action_id_prefix != NULL)
+        g_variant_builder_add (&builder, "{sv}", "action-id-prefix",
+                               g_variant_new_string (action_id_prefix));
+      if (subject != NULL)
+        g_variant_builder_add (&builder, "{sv}", "subject",
+                               polkit_subject_to_gvariant (subject));
+      options = g_variant_ref_sink (g_variant_builder_end (&builder));
+    }
 
   error = NULL;
   authority = polkit_authority_get_sync (NULL /* GCancellable* */, &error);
@@ -233,10 +253,11 @@ do_list_or_revoke_temp_authz (gboolean revoke)
 
   if (revoke)
     {
-      if (!polkit_authority_revoke_temporary_authorizations_sync (authority,
-                                                                  session,
-                                                                  NULL, /* GCancellable */
-                                                                  &error))
+      if (!polkit_authority_revoke_temporary_authorizations_with_options_sync (authority,
+                                                                               session,
+                                                                               options,
+                                                                               NULL, /* GCancellable */
+                                                                               &error))
         {
           g_printerr ("Error revoking temporary authorizations: %s\n", error->message);
           g_error_free (error);
@@ -251,10 +272,11 @@ do_list_or_revoke_temp_authz (gboolean revoke)
       GList *l;
 
       error = NULL;
-      authorizations = polkit_authority_enumerate_temporary_authorizations_sync (authority,
-                                                                                 session,
-                                                                                 NULL, /* GCancellable */
-                                                                                 &error);
+      authorizations = polkit_authority_enumerate_temporary_authorizations_with_options_sync (authority,
+                                                                                              session,
+                                                                                              options,
+                                                                                              NULL, /* GCancellable */
+                                                                                              &error);
       if (error != NULL)
         {
           g_printerr ("Error getting temporary authorizations: %s\n", error->message);
@@ -322,6 +344,8 @@ do_list_or_revoke_temp_authz (gboolean revoke)
     }
 
  out:
+  if (options != NULL)
+    g_variant_unref (options);
   if (authority != NULL)
     g_object_unref (authority);
   if (session != NULL)
@@ -512,12 +536,12 @@ main (int argc, char *argv[])
 
   if (list_temp)
     {
-      ret = do_list_or_revoke_temp_authz (FALSE);
+      ret = do_list_or_revoke_temp_authz (FALSE, action_id, subject);
       goto out;
     }
   else if (revoke_temp)
     {
-      ret = do_list_or_revoke_temp_authz (TRUE);
+      ret = do_list_or_revoke_temp_authz (TRUE, action_id, subject);
       goto out;
     }
   else if (subject == NULL)
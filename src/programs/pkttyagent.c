@@ -30,6 +30,120 @@
 #define POLKIT_AGENT_I_KNOW_API_IS_SUBJECT_TO_CHANGE
 #include <polkitagent/polkitagent.h>
 
+static GMainLoop *loop = NULL;
+static guint ret = 126;
+static gint opt_notify_fd = -1;
+static gchar *opt_action_id = NULL;
+static PolkitSubject *subject = NULL;
+static gpointer local_agent_handle = NULL;
+
+static void
+on_check_authorization_cb (GObject      *source_object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+  PolkitAuthorizationResult *result;
+  GError *error;
+
+  error = NULL;
+  result = polkit_authority_check_authorization_finish (POLKIT_AUTHORITY (source_object), res, &error);
+  if (result == NULL)
+    {
+      g_printerr ("Error checking for authorization %s: %s\n",
+                  opt_action_id,
+                  error->message);
+      g_error_free (error);
+      ret = 127;
+      goto out;
+    }
+
+  if (polkit_authorization_result_get_is_authorized (result))
+    {
+      ret = 0;
+    }
+  else if (polkit_authorization_result_get_is_challenge (result))
+    {
+      g_printerr ("Authorization requires authentication that this agent could not provide.\n");
+      ret = 2;
+    }
+  else if (polkit_authorization_result_get_dismissed (result))
+    {
+      g_printerr ("Authentication request was dismissed.\n");
+      ret = 3;
+    }
+  else
+    {
+      g_printerr ("Not authorized.\n");
+      ret = 1;
+    }
+  g_object_unref (result);
+
+ out:
+  g_main_loop_quit (loop);
+}
+
+static void
+on_registered_cb (GObject      *source_object,
+                  GAsyncResult *res,
+                  gpointer      user_data)
+{
+  PolkitAuthority *authority;
+  GError *error;
+
+  error = NULL;
+  local_agent_handle = polkit_agent_listener_register_with_options_finish (POLKIT_AGENT_LISTENER (source_object),
+                                                                           res,
+                                                                           &error);
+  if (local_agent_handle == NULL)
+    {
+      g_printerr ("Error registering authentication agent: %s (%s, %d)\n",
+                  error->message, g_quark_to_string (error->domain), error->code);
+      g_error_free (error);
+      g_main_loop_quit (loop);
+      goto out;
+    }
+
+  if (opt_notify_fd != -1)
+    {
+      if (close (opt_notify_fd) != 0)
+        {
+          g_printerr ("Error closing notify-fd %d: %m\n", opt_notify_fd);
+          g_main_loop_quit (loop);
+          goto out;
+        }
+    }
+
+  if (opt_action_id != NULL)
+    {
+      /* The authority was already obtained while registering, so this
+       * does not block - and the agent is being served from its own
+       * thread so it can handle the request that the check triggers.
+       */
+      authority = polkit_authority_get_sync (NULL /* GCancellable* */, &error);
+      if (authority == NULL)
+        {
+          g_printerr ("Error getting authority: %s (%s, %d)\n",
+                      error->message, g_quark_to_string (error->domain), error->code);
+          g_error_free (error);
+          ret = 127;
+          g_main_loop_quit (loop);
+          goto out;
+        }
+      polkit_authority_check_authorization (authority,
+                                            subject,
+                                            opt_action_id,
+                                            NULL, /* PolkitDetails */
+                                            POLKIT_CHECK_AUTHORIZATION_FLAGS_ALLOW_USER_INTERACTION,
+                                            NULL, /* GCancellable */
+                                            on_check_authorization_cb,
+                                            NULL);
+      g_object_unref (authority);
+    }
+
+ out:
+  ;
+}
+
 int
 main (int argc, char *argv[])
 {
@@ -37,9 +151,13 @@ main (int argc, char *argv[])
   gboolean opt_fallback = FALSE;
   gchar *opt_process = NULL;
   gchar *opt_system_bus_name = NULL;
-  gint opt_notify_fd = -1;
   GOptionEntry options[] =
     {
+      {
+	"action-id", 'a', 0, G_OPTION_ARG_STRING, &opt_action_id,
+	N_("Check whether the subject is authorized for ACTION and exit"),
+	N_("ACTION")
+      },
       {
 	"fallback", 0, 0, G_OPTION_ARG_NONE, &opt_fallback,
 	N_("Don't replace existing agent if any"), NULL
@@ -65,14 +183,9 @@ main (int argc, char *argv[])
     };
   GOptionContext *context;
   gchar *s;
-  PolkitAuthority *authority = NULL;
-  PolkitSubject *subject = NULL;
-  gpointer local_agent_handle = NULL;
   PolkitAgentListener *listener = NULL;
   GVariant *listener_options = NULL;
   GError *error;
-  GMainLoop *loop = NULL;
-  guint ret = 126;
   GVariantBuilder builder;
 
   /* Disable remote file access from GIO. */
@@ -159,16 +272,6 @@ main (int argc, char *argv[])
       g_assert (polkit_unix_process_get_start_time (POLKIT_UNIX_PROCESS (subject)) > 0);
     }
 
-  authority = polkit_authority_get_sync (NULL /* GCancellable* */, &error);
-  if (authority == NULL)
-    {
-      g_printerr ("Error getting authority: %s (%s, %d)\n",
-                  error->message, g_quark_to_string (error->domain), error->code);
-      g_error_free (error);
-      ret = 127;
-      goto out;
-    }
-
   if (opt_fallback)
     {
       g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
@@ -187,33 +290,25 @@ main (int argc, char *argv[])
       ret = 127;
       goto out;
     }
-  local_agent_handle = polkit_agent_listener_register_with_options (listener,
-                                                                    POLKIT_AGENT_REGISTER_FLAGS_RUN_IN_THREAD,
-                                                                    subject,
-                                                                    NULL, /* object_path */
-                                                                    listener_options,
-                                                                    NULL, /* GCancellable */
-                                                                    &error);
+
+  loop = g_main_loop_new (NULL, FALSE);
+
+  /* Register without blocking; the controlling terminal was opened
+   * above so the first prompt can be shown as soon as the authority
+   * asks for it. If --action-id was given, the check is sent as soon
+   * as the agent is registered (see on_registered_cb()).
+   */
+  polkit_agent_listener_register_with_options_async (listener,
+                                                     POLKIT_AGENT_REGISTER_FLAGS_RUN_IN_THREAD,
+                                                     subject,
+                                                     NULL, /* object_path */
+                                                     listener_options,
+                                                     NULL, /* GCancellable */
+                                                     on_registered_cb,
+                                                     NULL);
   listener_options = NULL; /* consumed */
   g_object_unref (listener);
-  if (local_agent_handle == NULL)
-    {
-      g_printerr ("Error registering authentication agent: %s (%s, %d)\n",
-                  error->message, g_quark_to_string (error->domain), error->code);
-      g_error_free (error);
-      goto out;
-    }
 
-  if (opt_notify_fd != -1)
-    {
-      if (close (opt_notify_fd) != 0)
-        {
-          g_printerr ("Error closing notify-fd %d: %m\n", opt_notify_fd);
-          goto out;
-        }
-    }
-
-  loop = g_main_loop_new (NULL, FALSE);
   g_main_loop_run (loop);
 
  out:
@@ -229,9 +324,7 @@ main (int argc, char *argv[])
   if (subject != NULL)
     g_object_unref (subject);
 
-  if (authority != NULL)
-    g_object_unref (authority);
-
+  g_free (opt_action_id);
   g_free (opt_process);
   g_free (opt_system_bus_name);
   g_option_context_free (context);
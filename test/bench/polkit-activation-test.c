@@ -0,0 +1,369 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/* polkit-activation-test checks that polkitd started with
+ * --exit-on-idle comes back quickly. It starts a private message bus
+ * (exported as the system bus) on which polkitd is D-Bus activated
+ * and, for a number of runs,
+ *
+ *  - calls CheckAuthorization, which activates polkitd, and measures
+ *    the time until the answer arrives,
+ *  - waits for polkitd to release its name once it has been idle.
+ *
+ * It fails if polkitd does not exit on idle or if the median time from
+ * activation to the first answer is above the target (--target-msec).
+ *
+ * polkitd runs as the calling user and loads the actions and rules in
+ * data/ unless --actions-dir and --rules-dir are given.
+ */
+
+#include "config.h"
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <polkit/polkit.h>
+
+#include "polkitbenchutils.h"
+
+static gchar    *opt_polkitd = NULL;
+static gchar    *opt_actions_dir = NULL;
+static gchar    *opt_rules_dir = NULL;
+static gchar    *opt_action = NULL;
+static gint      opt_runs = 5;
+static gint      opt_idle = 1;
+static gint      opt_target_msec = 1000;
+static gboolean  opt_verbose = FALSE;
+
+static GOptionEntry opt_entries[] =
+{
+  {"polkitd", 0, 0, G_OPTION_ARG_FILENAME, &opt_polkitd, "polkitd binary to activate (default: the one in the build tree)", "PATH"},
+  {"actions-dir", 0, 0, G_OPTION_ARG_FILENAME, &opt_actions_dir, "Directory to load actions from", "DIR"},
+  {"rules-dir", 0, 0, G_OPTION_ARG_FILENAME, &opt_rules_dir, "Directory to load rules from", "DIR"},
+  {"action", 'a', 0, G_OPTION_ARG_STRING, &opt_action, "Action to check (default: org.freedesktop.policykit.bench.yes)", "ACTION"},
+  {"runs", 'k', 0, G_OPTION_ARG_INT, &opt_runs, "Number of times to activate polkitd (default: 5)", "N"},
+  {"idle", 'i', 0, G_OPTION_ARG_INT, &opt_idle, "Seconds polkitd waits before exiting on idle (default: 1)", "SECONDS"},
+  {"target-msec", 't', 0, G_OPTION_ARG_INT, &opt_target_msec, "Fail if the median time to the first answer is above MSEC (default: 1000)", "MSEC"},
+  {"verbose", 'v', 0, G_OPTION_ARG_NONE, &opt_verbose, "Don't hide the output of polkitd", NULL},
+  {NULL}
+};
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Writes a service file activating polkitd on the bus at @address */
+static gboolean
+write_service_file (const gchar  *service_dir,
+                    const gchar  *address,
+                    GError      **error)
+{
+  GString *exec;
+  gchar *data_dir;
+  gchar *actions_dir;
+  gchar *rules_dir;
+  gchar *temporary_authorizations_file;
+  gchar *path;
+  gchar *contents;
+  gchar *quoted;
+  gboolean ret;
+
+  data_dir = g_strdup (g_getenv ("POLKIT_BENCH_DATA_DIR"));
+  if (data_dir == NULL)
+    data_dir = g_strdup (POLKIT_BENCH_DATA_DIR);
+  actions_dir = opt_actions_dir != NULL ? g_strdup (opt_actions_dir) : g_build_filename (data_dir, "actions", NULL);
+  rules_dir = opt_rules_dir != NULL ? g_strdup (opt_rules_dir) : g_build_filename (data_dir, "rules.d", NULL);
+  /* kept across activations like the real one, but not the real one */
+  temporary_authorizations_file = g_build_filename (service_dir, "temporary-authorizations", NULL);
+
+  /* the bus only tells activated services its address as the starter bus */
+  exec = g_string_new ("/usr/bin/env ");
+  quoted = g_strdup_printf ("DBUS_SYSTEM_BUS_ADDRESS=%s", address);
+  g_string_append_printf (exec, "'%s' ", quoted);
+  g_free (quoted);
+  g_string_append_printf (exec,
+                          "'%s' --no-change-user --exit-on-idle=%d '--actions-dir=%s' '--rules-dir=%s' "
+                          "'--temporary-authorizations-file=%s'%s",
+                          opt_polkitd != NULL ? opt_polkitd : POLKIT_BENCH_POLKITD,
+                          opt_idle,
+                          actions_dir,
+                          rules_dir,
+                          temporary_authorizations_file,
+                          opt_verbose ? "" : " --no-debug");
+
+  contents = g_strdup_printf ("[D-BUS Service]\n"
+                              "Name=org.freedesktop.PolicyKit1\n"
+                              "Exec=%s\n",
+                              exec->str);
+  path = g_build_filename (service_dir, "org.freedesktop.PolicyKit1.service", NULL);
+  ret = g_file_set_contents (path, contents, -1, error);
+
+  g_free (path);
+  g_free (contents);
+  g_string_free (exec, TRUE);
+  g_free (temporary_authorizations_file);
+  g_free (rules_dir);
+  g_free (actions_dir);
+  g_free (data_dir);
+  return ret;
+}
+
+/* Polls until org.freedesktop.PolicyKit1 has no owner, for up to @timeout_usec */
+static gboolean
+wait_for_no_owner (GDBusConnection  *connection,
+                   gint64            timeout_usec,
+                   GError          **error)
+{
+  gint64 deadline;
+
+  deadline = g_get_monotonic_time () + timeout_usec;
+  while (g_get_monotonic_time () < deadline)
+    {
+      GVariant *value;
+      gboolean has_owner;
+
+      value = g_dbus_connection_call_sync (connection,
+                                           "org.freedesktop.DBus",
+                                           "/org/freedesktop/DBus",
+                                           "org.freedesktop.DBus",
+                                           "NameHasOwner",
+                                           g_variant_new ("(s)", "org.freedesktop.PolicyKit1"),
+                                           G_VARIANT_TYPE ("(b)"),
+                                           G_DBUS_CALL_FLAGS_NONE,
+                                           -1,
+                                           NULL,
+                                           error);
+      if (value == NULL)
+        return FALSE;
+      g_variant_get (value, "(b)", &has_owner);
+      g_variant_unref (value);
+      if (!has_owner)
+        return TRUE;
+
+      g_usleep (G_USEC_PER_SEC / 100);
+    }
+
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+               "polkitd did not exit within %d seconds of being idle",
+               (gint) (timeout_usec / G_USEC_PER_SEC));
+  return FALSE;
+}
+
+static gboolean
+check_authorization (GDBusConnection  *connection,
+                     GVariant         *subject,
+                     const gchar      *action_id,
+                     GError          **error)
+{
+  GVariant *value;
+
+  /* without G_DBUS_CALL_FLAGS_NO_AUTO_START, so this activates polkitd */
+  value = g_dbus_connection_call_sync (connection,
+                                       "org.freedesktop.PolicyKit1",
+                                       "/org/freedesktop/PolicyKit1/Authority",
+                                       "org.freedesktop.PolicyKit1.Authority",
+                                       "CheckAuthorization",
+                                       g_variant_new ("(@(sa{sv})s@a{ss}us)",
+                                                      subject,
+                                                      action_id,
+                                                      g_variant_new_array (G_VARIANT_TYPE ("{ss}"), NULL, 0),
+                                                      0,
+                                                      ""),
+                                       G_VARIANT_TYPE ("((bba{ss}))"),
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1,
+                                       NULL,
+                                       error);
+  if (value == NULL)
+    return FALSE;
+  g_variant_unref (value);
+  return TRUE;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *opt_context;
+  GTestDBus *bus;
+  GDBusConnection *connection;
+  PolkitSubject *process;
+  GVariant *subject;
+  GArray *first_answer_usec;
+  GArray *idle_exit_usec;
+  gchar *service_dir;
+  GError *error;
+  gint64 median;
+  gint ret;
+  gint n;
+
+  ret = 1;
+  bus = NULL;
+  connection = NULL;
+  subject = NULL;
+  service_dir = NULL;
+  first_answer_usec = g_array_new (FALSE, FALSE, sizeof (gint64));
+  idle_exit_usec = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  setlocale (LC_ALL, "");
+  g_type_init ();
+
+  opt_context = g_option_context_new ("- check that an idle-exiting polkitd is activated quickly");
+  g_option_context_add_main_entries (opt_context, opt_entries, NULL);
+  error = NULL;
+  if (!g_option_context_parse (opt_context, &argc, &argv, &error))
+    {
+      g_printerr ("Error parsing options: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (opt_runs < 1 || opt_idle < 1 || opt_target_msec < 1)
+    {
+      g_printerr ("Invalid arguments\n");
+      goto out;
+    }
+
+  service_dir = g_dir_make_tmp ("polkit-activation-test-XXXXXX", &error);
+  if (service_dir == NULL)
+    {
+      g_printerr ("Error creating temporary directory: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  /* polkitd only ever uses the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_add_service_dir (bus, service_dir);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
+  /* the bus looks for new service files when activating an unknown name */
+  if (!write_service_file (service_dir, g_test_dbus_get_bus_address (bus), &error))
+    {
+      g_printerr ("Error writing service file: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+  if (connection == NULL)
+    {
+      g_printerr ("Error connecting to the message bus: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  process = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+  subject = g_variant_ref_sink (polkit_subject_to_gvariant (process));
+  g_object_unref (process);
+
+  for (n = 0; n < opt_runs; n++)
+    {
+      gint64 begin;
+      gint64 value;
+
+      begin = g_get_monotonic_time ();
+      if (!check_authorization (connection,
+                                subject,
+                                opt_action != NULL ? opt_action : "org.freedesktop.policykit.bench.yes",
+                                &error))
+        {
+          g_printerr ("Run %d: Error checking authorization: %s\n", n + 1, error->message);
+          g_error_free (error);
+          goto out;
+        }
+      value = g_get_monotonic_time () - begin;
+      g_array_append_val (first_answer_usec, value);
+
+      begin = g_get_monotonic_time ();
+      if (!wait_for_no_owner (connection, (opt_idle + 10) * G_USEC_PER_SEC, &error))
+        {
+          g_printerr ("Run %d: %s\n", n + 1, error->message);
+          g_error_free (error);
+          goto out;
+        }
+      value = g_get_monotonic_time () - begin;
+      g_array_append_val (idle_exit_usec, value);
+    }
+
+  polkit_bench_sort (first_answer_usec);
+  polkit_bench_sort (idle_exit_usec);
+  median = polkit_bench_percentile (first_answer_usec, 0.5);
+
+  g_print ("Runs:          %d\n"
+           "Exit on idle:  %d seconds\n"
+           "%-32s %10s %10s %10s\n"
+           "%-32s %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT "\n"
+           "%-32s %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT "\n",
+           opt_runs,
+           opt_idle,
+           "", "min", "median", "max",
+           "Activation to answer (usec)",
+           polkit_bench_percentile (first_answer_usec, 0.0), median,
+           polkit_bench_percentile (first_answer_usec, 1.0),
+           "Answer to exit (usec)",
+           polkit_bench_percentile (idle_exit_usec, 0.0),
+           polkit_bench_percentile (idle_exit_usec, 0.5),
+           polkit_bench_percentile (idle_exit_usec, 1.0));
+
+  if (median > (gint64) opt_target_msec * 1000)
+    {
+      g_printerr ("FAIL: median time from activation to the first answer is %d ms, the target is %d ms\n",
+                  (gint) (median / 1000), opt_target_msec);
+      goto out;
+    }
+
+  ret = 0;
+
+ out:
+  if (connection != NULL)
+    g_object_unref (connection);
+  if (bus != NULL)
+    {
+      g_test_dbus_down (bus);
+      g_object_unref (bus);
+    }
+  if (subject != NULL)
+    g_variant_unref (subject);
+  if (service_dir != NULL)
+    {
+      gchar *path;
+      path = g_build_filename (service_dir, "org.freedesktop.PolicyKit1.service", NULL);
+      g_unlink (path);
+      g_free (path);
+      path = g_build_filename (service_dir, "temporary-authorizations", NULL);
+      g_unlink (path);
+      g_free (path);
+      g_rmdir (service_dir);
+      g_free (service_dir);
+    }
+  g_array_unref (first_answer_usec);
+  g_array_unref (idle_exit_usec);
+  g_option_context_free (opt_context);
+  g_free (opt_polkitd);
+  g_free (opt_actions_dir);
+  g_free (opt_rules_dir);
+  g_free (opt_action);
+  return ret;
+}
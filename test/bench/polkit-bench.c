@@ -0,0 +1,770 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* polkit-bench starts a private message bus (exported as the system
+ * bus), runs polkitd from the build tree on it and sends it
+ * CheckAuthorization requests, keeping a fixed number of them in
+ * flight. When done, it reports throughput and latency percentiles
+ * either as text or as JSON (--json).
+ *
+ * polkitd runs as the calling user and loads the actions and rules
+ * in data/ unless --actions-dir and --rules-dir are given. The
+ * subject of the checks is polkit-bench itself - either its process
+ * or its unique name on the bus.
+ *
+ * Unless --real-sessions is given, polkitd uses fake sessions instead
+ * of logind or ConsoleKit: polkit-bench is in an active local session
+ * or in the sessions described by --sessions. With --session-changes
+ * polkitd gets that many session change events per second.
+ */
+
+#include "config.h"
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <polkit/polkit.h>
+
+#include "polkitbenchutils.h"
+
+static gchar    *opt_polkitd = NULL;
+static gchar    *opt_actions_dir = NULL;
+static gchar   **opt_rules_dirs = NULL;
+static gchar   **opt_actions = NULL;
+static gchar    *opt_subject_type = NULL;
+static gint      opt_concurrency = 16;
+static gint      opt_requests = 10000;
+static gint      opt_warmup = 1000;
+static gint      opt_num_details = 0;
+static gint      opt_detail_size = 16;
+static gint      opt_seed = 0;
+static gboolean  opt_json = FALSE;
+static gboolean  opt_verbose = FALSE;
+static gchar    *opt_sessions = NULL;
+static gint      opt_session_changes = 0;
+static gboolean  opt_real_sessions = FALSE;
+
+static GOptionEntry opt_entries[] =
+{
+  {"polkitd", 0, 0, G_OPTION_ARG_FILENAME, &opt_polkitd, "polkitd binary to run (default: the one in the build tree)", "PATH"},
+  {"actions-dir", 0, 0, G_OPTION_ARG_FILENAME, &opt_actions_dir, "Directory to load actions from", "DIR"},
+  {"rules-dir", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_rules_dirs, "Directory to load rules from, can be used multiple times", "DIR"},
+  {"action", 'a', 0, G_OPTION_ARG_STRING_ARRAY, &opt_actions, "Action to check with relative weight, can be used multiple times (default: all actions)", "ACTION[:WEIGHT]"},
+  {"subject-type", 's', 0, G_OPTION_ARG_STRING, &opt_subject_type, "Type of subject: unix-process, system-bus-name or mixed (default: unix-process)", "TYPE"},
+  {"concurrency", 'c', 0, G_OPTION_ARG_INT, &opt_concurrency, "Number of requests in flight (default: 16)", "N"},
+  {"requests", 'n', 0, G_OPTION_ARG_INT, &opt_requests, "Number of measured requests (default: 10000)", "N"},
+  {"warmup", 'w', 0, G_OPTION_ARG_INT, &opt_warmup, "Number of requests to send before measuring (default: 1000)", "N"},
+  {"details", 'd', 0, G_OPTION_ARG_INT, &opt_num_details, "Number of details to pass with each request (default: 0)", "N"},
+  {"detail-size", 0, 0, G_OPTION_ARG_INT, &opt_detail_size, "Size of each detail value in bytes (default: 16)", "BYTES"},
+  {"seed", 0, 0, G_OPTION_ARG_INT, &opt_seed, "Seed for picking actions (default: random)", "SEED"},
+  {"json", 'j', 0, G_OPTION_ARG_NONE, &opt_json, "Report results as JSON", NULL},
+  {"verbose", 'v', 0, G_OPTION_ARG_NONE, &opt_verbose, "Don't hide the output of polkitd", NULL},
+  {"sessions", 0, 0, G_OPTION_ARG_FILENAME, &opt_sessions, "Fake sessions for polkitd (default: an active local session)", "FILE"},
+  {"session-changes", 0, 0, G_OPTION_ARG_INT, &opt_session_changes, "Number of session changes per second to inject (default: 0)", "N"},
+  {"real-sessions", 0, 0, G_OPTION_ARG_NONE, &opt_real_sessions, "Use logind or ConsoleKit instead of fake sessions", NULL},
+  {NULL}
+};
+
+typedef enum
+{
+  SUBJECT_TYPE_UNIX_PROCESS,
+  SUBJECT_TYPE_SYSTEM_BUS_NAME,
+  SUBJECT_TYPE_MIXED
+} SubjectType;
+
+static const gchar *subject_type_names[] =
+{
+  "unix-process",
+  "system-bus-name",
+  "mixed"
+};
+
+typedef struct
+{
+  gchar *action_id;
+  guint weight;
+  guint num_checks;
+} BenchAction;
+
+typedef struct
+{
+  GMainLoop *loop;
+  PolkitAuthority *authority;
+
+  SubjectType subject_type;
+  PolkitSubject *process;
+  PolkitSubject *bus_name;
+  PolkitDetails *details;
+
+  /* of BenchAction */
+  GPtrArray *actions;
+  guint total_weight;
+  GRand *rand;
+
+  guint num_to_send;
+  guint num_sent;
+  guint num_in_flight;
+
+  /* latency in usec of the measured requests */
+  GArray *latencies;
+  gint64 start_time;
+  gint64 end_time;
+
+  guint num_authorized;
+  guint num_challenge;
+  guint num_not_authorized;
+  guint num_errors;
+} Bench;
+
+typedef struct
+{
+  Bench *bench;
+  gint64 begin;
+  gboolean measured;
+} Request;
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+bench_action_free (BenchAction *action)
+{
+  g_free (action->action_id);
+  g_free (action);
+}
+
+static gboolean
+parse_actions (Bench   *bench,
+               GError **error)
+{
+  gboolean ret;
+  guint n;
+
+  ret = FALSE;
+
+  for (n = 0; opt_actions[n] != NULL; n++)
+    {
+      BenchAction *action;
+      const gchar *colon;
+
+      action = g_new0 (BenchAction, 1);
+      action->weight = 1;
+      colon = strrchr (opt_actions[n], ':');
+      if (colon != NULL)
+        {
+          gchar *endp;
+          action->action_id = g_strndup (opt_actions[n], colon - opt_actions[n]);
+          action->weight = strtoul (colon + 1, &endp, 10);
+          if (*endp != '\0' || action->weight == 0)
+            {
+              g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+                           "Invalid weight in `%s'", opt_actions[n]);
+              bench_action_free (action);
+              goto out;
+            }
+        }
+      else
+        {
+          action->action_id = g_strdup (opt_actions[n]);
+        }
+      bench->total_weight += action->weight;
+      g_ptr_array_add (bench->actions, action);
+    }
+
+  ret = TRUE;
+
+ out:
+  return ret;
+}
+
+/* Use all actions known to polkitd with the same weight */
+static gboolean
+enumerate_actions (Bench   *bench,
+                   GError **error)
+{
+  GList *actions;
+  GList *l;
+  gboolean ret;
+
+  ret = FALSE;
+
+  actions = polkit_authority_enumerate_actions_sync (bench->authority, NULL, error);
+  if (actions == NULL)
+    {
+      if (error != NULL && *error == NULL)
+        g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "No actions are defined");
+      goto out;
+    }
+
+  for (l = actions; l != NULL; l = l->next)
+    {
+      BenchAction *action;
+      action = g_new0 (BenchAction, 1);
+      action->action_id = g_strdup (polkit_action_description_get_action_id (POLKIT_ACTION_DESCRIPTION (l->data)));
+      action->weight = 1;
+      bench->total_weight += action->weight;
+      g_ptr_array_add (bench->actions, action);
+    }
+  g_list_free_full (actions, g_object_unref);
+
+  ret = TRUE;
+
+ out:
+  return ret;
+}
+
+static BenchAction *
+pick_action (Bench *bench)
+{
+  BenchAction *action;
+  guint32 r;
+  guint n;
+
+  action = NULL;
+  r = g_rand_int_range (bench->rand, 0, bench->total_weight);
+  for (n = 0; n < bench->actions->len; n++)
+    {
+      action = bench->actions->pdata[n];
+      if (r < action->weight)
+        break;
+      r -= action->weight;
+    }
+  return action;
+}
+
+static PolkitSubject *
+pick_subject (Bench *bench)
+{
+  switch (bench->subject_type)
+    {
+    case SUBJECT_TYPE_UNIX_PROCESS:
+      return bench->process;
+    case SUBJECT_TYPE_SYSTEM_BUS_NAME:
+      return bench->bus_name;
+    case SUBJECT_TYPE_MIXED:
+      return bench->num_sent % 2 == 0 ? bench->process : bench->bus_name;
+    }
+  g_assert_not_reached ();
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void send_request (Bench *bench);
+
+static void
+on_check_authorization_cb (GObject      *source_object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+  Request *request = user_data;
+  Bench *bench = request->bench;
+  PolkitAuthorizationResult *result;
+  GError *error;
+  gint64 now;
+
+  now = g_get_monotonic_time ();
+
+  error = NULL;
+  result = polkit_authority_check_authorization_finish (POLKIT_AUTHORITY (source_object), res, &error);
+  if (result == NULL)
+    {
+      /* only show the first error, there are probably many more of the same kind */
+      if (bench->num_errors == 0)
+        g_printerr ("Error checking authorization: %s\n", error->message);
+      g_error_free (error);
+      bench->num_errors++;
+    }
+  else
+    {
+      if (polkit_authorization_result_get_is_authorized (result))
+        bench->num_authorized++;
+      else if (polkit_authorization_result_get_is_challenge (result))
+        bench->num_challenge++;
+      else
+        bench->num_not_authorized++;
+      g_object_unref (result);
+    }
+
+  if (request->measured)
+    {
+      gint64 latency = now - request->begin;
+      g_array_append_val (bench->latencies, latency);
+    }
+  g_free (request);
+
+  bench->num_in_flight--;
+  if (bench->num_sent < bench->num_to_send)
+    {
+      send_request (bench);
+    }
+  else if (bench->num_in_flight == 0)
+    {
+      bench->end_time = now;
+      g_main_loop_quit (bench->loop);
+    }
+}
+
+static void
+send_request (Bench *bench)
+{
+  BenchAction *action;
+  Request *request;
+
+  action = pick_action (bench);
+
+  request = g_new0 (Request, 1);
+  request->bench = bench;
+  request->measured = (bench->num_sent >= (guint) opt_warmup);
+  if (request->measured)
+    action->num_checks++;
+
+  request->begin = g_get_monotonic_time ();
+  if (request->measured && bench->start_time == 0)
+    bench->start_time = request->begin;
+
+  polkit_authority_check_authorization (bench->authority,
+                                        pick_subject (bench),
+                                        action->action_id,
+                                        bench->details,
+                                        POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE,
+                                        NULL, /* GCancellable */
+                                        on_check_authorization_cb,
+                                        request);
+  bench->num_sent++;
+  bench->num_in_flight++;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+report (Bench *bench)
+{
+  GArray *l = bench->latencies;
+  gdouble elapsed;
+  gdouble throughput;
+  gdouble mean;
+  gint64 sum;
+  GString *str;
+  guint n;
+
+  polkit_bench_sort (l);
+
+  sum = 0;
+  for (n = 0; n < l->len; n++)
+    sum += g_array_index (l, gint64, n);
+  mean = l->len > 0 ? ((gdouble) sum) / l->len : 0.0;
+
+  elapsed = (bench->end_time - bench->start_time) / ((gdouble) G_USEC_PER_SEC);
+  throughput = elapsed > 0.0 ? l->len / elapsed : 0.0;
+
+  str = g_string_new (NULL);
+  if (opt_json)
+    {
+      g_string_append_printf (str,
+                              "{\n"
+                              "  \"requests\": %u,\n"
+                              "  \"warmup\": %d,\n"
+                              "  \"concurrency\": %d,\n"
+                              "  \"subject_type\": \"%s\",\n"
+                              "  \"details\": %d,\n"
+                              "  \"detail_size\": %d,\n"
+                              "  \"session_changes_per_sec\": %d,\n"
+                              "  \"elapsed_sec\": %.6f,\n"
+                              "  \"throughput\": %.2f,\n"
+                              "  \"latency_usec\": {\n"
+                              "    \"min\": %" G_GINT64_FORMAT ",\n"
+                              "    \"mean\": %.2f,\n"
+                              "    \"p50\": %" G_GINT64_FORMAT ",\n"
+                              "    \"p99\": %" G_GINT64_FORMAT ",\n"
+                              "    \"p999\": %" G_GINT64_FORMAT ",\n"
+                              "    \"max\": %" G_GINT64_FORMAT "\n"
+                              "  },\n"
+                              "  \"results\": {\n"
+                              "    \"authorized\": %u,\n"
+                              "    \"challenge\": %u,\n"
+                              "    \"not_authorized\": %u,\n"
+                              "    \"errors\": %u\n"
+                              "  },\n"
+                              "  \"actions\": {\n",
+                              l->len,
+                              opt_warmup,
+                              opt_concurrency,
+                              subject_type_names[bench->subject_type],
+                              opt_num_details,
+                              opt_detail_size,
+                              opt_real_sessions ? 0 : opt_session_changes,
+                              elapsed,
+                              throughput,
+                              l->len > 0 ? g_array_index (l, gint64, 0) : 0,
+                              mean,
+                              polkit_bench_percentile (l, 0.50),
+                              polkit_bench_percentile (l, 0.99),
+                              polkit_bench_percentile (l, 0.999),
+                              l->len > 0 ? g_array_index (l, gint64, l->len - 1) : 0,
+                              bench->num_authorized,
+                              bench->num_challenge,
+                              bench->num_not_authorized,
+                              bench->num_errors);
+      /* action ids are restricted to [a-z0-9.-] so don't need escaping */
+      for (n = 0; n < bench->actions->len; n++)
+        {
+          BenchAction *action = bench->actions->pdata[n];
+          g_string_append_printf (str, "    \"%s\": %u%s\n",
+                                  action->action_id,
+                                  action->num_checks,
+                                  n + 1 < bench->actions->len ? "," : "");
+        }
+      g_string_append (str,
+                       "  }\n"
+                       "}\n");
+    }
+  else
+    {
+      g_string_append_printf (str,
+                              "Requests:      %u (after %d warm-up requests)\n"
+                              "Concurrency:   %d\n"
+                              "Subject type:  %s\n"
+                              "Details:       %d of %d bytes\n"
+                              "Sessions:      %s, %d changes/s\n"
+                              "Elapsed:       %.3f s\n"
+                              "Throughput:    %.1f requests/s\n"
+                              "Latency (usec):\n"
+                              "  min          %" G_GINT64_FORMAT "\n"
+                              "  mean         %.1f\n"
+                              "  p50          %" G_GINT64_FORMAT "\n"
+                              "  p99          %" G_GINT64_FORMAT "\n"
+                              "  p999         %" G_GINT64_FORMAT "\n"
+                              "  max          %" G_GINT64_FORMAT "\n"
+                              "Results:\n"
+                              "  authorized     %u\n"
+                              "  challenge      %u\n"
+                              "  not authorized %u\n"
+                              "  errors         %u\n"
+                              "Actions:\n",
+                              l->len,
+                              opt_warmup,
+                              opt_concurrency,
+                              subject_type_names[bench->subject_type],
+                              opt_num_details,
+                              opt_detail_size,
+                              opt_real_sessions ? "real" : (opt_sessions != NULL ? opt_sessions : "fake"),
+                              opt_real_sessions ? 0 : opt_session_changes,
+                              elapsed,
+                              throughput,
+                              l->len > 0 ? g_array_index (l, gint64, 0) : 0,
+                              mean,
+                              polkit_bench_percentile (l, 0.50),
+                              polkit_bench_percentile (l, 0.99),
+                              polkit_bench_percentile (l, 0.999),
+                              l->len > 0 ? g_array_index (l, gint64, l->len - 1) : 0,
+                              bench->num_authorized,
+                              bench->num_challenge,
+                              bench->num_not_authorized,
+                              bench->num_errors);
+      for (n = 0; n < bench->actions->len; n++)
+        {
+          BenchAction *action = bench->actions->pdata[n];
+          g_string_append_printf (str, "  %-12u %s\n", action->num_checks, action->action_id);
+        }
+    }
+
+  fwrite (str->str, 1, str->len, stdout);
+  g_string_free (str, TRUE);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Returns the name of a temporary file describing the sessions for
+ * polkitd, see polkit_backend_fake_sessions_new_from_file()
+ */
+static gchar *
+write_sessions_file (GError **error)
+{
+  gchar *path;
+  gchar *contents;
+  gchar *extra;
+  gint fd;
+
+  path = NULL;
+  contents = NULL;
+  extra = NULL;
+
+  fd = g_file_open_tmp ("polkit-bench-sessions-XXXXXX", &path, error);
+  if (fd == -1)
+    goto out;
+  close (fd);
+
+  if (opt_sessions != NULL)
+    {
+      if (!g_file_get_contents (opt_sessions, &extra, NULL, error))
+        goto fail;
+    }
+  else
+    {
+      extra = g_strdup_printf ("[Session bench]\n"
+                               "Uid=%d\n"
+                               "Seat=seat0\n"
+                               "Active=true\n",
+                               (gint) getuid ());
+    }
+
+  /* key files may have a group more than once */
+  contents = g_strdup_printf ("%s\n"
+                              "[General]\n"
+                              "%s"
+                              "ChangesPerSecond=%d\n",
+                              extra,
+                              opt_sessions != NULL ? "" : "DefaultSession=bench\n",
+                              opt_session_changes);
+  if (!g_file_set_contents (path, contents, -1, error))
+    goto fail;
+
+ out:
+  g_free (contents);
+  g_free (extra);
+  return path;
+
+ fail:
+  g_unlink (path);
+  g_free (path);
+  path = NULL;
+  goto out;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *opt_context;
+  GTestDBus *bus;
+  GDBusConnection *connection;
+  GPid polkitd_pid;
+  Bench bench;
+  GError *error;
+  gchar *sessions_path;
+  gchar *state_dir;
+  gchar *temporary_authorizations_path;
+  gint ret;
+  gint n;
+
+  ret = 1;
+  bus = NULL;
+  connection = NULL;
+  polkitd_pid = 0;
+  sessions_path = NULL;
+  state_dir = NULL;
+  temporary_authorizations_path = NULL;
+  memset (&bench, 0, sizeof bench);
+  bench.actions = g_ptr_array_new_with_free_func ((GDestroyNotify) bench_action_free);
+
+  setlocale (LC_ALL, "");
+  g_type_init ();
+
+  opt_context = g_option_context_new ("- measure polkitd throughput and latency");
+  g_option_context_add_main_entries (opt_context, opt_entries, NULL);
+  error = NULL;
+  if (!g_option_context_parse (opt_context, &argc, &argv, &error))
+    {
+      g_printerr ("Error parsing options: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (opt_subject_type == NULL || g_strcmp0 (opt_subject_type, "unix-process") == 0)
+    bench.subject_type = SUBJECT_TYPE_UNIX_PROCESS;
+  else if (g_strcmp0 (opt_subject_type, "system-bus-name") == 0)
+    bench.subject_type = SUBJECT_TYPE_SYSTEM_BUS_NAME;
+  else if (g_strcmp0 (opt_subject_type, "mixed") == 0)
+    bench.subject_type = SUBJECT_TYPE_MIXED;
+  else
+    {
+      g_printerr ("Unknown subject type `%s'\n", opt_subject_type);
+      goto out;
+    }
+
+  if (opt_concurrency < 1 || opt_requests < 1 || opt_warmup < 0 ||
+      opt_num_details < 0 || opt_detail_size < 0 || opt_session_changes < 0)
+    {
+      g_printerr ("Invalid arguments\n");
+      goto out;
+    }
+
+  if (opt_actions != NULL)
+    {
+      if (!parse_actions (&bench, &error))
+        {
+          g_printerr ("%s\n", error->message);
+          g_error_free (error);
+          goto out;
+        }
+    }
+
+  /* polkitd and the client library only ever use the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
+  connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+  if (connection == NULL)
+    {
+      g_printerr ("Error connecting to the message bus: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (!opt_real_sessions)
+    {
+      sessions_path = write_sessions_file (&error);
+      if (sessions_path == NULL)
+        {
+          g_printerr ("Error writing sessions file: %s\n", error->message);
+          g_error_free (error);
+          goto out;
+        }
+    }
+
+  /* keeps polkitd away from the file of the real one */
+  state_dir = g_dir_make_tmp ("polkit-bench-XXXXXX", &error);
+  if (state_dir == NULL)
+    {
+      g_printerr ("Error creating temporary directory: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+  temporary_authorizations_path = g_build_filename (state_dir, "temporary-authorizations", NULL);
+
+  polkitd_pid = polkit_bench_start_polkitd (opt_polkitd,
+                                            opt_actions_dir,
+                                            (const gchar * const *) opt_rules_dirs,
+                                            sessions_path,
+                                            temporary_authorizations_path,
+                                            opt_verbose,
+                                            &error);
+  if (polkitd_pid == 0)
+    {
+      g_printerr ("Error starting polkitd: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+  if (!polkit_bench_wait_for_polkitd (connection, polkitd_pid, G_USEC_PER_SEC / 20, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  bench.authority = polkit_authority_get_sync (NULL, &error);
+  if (bench.authority == NULL)
+    {
+      g_printerr ("Error getting authority: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (bench.actions->len == 0)
+    {
+      if (!enumerate_actions (&bench, &error))
+        {
+          g_printerr ("Error enumerating actions: %s\n", error->message);
+          g_error_free (error);
+          goto out;
+        }
+    }
+
+  bench.process = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+  bench.bus_name = polkit_system_bus_name_new (g_dbus_connection_get_unique_name (connection));
+
+  if (opt_num_details > 0)
+    {
+      gchar *value;
+      bench.details = polkit_details_new ();
+      value = g_strnfill (opt_detail_size, 'x');
+      for (n = 0; n < opt_num_details; n++)
+        {
+          gchar *key;
+          key = g_strdup_printf ("bench.key%d", n);
+          polkit_details_insert (bench.details, key, value);
+          g_free (key);
+        }
+      g_free (value);
+    }
+
+  bench.rand = opt_seed != 0 ? g_rand_new_with_seed (opt_seed) : g_rand_new ();
+  bench.latencies = g_array_sized_new (FALSE, FALSE, sizeof (gint64), opt_requests);
+  bench.num_to_send = opt_warmup + opt_requests;
+  bench.loop = g_main_loop_new (NULL, FALSE);
+
+  for (n = 0; n < opt_concurrency && bench.num_sent < bench.num_to_send; n++)
+    send_request (&bench);
+  g_main_loop_run (bench.loop);
+
+  report (&bench);
+
+  ret = bench.num_errors > 0 ? 1 : 0;
+
+ out:
+  if (bench.loop != NULL)
+    g_main_loop_unref (bench.loop);
+  if (bench.latencies != NULL)
+    g_array_unref (bench.latencies);
+  if (bench.rand != NULL)
+    g_rand_free (bench.rand);
+  if (bench.details != NULL)
+    g_object_unref (bench.details);
+  if (bench.process != NULL)
+    g_object_unref (bench.process);
+  if (bench.bus_name != NULL)
+    g_object_unref (bench.bus_name);
+  if (bench.authority != NULL)
+    g_object_unref (bench.authority);
+  g_ptr_array_unref (bench.actions);
+  if (polkitd_pid != 0)
+    polkit_bench_stop_polkitd (polkitd_pid);
+  if (connection != NULL)
+    g_object_unref (connection);
+  if (bus != NULL)
+    {
+      g_test_dbus_down (bus);
+      g_object_unref (bus);
+    }
+  if (sessions_path != NULL)
+    {
+      g_unlink (sessions_path);
+      g_free (sessions_path);
+    }
+  if (state_dir != NULL)
+    {
+      g_unlink (temporary_authorizations_path);
+      g_rmdir (state_dir);
+      g_free (temporary_authorizations_path);
+      g_free (state_dir);
+    }
+  g_option_context_free (opt_context);
+  g_free (opt_sessions);
+  g_free (opt_polkitd);
+  g_free (opt_actions_dir);
+  g_strfreev (opt_rules_dirs);
+  g_strfreev (opt_actions);
+  g_free (opt_subject_type);
+  return ret;
+}
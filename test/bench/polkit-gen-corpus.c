@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* polkit-gen-corpus writes a synthetic set of .policy and .rules files
+ * to DIR/actions and DIR/rules.d, for use with polkitd --actions-dir
+ * and --rules-dir or polkit-startup-bench --corpus.
+ *
+ * Each action has translated strings, some have exec.path, imply and
+ * owner annotations. Each rule tests the action id and then a number
+ * of other conditions (group membership, details, regular
+ * expressions...) given by --conditions.
+ */
+
+#include "config.h"
+
+#include <locale.h>
+#include <stdio.h>
+
+#include <gio/gio.h>
+
+#include "polkitbenchutils.h"
+
+static gint      opt_policy_files = 10;
+static gint      opt_actions = 20;
+static gint      opt_languages = 4;
+static gint      opt_rules_files = 10;
+static gint      opt_rules = 10;
+static gint      opt_conditions = 3;
+static gint      opt_seed = 1;
+
+static GOptionEntry opt_entries[] =
+{
+  {"policy-files", 'p', 0, G_OPTION_ARG_INT, &opt_policy_files, "Number of .policy files (default: 10)", "N"},
+  {"actions", 'a', 0, G_OPTION_ARG_INT, &opt_actions, "Number of actions per .policy file (default: 20)", "N"},
+  {"languages", 'l', 0, G_OPTION_ARG_INT, &opt_languages, "Number of translations per string (default: 4)", "N"},
+  {"rules-files", 'r', 0, G_OPTION_ARG_INT, &opt_rules_files, "Number of .rules files (default: 10)", "N"},
+  {"rules", 'n', 0, G_OPTION_ARG_INT, &opt_rules, "Number of rules per .rules file (default: 10)", "N"},
+  {"conditions", 'c', 0, G_OPTION_ARG_INT, &opt_conditions, "Number of conditions per rule (default: 3)", "N"},
+  {"seed", 's', 0, G_OPTION_ARG_INT, &opt_seed, "Random seed (default: 1)", "SEED"},
+  {NULL}
+};
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *opt_context;
+  PolkitBenchCorpus corpus;
+  GError *error;
+  gint ret;
+
+  ret = 1;
+
+  setlocale (LC_ALL, "");
+  g_type_init ();
+
+  opt_context = g_option_context_new ("DIR - generate .policy and .rules files");
+  g_option_context_add_main_entries (opt_context, opt_entries, NULL);
+  error = NULL;
+  if (!g_option_context_parse (opt_context, &argc, &argv, &error))
+    {
+      g_printerr ("Error parsing options: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (argc != 2)
+    {
+      g_printerr ("Expected a directory\n");
+      goto out;
+    }
+
+  if (opt_policy_files < 0 || opt_actions < 0 || opt_languages < 0 ||
+      opt_rules_files < 0 || opt_rules < 0 || opt_conditions < 1)
+    {
+      g_printerr ("Invalid arguments\n");
+      goto out;
+    }
+
+  corpus.num_policy_files = opt_policy_files;
+  corpus.num_actions = opt_actions;
+  corpus.num_languages = opt_languages;
+  corpus.num_rules_files = opt_rules_files;
+  corpus.num_rules = opt_rules;
+  corpus.num_conditions = opt_conditions;
+  corpus.seed = opt_seed;
+
+  if (!polkit_bench_write_corpus (&corpus, argv[1], &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  ret = 0;
+
+ out:
+  g_option_context_free (opt_context);
+  return ret;
+}
@@ -0,0 +1,944 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* polkit-rules-bench loads one or more rules.d directories into a
+ * PolkitBackendJsAuthority and replays a stream of checks through
+ * check_authorization_sync() and get_admin_identities(), without
+ * polkitd or a message bus. When done, it reports the latency of
+ * both calls, how the JS heap grew and how many times it was garbage
+ * collected, either as text or as JSON (--json).
+ *
+ * The stream is either read from a file (--replay) or generated
+ * (--synthetic). A replay file has one check per line:
+ *
+ *   ACTION-ID USER GROUP[,GROUP...] local|remote active|inactive [KEY=VALUE ...]
+ *
+ * where GROUP is `-' for no supplementary groups. Empty lines and
+ * lines starting with `#' are ignored, see data/replay/sample.replay.
+ *
+ * Rules see the user and groups through NSS, so unless --use-nss is
+ * given, passwd and group files for the users and groups in the
+ * stream are written to a temporary directory and used via mocklibc -
+ * run the program through test/mocklibc/bin/mocklibc like `make bench'
+ * does. With --use-nss the groups in the stream are ignored.
+ *
+ * Use --print-results to print the result for each check in the
+ * stream, e.g. to compare the decisions of two sets of rules.
+ */
+
+#include "config.h"
+#include "glib.h"
+
+#include <locale.h>
+#include <pwd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include <polkit/polkit.h>
+#include <polkitbackend/polkitbackendjsauthority.h>
+
+#include "polkitbenchutils.h"
+
+#define FIRST_UID 10000
+#define FIRST_GID 20000
+
+static gchar   **opt_rules_dirs = NULL;
+static gchar    *opt_replay = NULL;
+static gint      opt_synthetic = 0;
+static gchar   **opt_actions = NULL;
+static gint      opt_num_users = 16;
+static gchar    *opt_groups = NULL;
+static gint      opt_num_details = 0;
+static gint      opt_requests = 10000;
+static gint      opt_warmup = 1000;
+static gint      opt_seed = 0;
+static gboolean  opt_use_nss = FALSE;
+static gboolean  opt_no_admin_identities = FALSE;
+static gboolean  opt_print_results = FALSE;
+static gboolean  opt_json = FALSE;
+
+static GOptionEntry opt_entries[] =
+{
+  {"rules-dir", 0, 0, G_OPTION_ARG_FILENAME_ARRAY, &opt_rules_dirs, "Directory to load rules from, can be used multiple times (default: data/rules.d)", "DIR"},
+  {"replay", 'r', 0, G_OPTION_ARG_FILENAME, &opt_replay, "File with the checks to replay", "FILE"},
+  {"synthetic", 0, 0, G_OPTION_ARG_INT, &opt_synthetic, "Generate a stream of N random checks instead", "N"},
+  {"action", 'a', 0, G_OPTION_ARG_STRING_ARRAY, &opt_actions, "Action to use for generated checks, can be used multiple times", "ACTION"},
+  {"users", 'u', 0, G_OPTION_ARG_INT, &opt_num_users, "Number of users for generated checks (default: 16)", "N"},
+  {"groups", 'g', 0, G_OPTION_ARG_STRING, &opt_groups, "Comma-separated groups to assign to the users of generated checks", "GROUPS"},
+  {"details", 'd', 0, G_OPTION_ARG_INT, &opt_num_details, "Number of details to pass with generated checks (default: 0)", "N"},
+  {"requests", 'n', 0, G_OPTION_ARG_INT, &opt_requests, "Number of measured checks, the stream is repeated as needed (default: 10000)", "N"},
+  {"warmup", 'w', 0, G_OPTION_ARG_INT, &opt_warmup, "Number of checks to run before measuring (default: 1000)", "N"},
+  {"seed", 0, 0, G_OPTION_ARG_INT, &opt_seed, "Seed for generating checks (default: random)", "SEED"},
+  {"use-nss", 0, 0, G_OPTION_ARG_NONE, &opt_use_nss, "Resolve users with the system's NSS configuration", NULL},
+  {"no-admin-identities", 0, 0, G_OPTION_ARG_NONE, &opt_no_admin_identities, "Don't call get_admin_identities()", NULL},
+  {"print-results", 'p', 0, G_OPTION_ARG_NONE, &opt_print_results, "Print the result of each check in the stream", NULL},
+  {"json", 'j', 0, G_OPTION_ARG_NONE, &opt_json, "Report results as JSON", NULL},
+  {NULL}
+};
+
+typedef struct
+{
+  gchar *name;
+  gint uid;
+  gint gid;
+  PolkitIdentity *identity;
+  PolkitSubject *subject;
+} BenchUser;
+
+typedef struct
+{
+  gchar *name;
+  gint gid;
+  /* of gchar*, not owned */
+  GPtrArray *members;
+} BenchGroup;
+
+typedef struct
+{
+  gchar *line;
+  gchar *action_id;
+  BenchUser *user;
+  gboolean is_local;
+  gboolean is_active;
+  PolkitDetails *details;
+} BenchCheck;
+
+typedef struct
+{
+  PolkitBackendJsAuthority *authority;
+  PolkitSubject *caller;
+
+  /* name -> BenchUser, BenchGroup */
+  GHashTable *users;
+  GHashTable *groups;
+  gint next_uid;
+  gint next_gid;
+
+  /* of BenchCheck */
+  GPtrArray *checks;
+
+  gchar *fixture_dir;
+
+  /* latency in usec of the measured calls */
+  GArray *check_latencies;
+  GArray *admin_latencies;
+  gint64 start_time;
+  gint64 end_time;
+
+  guint64 heap_bytes_loaded;
+  guint64 heap_bytes_warm;
+  guint64 heap_bytes_end;
+  guint64 heap_bytes_max;
+  guint64 num_gcs_warm;
+  guint64 num_gcs_end;
+
+  /* indexed by PolkitImplicitAuthorization, UNKNOWN (-1) is last */
+  guint num_results[POLKIT_IMPLICIT_AUTHORIZATION_AUTHORIZED + 2];
+  guint num_admin_identities;
+} Bench;
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+bench_user_free (BenchUser *user)
+{
+  g_free (user->name);
+  if (user->identity != NULL)
+    g_object_unref (user->identity);
+  if (user->subject != NULL)
+    g_object_unref (user->subject);
+  g_free (user);
+}
+
+static void
+bench_group_free (BenchGroup *group)
+{
+  g_free (group->name);
+  g_ptr_array_unref (group->members);
+  g_free (group);
+}
+
+static void
+bench_check_free (BenchCheck *check)
+{
+  g_free (check->line);
+  g_free (check->action_id);
+  g_object_unref (check->details);
+  g_free (check);
+}
+
+static BenchGroup *
+lookup_group (Bench       *bench,
+              const gchar *name)
+{
+  BenchGroup *group;
+
+  group = g_hash_table_lookup (bench->groups, name);
+  if (group == NULL)
+    {
+      group = g_new0 (BenchGroup, 1);
+      group->name = g_strdup (name);
+      group->gid = g_strcmp0 (name, "root") == 0 ? 0 : bench->next_gid++;
+      group->members = g_ptr_array_new ();
+      g_hash_table_insert (bench->groups, group->name, group);
+    }
+  return group;
+}
+
+static BenchUser *
+lookup_user (Bench       *bench,
+             const gchar *name)
+{
+  BenchUser *user;
+
+  user = g_hash_table_lookup (bench->users, name);
+  if (user == NULL)
+    {
+      user = g_new0 (BenchUser, 1);
+      user->name = g_strdup (name);
+      user->uid = g_strcmp0 (name, "root") == 0 ? 0 : bench->next_uid++;
+      /* the primary group is named after the user */
+      user->gid = lookup_group (bench, name)->gid;
+      g_hash_table_insert (bench->users, user->name, user);
+    }
+  return user;
+}
+
+static void
+add_user_to_group (Bench       *bench,
+                   BenchUser   *user,
+                   const gchar *group_name)
+{
+  BenchGroup *group;
+  guint n;
+
+  group = lookup_group (bench, group_name);
+  for (n = 0; n < group->members->len; n++)
+    {
+      if (group->members->pdata[n] == user->name)
+        return;
+    }
+  g_ptr_array_add (group->members, user->name);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gboolean
+parse_check (Bench        *bench,
+             const gchar  *line,
+             GError      **error)
+{
+  BenchCheck *check;
+  gchar **tokens;
+  gchar **groups;
+  gboolean ret;
+  guint num_tokens;
+  guint n;
+
+  ret = FALSE;
+  check = NULL;
+  tokens = g_strsplit_set (line, " \t", -1);
+
+  /* squash runs of separators */
+  for (n = 0, num_tokens = 0; tokens[n] != NULL; n++)
+    {
+      if (tokens[n][0] == '\0')
+        g_free (tokens[n]);
+      else
+        tokens[num_tokens++] = tokens[n];
+    }
+  tokens[num_tokens] = NULL;
+
+  if (num_tokens < 5)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Expected at least 5 fields");
+      goto out;
+    }
+
+  check = g_new0 (BenchCheck, 1);
+  check->line = g_strjoinv (" ", tokens);
+  check->action_id = g_strdup (tokens[0]);
+  check->user = lookup_user (bench, tokens[1]);
+  check->details = polkit_details_new ();
+
+  if (g_strcmp0 (tokens[2], "-") != 0)
+    {
+      groups = g_strsplit (tokens[2], ",", 0);
+      for (n = 0; groups[n] != NULL; n++)
+        add_user_to_group (bench, check->user, groups[n]);
+      g_strfreev (groups);
+    }
+
+  if (g_strcmp0 (tokens[3], "local") == 0)
+    check->is_local = TRUE;
+  else if (g_strcmp0 (tokens[3], "remote") != 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Expected `local' or `remote', got `%s'", tokens[3]);
+      goto out;
+    }
+
+  if (g_strcmp0 (tokens[4], "active") == 0)
+    check->is_active = TRUE;
+  else if (g_strcmp0 (tokens[4], "inactive") != 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                   "Expected `active' or `inactive', got `%s'", tokens[4]);
+      goto out;
+    }
+
+  for (n = 5; n < num_tokens; n++)
+    {
+      gchar *eq;
+
+      eq = strchr (tokens[n], '=');
+      if (eq == NULL)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                       "Expected KEY=VALUE, got `%s'", tokens[n]);
+          goto out;
+        }
+      *eq = '\0';
+      polkit_details_insert (check->details, tokens[n], eq + 1);
+    }
+
+  g_ptr_array_add (bench->checks, check);
+  check = NULL;
+  ret = TRUE;
+
+ out:
+  if (check != NULL)
+    bench_check_free (check);
+  g_strfreev (tokens);
+  return ret;
+}
+
+static gboolean
+load_replay (Bench        *bench,
+             const gchar  *filename,
+             GError      **error)
+{
+  gchar *contents;
+  gchar **lines;
+  gboolean ret;
+  guint n;
+
+  ret = FALSE;
+  lines = NULL;
+
+  if (!g_file_get_contents (filename, &contents, NULL, error))
+    goto out;
+
+  lines = g_strsplit (contents, "\n", -1);
+  g_free (contents);
+
+  for (n = 0; lines[n] != NULL; n++)
+    {
+      gchar *line = g_strstrip (lines[n]);
+
+      if (line[0] == '\0' || line[0] == '#')
+        continue;
+
+      if (!parse_check (bench, line, error))
+        {
+          g_prefix_error (error, "%s:%u: ", filename, n + 1);
+          goto out;
+        }
+    }
+
+  if (bench->checks->len == 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "%s: No checks to replay", filename);
+      goto out;
+    }
+
+  ret = TRUE;
+
+ out:
+  g_strfreev (lines);
+  return ret;
+}
+
+static gboolean
+generate_checks (Bench   *bench,
+                 GError **error)
+{
+  GString *line;
+  GRand *rand;
+  gchar **groups;
+  guint num_groups;
+  gboolean ret;
+  gint n;
+
+  ret = FALSE;
+  line = g_string_new (NULL);
+  rand = opt_seed != 0 ? g_rand_new_with_seed (opt_seed) : g_rand_new ();
+  groups = g_strsplit (opt_groups != NULL ? opt_groups : "", ",", 0);
+  num_groups = g_strv_length (groups);
+
+  for (n = 0; n < opt_synthetic; n++)
+    {
+      guint user;
+      guint m;
+
+      user = g_rand_int_range (rand, 0, opt_num_users);
+      g_string_printf (line, "%s benchuser%u ",
+                       opt_actions[g_rand_int_range (rand, 0, g_strv_length (opt_actions))],
+                       user);
+
+      /* a user is always in the same groups, the ones picked by its number */
+      if (num_groups == 0)
+        g_string_append (line, "-");
+      for (m = 0; m < num_groups; m++)
+        {
+          if (user & (1 << (m % 31)))
+            g_string_append_printf (line, "%s,", groups[m]);
+        }
+      if (line->str[line->len - 1] == ',')
+        g_string_truncate (line, line->len - 1);
+      else if (line->str[line->len - 1] == ' ')
+        g_string_append (line, "-");
+
+      g_string_append (line, g_rand_boolean (rand) ? " local" : " remote");
+      g_string_append (line, g_rand_boolean (rand) ? " active" : " inactive");
+
+      for (m = 0; m < (guint) opt_num_details; m++)
+        g_string_append_printf (line, " bench.key%u=%08x", m, g_rand_int (rand));
+
+      if (!parse_check (bench, line->str, error))
+        goto out;
+    }
+
+  ret = TRUE;
+
+ out:
+  g_strfreev (groups);
+  g_rand_free (rand);
+  g_string_free (line, TRUE);
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gboolean
+write_fixtures (Bench   *bench,
+                GError **error)
+{
+  GHashTableIter iter;
+  BenchUser *user;
+  BenchGroup *group;
+  GString *passwd;
+  GString *group_str;
+  gchar *path;
+  gboolean ret;
+  guint n;
+
+  ret = FALSE;
+  passwd = g_string_new (NULL);
+  group_str = g_string_new (NULL);
+
+  g_hash_table_iter_init (&iter, bench->users);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &user))
+    {
+      g_string_append_printf (passwd, "%s:x:%d:%d::/home/%s:/bin/sh\n",
+                              user->name, user->uid, user->gid, user->name);
+    }
+
+  g_hash_table_iter_init (&iter, bench->groups);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &group))
+    {
+      g_string_append_printf (group_str, "%s:x:%d:", group->name, group->gid);
+      for (n = 0; n < group->members->len; n++)
+        g_string_append_printf (group_str, "%s%s", n > 0 ? "," : "", (const gchar *) group->members->pdata[n]);
+      g_string_append_c (group_str, '\n');
+    }
+
+  bench->fixture_dir = g_dir_make_tmp ("polkit-rules-bench-XXXXXX", error);
+  if (bench->fixture_dir == NULL)
+    goto out;
+
+  path = g_build_filename (bench->fixture_dir, "passwd", NULL);
+  if (!g_file_set_contents (path, passwd->str, passwd->len, error))
+    {
+      g_free (path);
+      goto out;
+    }
+  g_setenv ("MOCK_PASSWD", path, TRUE);
+  g_free (path);
+
+  path = g_build_filename (bench->fixture_dir, "group", NULL);
+  if (!g_file_set_contents (path, group_str->str, group_str->len, error))
+    {
+      g_free (path);
+      goto out;
+    }
+  g_setenv ("MOCK_GROUP", path, TRUE);
+  g_free (path);
+
+  ret = TRUE;
+
+ out:
+  g_string_free (passwd, TRUE);
+  g_string_free (group_str, TRUE);
+  return ret;
+}
+
+static void
+remove_fixtures (Bench *bench)
+{
+  gchar *path;
+
+  if (bench->fixture_dir == NULL)
+    return;
+
+  path = g_build_filename (bench->fixture_dir, "passwd", NULL);
+  g_unlink (path);
+  g_free (path);
+  path = g_build_filename (bench->fixture_dir, "group", NULL);
+  g_unlink (path);
+  g_free (path);
+  g_rmdir (bench->fixture_dir);
+}
+
+/* Creates the identity and subject for each user, checking that the
+ * users resolve as expected
+ */
+static gboolean
+resolve_users (Bench   *bench,
+               GError **error)
+{
+  GHashTableIter iter;
+  BenchUser *user;
+  gboolean ret;
+
+  ret = FALSE;
+
+  g_hash_table_iter_init (&iter, bench->users);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &user))
+    {
+      struct passwd *pw;
+
+      pw = getpwnam (user->name);
+      if (pw == NULL)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND,
+                       "Unknown user `%s'%s", user->name,
+                       opt_use_nss ? "" : " - is the program running under mocklibc?");
+          goto out;
+        }
+      if (!opt_use_nss && (gint) pw->pw_uid != user->uid)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "User `%s' has uid %d instead of %d - is the program running under mocklibc?",
+                       user->name, (gint) pw->pw_uid, user->uid);
+          goto out;
+        }
+      user->uid = pw->pw_uid;
+      user->identity = polkit_unix_user_new (user->uid);
+      user->subject = polkit_unix_process_new_for_owner (getpid (), 0, user->uid);
+    }
+
+  ret = TRUE;
+
+ out:
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static PolkitImplicitAuthorization
+run_check (Bench      *bench,
+           BenchCheck *check,
+           gboolean    measured)
+{
+  PolkitImplicitAuthorization result;
+  GList *admin_identities;
+  gint64 begin;
+  gint64 latency;
+  guint64 heap_bytes;
+
+  begin = g_get_monotonic_time ();
+  result = polkit_backend_interactive_authority_check_authorization_sync (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (bench->authority),
+                                                                          bench->caller,
+                                                                          check->user->subject,
+                                                                          check->user->identity,
+                                                                          check->is_local,
+                                                                          check->is_active,
+                                                                          check->action_id,
+                                                                          check->details,
+                                                                          POLKIT_IMPLICIT_AUTHORIZATION_UNKNOWN);
+  latency = g_get_monotonic_time () - begin;
+  if (measured)
+    {
+      g_array_append_val (bench->check_latencies, latency);
+      if (result == POLKIT_IMPLICIT_AUTHORIZATION_UNKNOWN)
+        bench->num_results[G_N_ELEMENTS (bench->num_results) - 1]++;
+      else
+        bench->num_results[result]++;
+    }
+
+  if (!opt_no_admin_identities)
+    {
+      begin = g_get_monotonic_time ();
+      admin_identities = polkit_backend_interactive_authority_get_admin_identities (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (bench->authority),
+                                                                                    bench->caller,
+                                                                                    check->user->subject,
+                                                                                    check->user->identity,
+                                                                                    check->is_local,
+                                                                                    check->is_active,
+                                                                                    check->action_id,
+                                                                                    check->details);
+      latency = g_get_monotonic_time () - begin;
+      if (measured)
+        {
+          g_array_append_val (bench->admin_latencies, latency);
+          bench->num_admin_identities += g_list_length (admin_identities);
+        }
+      g_list_free_full (admin_identities, g_object_unref);
+    }
+
+  if (measured)
+    {
+      polkit_backend_js_authority_get_gc_statistics (bench->authority, &heap_bytes, NULL);
+      bench->heap_bytes_max = MAX (bench->heap_bytes_max, heap_bytes);
+    }
+
+  return result;
+}
+
+static void
+print_results (Bench *bench)
+{
+  guint n;
+
+  for (n = 0; n < bench->checks->len; n++)
+    {
+      BenchCheck *check = bench->checks->pdata[n];
+      PolkitImplicitAuthorization result;
+
+      result = run_check (bench, check, FALSE);
+      g_print ("%-24s %s\n",
+               result == POLKIT_IMPLICIT_AUTHORIZATION_UNKNOWN ? "not-handled" : polkit_implicit_authorization_to_string (result),
+               check->line);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+append_latencies (GString     *str,
+                  const gchar *name,
+                  GArray      *l)
+{
+  gdouble mean;
+  gint64 sum;
+  guint n;
+
+  polkit_bench_sort (l);
+
+  sum = 0;
+  for (n = 0; n < l->len; n++)
+    sum += g_array_index (l, gint64, n);
+  mean = l->len > 0 ? ((gdouble) sum) / l->len : 0.0;
+
+  if (opt_json)
+    {
+      g_string_append_printf (str,
+                              "  \"%s_latency_usec\": {\n"
+                              "    \"min\": %" G_GINT64_FORMAT ",\n"
+                              "    \"mean\": %.2f,\n"
+                              "    \"p50\": %" G_GINT64_FORMAT ",\n"
+                              "    \"p99\": %" G_GINT64_FORMAT ",\n"
+                              "    \"p999\": %" G_GINT64_FORMAT ",\n"
+                              "    \"max\": %" G_GINT64_FORMAT "\n"
+                              "  },\n",
+                              name,
+                              l->len > 0 ? g_array_index (l, gint64, 0) : 0,
+                              mean,
+                              polkit_bench_percentile (l, 0.50),
+                              polkit_bench_percentile (l, 0.99),
+                              polkit_bench_percentile (l, 0.999),
+                              l->len > 0 ? g_array_index (l, gint64, l->len - 1) : 0);
+    }
+  else
+    {
+      g_string_append_printf (str,
+                              "%s latency (usec):\n"
+                              "  min          %" G_GINT64_FORMAT "\n"
+                              "  mean         %.1f\n"
+                              "  p50          %" G_GINT64_FORMAT "\n"
+                              "  p99          %" G_GINT64_FORMAT "\n"
+                              "  p999         %" G_GINT64_FORMAT "\n"
+                              "  max          %" G_GINT64_FORMAT "\n",
+                              name,
+                              l->len > 0 ? g_array_index (l, gint64, 0) : 0,
+                              mean,
+                              polkit_bench_percentile (l, 0.50),
+                              polkit_bench_percentile (l, 0.99),
+                              polkit_bench_percentile (l, 0.999),
+                              l->len > 0 ? g_array_index (l, gint64, l->len - 1) : 0);
+    }
+}
+
+static void
+report (Bench *bench)
+{
+  gdouble elapsed;
+  guint *r = bench->num_results;
+  guint unknown = G_N_ELEMENTS (bench->num_results) - 1;
+  GString *str;
+
+  elapsed = (bench->end_time - bench->start_time) / ((gdouble) G_USEC_PER_SEC);
+
+  str = g_string_new (NULL);
+  if (opt_json)
+    {
+      g_string_append_printf (str,
+                              "{\n"
+                              "  \"checks\": %u,\n"
+                              "  \"stream_length\": %u,\n"
+                              "  \"warmup\": %d,\n"
+                              "  \"users\": %u,\n"
+                              "  \"elapsed_sec\": %.6f,\n",
+                              bench->check_latencies->len,
+                              bench->checks->len,
+                              opt_warmup,
+                              g_hash_table_size (bench->users),
+                              elapsed);
+      append_latencies (str, "check", bench->check_latencies);
+      if (!opt_no_admin_identities)
+        append_latencies (str, "admin_identities", bench->admin_latencies);
+      g_string_append_printf (str,
+                              "  \"js_heap_bytes\": {\n"
+                              "    \"loaded\": %" G_GUINT64_FORMAT ",\n"
+                              "    \"warm\": %" G_GUINT64_FORMAT ",\n"
+                              "    \"end\": %" G_GUINT64_FORMAT ",\n"
+                              "    \"max\": %" G_GUINT64_FORMAT "\n"
+                              "  },\n"
+                              "  \"js_gcs\": %" G_GUINT64_FORMAT ",\n"
+                              "  \"results\": {\n"
+                              "    \"not_authorized\": %u,\n"
+                              "    \"authentication_required\": %u,\n"
+                              "    \"administrator_authentication_required\": %u,\n"
+                              "    \"authentication_required_retained\": %u,\n"
+                              "    \"administrator_authentication_required_retained\": %u,\n"
+                              "    \"authorized\": %u,\n"
+                              "    \"not_handled\": %u\n"
+                              "  },\n"
+                              "  \"admin_identities\": %u\n"
+                              "}\n",
+                              bench->heap_bytes_loaded,
+                              bench->heap_bytes_warm,
+                              bench->heap_bytes_end,
+                              bench->heap_bytes_max,
+                              bench->num_gcs_end - bench->num_gcs_warm,
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_NOT_AUTHORIZED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_AUTHENTICATION_REQUIRED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_AUTHENTICATION_REQUIRED_RETAINED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED_RETAINED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_AUTHORIZED],
+                              r[unknown],
+                              bench->num_admin_identities);
+    }
+  else
+    {
+      g_string_append_printf (str,
+                              "Checks:        %u (after %d warm-up checks)\n"
+                              "Stream:        %u checks, %u users\n"
+                              "Elapsed:       %.3f s\n",
+                              bench->check_latencies->len,
+                              opt_warmup,
+                              bench->checks->len,
+                              g_hash_table_size (bench->users),
+                              elapsed);
+      append_latencies (str, "Check", bench->check_latencies);
+      if (!opt_no_admin_identities)
+        append_latencies (str, "Admin identities", bench->admin_latencies);
+      g_string_append_printf (str,
+                              "JS heap (bytes):\n"
+                              "  loaded       %" G_GUINT64_FORMAT "\n"
+                              "  warm         %" G_GUINT64_FORMAT "\n"
+                              "  end          %" G_GUINT64_FORMAT "\n"
+                              "  max          %" G_GUINT64_FORMAT "\n"
+                              "JS GCs:        %" G_GUINT64_FORMAT "\n"
+                              "Results:\n"
+                              "  not authorized  %u\n"
+                              "  auth self       %u\n"
+                              "  auth admin      %u\n"
+                              "  auth self keep  %u\n"
+                              "  auth admin keep %u\n"
+                              "  authorized      %u\n"
+                              "  not handled     %u\n"
+                              "Admin identities: %u\n",
+                              bench->heap_bytes_loaded,
+                              bench->heap_bytes_warm,
+                              bench->heap_bytes_end,
+                              bench->heap_bytes_max,
+                              bench->num_gcs_end - bench->num_gcs_warm,
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_NOT_AUTHORIZED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_AUTHENTICATION_REQUIRED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_AUTHENTICATION_REQUIRED_RETAINED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_ADMINISTRATOR_AUTHENTICATION_REQUIRED_RETAINED],
+                              r[POLKIT_IMPLICIT_AUTHORIZATION_AUTHORIZED],
+                              r[unknown],
+                              bench->num_admin_identities);
+    }
+
+  fwrite (str->str, 1, str->len, stdout);
+  g_string_free (str, TRUE);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *opt_context;
+  gchar *default_rules_dirs[2] = {NULL, NULL};
+  Bench bench;
+  GError *error;
+  gint ret;
+  gint n;
+
+  ret = 1;
+  memset (&bench, 0, sizeof bench);
+  bench.users = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) bench_user_free);
+  bench.groups = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) bench_group_free);
+  bench.next_uid = FIRST_UID;
+  bench.next_gid = FIRST_GID;
+  bench.checks = g_ptr_array_new_with_free_func ((GDestroyNotify) bench_check_free);
+
+  setlocale (LC_ALL, "");
+  g_type_init ();
+
+  opt_context = g_option_context_new ("- replay checks through polkit rules");
+  g_option_context_add_main_entries (opt_context, opt_entries, NULL);
+  error = NULL;
+  if (!g_option_context_parse (opt_context, &argc, &argv, &error))
+    {
+      g_printerr ("Error parsing options: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (opt_requests < 1 || opt_warmup < 0 || opt_num_users < 1 || opt_num_details < 0 || opt_synthetic < 0)
+    {
+      g_printerr ("Invalid arguments\n");
+      goto out;
+    }
+
+  if (opt_replay != NULL)
+    {
+      if (!load_replay (&bench, opt_replay, &error))
+        {
+          g_printerr ("%s\n", error->message);
+          g_error_free (error);
+          goto out;
+        }
+    }
+  else if (opt_synthetic > 0)
+    {
+      if (opt_actions == NULL)
+        {
+          g_printerr ("--synthetic needs at least one --action\n");
+          goto out;
+        }
+      if (!generate_checks (&bench, &error))
+        {
+          g_printerr ("%s\n", error->message);
+          g_error_free (error);
+          goto out;
+        }
+    }
+  else
+    {
+      g_printerr ("Either --replay or --synthetic must be given\n");
+      goto out;
+    }
+
+  if (!opt_use_nss && !write_fixtures (&bench, &error))
+    {
+      g_printerr ("Error writing passwd and group files: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+  if (!resolve_users (&bench, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (opt_rules_dirs == NULL)
+    {
+      default_rules_dirs[0] = g_build_filename (POLKIT_BENCH_DATA_DIR, "rules.d", NULL);
+      opt_rules_dirs = g_strdupv (default_rules_dirs);
+    }
+
+  bench.authority = g_object_new (POLKIT_BACKEND_TYPE_JS_AUTHORITY,
+                                  "rules-dirs", opt_rules_dirs,
+                                  NULL);
+  polkit_backend_js_authority_initialize (bench.authority);
+  bench.caller = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+  polkit_backend_js_authority_get_gc_statistics (bench.authority, &bench.heap_bytes_loaded, NULL);
+
+  if (opt_print_results)
+    print_results (&bench);
+
+  for (n = 0; n < opt_warmup; n++)
+    run_check (&bench, bench.checks->pdata[n % bench.checks->len], FALSE);
+  polkit_backend_js_authority_get_gc_statistics (bench.authority, &bench.heap_bytes_warm, &bench.num_gcs_warm);
+  bench.heap_bytes_max = bench.heap_bytes_warm;
+
+  bench.check_latencies = g_array_sized_new (FALSE, FALSE, sizeof (gint64), opt_requests);
+  bench.admin_latencies = g_array_sized_new (FALSE, FALSE, sizeof (gint64), opt_requests);
+  bench.start_time = g_get_monotonic_time ();
+  for (n = 0; n < opt_requests; n++)
+    run_check (&bench, bench.checks->pdata[n % bench.checks->len], TRUE);
+  bench.end_time = g_get_monotonic_time ();
+  polkit_backend_js_authority_get_gc_statistics (bench.authority, &bench.heap_bytes_end, &bench.num_gcs_end);
+
+  report (&bench);
+
+  ret = 0;
+
+ out:
+  remove_fixtures (&bench);
+  g_free (bench.fixture_dir);
+  g_free (default_rules_dirs[0]);
+  if (bench.check_latencies != NULL)
+    g_array_unref (bench.check_latencies);
+  if (bench.admin_latencies != NULL)
+    g_array_unref (bench.admin_latencies);
+  if (bench.caller != NULL)
+    g_object_unref (bench.caller);
+  if (bench.authority != NULL)
+    g_object_unref (bench.authority);
+  g_ptr_array_unref (bench.checks);
+  g_hash_table_unref (bench.users);
+  g_hash_table_unref (bench.groups);
+  g_option_context_free (opt_context);
+  return ret;
+}
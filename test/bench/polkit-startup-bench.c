@@ -0,0 +1,641 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* polkit-startup-bench measures how polkitd startup scales with the
+ * number of actions and rules. It generates a corpus like
+ * polkit-gen-corpus (or uses an existing one with --corpus), then
+ * starts polkitd on a private message bus several times and measures
+ *
+ *  - the time until polkitd owns its bus name,
+ *  - the time until it answers the first CheckAuthorization call,
+ *    which includes loading all .policy files,
+ *  - its resident set size after that answer,
+ *  - the time from adding a .rules file until polkitd emits Changed,
+ *    i.e. until the JS authority has reloaded all rules,
+ *  - the time from adding a .policy file until polkitd emits Changed
+ *    and the time of the following EnumerateActions call, which
+ *    reloads the action pool.
+ *
+ * The reload times include the file monitor latency. The files added
+ * to measure reloading are removed again before polkitd is stopped.
+ */
+
+#include "config.h"
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+#include <polkit/polkit.h>
+#include <polkit/polkitprivate.h>
+
+#include "polkitbenchutils.h"
+
+static gchar    *opt_polkitd = NULL;
+static gchar    *opt_corpus = NULL;
+static gchar    *opt_action = NULL;
+static gint      opt_policy_files = 10;
+static gint      opt_actions = 20;
+static gint      opt_languages = 4;
+static gint      opt_rules_files = 10;
+static gint      opt_rules = 10;
+static gint      opt_conditions = 3;
+static gint      opt_seed = 1;
+static gint      opt_runs = 5;
+static gboolean  opt_json = FALSE;
+static gboolean  opt_verbose = FALSE;
+
+static GOptionEntry opt_entries[] =
+{
+  {"polkitd", 0, 0, G_OPTION_ARG_FILENAME, &opt_polkitd, "polkitd binary to run (default: the one in the build tree)", "PATH"},
+  {"corpus", 0, 0, G_OPTION_ARG_FILENAME, &opt_corpus, "Use the actions and rules.d directories in DIR instead of generating them", "DIR"},
+  {"action", 0, 0, G_OPTION_ARG_STRING, &opt_action, "Action to check (default: the first generated action)", "ACTION"},
+  {"policy-files", 'p', 0, G_OPTION_ARG_INT, &opt_policy_files, "Number of .policy files to generate (default: 10)", "N"},
+  {"actions", 'a', 0, G_OPTION_ARG_INT, &opt_actions, "Number of actions per .policy file (default: 20)", "N"},
+  {"languages", 'l', 0, G_OPTION_ARG_INT, &opt_languages, "Number of translations per string (default: 4)", "N"},
+  {"rules-files", 'r', 0, G_OPTION_ARG_INT, &opt_rules_files, "Number of .rules files to generate (default: 10)", "N"},
+  {"rules", 'n', 0, G_OPTION_ARG_INT, &opt_rules, "Number of rules per .rules file (default: 10)", "N"},
+  {"conditions", 'c', 0, G_OPTION_ARG_INT, &opt_conditions, "Number of conditions per rule (default: 3)", "N"},
+  {"seed", 's', 0, G_OPTION_ARG_INT, &opt_seed, "Random seed (default: 1)", "SEED"},
+  {"runs", 'k', 0, G_OPTION_ARG_INT, &opt_runs, "Number of times to start polkitd (default: 5)", "N"},
+  {"json", 'j', 0, G_OPTION_ARG_NONE, &opt_json, "Report results as JSON", NULL},
+  {"verbose", 'v', 0, G_OPTION_ARG_NONE, &opt_verbose, "Don't hide the output of polkitd", NULL},
+  {NULL}
+};
+
+typedef enum
+{
+  METRIC_NAME_ACQUIRED,
+  METRIC_FIRST_ANSWER,
+  METRIC_RSS,
+  METRIC_RULES_RELOAD,
+  METRIC_ACTIONS_CHANGED,
+  METRIC_ACTIONS_RELOAD,
+  NUM_METRICS
+} Metric;
+
+static const struct
+{
+  const gchar *name;
+  const gchar *description;
+} metrics[NUM_METRICS] =
+{
+  {"name_acquired_usec", "Name acquired (usec)"},
+  {"first_answer_usec", "First answer (usec)"},
+  {"rss_kb", "RSS after first answer (kB)"},
+  {"rules_reload_usec", "Rules reload (usec)"},
+  {"actions_changed_usec", "Actions changed (usec)"},
+  {"actions_reload_usec", "Actions reload (usec)"}
+};
+
+typedef struct
+{
+  GDBusConnection *connection;
+  gchar *actions_dir;
+  gchar *rules_dir;
+  gchar *temporary_authorizations_file;
+  GVariant *subject;
+  gchar *action_id;
+
+  /* time of the last Changed signal */
+  gint64 changed_time;
+
+  /* of gint64, one per run */
+  GArray *values[NUM_METRICS];
+} Bench;
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+on_changed (GDBusConnection *connection,
+            const gchar     *sender_name,
+            const gchar     *object_path,
+            const gchar     *interface_name,
+            const gchar     *signal_name,
+            GVariant        *parameters,
+            gpointer         user_data)
+{
+  Bench *bench = user_data;
+
+  bench->changed_time = g_get_monotonic_time ();
+}
+
+/* Returns the time of the first Changed signal after @since or 0 on timeout */
+static gint64
+wait_for_changed (Bench  *bench,
+                  gint64  since)
+{
+  gint64 deadline;
+
+  deadline = g_get_monotonic_time () + 10 * G_USEC_PER_SEC;
+  while (bench->changed_time < since && g_get_monotonic_time () < deadline)
+    g_main_context_iteration (NULL, FALSE);
+
+  return bench->changed_time >= since ? bench->changed_time : 0;
+}
+
+/* Lets the file monitors settle and collapses trailing Changed signals */
+static void
+settle (void)
+{
+  gint64 deadline;
+
+  deadline = g_get_monotonic_time () + G_USEC_PER_SEC / 4;
+  while (g_get_monotonic_time () < deadline)
+    {
+      while (g_main_context_iteration (NULL, FALSE))
+        ;
+      g_usleep (G_USEC_PER_SEC / 100);
+    }
+}
+
+static gboolean
+check_authorization (Bench   *bench,
+                     GError **error)
+{
+  GVariant *value;
+
+  value = g_dbus_connection_call_sync (bench->connection,
+                                       "org.freedesktop.PolicyKit1",
+                                       "/org/freedesktop/PolicyKit1/Authority",
+                                       "org.freedesktop.PolicyKit1.Authority",
+                                       "CheckAuthorization",
+                                       g_variant_new ("(@(sa{sv})s@a{ss}us)",
+                                                      bench->subject,
+                                                      bench->action_id,
+                                                      g_variant_new_array (G_VARIANT_TYPE ("{ss}"), NULL, 0),
+                                                      0,
+                                                      ""),
+                                       G_VARIANT_TYPE ("((bba{ss}))"),
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1,
+                                       NULL,
+                                       error);
+  if (value == NULL)
+    return FALSE;
+  g_variant_unref (value);
+  return TRUE;
+}
+
+static gboolean
+enumerate_actions (Bench   *bench,
+                   GError **error)
+{
+  GVariant *value;
+
+  value = g_dbus_connection_call_sync (bench->connection,
+                                       "org.freedesktop.PolicyKit1",
+                                       "/org/freedesktop/PolicyKit1/Authority",
+                                       "org.freedesktop.PolicyKit1.Authority",
+                                       "EnumerateActions",
+                                       g_variant_new ("(s)", ""),
+                                       NULL,
+                                       G_DBUS_CALL_FLAGS_NONE,
+                                       -1,
+                                       NULL,
+                                       error);
+  if (value == NULL)
+    return FALSE;
+  g_variant_unref (value);
+  return TRUE;
+}
+
+static gint64
+get_rss_kb (GPid pid)
+{
+  gchar *path;
+  gchar *contents;
+  const gchar *p;
+  gint64 ret;
+
+  ret = 0;
+  path = g_strdup_printf ("/proc/%d/status", (gint) pid);
+  if (g_file_get_contents (path, &contents, NULL, NULL))
+    {
+      p = strstr (contents, "\nVmRSS:");
+      if (p != NULL)
+        ret = g_ascii_strtoll (p + strlen ("\nVmRSS:"), NULL, 10);
+      g_free (contents);
+    }
+  g_free (path);
+  return ret;
+}
+
+/* Adds a file, waits for polkitd to notice and returns the time that took */
+static gint64
+add_file (Bench        *bench,
+          const gchar  *path,
+          const gchar  *contents,
+          GError      **error)
+{
+  gint64 begin;
+  gint64 changed;
+
+  begin = g_get_monotonic_time ();
+  if (!g_file_set_contents (path, contents, -1, error))
+    return -1;
+
+  changed = wait_for_changed (bench, begin);
+  if (changed == 0)
+    {
+      g_set_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+                   "Timed out waiting for polkitd to notice %s", path);
+      return -1;
+    }
+  return changed - begin;
+}
+
+static void
+remove_file (Bench       *bench,
+             const gchar *path)
+{
+  g_unlink (path);
+  wait_for_changed (bench, g_get_monotonic_time ());
+  settle ();
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gboolean
+run_once (Bench   *bench,
+          GError **error)
+{
+  const gchar *rules_dirs[2];
+  gchar *rules_path;
+  gchar *policy_path;
+  gchar *policy;
+  gint64 begin;
+  gint64 value;
+  gboolean ret;
+  GPid pid;
+
+  ret = FALSE;
+  rules_path = g_build_filename (bench->rules_dir, "99-startup-bench.rules", NULL);
+  policy_path = g_build_filename (bench->actions_dir, "org.freedesktop.policykit.startup-bench.policy", NULL);
+  policy = NULL;
+
+  rules_dirs[0] = bench->rules_dir;
+  rules_dirs[1] = NULL;
+
+  begin = g_get_monotonic_time ();
+  pid = polkit_bench_start_polkitd (opt_polkitd,
+                                    bench->actions_dir,
+                                    rules_dirs,
+                                    NULL, /* sessions_file */
+                                    bench->temporary_authorizations_file,
+                                    opt_verbose,
+                                    error);
+  if (pid == 0)
+    goto out;
+
+  if (!polkit_bench_wait_for_polkitd (bench->connection, pid, G_USEC_PER_SEC / 1000, error))
+    goto out;
+  value = g_get_monotonic_time () - begin;
+  g_array_append_val (bench->values[METRIC_NAME_ACQUIRED], value);
+
+  if (!check_authorization (bench, error))
+    goto out;
+  value = g_get_monotonic_time () - begin;
+  g_array_append_val (bench->values[METRIC_FIRST_ANSWER], value);
+
+  value = get_rss_kb (pid);
+  g_array_append_val (bench->values[METRIC_RSS], value);
+
+  settle ();
+
+  value = add_file (bench,
+                    rules_path,
+                    "polkit.addRule(function(action, subject) {\n"
+                    "    if (action.id == \"org.freedesktop.policykit.startup-bench\")\n"
+                    "        return polkit.Result.YES;\n"
+                    "});\n",
+                    error);
+  if (value < 0)
+    goto out;
+  g_array_append_val (bench->values[METRIC_RULES_RELOAD], value);
+  settle ();
+  remove_file (bench, rules_path);
+
+  policy = g_strdup ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                     "<!DOCTYPE policyconfig PUBLIC \"-//freedesktop//DTD polkit Policy Configuration 1.0//EN\"\n"
+                     "\"http://www.freedesktop.org/software/polkit/policyconfig-1.dtd\">\n"
+                     "<policyconfig>\n"
+                     "  <action id=\"org.freedesktop.policykit.startup-bench\">\n"
+                     "    <description>Added by polkit-startup-bench</description>\n"
+                     "    <message>Added by polkit-startup-bench</message>\n"
+                     "    <defaults>\n"
+                     "      <allow_any>no</allow_any>\n"
+                     "      <allow_inactive>no</allow_inactive>\n"
+                     "      <allow_active>yes</allow_active>\n"
+                     "    </defaults>\n"
+                     "  </action>\n"
+                     "</policyconfig>\n");
+  value = add_file (bench, policy_path, policy, error);
+  if (value < 0)
+    goto out;
+  g_array_append_val (bench->values[METRIC_ACTIONS_CHANGED], value);
+  settle ();
+
+  begin = g_get_monotonic_time ();
+  if (!enumerate_actions (bench, error))
+    goto out;
+  value = g_get_monotonic_time () - begin;
+  g_array_append_val (bench->values[METRIC_ACTIONS_RELOAD], value);
+
+  ret = TRUE;
+
+ out:
+  if (g_file_test (rules_path, G_FILE_TEST_EXISTS))
+    remove_file (bench, rules_path);
+  if (g_file_test (policy_path, G_FILE_TEST_EXISTS))
+    remove_file (bench, policy_path);
+  if (pid != 0)
+    polkit_bench_stop_polkitd (pid);
+  g_free (policy);
+  g_free (rules_path);
+  g_free (policy_path);
+  return ret;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+report (Bench *bench)
+{
+  GString *str;
+  guint n;
+
+  str = g_string_new (NULL);
+  if (opt_json)
+    {
+      g_string_append_printf (str,
+                              "{\n"
+                              "  \"runs\": %d,\n"
+                              "  \"action\": \"%s\",\n",
+                              opt_runs,
+                              bench->action_id);
+      if (opt_corpus == NULL)
+        g_string_append_printf (str,
+                                "  \"corpus\": {\n"
+                                "    \"policy_files\": %d,\n"
+                                "    \"actions\": %d,\n"
+                                "    \"languages\": %d,\n"
+                                "    \"rules_files\": %d,\n"
+                                "    \"rules\": %d,\n"
+                                "    \"conditions\": %d,\n"
+                                "    \"seed\": %d\n"
+                                "  },\n",
+                                opt_policy_files,
+                                opt_actions,
+                                opt_languages,
+                                opt_rules_files,
+                                opt_rules,
+                                opt_conditions,
+                                opt_seed);
+      for (n = 0; n < NUM_METRICS; n++)
+        {
+          GArray *v = bench->values[n];
+          polkit_bench_sort (v);
+          g_string_append_printf (str,
+                                  "  \"%s\": {\"min\": %" G_GINT64_FORMAT ", \"median\": %" G_GINT64_FORMAT
+                                  ", \"max\": %" G_GINT64_FORMAT "}%s\n",
+                                  metrics[n].name,
+                                  polkit_bench_percentile (v, 0.0),
+                                  polkit_bench_percentile (v, 0.5),
+                                  polkit_bench_percentile (v, 1.0),
+                                  n + 1 < NUM_METRICS ? "," : "");
+        }
+      g_string_append (str, "}\n");
+    }
+  else
+    {
+      if (opt_corpus == NULL)
+        g_string_append_printf (str,
+                                "Corpus:        %d .policy files with %d actions, %d translations\n"
+                                "               %d .rules files with %d rules of %d conditions\n",
+                                opt_policy_files, opt_actions, opt_languages,
+                                opt_rules_files, opt_rules, opt_conditions);
+      else
+        g_string_append_printf (str, "Corpus:        %s\n", opt_corpus);
+      g_string_append_printf (str,
+                              "Runs:          %d\n"
+                              "Action:        %s\n"
+                              "%-32s %10s %10s %10s\n",
+                              opt_runs,
+                              bench->action_id,
+                              "", "min", "median", "max");
+      for (n = 0; n < NUM_METRICS; n++)
+        {
+          GArray *v = bench->values[n];
+          polkit_bench_sort (v);
+          g_string_append_printf (str, "%-32s %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT " %10" G_GINT64_FORMAT "\n",
+                                  metrics[n].description,
+                                  polkit_bench_percentile (v, 0.0),
+                                  polkit_bench_percentile (v, 0.5),
+                                  polkit_bench_percentile (v, 1.0));
+        }
+    }
+
+  fwrite (str->str, 1, str->len, stdout);
+  g_string_free (str, TRUE);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+remove_tree (const gchar *path)
+{
+  GDir *dir;
+  const gchar *name;
+
+  dir = g_dir_open (path, 0, NULL);
+  if (dir != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+        {
+          gchar *child;
+          child = g_build_filename (path, name, NULL);
+          remove_tree (child);
+          g_free (child);
+        }
+      g_dir_close (dir);
+      g_rmdir (path);
+    }
+  else
+    {
+      g_unlink (path);
+    }
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *opt_context;
+  GTestDBus *bus;
+  PolkitSubject *process;
+  gchar *tmp_dir;
+  Bench bench;
+  GError *error;
+  guint subscription_id;
+  gint ret;
+  gint n;
+
+  ret = 1;
+  bus = NULL;
+  tmp_dir = NULL;
+  subscription_id = 0;
+  memset (&bench, 0, sizeof bench);
+  for (n = 0; n < NUM_METRICS; n++)
+    bench.values[n] = g_array_new (FALSE, FALSE, sizeof (gint64));
+
+  setlocale (LC_ALL, "");
+  g_type_init ();
+
+  opt_context = g_option_context_new ("- measure polkitd startup and reload time");
+  g_option_context_add_main_entries (opt_context, opt_entries, NULL);
+  error = NULL;
+  if (!g_option_context_parse (opt_context, &argc, &argv, &error))
+    {
+      g_printerr ("Error parsing options: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  if (opt_runs < 1 || opt_policy_files < 1 || opt_actions < 1 || opt_languages < 0 ||
+      opt_rules_files < 0 || opt_rules < 0 || opt_conditions < 1)
+    {
+      g_printerr ("Invalid arguments\n");
+      goto out;
+    }
+
+  tmp_dir = g_dir_make_tmp ("polkit-startup-bench-XXXXXX", &error);
+  if (tmp_dir == NULL)
+    {
+      g_printerr ("Error creating temporary directory: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+  /* keeps polkitd away from the file of the real one */
+  bench.temporary_authorizations_file = g_build_filename (tmp_dir, "temporary-authorizations", NULL);
+
+  if (opt_corpus != NULL)
+    {
+      bench.actions_dir = g_build_filename (opt_corpus, "actions", NULL);
+      bench.rules_dir = g_build_filename (opt_corpus, "rules.d", NULL);
+    }
+  else
+    {
+      PolkitBenchCorpus corpus;
+
+      corpus.num_policy_files = opt_policy_files;
+      corpus.num_actions = opt_actions;
+      corpus.num_languages = opt_languages;
+      corpus.num_rules_files = opt_rules_files;
+      corpus.num_rules = opt_rules;
+      corpus.num_conditions = opt_conditions;
+      corpus.seed = opt_seed;
+      if (!polkit_bench_write_corpus (&corpus, tmp_dir, &error))
+        {
+          g_printerr ("Error generating corpus: %s\n", error->message);
+          g_error_free (error);
+          goto out;
+        }
+      bench.actions_dir = g_build_filename (tmp_dir, "actions", NULL);
+      bench.rules_dir = g_build_filename (tmp_dir, "rules.d", NULL);
+    }
+
+  if (opt_action != NULL)
+    bench.action_id = g_strdup (opt_action);
+  else
+    bench.action_id = polkit_bench_corpus_action_id (0, 0);
+
+  /* polkitd only ever uses the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
+  bench.connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+  if (bench.connection == NULL)
+    {
+      g_printerr ("Error connecting to the message bus: %s\n", error->message);
+      g_error_free (error);
+      goto out;
+    }
+
+  subscription_id = g_dbus_connection_signal_subscribe (bench.connection,
+                                                        NULL, /* sender, changes with each run */
+                                                        "org.freedesktop.PolicyKit1.Authority",
+                                                        "Changed",
+                                                        "/org/freedesktop/PolicyKit1/Authority",
+                                                        NULL, /* arg0 */
+                                                        G_DBUS_SIGNAL_FLAGS_NONE,
+                                                        on_changed,
+                                                        &bench,
+                                                        NULL);
+
+  process = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+  bench.subject = g_variant_ref_sink (polkit_subject_to_gvariant (process));
+  g_object_unref (process);
+
+  for (n = 0; n < opt_runs; n++)
+    {
+      if (!run_once (&bench, &error))
+        {
+          g_printerr ("Run %d failed: %s\n", n + 1, error->message);
+          g_error_free (error);
+          goto out;
+        }
+    }
+
+  report (&bench);
+
+  ret = 0;
+
+ out:
+  if (subscription_id != 0)
+    g_dbus_connection_signal_unsubscribe (bench.connection, subscription_id);
+  if (bench.connection != NULL)
+    g_object_unref (bench.connection);
+  if (bus != NULL)
+    {
+      g_test_dbus_down (bus);
+      g_object_unref (bus);
+    }
+  if (bench.subject != NULL)
+    g_variant_unref (bench.subject);
+  for (n = 0; n < NUM_METRICS; n++)
+    g_array_unref (bench.values[n]);
+  if (tmp_dir != NULL)
+    {
+      remove_tree (tmp_dir);
+      g_free (tmp_dir);
+    }
+  g_free (bench.actions_dir);
+  g_free (bench.rules_dir);
+  g_free (bench.temporary_authorizations_file);
+  g_free (bench.action_id);
+  g_option_context_free (opt_context);
+  g_free (opt_polkitd);
+  g_free (opt_corpus);
+  g_free (opt_action);
+  return ret;
+}
@@ -0,0 +1,488 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <glib/gstdio.h>
+
+#include "polkitbenchutils.h"
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Starts polkitd as the calling user, loading the actions and rules in
+ * data/ unless other directories are given and tracking the sessions
+ * in @sessions_file instead of the real ones if that is not %NULL.
+ * Temporary authorizations are kept in @temporary_authorizations_file
+ * across restarts if that is not %NULL.
+ */
+GPid
+polkit_bench_start_polkitd (const gchar         *polkitd,
+                            const gchar         *actions_dir,
+                            const gchar * const *rules_dirs,
+                            const gchar         *sessions_file,
+                            const gchar         *temporary_authorizations_file,
+                            gboolean             verbose,
+                            GError             **error)
+{
+  GPtrArray *argv;
+  GPid pid;
+  gchar *data_dir;
+  guint n;
+
+  pid = 0;
+
+  argv = g_ptr_array_new_with_free_func (g_free);
+  g_ptr_array_add (argv, g_strdup (polkitd != NULL ? polkitd : POLKIT_BENCH_POLKITD));
+  g_ptr_array_add (argv, g_strdup ("--no-change-user"));
+
+  data_dir = g_strdup (g_getenv ("POLKIT_BENCH_DATA_DIR"));
+  if (data_dir == NULL)
+    data_dir = g_strdup (POLKIT_BENCH_DATA_DIR);
+
+  g_ptr_array_add (argv, g_strdup ("--actions-dir"));
+  if (actions_dir != NULL)
+    g_ptr_array_add (argv, g_strdup (actions_dir));
+  else
+    g_ptr_array_add (argv, g_build_filename (data_dir, "actions", NULL));
+
+  if (rules_dirs != NULL)
+    {
+      for (n = 0; rules_dirs[n] != NULL; n++)
+        {
+          g_ptr_array_add (argv, g_strdup ("--rules-dir"));
+          g_ptr_array_add (argv, g_strdup (rules_dirs[n]));
+        }
+    }
+  else
+    {
+      g_ptr_array_add (argv, g_strdup ("--rules-dir"));
+      g_ptr_array_add (argv, g_build_filename (data_dir, "rules.d", NULL));
+    }
+
+  if (sessions_file != NULL)
+    {
+      g_ptr_array_add (argv, g_strdup ("--fake-sessions"));
+      g_ptr_array_add (argv, g_strdup (sessions_file));
+    }
+
+  if (temporary_authorizations_file != NULL)
+    {
+      g_ptr_array_add (argv, g_strdup ("--temporary-authorizations-file"));
+      g_ptr_array_add (argv, g_strdup (temporary_authorizations_file));
+    }
+  g_ptr_array_add (argv, NULL);
+
+  if (!g_spawn_async (NULL,
+                      (gchar **) argv->pdata,
+                      NULL,
+                      G_SPAWN_DO_NOT_REAP_CHILD |
+                      (verbose ? 0 : G_SPAWN_STDOUT_TO_DEV_NULL | G_SPAWN_STDERR_TO_DEV_NULL),
+                      NULL,
+                      NULL,
+                      &pid,
+                      error))
+    pid = 0;
+
+  g_ptr_array_unref (argv);
+  g_free (data_dir);
+  return pid;
+}
+
+/* Polls every @poll_usec until polkitd owns its name, for up to 30 seconds */
+gboolean
+polkit_bench_wait_for_polkitd (GDBusConnection  *connection,
+                               GPid              pid,
+                               gulong            poll_usec,
+                               GError          **error)
+{
+  gboolean ret;
+  gint64 deadline;
+
+  ret = FALSE;
+  deadline = g_get_monotonic_time () + 30 * G_USEC_PER_SEC;
+
+  while (g_get_monotonic_time () < deadline)
+    {
+      GVariant *value;
+      gboolean has_owner;
+      gint status;
+
+      if (waitpid (pid, &status, WNOHANG) == pid)
+        {
+          g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                       "polkitd exited with status %d before acquiring its name", status);
+          goto out;
+        }
+
+      value = g_dbus_connection_call_sync (connection,
+                                           "org.freedesktop.DBus",
+                                           "/org/freedesktop/DBus",
+                                           "org.freedesktop.DBus",
+                                           "NameHasOwner",
+                                           g_variant_new ("(s)", "org.freedesktop.PolicyKit1"),
+                                           G_VARIANT_TYPE ("(b)"),
+                                           G_DBUS_CALL_FLAGS_NONE,
+                                           -1,
+                                           NULL,
+                                           error);
+      if (value == NULL)
+        goto out;
+      g_variant_get (value, "(b)", &has_owner);
+      g_variant_unref (value);
+      if (has_owner)
+        {
+          ret = TRUE;
+          goto out;
+        }
+
+      g_usleep (poll_usec);
+    }
+
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT,
+               "Timed out waiting for polkitd to acquire its name");
+
+ out:
+  return ret;
+}
+
+void
+polkit_bench_stop_polkitd (GPid pid)
+{
+  kill (pid, SIGTERM);
+  waitpid (pid, NULL, 0);
+  g_spawn_close_pid (pid);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gint
+compare_int64 (gconstpointer a,
+               gconstpointer b)
+{
+  gint64 va = *((const gint64 *) a);
+  gint64 vb = *((const gint64 *) b);
+  return va < vb ? -1 : (va > vb ? 1 : 0);
+}
+
+/* Sorts an array of gint64 */
+void
+polkit_bench_sort (GArray *values)
+{
+  g_array_sort (values, compare_int64);
+}
+
+/* Nearest-rank percentile, @values must be sorted */
+gint64
+polkit_bench_percentile (GArray  *values,
+                         gdouble  p)
+{
+  guint rank;
+
+  if (values->len == 0)
+    return 0;
+
+  rank = (guint) (p * values->len + 0.999999);
+  if (rank == 0)
+    rank = 1;
+  if (rank > values->len)
+    rank = values->len;
+  return g_array_index (values, gint64, rank - 1);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static const gchar *languages[] =
+{
+  "de", "fr", "es", "it", "pt_BR", "ru", "ja", "zh_CN", "pl", "nl", "sv", "cs", "ko", "tr", "uk", "da"
+};
+
+static const gchar *implicit_values[] =
+{
+  "no", "yes", "auth_self", "auth_admin", "auth_self_keep", "auth_admin_keep"
+};
+
+static const gchar *rule_results[] =
+{
+  "polkit.Result.YES", "polkit.Result.NO", "polkit.Result.AUTH_ADMIN", "polkit.Result.AUTH_SELF_KEEP"
+};
+
+gchar *
+polkit_bench_corpus_action_id (guint file,
+                               guint action)
+{
+  return g_strdup_printf ("org.freedesktop.policykit.corpus.file%u.action%u", file, action);
+}
+
+static void
+append_translated (GString     *str,
+                   const gchar *element,
+                   const gchar *text,
+                   guint        num_languages)
+{
+  guint n;
+
+  g_string_append_printf (str, "    <%s>%s</%s>\n", element, text, element);
+  for (n = 0; n < num_languages; n++)
+    {
+      gchar *lang;
+
+      if (n < G_N_ELEMENTS (languages))
+        lang = g_strdup (languages[n]);
+      else
+        lang = g_strdup_printf ("x%u", n);
+      g_string_append_printf (str, "    <%s xml:lang=\"%s\">%s [%s]</%s>\n", element, lang, text, lang, element);
+      g_free (lang);
+    }
+}
+
+static gchar *
+corpus_policy_file (const PolkitBenchCorpus *corpus,
+                    guint                    file,
+                    GRand                   *rand)
+{
+  GString *str;
+  guint n;
+
+  str = g_string_new ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                      "<!DOCTYPE policyconfig PUBLIC \"-//freedesktop//DTD polkit Policy Configuration 1.0//EN\"\n"
+                      "\"http://www.freedesktop.org/software/polkit/policyconfig-1.dtd\">\n"
+                      "\n"
+                      "<!-- Generated by polkit-gen-corpus, see test/bench/polkitbenchutils.c -->\n"
+                      "\n"
+                      "<policyconfig>\n"
+                      "  <vendor>The polkit project</vendor>\n"
+                      "  <vendor_url>http://www.freedesktop.org/wiki/Software/polkit/</vendor_url>\n"
+                      "  <icon_name>polkit-corpus</icon_name>\n");
+
+  for (n = 0; n < corpus->num_actions; n++)
+    {
+      gchar *action_id;
+      gchar *text;
+
+      action_id = polkit_bench_corpus_action_id (file, n);
+      g_string_append_printf (str, "\n  <action id=\"%s\">\n", action_id);
+
+      text = g_strdup_printf ("Corpus action %u of file %u", n, file);
+      append_translated (str, "description", text, corpus->num_languages);
+      g_free (text);
+      text = g_strdup_printf ("Authentication is required for corpus action %u of file %u", n, file);
+      append_translated (str, "message", text, corpus->num_languages);
+      g_free (text);
+
+      g_string_append_printf (str,
+                              "    <defaults>\n"
+                              "      <allow_any>%s</allow_any>\n"
+                              "      <allow_inactive>%s</allow_inactive>\n"
+                              "      <allow_active>%s</allow_active>\n"
+                              "    </defaults>\n",
+                              implicit_values[g_rand_int_range (rand, 0, G_N_ELEMENTS (implicit_values))],
+                              implicit_values[g_rand_int_range (rand, 0, G_N_ELEMENTS (implicit_values))],
+                              implicit_values[g_rand_int_range (rand, 0, G_N_ELEMENTS (implicit_values))]);
+
+      if (n % 4 == 0)
+        g_string_append_printf (str,
+                                "    <annotate key=\"org.freedesktop.policykit.exec.path\">/usr/libexec/polkit-corpus-helper%u</annotate>\n"
+                                "    <annotate key=\"org.freedesktop.policykit.exec.allow_gui\">true</annotate>\n",
+                                n);
+      if (n % 5 == 1)
+        {
+          gchar *implied_id;
+          implied_id = polkit_bench_corpus_action_id (file, n - 1);
+          g_string_append_printf (str,
+                                  "    <annotate key=\"org.freedesktop.policykit.imply\">%s</annotate>\n",
+                                  implied_id);
+          g_free (implied_id);
+        }
+      if (n % 3 == 2)
+        g_string_append (str,
+                         "    <annotate key=\"org.freedesktop.policykit.owner\">unix-user:root</annotate>\n");
+
+      g_string_append (str, "  </action>\n");
+      g_free (action_id);
+    }
+
+  g_string_append (str, "</policyconfig>\n");
+  return g_string_free (str, FALSE);
+}
+
+static void
+append_condition (GString *str,
+                  guint    kind,
+                  GRand   *rand)
+{
+  switch (kind % 6)
+    {
+    case 0:
+      g_string_append_printf (str, "subject.isInGroup(\"corpus-group%u\")", g_rand_int_range (rand, 0, 100));
+      break;
+    case 1:
+      g_string_append (str, "subject.local");
+      break;
+    case 2:
+      g_string_append (str, "subject.active");
+      break;
+    case 3:
+      g_string_append_printf (str, "action.lookup(\"corpus.key%u\") == \"value%u\"",
+                              g_rand_int_range (rand, 0, 8), g_rand_int_range (rand, 0, 8));
+      break;
+    case 4:
+      g_string_append_printf (str, "subject.user != \"corpus-user%u\"", g_rand_int_range (rand, 0, 1000));
+      break;
+    case 5:
+      g_string_append_printf (str, "/\\.action%u$/.test(action.id)", g_rand_int_range (rand, 0, 100));
+      break;
+    }
+}
+
+static gchar *
+corpus_rules_file (const PolkitBenchCorpus *corpus,
+                   guint                    file,
+                   GRand                   *rand)
+{
+  GString *str;
+  guint n;
+  guint m;
+
+  str = g_string_new ("/* -*- mode: js; js-indent-level: 4; indent-tabs-mode: nil -*- */\n"
+                      "\n"
+                      "/* Generated by polkit-gen-corpus, see test/bench/polkitbenchutils.c */\n");
+
+  for (n = 0; n < corpus->num_rules; n++)
+    {
+      guint policy_file;
+
+      policy_file = corpus->num_policy_files > 0 ? g_rand_int_range (rand, 0, corpus->num_policy_files) : 0;
+
+      g_string_append (str, "\npolkit.addRule(function(action, subject) {\n    if (");
+      if (n % 2 == 0 && corpus->num_actions > 0)
+        {
+          gchar *action_id;
+          action_id = polkit_bench_corpus_action_id (policy_file, g_rand_int_range (rand, 0, corpus->num_actions));
+          g_string_append_printf (str, "action.id == \"%s\"", action_id);
+          g_free (action_id);
+        }
+      else
+        {
+          g_string_append_printf (str, "action.id.indexOf(\"org.freedesktop.policykit.corpus.file%u.\") == 0", policy_file);
+        }
+
+      for (m = 1; m < corpus->num_conditions; m++)
+        {
+          g_string_append (str, " &&\n        ");
+          append_condition (str, g_rand_int (rand), rand);
+        }
+
+      g_string_append_printf (str,
+                              ") {\n"
+                              "        return %s;\n"
+                              "    }\n"
+                              "});\n",
+                              rule_results[g_rand_int_range (rand, 0, G_N_ELEMENTS (rule_results))]);
+    }
+
+  g_string_append_printf (str,
+                          "\npolkit.addAdminRule(function(action, subject) {\n"
+                          "    if (action.id.indexOf(\"org.freedesktop.policykit.corpus.file%u.\") == 0)\n"
+                          "        return [\"unix-group:corpus-admins%u\"];\n"
+                          "    return null;\n"
+                          "});\n",
+                          file, file);
+
+  return g_string_free (str, FALSE);
+}
+
+/* Writes @corpus->num_policy_files .policy files to @dir/actions and
+ * @corpus->num_rules_files .rules files to @dir/rules.d, creating the
+ * directories if needed. The output only depends on @corpus.
+ */
+gboolean
+polkit_bench_write_corpus (const PolkitBenchCorpus  *corpus,
+                           const gchar              *dir,
+                           GError                  **error)
+{
+  gchar *actions_dir;
+  gchar *rules_dir;
+  GRand *rand;
+  gboolean ret;
+  guint n;
+
+  ret = FALSE;
+  rand = g_rand_new_with_seed (corpus->seed);
+  actions_dir = g_build_filename (dir, "actions", NULL);
+  rules_dir = g_build_filename (dir, "rules.d", NULL);
+
+  if (g_mkdir_with_parents (actions_dir, 0755) != 0 ||
+      g_mkdir_with_parents (rules_dir, 0755) != 0)
+    {
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                   "Error creating directories in %s: %s", dir, g_strerror (errno));
+      goto out;
+    }
+
+  for (n = 0; n < corpus->num_policy_files; n++)
+    {
+      gchar *path;
+      gchar *name;
+      gchar *contents;
+      gboolean written;
+
+      name = g_strdup_printf ("org.freedesktop.policykit.corpus.file%u.policy", n);
+      path = g_build_filename (actions_dir, name, NULL);
+      contents = corpus_policy_file (corpus, n, rand);
+      written = g_file_set_contents (path, contents, -1, error);
+      g_free (contents);
+      g_free (path);
+      g_free (name);
+      if (!written)
+        goto out;
+    }
+
+  for (n = 0; n < corpus->num_rules_files; n++)
+    {
+      gchar *path;
+      gchar *name;
+      gchar *contents;
+      gboolean written;
+
+      name = g_strdup_printf ("50-corpus%04u.rules", n);
+      path = g_build_filename (rules_dir, name, NULL);
+      contents = corpus_rules_file (corpus, n, rand);
+      written = g_file_set_contents (path, contents, -1, error);
+      g_free (contents);
+      g_free (path);
+      g_free (name);
+      if (!written)
+        goto out;
+    }
+
+  ret = TRUE;
+
+ out:
+  g_free (actions_dir);
+  g_free (rules_dir);
+  g_rand_free (rand);
+  return ret;
+}
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef POLKIT_BENCH_UTILS_H_
+#define POLKIT_BENCH_UTILS_H_
+
+#include <gio/gio.h>
+
+/* Shared by the benchmark programs in test/bench */
+
+GPid     polkit_bench_start_polkitd   (const gchar         *polkitd,
+                                       const gchar         *actions_dir,
+                                       const gchar * const *rules_dirs,
+                                       const gchar         *sessions_file,
+                                       const gchar         *temporary_authorizations_file,
+                                       gboolean             verbose,
+                                       GError             **error);
+
+gboolean polkit_bench_wait_for_polkitd (GDBusConnection    *connection,
+                                        GPid                pid,
+                                        gulong              poll_usec,
+                                        GError            **error);
+
+void     polkit_bench_stop_polkitd    (GPid                 pid);
+
+gint64   polkit_bench_percentile      (GArray              *values,
+                                       gdouble              p);
+
+void     polkit_bench_sort            (GArray              *values);
+
+/**
+ * PolkitBenchCorpus:
+ * @num_policy_files: Number of .policy files to write.
+ * @num_actions: Number of actions in each .policy file.
+ * @num_languages: Number of translations of each string.
+ * @num_rules_files: Number of .rules files to write.
+ * @num_rules: Number of polkit.addRule() calls in each .rules file.
+ * @num_conditions: Number of conditions each rule tests.
+ * @seed: Seed for the random parts.
+ *
+ * Parameters for polkit_bench_write_corpus().
+ */
+typedef struct
+{
+  guint num_policy_files;
+  guint num_actions;
+  guint num_languages;
+  guint num_rules_files;
+  guint num_rules;
+  guint num_conditions;
+  guint32 seed;
+} PolkitBenchCorpus;
+
+gchar   *polkit_bench_corpus_action_id (guint                    file,
+                                        guint                    action);
+
+gboolean polkit_bench_write_corpus    (const PolkitBenchCorpus *corpus,
+                                       const gchar             *dir,
+                                       GError                 **error);
+
+#endif /* POLKIT_BENCH_UTILS_H_ */
@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Microbenchmarks for libpolkit-gobject, run with `make bench'.
+ *
+ * Each benchmark is a function running an operation a given number
+ * of times. The operation is first run for WARMUP_USEC, then the
+ * number of iterations is calibrated so a sample takes at least
+ * SAMPLE_USEC and NUM_SAMPLES samples are taken. The time per
+ * operation is reported with g_test_minimized_result() and as one
+ * JSON object per line on stdout.
+ *
+ * Without -m perf each operation is only run once, as a smoke test.
+ *
+ * The identity benchmarks look up users and groups so they should be
+ * run under mocklibc with the passwd/group files in test/data.
+ */
+
+#include "config.h"
+#include "glib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <polkit/polkit.h>
+#include <polkit/polkitprivate.h>
+
+#define WARMUP_USEC  (G_USEC_PER_SEC / 20)
+#define SAMPLE_USEC  (G_USEC_PER_SEC / 100)
+#define NUM_SAMPLES  21
+
+typedef void (*BenchFunc) (guint iterations);
+
+typedef struct
+{
+  const gchar *name;
+  BenchFunc func;
+} Benchmark;
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static gint64
+time_iterations (BenchFunc func,
+                 guint     iterations)
+{
+  gint64 begin;
+
+  begin = g_get_monotonic_time ();
+  func (iterations);
+  return g_get_monotonic_time () - begin;
+}
+
+static gint
+compare_double (gconstpointer a,
+                gconstpointer b)
+{
+  gdouble da = *((const gdouble *) a);
+  gdouble db = *((const gdouble *) b);
+  return da < db ? -1 : (da > db ? 1 : 0);
+}
+
+static void
+run_benchmark (gconstpointer user_data)
+{
+  const Benchmark *benchmark = user_data;
+  gdouble ns_per_op[NUM_SAMPLES];
+  guint iterations;
+  gint64 elapsed;
+  guint n;
+
+  if (!g_test_perf ())
+    {
+      benchmark->func (1);
+      return;
+    }
+
+  /* warm up caches, the type system, NSS etc. */
+  elapsed = 0;
+  for (iterations = 1; elapsed < WARMUP_USEC; iterations *= 2)
+    elapsed += time_iterations (benchmark->func, iterations);
+
+  /* calibrate so a sample is long enough to measure */
+  for (iterations = 1; ; iterations *= 2)
+    {
+      if (time_iterations (benchmark->func, iterations) >= SAMPLE_USEC)
+        break;
+    }
+
+  for (n = 0; n < NUM_SAMPLES; n++)
+    {
+      elapsed = time_iterations (benchmark->func, iterations);
+      ns_per_op[n] = elapsed * 1000.0 / iterations;
+    }
+  qsort (ns_per_op, NUM_SAMPLES, sizeof (gdouble), compare_double);
+
+  g_test_minimized_result (ns_per_op[NUM_SAMPLES / 2],
+                           "%s: %.1f ns/op (min %.1f, max %.1f, %u iterations per sample)",
+                           benchmark->name,
+                           ns_per_op[NUM_SAMPLES / 2],
+                           ns_per_op[0],
+                           ns_per_op[NUM_SAMPLES - 1],
+                           iterations);
+
+  g_print ("{\"benchmark\": \"%s\", \"iterations\": %u, \"samples\": %d, "
+           "\"ns_per_op\": {\"min\": %.1f, \"median\": %.1f, \"max\": %.1f}}\n",
+           benchmark->name,
+           iterations,
+           NUM_SAMPLES,
+           ns_per_op[0],
+           ns_per_op[NUM_SAMPLES / 2],
+           ns_per_op[NUM_SAMPLES - 1]);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+subject_from_string (const gchar *str,
+                     guint        iterations)
+{
+  guint n;
+
+  for (n = 0; n < iterations; n++)
+    {
+      PolkitSubject *subject;
+      GError *error = NULL;
+
+      subject = polkit_subject_from_string (str, &error);
+      g_assert_no_error (error);
+      g_object_unref (subject);
+    }
+}
+
+static void
+bench_subject_from_string_unix_process (guint iterations)
+{
+  /* with start time and uid, so /proc is not consulted */
+  subject_from_string ("unix-process:1234:5678:1000", iterations);
+}
+
+static void
+bench_subject_from_string_system_bus_name (guint iterations)
+{
+  subject_from_string ("system-bus-name::1.42", iterations);
+}
+
+static void
+bench_subject_from_string_unix_session (guint iterations)
+{
+  subject_from_string ("unix-session:c2", iterations);
+}
+
+static void
+bench_subject_to_gvariant (guint iterations)
+{
+  PolkitSubject *subject;
+  guint n;
+
+  subject = polkit_unix_process_new_for_owner (1234, 5678, 1000);
+  for (n = 0; n < iterations; n++)
+    {
+      GVariant *value;
+      value = polkit_subject_to_gvariant (subject);
+      g_variant_ref_sink (value);
+      g_variant_unref (value);
+    }
+  g_object_unref (subject);
+}
+
+static void
+bench_subject_new_for_gvariant (guint iterations)
+{
+  PolkitSubject *subject;
+  GVariant *value;
+  guint n;
+
+  subject = polkit_unix_process_new_for_owner (1234, 5678, 1000);
+  value = g_variant_ref_sink (polkit_subject_to_gvariant (subject));
+  g_object_unref (subject);
+
+  for (n = 0; n < iterations; n++)
+    {
+      GError *error = NULL;
+      subject = polkit_subject_new_for_gvariant (value, &error);
+      g_assert_no_error (error);
+      g_object_unref (subject);
+    }
+  g_variant_unref (value);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+#define NUM_DETAILS 8
+
+static PolkitDetails *
+make_details (void)
+{
+  PolkitDetails *details;
+  guint n;
+
+  details = polkit_details_new ();
+  for (n = 0; n < NUM_DETAILS; n++)
+    {
+      gchar key[32];
+      g_snprintf (key, sizeof key, "bench.key%u", n);
+      polkit_details_insert (details, key, "a value of typical length");
+    }
+  return details;
+}
+
+static void
+bench_details_insert (guint iterations)
+{
+  guint n;
+
+  for (n = 0; n < iterations; n++)
+    {
+      PolkitDetails *details;
+      details = make_details ();
+      g_object_unref (details);
+    }
+}
+
+static void
+bench_details_lookup (guint iterations)
+{
+  PolkitDetails *details;
+  guint n;
+
+  details = make_details ();
+  for (n = 0; n < iterations; n++)
+    g_assert (polkit_details_lookup (details, "bench.key3") != NULL);
+  g_object_unref (details);
+}
+
+static void
+bench_details_get_keys (guint iterations)
+{
+  PolkitDetails *details;
+  guint n;
+
+  details = make_details ();
+  for (n = 0; n < iterations; n++)
+    g_strfreev (polkit_details_get_keys (details));
+  g_object_unref (details);
+}
+
+static void
+bench_details_to_gvariant (guint iterations)
+{
+  PolkitDetails *details;
+  guint n;
+
+  details = make_details ();
+  for (n = 0; n < iterations; n++)
+    {
+      GVariant *value;
+      value = polkit_details_to_gvariant (details);
+      g_variant_ref_sink (value);
+      g_variant_unref (value);
+    }
+  g_object_unref (details);
+}
+
+static void
+bench_details_new_for_gvariant (guint iterations)
+{
+  PolkitDetails *details;
+  GVariant *value;
+  guint n;
+
+  details = make_details ();
+  value = g_variant_ref_sink (polkit_details_to_gvariant (details));
+  g_object_unref (details);
+
+  for (n = 0; n < iterations; n++)
+    {
+      details = polkit_details_new_for_gvariant (value);
+      g_object_unref (details);
+    }
+  g_variant_unref (value);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+identity_from_string (const gchar *str,
+                      guint        iterations)
+{
+  guint n;
+
+  for (n = 0; n < iterations; n++)
+    {
+      PolkitIdentity *identity;
+      GError *error = NULL;
+
+      identity = polkit_identity_from_string (str, &error);
+      g_assert_no_error (error);
+      g_object_unref (identity);
+    }
+}
+
+static void
+bench_identity_from_string_uid (guint iterations)
+{
+  identity_from_string ("unix-user:0", iterations);
+}
+
+static void
+bench_identity_from_string_user_name (guint iterations)
+{
+  /* looks up the user name */
+  identity_from_string ("unix-user:root", iterations);
+}
+
+static void
+bench_identity_from_string_group_name (guint iterations)
+{
+  /* looks up the group name */
+  identity_from_string ("unix-group:root", iterations);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+bench_unix_process_new (guint iterations)
+{
+  gint pid;
+  guint n;
+
+  pid = getpid ();
+  for (n = 0; n < iterations; n++)
+    {
+      PolkitSubject *subject;
+      /* parses the start time and uid from /proc */
+      subject = polkit_unix_process_new_for_owner (pid, 0, -1);
+      g_object_unref (subject);
+    }
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+bench_authorization_result_new_for_gvariant (guint iterations)
+{
+  PolkitAuthorizationResult *result;
+  PolkitDetails *details;
+  GVariant *value;
+  guint n;
+
+  details = make_details ();
+  result = polkit_authorization_result_new (FALSE, TRUE, details);
+  value = g_variant_ref_sink (polkit_authorization_result_to_gvariant (result));
+  g_object_unref (result);
+  g_object_unref (details);
+
+  for (n = 0; n < iterations; n++)
+    {
+      result = polkit_authorization_result_new_for_gvariant (value);
+      g_object_unref (result);
+    }
+  g_variant_unref (value);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static const Benchmark benchmarks[] =
+{
+  {"/PolkitBench/subject_from_string/unix_process", bench_subject_from_string_unix_process},
+  {"/PolkitBench/subject_from_string/system_bus_name", bench_subject_from_string_system_bus_name},
+  {"/PolkitBench/subject_from_string/unix_session", bench_subject_from_string_unix_session},
+  {"/PolkitBench/subject_to_gvariant", bench_subject_to_gvariant},
+  {"/PolkitBench/subject_new_for_gvariant", bench_subject_new_for_gvariant},
+  {"/PolkitBench/details_insert", bench_details_insert},
+  {"/PolkitBench/details_lookup", bench_details_lookup},
+  {"/PolkitBench/details_get_keys", bench_details_get_keys},
+  {"/PolkitBench/details_to_gvariant", bench_details_to_gvariant},
+  {"/PolkitBench/details_new_for_gvariant", bench_details_new_for_gvariant},
+  {"/PolkitBench/identity_from_string/uid", bench_identity_from_string_uid},
+  {"/PolkitBench/identity_from_string/user_name", bench_identity_from_string_user_name},
+  {"/PolkitBench/identity_from_string/group_name", bench_identity_from_string_group_name},
+  {"/PolkitBench/unix_process_new", bench_unix_process_new},
+  {"/PolkitBench/authorization_result_new_for_gvariant", bench_authorization_result_new_for_gvariant},
+};
+
+int
+main (int argc, char *argv[])
+{
+  guint n;
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  for (n = 0; n < G_N_ELEMENTS (benchmarks); n++)
+    g_test_add_data_func (benchmarks[n].name, &benchmarks[n], run_benchmark);
+
+  return g_test_run ();
+}
@@ -0,0 +1,67 @@
+/**
+ * Copyright 2016 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Public methods. */
+
+int db_file_update(struct db_file *file, const char *path) {
+  struct stat st;
+  if (stat(path, &st)) {
+    db_file_clear(file);
+    return -1;
+  }
+
+  if (file->path && strcmp(file->path, path) == 0 &&
+      file->dev == st.st_dev && file->ino == st.st_ino &&
+      file->size == st.st_size &&
+      file->mtime.tv_sec == st.st_mtim.tv_sec &&
+      file->mtime.tv_nsec == st.st_mtim.tv_nsec)
+    return 0;
+
+  db_file_clear(file);
+  file->path = strdup(path);
+  file->dev = st.st_dev;
+  file->ino = st.st_ino;
+  file->size = st.st_size;
+  file->mtime = st.st_mtim;
+  return 1;
+}
+
+void db_file_clear(struct db_file *file) {
+  free(file->path);
+  memset(file, 0, sizeof(struct db_file));
+}
+
+void db_lookup_latency(void) {
+  const char *value = getenv(LATENCY_CONFIG_KEY);
+  if (!value)
+    return;
+
+  long usec = strtol(value, NULL, 10);
+  if (usec <= 0)
+    return;
+
+  struct timespec ts;
+  ts.tv_sec = usec / 1000000;
+  ts.tv_nsec = (usec % 1000000) * 1000;
+  while (nanosleep(&ts, &ts) == -1 && errno == EINTR) {}
+}
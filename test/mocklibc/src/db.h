@@ -0,0 +1,58 @@
+/**
+ * Copyright 2016 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DB_H_
+#define DB_H_
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#define LATENCY_CONFIG_KEY "MOCK_LATENCY_USEC"
+
+/**
+ * Identity of a database file at the time it was loaded into memory.
+ */
+struct db_file {
+  char *path;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+};
+
+/**
+ * Check whether a database needs to be (re)loaded because its path or
+ * the file itself changed since the last call, and remember the new
+ * identity if so.
+ * @param file Identity of the loaded file, zero-filled if none
+ * @param path Path from the environment
+ * @return 1 if the file must be loaded, 0 if unchanged, -1 if it doesn't exist
+ */
+int db_file_update(struct db_file *file, const char *path);
+
+/**
+ * Forget the identity of the loaded file, so the next update reloads it.
+ * @param file Identity to clear
+ */
+void db_file_clear(struct db_file *file);
+
+/**
+ * Sleep for MOCK_LATENCY_USEC microseconds, if set, to emulate a
+ * directory service like LDAP. Called once per lookup.
+ */
+void db_lookup_latency(void);
+
+#endif
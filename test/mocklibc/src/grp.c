@@ -18,6 +18,12 @@
 
 #include <grp.h>
 
+#include "db.h"
+#include "hash.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,8 +31,263 @@
 
 #define GROUP_CONFIG_KEY "MOCK_GROUP"
 
+/**
+ * Groups a user is a member of, for getgrouplist().
+ */
+struct membership {
+  struct membership *next;
+  gid_t *gids;
+  int n_gids;
+  int alloc_gids;
+};
+
+/**
+ * The group file in memory, indexed by name, gid and member. Entries
+ * returned by lookups stay valid until the file changes.
+ */
+struct group_db {
+  struct db_file file;
+  struct group *entries;
+  size_t n_entries;
+  struct hash *by_name;
+  struct hash *by_gid;
+  struct hash *by_member;
+  struct membership *memberships;
+};
+
 static FILE *global_stream = NULL;
 
+static struct group_db db;
+static pthread_mutex_t db_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Private methods. */
+
+static void group_db_clear(void) {
+  size_t i;
+  for (i = 0; i < db.n_entries; i++) {
+    char **cur_user;
+    for (cur_user = db.entries[i].gr_mem; cur_user && *cur_user; cur_user++)
+      free(*cur_user);
+    free(db.entries[i].gr_mem);
+    free(db.entries[i].gr_name);
+    free(db.entries[i].gr_passwd);
+  }
+  free(db.entries);
+
+  struct membership *membership = db.memberships;
+  while (membership) {
+    struct membership *next = membership->next;
+    free(membership->gids);
+    free(membership);
+    membership = next;
+  }
+
+  hash_free(db.by_name);
+  hash_free(db.by_gid);
+  hash_free(db.by_member);
+  db.entries = NULL;
+  db.n_entries = 0;
+  db.by_name = NULL;
+  db.by_gid = NULL;
+  db.by_member = NULL;
+  db.memberships = NULL;
+}
+
+/**
+ * Copy a NULL-terminated array of strings.
+ */
+static char **strv_dup(char **strv) {
+  size_t n;
+  for (n = 0; strv[n]; n++) {}
+
+  char **copy = calloc(n + 1, sizeof(char *));
+  if (!copy)
+    return NULL;
+
+  size_t i;
+  for (i = 0; i < n; i++)
+    copy[i] = strdup(strv[i]);
+  return copy;
+}
+
+/**
+ * Record that a user is a member of a group.
+ * @return 0 on success, -1 if out of memory
+ */
+static int group_db_add_member(const char *user, gid_t gid) {
+  struct membership *membership = hash_lookup_str(db.by_member, user);
+  if (!membership) {
+    membership = calloc(1, sizeof(struct membership));
+    if (!membership)
+      return -1;
+    membership->next = db.memberships;
+    db.memberships = membership;
+    if (hash_insert_str(db.by_member, user, membership))
+      return -1;
+  }
+
+  if (membership->n_gids == membership->alloc_gids) {
+    int alloc = membership->alloc_gids ? membership->alloc_gids * 2 : 8;
+    gid_t *gids = realloc(membership->gids, alloc * sizeof(gid_t));
+    if (!gids)
+      return -1;
+    membership->gids = gids;
+    membership->alloc_gids = alloc;
+  }
+  membership->gids[membership->n_gids++] = gid;
+  return 0;
+}
+
+/**
+ * Read all entries of the group file and index them.
+ * @return 1 on success, 0 on failure
+ */
+static int group_db_load(const char *path) {
+  FILE *stream = fopen(path, "r");
+  if (!stream)
+    return 0;
+
+  size_t alloc = 0;
+  struct group *entry;
+  while ((entry = fgetgrent(stream))) {
+    if (db.n_entries == alloc) {
+      alloc = alloc ? alloc * 2 : 64;
+      struct group *entries = realloc(db.entries, alloc * sizeof(struct group));
+      if (!entries)
+        break;
+      db.entries = entries;
+    }
+
+    struct group *copy = &db.entries[db.n_entries++];
+    *copy = *entry;
+    copy->gr_name = strdup(entry->gr_name);
+    copy->gr_passwd = strdup(entry->gr_passwd);
+    copy->gr_mem = strv_dup(entry->gr_mem);
+  }
+  fclose(stream);
+
+  // Index only once the array doesn't move anymore
+  db.by_name = hash_new();
+  db.by_gid = hash_new();
+  db.by_member = hash_new();
+  if (!db.by_name || !db.by_gid || !db.by_member)
+    return 0;
+
+  size_t i;
+  for (i = 0; i < db.n_entries; i++) {
+    struct group *group = &db.entries[i];
+    if (!group->gr_mem ||
+        hash_insert_str(db.by_name, group->gr_name, group) ||
+        hash_insert_int(db.by_gid, group->gr_gid, group))
+      return 0;
+
+    char **cur_user;
+    for (cur_user = group->gr_mem; *cur_user; cur_user++) {
+      if (group_db_add_member(*cur_user, group->gr_gid))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+/**
+ * Make sure the file named by MOCK_GROUP is loaded. Call with db_lock held.
+ * @return 1 if the database can be used, 0 otherwise
+ */
+static int group_db_update(void) {
+  const char *path = getenv(GROUP_CONFIG_KEY);
+  if (!path) {
+    group_db_clear();
+    db_file_clear(&db.file);
+    return 0;
+  }
+
+  switch (db_file_update(&db.file, path)) {
+    case 0:
+      break;
+    case 1:
+      group_db_clear();
+      if (!group_db_load(path)) {
+        group_db_clear();
+        db_file_clear(&db.file);
+      }
+      break;
+    default:
+      group_db_clear();
+      break;
+  }
+
+  return db.by_name != NULL;
+}
+
+
+/**
+ * Copy an entry, its member list and the strings they point to into a caller
+ * supplied buffer, for the reentrant lookups. Returns ERANGE if the buffer is
+ * too small.
+ */
+static int group_copy(const struct group *entry, struct group *grp,
+                      char *buf, size_t buflen) {
+  size_t n_members = 0;
+  size_t i;
+
+  while (entry->gr_mem && entry->gr_mem[n_members])
+    n_members++;
+
+  // The member array goes first, aligned for pointers
+  size_t align = (sizeof(char *) - (uintptr_t) buf % sizeof(char *)) % sizeof(char *);
+  size_t array_size = (n_members + 1) * sizeof(char *);
+  if (align + array_size > buflen)
+    return ERANGE;
+
+  char **members = (char **) (buf + align);
+  buf += align + array_size;
+  buflen -= align + array_size;
+
+  *grp = *entry;
+  grp->gr_mem = members;
+
+  const char *strs[] = {entry->gr_name, entry->gr_passwd};
+  char **dests[] = {&grp->gr_name, &grp->gr_passwd};
+  for (i = 0; i < n_members + 2; i++) {
+    const char *str = i < 2 ? strs[i] : entry->gr_mem[i - 2];
+    char **dest = i < 2 ? dests[i] : &members[i - 2];
+
+    if (!str) {
+      *dest = NULL;
+      continue;
+    }
+
+    size_t len = strlen(str) + 1;
+    if (len > buflen)
+      return ERANGE;
+
+    memcpy(buf, str, len);
+    *dest = buf;
+    buf += len;
+    buflen -= len;
+  }
+  members[n_members] = NULL;
+
+  return 0;
+}
+
+static int group_copy_result(const struct group *entry, struct group *grp,
+                             char *buf, size_t buflen,
+                             struct group **result) {
+  *result = NULL;
+  if (!entry)
+    return 0;
+
+  int err = group_copy(entry, grp, buf, buflen);
+  if (!err)
+    *result = grp;
+  return err;
+}
+
+
+/** Public methods. */
+
 void setgrent(void) {
   if (global_stream)
     endgrent();
@@ -57,56 +318,63 @@ void endgrent(void) {
 }
 
 struct group *getgrnam(const char *name) {
-  const char *path = getenv(GROUP_CONFIG_KEY);
-  if (!path)
-    return NULL;
+  db_lookup_latency();
 
-  FILE *stream = fopen(path, "r");
-  if (!stream)
-    return NULL;
+  pthread_mutex_lock(&db_lock);
+  struct group *entry = NULL;
+  if (group_db_update())
+    entry = hash_lookup_str(db.by_name, name);
+  pthread_mutex_unlock(&db_lock);
 
-  struct group *entry;
-  while ((entry = fgetgrent(stream))) {
-    if (strcmp(entry->gr_name, name) == 0) {
-      fclose(stream);
-      return entry;
-    }
-  }
-
-  fclose(stream);
-  return NULL;
+  return entry;
 }
 
 struct group *getgrgid(gid_t gid) {
-  const char *path = getenv(GROUP_CONFIG_KEY);
-  if (!path)
-    return NULL;
+  db_lookup_latency();
 
-  FILE *stream = fopen(path, "r");
-  if (!stream)
-    return NULL;
+  pthread_mutex_lock(&db_lock);
+  struct group *entry = NULL;
+  if (group_db_update())
+    entry = hash_lookup_int(db.by_gid, gid);
+  pthread_mutex_unlock(&db_lock);
 
-  struct group *entry;
-  while ((entry = fgetgrent(stream))) {
-    if (entry->gr_gid == gid) {
-      fclose(stream);
-      return entry;
-    }
-  }
+  return entry;
+}
 
-  fclose(stream);
-  return NULL;
+int getgrnam_r(const char *name, struct group *grp, char *buf, size_t buflen,
+               struct group **result) {
+  db_lookup_latency();
+
+  pthread_mutex_lock(&db_lock);
+  struct group *entry = NULL;
+  if (group_db_update())
+    entry = hash_lookup_str(db.by_name, name);
+  int err = group_copy_result(entry, grp, buf, buflen, result);
+  pthread_mutex_unlock(&db_lock);
+
+  return err;
+}
+
+int getgrgid_r(gid_t gid, struct group *grp, char *buf, size_t buflen,
+               struct group **result) {
+  db_lookup_latency();
+
+  pthread_mutex_lock(&db_lock);
+  struct group *entry = NULL;
+  if (group_db_update())
+    entry = hash_lookup_int(db.by_gid, gid);
+  int err = group_copy_result(entry, grp, buf, buflen, result);
+  pthread_mutex_unlock(&db_lock);
+
+  return err;
 }
 
 int getgrouplist(const char *user, gid_t group, gid_t *groups, int *ngroups) {
-  const char *path = getenv(GROUP_CONFIG_KEY);
-  if (!path) {
-    *ngroups = 0;
-    return -1;
-  }
+  db_lookup_latency();
 
-  FILE *stream = fopen(path, "r");
-  if (!stream) {
+  pthread_mutex_lock(&db_lock);
+  if (!group_db_update()) {
+    pthread_mutex_unlock(&db_lock);
     *ngroups = 0;
     return -1;
   }
@@ -114,28 +382,22 @@ int getgrouplist(const char *user, gid_t group, gid_t *groups, int *ngroups) {
   int default_group_found = 0;
   int groups_found = 0;
 
-  // Loop through all groups
-  struct group *entry;
-  while ((entry = fgetgrent(stream))) {
-    // Loop through all users in group
-    char **cur_user;
-    for (cur_user = entry->gr_mem; *cur_user; cur_user++) {
-      // Skip users who don't match arg 'user'
-      if (strcmp(*cur_user, user))
-        continue;
-
-      // Is this the default group? if so, flag it
-      if (entry->gr_gid == group)
-        default_group_found = 1;
-
-      // Only insert new entries if we have room
-      if (groups_found < *ngroups) {
-        groups[groups_found] = entry->gr_gid;
-      }
+  // Groups the user is a member of, in the order of the file
+  struct membership *membership = hash_lookup_str(db.by_member, user);
+  int i;
+  for (i = 0; membership && i < membership->n_gids; i++) {
+    // Is this the default group? if so, flag it
+    if (membership->gids[i] == group)
+      default_group_found = 1;
 
-      groups_found++;
+    // Only insert new entries if we have room
+    if (groups_found < *ngroups) {
+      groups[groups_found] = membership->gids[i];
     }
+
+    groups_found++;
   }
+  pthread_mutex_unlock(&db_lock);
 
   // Include the default group if it wasn't found
   if (!default_group_found) {
@@ -151,6 +413,5 @@ int getgrouplist(const char *user, gid_t group, gid_t *groups, int *ngroups) {
   // Always tell the user how many groups we found via *ngroups
   *ngroups = groups_found;
 
-  fclose(stream);
   return retval;
 }
@@ -0,0 +1,176 @@
+/**
+ * Copyright 2016 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HASH_INITIAL_SIZE 64
+
+struct node {
+  struct node *next;
+  unsigned long hash;
+  const char *str_key;
+  unsigned long int_key;
+  void *value;
+};
+
+struct hash {
+  /* Array of chains, the size is a power of two. */
+  struct node **buckets;
+  unsigned long size;
+  unsigned long count;
+};
+
+/** Private methods. */
+
+/**
+ * FNV-1a hash of a string.
+ */
+static unsigned long hash_str(const char *key) {
+  unsigned long h = 2166136261UL;
+  for (; *key; key++) {
+    h ^= (unsigned char) *key;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+/**
+ * Mix the bits of an integer so consecutive ids spread over buckets.
+ */
+static unsigned long hash_int(unsigned long key) {
+  key ^= key >> 16;
+  key *= 0x45d9f3bUL;
+  key ^= key >> 16;
+  return key;
+}
+
+/**
+ * Double the number of buckets once the chains get long.
+ * @return 0 on success, -1 if out of memory
+ */
+static int hash_grow(struct hash *table) {
+  unsigned long new_size = table->size * 2;
+  struct node **new_buckets = calloc(new_size, sizeof(struct node *));
+  if (!new_buckets)
+    return -1;
+
+  unsigned long i;
+  for (i = 0; i < table->size; i++) {
+    struct node *node = table->buckets[i];
+    while (node) {
+      struct node *next = node->next;
+      unsigned long j = node->hash & (new_size - 1);
+      node->next = new_buckets[j];
+      new_buckets[j] = node;
+      node = next;
+    }
+  }
+
+  free(table->buckets);
+  table->buckets = new_buckets;
+  table->size = new_size;
+  return 0;
+}
+
+static int hash_insert(struct hash *table, unsigned long h,
+    const char *str_key, unsigned long int_key, void *value) {
+  if (table->count >= table->size && hash_grow(table))
+    return -1;
+
+  struct node *node = malloc(sizeof(struct node));
+  if (!node)
+    return -1;
+
+  unsigned long i = h & (table->size - 1);
+  node->hash = h;
+  node->str_key = str_key;
+  node->int_key = int_key;
+  node->value = value;
+  node->next = table->buckets[i];
+  table->buckets[i] = node;
+  table->count++;
+  return 0;
+}
+
+
+/** Public methods. */
+
+struct hash *hash_new(void) {
+  struct hash *table = malloc(sizeof(struct hash));
+  if (!table)
+    return NULL;
+
+  table->size = HASH_INITIAL_SIZE;
+  table->count = 0;
+  table->buckets = calloc(table->size, sizeof(struct node *));
+  if (!table->buckets) {
+    free(table);
+    return NULL;
+  }
+  return table;
+}
+
+void hash_free(struct hash *table) {
+  if (!table)
+    return;
+
+  unsigned long i;
+  for (i = 0; i < table->size; i++) {
+    struct node *node = table->buckets[i];
+    while (node) {
+      struct node *next = node->next;
+      free(node);
+      node = next;
+    }
+  }
+  free(table->buckets);
+  free(table);
+}
+
+int hash_insert_str(struct hash *table, const char *key, void *value) {
+  if (hash_lookup_str(table, key))
+    return 0;
+  return hash_insert(table, hash_str(key), key, 0, value);
+}
+
+void *hash_lookup_str(struct hash *table, const char *key) {
+  unsigned long h = hash_str(key);
+  struct node *node;
+  for (node = table->buckets[h & (table->size - 1)]; node; node = node->next) {
+    if (node->hash == h && strcmp(node->str_key, key) == 0)
+      return node->value;
+  }
+  return NULL;
+}
+
+int hash_insert_int(struct hash *table, unsigned long key, void *value) {
+  if (hash_lookup_int(table, key))
+    return 0;
+  return hash_insert(table, hash_int(key), NULL, key, value);
+}
+
+void *hash_lookup_int(struct hash *table, unsigned long key) {
+  unsigned long h = hash_int(key);
+  struct node *node;
+  for (node = table->buckets[h & (table->size - 1)]; node; node = node->next) {
+    if (node->int_key == key && node->str_key == NULL)
+      return node->value;
+  }
+  return NULL;
+}
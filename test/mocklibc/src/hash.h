@@ -0,0 +1,67 @@
+/**
+ * Copyright 2016 Red Hat, Inc.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HASH_H_
+#define HASH_H_
+
+/**
+ * Hash table with string or integer keys. Neither keys nor values are
+ * owned by the table, and each table should only be used with one kind
+ * of key.
+ */
+struct hash;
+
+/**
+ * Create an empty hash table.
+ * @return New hash table or NULL if out of memory
+ */
+struct hash *hash_new(void);
+
+/**
+ * Free a hash table, but not its keys and values.
+ * @param table Hash table to free
+ */
+void hash_free(struct hash *table);
+
+/**
+ * Insert a value unless the key is already present, so that the first
+ * of several entries with the same key wins like when scanning a file.
+ * @param table Hash table to insert into
+ * @param key Key, must stay valid as long as the table is used
+ * @param value Value for key
+ * @return 0 on success, -1 if out of memory
+ */
+int hash_insert_str(struct hash *table, const char *key, void *value);
+
+/**
+ * Find the value for a string key.
+ * @param table Hash table to search
+ * @param key Key to find
+ * @return Value for key or NULL if not found
+ */
+void *hash_lookup_str(struct hash *table, const char *key);
+
+/**
+ * Integer key version of hash_insert_str().
+ */
+int hash_insert_int(struct hash *table, unsigned long key, void *value);
+
+/**
+ * Integer key version of hash_lookup_str().
+ */
+void *hash_lookup_int(struct hash *table, unsigned long key);
+
+#endif
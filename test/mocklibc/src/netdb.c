@@ -16,11 +16,14 @@
  * Author: Nikki VonHollen <vonhollen@gmail.com>
  */
 
+#include "db.h"
+#include "hash.h"
 #include "netgroup.h"
 
 #include <netdb.h>
 
 #include <ctype.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
@@ -29,35 +32,86 @@
 
 /** Private static data. */
 
+/**
+ * The netgroup file in memory, indexed by name. Like the other databases
+ * it is only reloaded when the file changes.
+ */
+static struct db_file global_netgroup_file;
 static struct netgroup *global_netgroup_head = NULL;
+static struct hash *global_netgroup_index = NULL;
+static pthread_mutex_t global_netgroup_lock = PTHREAD_MUTEX_INITIALIZER;
 static struct netgroup_iter global_iter;
+static int global_iter_valid = 0;
+
+/** Private methods. */
+
+static void netgroup_db_clear(void) {
+  hash_free(global_netgroup_index);
+  netgroup_free_all(global_netgroup_head);
+  global_netgroup_index = NULL;
+  global_netgroup_head = NULL;
+  global_iter_valid = 0;
+}
+
+/**
+ * Make sure the file named by MOCK_NETGROUP is loaded. Call with
+ * global_netgroup_lock held.
+ * @return 1 if the database can be used, 0 otherwise
+ */
+static int netgroup_db_update(void) {
+  const char *path = getenv(NETGROUP_CONFIG_KEY);
+  if (!path) {
+    netgroup_db_clear();
+    db_file_clear(&global_netgroup_file);
+    return 0;
+  }
+
+  switch (db_file_update(&global_netgroup_file, path)) {
+    case 0:
+      break;
+    case 1:
+      netgroup_db_clear();
+      global_netgroup_head = netgroup_parse_all();
+      global_netgroup_index = netgroup_index_all(global_netgroup_head);
+      if (!global_netgroup_index) {
+        netgroup_db_clear();
+        db_file_clear(&global_netgroup_file);
+      }
+      break;
+    default:
+      netgroup_db_clear();
+      break;
+  }
+
+  return global_netgroup_index != NULL;
+}
 
 /** Public methods */
 
 // REMEMBER: 1 means success, 0 means failure for netgroup methods
 
 int setnetgrent(const char *netgroup) {
-  if (!global_netgroup_head)
-    global_netgroup_head = netgroup_parse_all();
+  db_lookup_latency();
 
-  struct netgroup *group = netgroup_find(global_netgroup_head, netgroup);
-  if (!group) {
-     netgroup_free_all(global_netgroup_head);
-    global_netgroup_head = NULL;
-    return 0;
-  }
+  pthread_mutex_lock(&global_netgroup_lock);
+  struct netgroup *group = NULL;
+  if (netgroup_db_update())
+    group = hash_lookup_str(global_netgroup_index, netgroup);
 
-  netgroup_iter_init(&global_iter, group);
-  return 1;
+  global_iter_valid = group != NULL;
+  if (group)
+    netgroup_iter_init(&global_iter, group);
+  pthread_mutex_unlock(&global_netgroup_lock);
+
+  return group != NULL;
 }
 
 void endnetgrent(void) {
-  netgroup_free_all(global_netgroup_head);
-  global_netgroup_head = NULL;
+  global_iter_valid = 0;
 }
 
 int getnetgrent(char **host, char **user, char **domain) {
-  if (!global_netgroup_head)
+  if (!global_iter_valid)
     return 0;
 
   struct entry *result = netgroup_iter_next(&global_iter);
@@ -72,12 +126,16 @@ int getnetgrent(char **host, char **user, char **domain) {
 
 int innetgr(const char *netgroup, const char *host, const char *user,
     const char *domain) {
+  db_lookup_latency();
+
   int retval = 0;
-  struct netgroup *head = netgroup_parse_all();
-  struct netgroup *group = netgroup_find(head, netgroup);
+  pthread_mutex_lock(&global_netgroup_lock);
+  struct netgroup *group = NULL;
+  if (netgroup_db_update())
+    group = hash_lookup_str(global_netgroup_index, netgroup);
   if (!group) {
     // Can't find group
-    netgroup_free_all(head);
+    pthread_mutex_unlock(&global_netgroup_lock);
     return 0;
   }
 
@@ -95,6 +153,6 @@ int innetgr(const char *netgroup, const char *host, const char *user,
     break;
   }
 
-  netgroup_free_all(head);
+  pthread_mutex_unlock(&global_netgroup_lock);
   return retval;
 }
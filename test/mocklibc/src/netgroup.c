@@ -17,6 +17,7 @@
  */
 
 #include "netgroup.h"
+#include "hash.h"
 
 #include <ctype.h>
 #include <regex.h>
@@ -25,7 +26,6 @@
 #include <string.h>
 #include <sys/types.h>
 
-#define NETGROUP_CONFIG_KEY "MOCK_NETGROUP"
 #define NETGROUP_TRIPLE_REGEX "\\(([^,]*),([^,]*),([^\\)]*)\\)"
 #define FREE_IF_NOT_NULL(ptr) if (ptr) free(ptr)
 
@@ -85,9 +85,9 @@ void print_indent(FILE *stream, unsigned int indent) {
 /**
  * Connect entries with 'child' type to their child entries.
  * @param headentry Head of list of entries that need to be connected
- * @param headgroup Head of list of netgroups to connect child entries to
+ * @param index Netgroups to connect child entries to, by name
  */
-static void netgroup_connect_children(struct entry *headentry, struct netgroup *headgroup) {
+static void netgroup_connect_children(struct entry *headentry, struct hash *index) {
   struct entry *curentry;
   for (curentry = headentry; curentry; curentry = curentry->next) {
     // Skip entries that don't have children
@@ -95,7 +95,7 @@ static void netgroup_connect_children(struct entry *headentry, struct netgroup *
       continue;
 
     // Set the entry's children to the head of the netgroup with the same name
-    struct netgroup *group = netgroup_find(headgroup, curentry->data.child.name);
+    struct netgroup *group = hash_lookup_str(index, curentry->data.child.name);
     if (group)
       curentry->data.child.head = group->head;
   }
@@ -144,14 +144,36 @@ struct netgroup *netgroup_parse_all() {
   fclose(stream);
 
   // Fill in child entry pointers
+  struct hash *index = netgroup_index_all(headgroup);
+  if (!index) {
+    netgroup_free_all(headgroup);
+    return NULL;
+  }
+
   struct netgroup *curgroup;
   for (curgroup = headgroup; curgroup; curgroup = curgroup->next) {
-    netgroup_connect_children(curgroup->head, headgroup);
+    netgroup_connect_children(curgroup->head, index);
   }
 
+  hash_free(index);
   return headgroup;
 }
 
+struct hash *netgroup_index_all(struct netgroup *head) {
+  struct hash *index = hash_new();
+  if (!index)
+    return NULL;
+
+  struct netgroup *group;
+  for (group = head; group; group = group->next) {
+    if (hash_insert_str(index, group->name, group)) {
+      hash_free(index);
+      return NULL;
+    }
+  }
+  return index;
+}
+
 void netgroup_free_all(struct netgroup *head) {
   struct netgroup *group = head;
   struct netgroup *nextgroup;
@@ -19,8 +19,11 @@
 #ifndef NETGROUP_H_
 #define NETGROUP_H_
 
+#define NETGROUP_CONFIG_KEY "MOCK_NETGROUP"
 #define NETGROUP_MAX_DEPTH 32
 
+struct hash;
+
 /**
  * Netgroup with a name and list of entries.
  */
@@ -81,6 +84,13 @@ struct netgroup_iter {
  */
 struct netgroup *netgroup_parse_all();
 
+/**
+ * Index a list of netgroups by name, the first netgroup with a name wins.
+ * @param head Head of list of netgroups
+ * @return Hash table of netgroups by name, free with hash_free(), or NULL
+ */
+struct hash *netgroup_index_all(struct netgroup *head);
+
 /**
  * Free a list of netgroups.
  * @param head Head of list of netgroups
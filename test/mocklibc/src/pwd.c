@@ -18,6 +18,11 @@
 
 #include <pwd.h>
 
+#include "db.h"
+#include "hash.h"
+
+#include <errno.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,8 +30,167 @@
 
 #define PASSWD_CONFIG_KEY "MOCK_PASSWD"
 
+/**
+ * The passwd file in memory, indexed by name and uid. Entries returned
+ * by lookups stay valid until the file changes.
+ */
+struct passwd_db {
+  struct db_file file;
+  struct passwd *entries;
+  size_t n_entries;
+  struct hash *by_name;
+  struct hash *by_uid;
+};
+
 static FILE *global_stream = NULL;
 
+static struct passwd_db db;
+static pthread_mutex_t db_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** Private methods. */
+
+static void passwd_db_clear(void) {
+  size_t i;
+  for (i = 0; i < db.n_entries; i++) {
+    free(db.entries[i].pw_name);
+    free(db.entries[i].pw_passwd);
+    free(db.entries[i].pw_gecos);
+    free(db.entries[i].pw_dir);
+    free(db.entries[i].pw_shell);
+  }
+  free(db.entries);
+  hash_free(db.by_name);
+  hash_free(db.by_uid);
+  db.entries = NULL;
+  db.n_entries = 0;
+  db.by_name = NULL;
+  db.by_uid = NULL;
+}
+
+/**
+ * Read all entries of the passwd file and index them.
+ * @return 1 on success, 0 on failure
+ */
+static int passwd_db_load(const char *path) {
+  FILE *stream = fopen(path, "r");
+  if (!stream)
+    return 0;
+
+  size_t alloc = 0;
+  struct passwd *entry;
+  while ((entry = fgetpwent(stream))) {
+    if (db.n_entries == alloc) {
+      alloc = alloc ? alloc * 2 : 64;
+      struct passwd *entries = realloc(db.entries, alloc * sizeof(struct passwd));
+      if (!entries)
+        break;
+      db.entries = entries;
+    }
+
+    struct passwd *copy = &db.entries[db.n_entries++];
+    *copy = *entry;
+    copy->pw_name = strdup(entry->pw_name);
+    copy->pw_passwd = strdup(entry->pw_passwd);
+    copy->pw_gecos = strdup(entry->pw_gecos);
+    copy->pw_dir = strdup(entry->pw_dir);
+    copy->pw_shell = strdup(entry->pw_shell);
+  }
+  fclose(stream);
+
+  // Index only once the array doesn't move anymore
+  db.by_name = hash_new();
+  db.by_uid = hash_new();
+  if (!db.by_name || !db.by_uid)
+    return 0;
+
+  size_t i;
+  for (i = 0; i < db.n_entries; i++) {
+    if (hash_insert_str(db.by_name, db.entries[i].pw_name, &db.entries[i]) ||
+        hash_insert_int(db.by_uid, db.entries[i].pw_uid, &db.entries[i]))
+      return 0;
+  }
+  return 1;
+}
+
+/**
+ * Make sure the file named by MOCK_PASSWD is loaded. Call with db_lock held.
+ * @return 1 if the database can be used, 0 otherwise
+ */
+static int passwd_db_update(void) {
+  const char *path = getenv(PASSWD_CONFIG_KEY);
+  if (!path) {
+    passwd_db_clear();
+    db_file_clear(&db.file);
+    return 0;
+  }
+
+  switch (db_file_update(&db.file, path)) {
+    case 0:
+      break;
+    case 1:
+      passwd_db_clear();
+      if (!passwd_db_load(path)) {
+        passwd_db_clear();
+        db_file_clear(&db.file);
+      }
+      break;
+    default:
+      passwd_db_clear();
+      break;
+  }
+
+  return db.by_name != NULL;
+}
+
+
+/**
+ * Copy an entry and the strings it points to into a caller supplied buffer,
+ * for the reentrant lookups. Returns ERANGE if the buffer is too small.
+ */
+static int passwd_copy(const struct passwd *entry, struct passwd *pwd,
+                       char *buf, size_t buflen) {
+  const char *strs[] = {entry->pw_name, entry->pw_passwd, entry->pw_gecos,
+                        entry->pw_dir, entry->pw_shell};
+  char **dests[] = {&pwd->pw_name, &pwd->pw_passwd, &pwd->pw_gecos,
+                    &pwd->pw_dir, &pwd->pw_shell};
+  size_t i;
+
+  *pwd = *entry;
+  for (i = 0; i < sizeof(strs) / sizeof(strs[0]); i++) {
+    if (!strs[i]) {
+      *dests[i] = NULL;
+      continue;
+    }
+
+    size_t len = strlen(strs[i]) + 1;
+    if (len > buflen)
+      return ERANGE;
+
+    memcpy(buf, strs[i], len);
+    *dests[i] = buf;
+    buf += len;
+    buflen -= len;
+  }
+
+  return 0;
+}
+
+static int passwd_copy_result(const struct passwd *entry, struct passwd *pwd,
+                              char *buf, size_t buflen,
+                              struct passwd **result) {
+  *result = NULL;
+  if (!entry)
+    return 0;
+
+  int err = passwd_copy(entry, pwd, buf, buflen);
+  if (!err)
+    *result = pwd;
+  return err;
+}
+
+
+/** Public methods. */
+
 void setpwent(void) {
   if (global_stream)
     endpwent();
@@ -57,43 +221,53 @@ void endpwent(void) {
 }
 
 struct passwd *getpwnam(const char *name) {
-  const char *path = getenv(PASSWD_CONFIG_KEY);
-  if (!path)
-    return NULL;
-
-  FILE *stream = fopen(path, "r");
-  if (!stream)
-    return NULL;
+  db_lookup_latency();
 
-  struct passwd *entry;
-  while ((entry = fgetpwent(stream))) {
-    if (strcmp(entry->pw_name, name) == 0) {
-      fclose(stream);
-      return entry;
-    }
-  }
+  pthread_mutex_lock(&db_lock);
+  struct passwd *entry = NULL;
+  if (passwd_db_update())
+    entry = hash_lookup_str(db.by_name, name);
+  pthread_mutex_unlock(&db_lock);
 
-  fclose(stream);
-  return NULL;
+  return entry;
 }
 
 struct passwd *getpwuid(uid_t uid) {
-  const char *path = getenv(PASSWD_CONFIG_KEY);
-  if (!path)
-    return NULL;
+  db_lookup_latency();
 
-  FILE *stream = fopen(path, "r");
-  if (!stream)
-    return NULL;
+  pthread_mutex_lock(&db_lock);
+  struct passwd *entry = NULL;
+  if (passwd_db_update())
+    entry = hash_lookup_int(db.by_uid, uid);
+  pthread_mutex_unlock(&db_lock);
 
-  struct passwd *entry;
-  while ((entry = fgetpwent(stream))) {
-    if (entry->pw_uid == uid) {
-      fclose(stream);
-      return entry;
-    }
-  }
+  return entry;
+}
 
-  fclose(stream);
-  return NULL;
+int getpwnam_r(const char *name, struct passwd *pwd, char *buf, size_t buflen,
+               struct passwd **result) {
+  db_lookup_latency();
+
+  pthread_mutex_lock(&db_lock);
+  struct passwd *entry = NULL;
+  if (passwd_db_update())
+    entry = hash_lookup_str(db.by_name, name);
+  int err = passwd_copy_result(entry, pwd, buf, buflen, result);
+  pthread_mutex_unlock(&db_lock);
+
+  return err;
+}
+
+int getpwuid_r(uid_t uid, struct passwd *pwd, char *buf, size_t buflen,
+               struct passwd **result) {
+  db_lookup_latency();
+
+  pthread_mutex_lock(&db_lock);
+  struct passwd *entry = NULL;
+  if (passwd_db_update())
+    entry = hash_lookup_int(db.by_uid, uid);
+  int err = passwd_copy_result(entry, pwd, buf, buflen, result);
+  pthread_mutex_unlock(&db_lock);
+
+  return err;
 }
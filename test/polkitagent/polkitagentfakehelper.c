@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* A stand-in for polkit-agent-helper-1 used by polkitagentsessiontest.
+ *
+ * It speaks the same line based protocol on stdin/stdout but never
+ * talks to the PolicyKit daemon. The behavior is selected with the
+ * FAKE_HELPER_MODE environment variable:
+ *
+ *  - "password" (default): ask for a password and report SUCCESS if it
+ *    is "secret", FAILURE otherwise
+ *  - "slow-exit": ask for a password and then take a second to exit,
+ *    whether terminated by a signal or by stdin being closed
+ *  - "silent": exit without writing anything
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static void
+slow_exit (int signum)
+{
+  sleep (1);
+  _exit (0);
+}
+
+static int
+read_line (char *buf, size_t size)
+{
+  if (fgets (buf, size, stdin) == NULL)
+    return 0;
+  buf[strcspn (buf, "\n")] = '\0';
+  return 1;
+}
+
+int
+main (int argc, char *argv[])
+{
+  const char *mode;
+  char cookie[256];
+  char response[256];
+  char out[512];
+
+  mode = getenv ("FAKE_HELPER_MODE");
+  if (mode == NULL)
+    mode = "password";
+
+  if (argc != 2)
+    return 1;
+
+  if (strcmp (mode, "silent") == 0)
+    return 0;
+
+  if (strcmp (mode, "slow-exit") == 0)
+    signal (SIGTERM, slow_exit);
+
+  if (!read_line (cookie, sizeof cookie))
+    return 1;
+
+  /* use a single write to check that the agent splits lines properly */
+  snprintf (out, sizeof out,
+            "PAM_TEXT_INFO pid=%d\n"
+            "PAM_PROMPT_ECHO_OFF Password for %s: \n",
+            (int) getpid (),
+            argv[1]);
+  if (write (STDOUT_FILENO, out, strlen (out)) < 0)
+    return 1;
+
+  if (!read_line (response, sizeof response))
+    {
+      if (strcmp (mode, "slow-exit") == 0)
+        slow_exit (0);
+      return 1;
+    }
+
+  if (strcmp (response, "secret") == 0)
+    printf ("SUCCESS\n");
+  else
+    printf ("FAILURE\n");
+  fflush (stdout);
+
+  return 0;
+}
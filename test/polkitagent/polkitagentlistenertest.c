@@ -0,0 +1,524 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "glib.h"
+
+#include <locale.h>
+#include <string.h>
+
+#include <polkit/polkit.h>
+#define POLKIT_AGENT_I_KNOW_API_IS_SUBJECT_TO_CHANGE
+#include <polkitagent/polkitagent.h>
+#include <polkittesthelper.h>
+
+/* The tests in this file run a private message bus (exported as the
+ * system bus) with a mock PolicyKit daemon that only implements agent
+ * registration. The mock daemon runs in its own thread since
+ * registration is synchronous.
+ */
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  GThread *thread;
+  GMainContext *context;
+  GMainLoop *loop;
+  GDBusConnection *connection;
+  guint registration_id;
+  guint owner_id;
+
+  GMutex lock;
+  GCond cond;
+  gboolean ready;
+  gchar *agent_name;
+  gchar *agent_object_path;
+} MockAuthority;
+
+static const gchar *mock_authority_introspection_data =
+  "<node>"
+  "  <interface name='org.freedesktop.PolicyKit1.Authority'>"
+  "    <method name='RegisterAuthenticationAgent'>"
+  "      <arg type='(sa{sv})' name='subject' direction='in'/>"
+  "      <arg type='s' name='locale' direction='in'/>"
+  "      <arg type='s' name='object_path' direction='in'/>"
+  "    </method>"
+  "    <method name='UnregisterAuthenticationAgent'>"
+  "      <arg type='(sa{sv})' name='subject' direction='in'/>"
+  "      <arg type='s' name='object_path' direction='in'/>"
+  "    </method>"
+  "  </interface>"
+  "</node>";
+
+static void
+mock_authority_handle_method_call (GDBusConnection        *connection,
+                                   const gchar            *sender,
+                                   const gchar            *object_path,
+                                   const gchar            *interface_name,
+                                   const gchar            *method_name,
+                                   GVariant               *parameters,
+                                   GDBusMethodInvocation  *invocation,
+                                   gpointer                user_data)
+{
+  MockAuthority *mock = user_data;
+
+  if (g_strcmp0 (method_name, "RegisterAuthenticationAgent") == 0)
+    {
+      const gchar *agent_object_path;
+
+      g_variant_get (parameters, "(@(sa{sv})&s&s)", NULL, NULL, &agent_object_path);
+
+      g_mutex_lock (&mock->lock);
+      g_free (mock->agent_name);
+      g_free (mock->agent_object_path);
+      mock->agent_name = g_strdup (sender);
+      mock->agent_object_path = g_strdup (agent_object_path);
+      g_mutex_unlock (&mock->lock);
+    }
+  else if (g_strcmp0 (method_name, "UnregisterAuthenticationAgent") == 0)
+    {
+      g_mutex_lock (&mock->lock);
+      g_clear_pointer (&mock->agent_name, g_free);
+      g_clear_pointer (&mock->agent_object_path, g_free);
+      g_mutex_unlock (&mock->lock);
+    }
+
+  g_dbus_method_invocation_return_value (invocation, NULL);
+}
+
+static const GDBusInterfaceVTable mock_authority_vtable =
+{
+  mock_authority_handle_method_call,
+  NULL, /* _handle_get_property */
+  NULL  /* _handle_set_property */
+};
+
+static void
+on_mock_authority_name_acquired (GDBusConnection *connection,
+                                 const gchar     *name,
+                                 gpointer         user_data)
+{
+  MockAuthority *mock = user_data;
+
+  g_mutex_lock (&mock->lock);
+  mock->ready = TRUE;
+  g_cond_signal (&mock->cond);
+  g_mutex_unlock (&mock->lock);
+}
+
+static gpointer
+mock_authority_thread_func (gpointer user_data)
+{
+  MockAuthority *mock = user_data;
+  GDBusNodeInfo *node_info;
+  GError *error = NULL;
+
+  g_main_context_push_thread_default (mock->context);
+
+  node_info = g_dbus_node_info_new_for_xml (mock_authority_introspection_data, &error);
+  g_assert_no_error (error);
+  mock->registration_id = g_dbus_connection_register_object (mock->connection,
+                                                             "/org/freedesktop/PolicyKit1/Authority",
+                                                             node_info->interfaces[0],
+                                                             &mock_authority_vtable,
+                                                             mock,
+                                                             NULL,
+                                                             &error);
+  g_assert_no_error (error);
+  g_dbus_node_info_unref (node_info);
+
+  mock->owner_id = g_bus_own_name_on_connection (mock->connection,
+                                                 "org.freedesktop.PolicyKit1",
+                                                 G_BUS_NAME_OWNER_FLAGS_NONE,
+                                                 on_mock_authority_name_acquired,
+                                                 NULL,
+                                                 mock,
+                                                 NULL);
+
+  g_main_loop_run (mock->loop);
+
+  g_bus_unown_name (mock->owner_id);
+  g_dbus_connection_unregister_object (mock->connection, mock->registration_id);
+
+  g_main_context_pop_thread_default (mock->context);
+  return NULL;
+}
+
+static MockAuthority *
+mock_authority_new (const gchar *address)
+{
+  MockAuthority *mock;
+  GError *error = NULL;
+
+  mock = g_new0 (MockAuthority, 1);
+  g_mutex_init (&mock->lock);
+  g_cond_init (&mock->cond);
+  mock->context = g_main_context_new ();
+  mock->loop = g_main_loop_new (mock->context, FALSE);
+  mock->connection = g_dbus_connection_new_for_address_sync (address,
+                                                             G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                             G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                             NULL, /* GDBusAuthObserver */
+                                                             NULL, /* GCancellable */
+                                                             &error);
+  g_assert_no_error (error);
+
+  mock->thread = g_thread_new ("mock-authority", mock_authority_thread_func, mock);
+
+  g_mutex_lock (&mock->lock);
+  while (!mock->ready)
+    g_cond_wait (&mock->cond, &mock->lock);
+  g_mutex_unlock (&mock->lock);
+
+  return mock;
+}
+
+static void
+mock_authority_free (MockAuthority *mock)
+{
+  g_main_loop_quit (mock->loop);
+  g_thread_join (mock->thread);
+  g_object_unref (mock->connection);
+  g_main_loop_unref (mock->loop);
+  g_main_context_unref (mock->context);
+  g_mutex_clear (&mock->lock);
+  g_cond_clear (&mock->cond);
+  g_free (mock->agent_name);
+  g_free (mock->agent_object_path);
+  g_free (mock);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* A listener that records every request and only completes it when told to */
+
+typedef struct
+{
+  gchar *cookie;
+  GCancellable *cancellable;
+  gulong cancel_id;
+  GSimpleAsyncResult *simple;
+  gboolean completed;
+} TestRequest;
+
+typedef struct
+{
+  PolkitAgentListener parent_instance;
+  GPtrArray *requests;
+} TestListener;
+
+typedef struct
+{
+  PolkitAgentListenerClass parent_class;
+} TestListenerClass;
+
+static GType test_listener_get_type (void);
+
+G_DEFINE_TYPE (TestListener, test_listener, POLKIT_AGENT_TYPE_LISTENER);
+
+static void
+test_request_free (TestRequest *request)
+{
+  g_cancellable_disconnect (request->cancellable, request->cancel_id);
+  g_object_unref (request->cancellable);
+  g_object_unref (request->simple);
+  g_free (request->cookie);
+  g_free (request);
+}
+
+static void
+test_request_complete (TestRequest *request,
+                       gboolean     cancelled)
+{
+  g_assert (!request->completed);
+  if (cancelled)
+    g_simple_async_result_set_error (request->simple,
+                                     POLKIT_ERROR,
+                                     POLKIT_ERROR_CANCELLED,
+                                     "Authentication was cancelled.");
+  g_simple_async_result_complete_in_idle (request->simple);
+  request->completed = TRUE;
+}
+
+static void
+on_test_request_cancelled (GCancellable *cancellable,
+                           gpointer      user_data)
+{
+  TestRequest *request = user_data;
+  test_request_complete (request, TRUE);
+}
+
+static void
+test_listener_initiate_authentication (PolkitAgentListener  *_listener,
+                                       const gchar          *action_id,
+                                       const gchar          *message,
+                                       const gchar          *icon_name,
+                                       PolkitDetails        *details,
+                                       const gchar          *cookie,
+                                       GList                *identities,
+                                       GCancellable         *cancellable,
+                                       GAsyncReadyCallback   callback,
+                                       gpointer              user_data)
+{
+  TestListener *listener = (TestListener *) _listener;
+  TestRequest *request;
+
+  request = g_new0 (TestRequest, 1);
+  request->cookie = g_strdup (cookie);
+  request->cancellable = g_object_ref (cancellable);
+  request->simple = g_simple_async_result_new (G_OBJECT (listener),
+                                               callback,
+                                               user_data,
+                                               test_listener_initiate_authentication);
+  g_ptr_array_add (listener->requests, request);
+  request->cancel_id = g_cancellable_connect (cancellable,
+                                              G_CALLBACK (on_test_request_cancelled),
+                                              request,
+                                              NULL);
+}
+
+static gboolean
+test_listener_initiate_authentication_finish (PolkitAgentListener  *_listener,
+                                              GAsyncResult         *res,
+                                              GError              **error)
+{
+  return !g_simple_async_result_propagate_error (G_SIMPLE_ASYNC_RESULT (res), error);
+}
+
+static void
+test_listener_init (TestListener *listener)
+{
+  listener->requests = g_ptr_array_new_with_free_func ((GDestroyNotify) test_request_free);
+}
+
+static void
+test_listener_finalize (GObject *object)
+{
+  TestListener *listener = (TestListener *) object;
+  g_ptr_array_unref (listener->requests);
+  G_OBJECT_CLASS (test_listener_parent_class)->finalize (object);
+}
+
+static void
+test_listener_class_init (TestListenerClass *klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  PolkitAgentListenerClass *listener_class = POLKIT_AGENT_LISTENER_CLASS (klass);
+
+  gobject_class->finalize = test_listener_finalize;
+  listener_class->initiate_authentication = test_listener_initiate_authentication;
+  listener_class->initiate_authentication_finish = test_listener_initiate_authentication_finish;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  gboolean done;
+  GError *error;
+} CallResult;
+
+static void
+call_cb (GObject      *source_object,
+         GAsyncResult *res,
+         gpointer      user_data)
+{
+  CallResult *result = user_data;
+  GVariant *value;
+
+  value = g_dbus_connection_call_finish (G_DBUS_CONNECTION (source_object), res, &result->error);
+  if (value != NULL)
+    g_variant_unref (value);
+  result->done = TRUE;
+}
+
+static void
+wait_for_call (CallResult *result)
+{
+  while (!result->done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+begin_authentication (MockAuthority *mock,
+                      const gchar   *cookie,
+                      CallResult    *result)
+{
+  GVariantBuilder details_builder;
+  GVariantBuilder identities_builder;
+  GVariantBuilder identity_builder;
+
+  g_variant_builder_init (&details_builder, G_VARIANT_TYPE ("a{ss}"));
+  g_variant_builder_init (&identity_builder, G_VARIANT_TYPE ("a{sv}"));
+  g_variant_builder_add (&identity_builder, "{sv}", "uid", g_variant_new_uint32 (0));
+  g_variant_builder_init (&identities_builder, G_VARIANT_TYPE ("a(sa{sv})"));
+  g_variant_builder_add (&identities_builder, "(sa{sv})", "unix-user", &identity_builder);
+
+  g_mutex_lock (&mock->lock);
+  g_dbus_connection_call (mock->connection,
+                          mock->agent_name,
+                          mock->agent_object_path,
+                          "org.freedesktop.PolicyKit1.AuthenticationAgent",
+                          "BeginAuthentication",
+                          g_variant_new ("(sssa{ss}sa(sa{sv}))",
+                                         "org.freedesktop.policykit.test",
+                                         "Authentication is needed for testing",
+                                         "",
+                                         &details_builder,
+                                         cookie,
+                                         &identities_builder),
+                          NULL, /* reply_type */
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL, /* GCancellable */
+                          call_cb,
+                          result);
+  g_mutex_unlock (&mock->lock);
+}
+
+static void
+cancel_authentication (MockAuthority *mock,
+                       const gchar   *cookie,
+                       CallResult    *result)
+{
+  g_mutex_lock (&mock->lock);
+  g_dbus_connection_call (mock->connection,
+                          mock->agent_name,
+                          mock->agent_object_path,
+                          "org.freedesktop.PolicyKit1.AuthenticationAgent",
+                          "CancelAuthentication",
+                          g_variant_new ("(s)", cookie),
+                          NULL, /* reply_type */
+                          G_DBUS_CALL_FLAGS_NONE,
+                          -1,
+                          NULL, /* GCancellable */
+                          call_cb,
+                          result);
+  g_mutex_unlock (&mock->lock);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static MockAuthority *mock_authority = NULL;
+
+static void
+test_concurrent_requests (void)
+{
+  TestListener *listener;
+  PolkitSubject *subject;
+  gpointer handle;
+  GError *error = NULL;
+  CallResult results[3] = {{0}};
+  CallResult duplicate = {0};
+  CallResult cancel = {0};
+  guint n;
+
+  listener = g_object_new (test_listener_get_type (), NULL);
+  subject = polkit_unix_session_new ("test-session");
+  handle = polkit_agent_listener_register (POLKIT_AGENT_LISTENER (listener),
+                                           POLKIT_AGENT_REGISTER_FLAGS_NONE,
+                                           subject,
+                                           NULL, /* object_path */
+                                           NULL, /* GCancellable */
+                                           &error);
+  g_assert_no_error (error);
+  g_assert (handle != NULL);
+  g_assert (mock_authority->agent_name != NULL);
+
+  begin_authentication (mock_authority, "cookie-0", &results[0]);
+  begin_authentication (mock_authority, "cookie-1", &results[1]);
+  begin_authentication (mock_authority, "cookie-2", &results[2]);
+
+  /* all three requests must reach the listener without any of them completing */
+  while (listener->requests->len < 3)
+    g_main_context_iteration (NULL, TRUE);
+  for (n = 0; n < 3; n++)
+    {
+      TestRequest *request = listener->requests->pdata[n];
+      gchar *expected_cookie = g_strdup_printf ("cookie-%u", n);
+      g_assert_cmpstr (request->cookie, ==, expected_cookie);
+      g_assert (!results[n].done);
+      g_free (expected_cookie);
+    }
+
+  /* a second request with a cookie that is still pending is refused */
+  begin_authentication (mock_authority, "cookie-0", &duplicate);
+  wait_for_call (&duplicate);
+  g_assert (duplicate.error != NULL);
+  g_clear_error (&duplicate.error);
+  g_assert_cmpint (listener->requests->len, ==, 3);
+
+  /* cancelling one request only affects that request */
+  cancel_authentication (mock_authority, "cookie-1", &cancel);
+  wait_for_call (&cancel);
+  g_assert_no_error (cancel.error);
+  wait_for_call (&results[1]);
+  g_assert (results[1].error != NULL);
+  g_clear_error (&results[1].error);
+  g_assert (!results[0].done);
+  g_assert (!results[2].done);
+
+  /* requests can complete in any order */
+  test_request_complete (listener->requests->pdata[2], FALSE);
+  wait_for_call (&results[2]);
+  g_assert_no_error (results[2].error);
+  g_assert (!results[0].done);
+
+  test_request_complete (listener->requests->pdata[0], FALSE);
+  wait_for_call (&results[0]);
+  g_assert_no_error (results[0].error);
+
+  polkit_agent_listener_unregister (handle);
+  g_assert (mock_authority->agent_name == NULL);
+
+  g_object_unref (subject);
+  g_object_unref (listener);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+  GTestDBus *bus;
+  gint ret;
+
+  setlocale (LC_ALL, "");
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  /* the agent library only ever talks to the system bus */
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
+  mock_authority = mock_authority_new (g_test_dbus_get_bus_address (bus));
+
+  g_test_add_func ("/PolkitAgentListener/concurrent_requests", test_concurrent_requests);
+
+  ret = g_test_run ();
+
+  mock_authority_free (mock_authority);
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  return ret;
+}
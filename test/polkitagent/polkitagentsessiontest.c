@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "glib.h"
+
+#include <errno.h>
+#include <locale.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <polkit/polkit.h>
+#define POLKIT_AGENT_I_KNOW_API_IS_SUBJECT_TO_CHANGE
+#include <polkitagent/polkitagent.h>
+
+/* The tests in this file run PolkitAgentSession against
+ * polkitagentfakehelper instead of the real (setuid) helper.
+ */
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+typedef struct
+{
+  const gchar *response;
+  GMainLoop *loop;
+  gboolean quit_on_request;
+
+  gint helper_pid;
+  guint num_requests;
+  gboolean completed;
+  gboolean gained_authorization;
+} SessionData;
+
+static void
+on_show_info (PolkitAgentSession *session,
+              const gchar        *text,
+              gpointer            user_data)
+{
+  SessionData *data = user_data;
+
+  g_assert (sscanf (text, "pid=%d", &data->helper_pid) == 1);
+}
+
+static void
+on_request (PolkitAgentSession *session,
+            const gchar        *request,
+            gboolean            echo_on,
+            gpointer            user_data)
+{
+  SessionData *data = user_data;
+
+  g_assert (g_str_has_prefix (request, "Password for "));
+  g_assert (!echo_on);
+  g_assert_cmpint (data->helper_pid, >, 0);
+
+  data->num_requests++;
+
+  if (data->quit_on_request)
+    g_main_loop_quit (data->loop);
+  else
+    polkit_agent_session_response (session, data->response);
+}
+
+static void
+on_completed (PolkitAgentSession *session,
+              gboolean            gained_authorization,
+              gpointer            user_data)
+{
+  SessionData *data = user_data;
+
+  g_assert (!data->completed);
+  data->completed = TRUE;
+  data->gained_authorization = gained_authorization;
+  if (data->loop != NULL)
+    g_main_loop_quit (data->loop);
+}
+
+static PolkitAgentSession *
+session_new (SessionData *data)
+{
+  PolkitAgentSession *session;
+  PolkitIdentity *identity;
+
+  identity = polkit_unix_user_new (getuid ());
+  session = g_object_new (POLKIT_AGENT_TYPE_SESSION,
+                          "identity", identity,
+                          "cookie", "cookie",
+                          "helper-path", POLKIT_AGENT_FAKE_HELPER,
+                          NULL);
+  g_object_unref (identity);
+
+  g_signal_connect (session, "show-info", G_CALLBACK (on_show_info), data);
+  g_signal_connect (session, "request", G_CALLBACK (on_request), data);
+  g_signal_connect (session, "completed", G_CALLBACK (on_completed), data);
+
+  return session;
+}
+
+static gboolean
+child_is_reaped (gint pid)
+{
+  siginfo_t info;
+
+  /* WNOWAIT so we don't reap the child ourselves */
+  memset (&info, 0, sizeof info);
+  if (waitid (P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT) == -1)
+    {
+      g_assert_cmpint (errno, ==, ECHILD);
+      return TRUE;
+    }
+  return FALSE;
+}
+
+static gboolean
+child_is_running (gint pid)
+{
+  siginfo_t info;
+
+  memset (&info, 0, sizeof info);
+  g_assert_cmpint (waitid (P_PID, pid, &info, WEXITED | WNOHANG | WNOWAIT), ==, 0);
+  return info.si_pid == 0;
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+  g_error ("Timed out");
+  return FALSE;
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+run_session (const gchar *response,
+             gboolean     expected_result)
+{
+  PolkitAgentSession *session;
+  SessionData data;
+  guint timeout_id;
+
+  memset (&data, 0, sizeof data);
+  data.response = response;
+  data.loop = g_main_loop_new (NULL, FALSE);
+
+  session = session_new (&data);
+  timeout_id = g_timeout_add_seconds (10, on_timeout, NULL);
+  polkit_agent_session_initiate (session);
+  g_main_loop_run (data.loop);
+  g_source_remove (timeout_id);
+
+  g_assert_cmpuint (data.num_requests, ==, 1);
+  g_assert (data.completed);
+  g_assert (data.gained_authorization == expected_result);
+
+  /* the helper is reaped from the main loop */
+  while (!child_is_reaped (data.helper_pid))
+    g_main_context_iteration (NULL, TRUE);
+
+  g_object_unref (session);
+  g_main_loop_unref (data.loop);
+}
+
+static void
+test_success (void)
+{
+  g_setenv ("FAKE_HELPER_MODE", "password", TRUE);
+  run_session ("secret", TRUE);
+}
+
+static void
+test_failure (void)
+{
+  g_setenv ("FAKE_HELPER_MODE", "password", TRUE);
+  run_session ("wrong", FALSE);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+test_helper_without_output (void)
+{
+  PolkitAgentSession *session;
+  SessionData data;
+  guint timeout_id;
+
+  g_setenv ("FAKE_HELPER_MODE", "silent", TRUE);
+
+  memset (&data, 0, sizeof data);
+  data.loop = g_main_loop_new (NULL, FALSE);
+
+  session = session_new (&data);
+  timeout_id = g_timeout_add_seconds (10, on_timeout, NULL);
+  g_test_expect_message (NULL, G_LOG_LEVEL_WARNING, "Error reading line from helper: nothing to read");
+  polkit_agent_session_initiate (session);
+  g_main_loop_run (data.loop);
+  g_test_assert_expected_messages ();
+  g_source_remove (timeout_id);
+
+  g_assert_cmpuint (data.num_requests, ==, 0);
+  g_assert (data.completed);
+  g_assert (!data.gained_authorization);
+
+  g_object_unref (session);
+  g_main_loop_unref (data.loop);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+/* Cancelling must not wait for the helper to exit */
+static void
+test_cancel_does_not_block (void)
+{
+  PolkitAgentSession *session;
+  SessionData data;
+  guint timeout_id;
+  gint64 begin;
+
+  g_setenv ("FAKE_HELPER_MODE", "slow-exit", TRUE);
+
+  memset (&data, 0, sizeof data);
+  data.loop = g_main_loop_new (NULL, FALSE);
+  data.quit_on_request = TRUE;
+
+  session = session_new (&data);
+  timeout_id = g_timeout_add_seconds (10, on_timeout, NULL);
+  polkit_agent_session_initiate (session);
+  g_main_loop_run (data.loop);
+  g_assert_cmpuint (data.num_requests, ==, 1);
+
+  begin = g_get_monotonic_time ();
+  polkit_agent_session_cancel (session);
+  g_object_unref (session);
+  g_assert_cmpint (g_get_monotonic_time () - begin, <, G_USEC_PER_SEC / 2);
+
+  g_assert (data.completed);
+  g_assert (!data.gained_authorization);
+
+  /* the helper takes a second to exit and is reaped even though the
+   * session is gone
+   */
+  g_assert (child_is_running (data.helper_pid));
+  while (!child_is_reaped (data.helper_pid))
+    g_main_context_iteration (NULL, TRUE);
+  g_source_remove (timeout_id);
+
+  g_main_loop_unref (data.loop);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+#define NUM_CONCURRENT_SESSIONS 32
+
+static void
+test_concurrent_sessions (void)
+{
+  PolkitAgentSession *sessions[NUM_CONCURRENT_SESSIONS];
+  SessionData data[NUM_CONCURRENT_SESSIONS];
+  guint timeout_id;
+  guint num_completed;
+  guint n;
+
+  g_setenv ("FAKE_HELPER_MODE", "password", TRUE);
+
+  timeout_id = g_timeout_add_seconds (30, on_timeout, NULL);
+
+  memset (data, 0, sizeof data);
+  for (n = 0; n < NUM_CONCURRENT_SESSIONS; n++)
+    {
+      data[n].response = n % 2 == 0 ? "secret" : "wrong";
+      sessions[n] = session_new (&data[n]);
+      polkit_agent_session_initiate (sessions[n]);
+    }
+
+  do
+    {
+      g_main_context_iteration (NULL, TRUE);
+      num_completed = 0;
+      for (n = 0; n < NUM_CONCURRENT_SESSIONS; n++)
+        if (data[n].completed)
+          num_completed++;
+    }
+  while (num_completed < NUM_CONCURRENT_SESSIONS);
+
+  for (n = 0; n < NUM_CONCURRENT_SESSIONS; n++)
+    {
+      g_assert_cmpuint (data[n].num_requests, ==, 1);
+      g_assert (data[n].gained_authorization == (n % 2 == 0));
+      g_object_unref (sessions[n]);
+    }
+
+  for (n = 0; n < NUM_CONCURRENT_SESSIONS; n++)
+    {
+      while (!child_is_reaped (data[n].helper_pid))
+        g_main_context_iteration (NULL, TRUE);
+    }
+
+  g_source_remove (timeout_id);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/PolkitAgentSession/success", test_success);
+  g_test_add_func ("/PolkitAgentSession/failure", test_failure);
+  g_test_add_func ("/PolkitAgentSession/helper_without_output", test_helper_without_output);
+  g_test_add_func ("/PolkitAgentSession/cancel_does_not_block", test_cancel_does_not_block);
+  g_test_add_func ("/PolkitAgentSession/concurrent_sessions", test_concurrent_sessions);
+
+  return g_test_run ();
+}
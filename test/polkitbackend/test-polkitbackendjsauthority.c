@@ -26,9 +26,13 @@
 
 #include <locale.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
 
 #include <polkit/polkit.h>
 #include <polkitbackend/polkitbackendjsauthority.h>
+#include <polkitbackend/polkitbackendfakesessions.h>
 #include <polkittesthelper.h>
 
 /* see test/data/etc/polkit-1/rules.d/10-testing.rules */
@@ -38,7 +42,7 @@
 static PolkitBackendJsAuthority *get_authority (void);
 
 static PolkitBackendJsAuthority *
-get_authority (void)
+get_authority_for_sessions (PolkitBackendFakeSessions *sessions)
 {
   gchar *rules_dirs[3] = {0};
   PolkitBackendJsAuthority *authority;
@@ -51,12 +55,19 @@ get_authority (void)
 
   authority = g_object_new (POLKIT_BACKEND_TYPE_JS_AUTHORITY,
                             "rules-dirs", rules_dirs,
+                            "fake-sessions", sessions,
                             NULL);
   g_free (rules_dirs[0]);
   g_free (rules_dirs[1]);
   return authority;
 }
 
+static PolkitBackendJsAuthority *
+get_authority (void)
+{
+  return get_authority_for_sessions (NULL);
+}
+
 
 static void
 test_get_admin_identities_for_action_id (const gchar         *action_id,
@@ -314,6 +325,15 @@ static const RulesTestCase rules_test_cases[] = {
     POLKIT_IMPLICIT_AUTHORIZATION_AUTHORIZED,
   },
 
+  /* polkit.cache */
+  {
+    "cache",
+    "net.company.cache",
+    "unix-user:root",
+    NULL,
+    POLKIT_IMPLICIT_AUTHORIZATION_AUTHORIZED,
+  },
+
   /* runaway scripts */
   {
     "runaway_script",
@@ -398,17 +418,872 @@ add_rules_tests (void)
 
 /* ---------------------------------------------------------------------------------------------------- */
 
+static GVariant *
+get_statistics (PolkitBackendJsAuthority *authority)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+  polkit_backend_authority_add_statistics (POLKIT_BACKEND_AUTHORITY (authority), &builder);
+  return g_variant_ref_sink (g_variant_builder_end (&builder));
+}
+
+static void
+test_statistics (void)
+{
+  PolkitBackendJsAuthority *authority;
+  GVariant *statistics;
+  guint64 value;
+  guint32 count;
+  gboolean initialized;
+
+  authority = get_authority ();
+
+  /* the JS environment is only set up when first needed */
+  statistics = get_statistics (authority);
+  g_assert (g_variant_lookup (statistics, "js-initialized", "b", &initialized));
+  g_assert (!initialized);
+  g_assert (g_variant_lookup (statistics, "memory-js-heap-bytes", "t", &value));
+  g_assert_cmpuint (value, ==, 0);
+  g_variant_unref (statistics);
+
+  polkit_backend_js_authority_initialize (authority);
+  statistics = get_statistics (authority);
+  g_assert (g_variant_lookup (statistics, "js-initialized", "b", &initialized));
+  g_assert (initialized);
+  g_assert (g_variant_lookup (statistics, "memory-js-heap-bytes", "t", &value));
+  g_assert_cmpuint (value, >, 0);
+  g_assert (g_variant_lookup (statistics, "js-heap-limit-bytes", "t", &value));
+  g_assert_cmpuint (value, ==, 8 * 1024 * 1024);
+  g_assert (g_variant_lookup (statistics, "memory-actions-bytes", "t", &value));
+  g_assert (g_variant_lookup (statistics, "memory-agents-bytes", "t", &value));
+  g_assert (g_variant_lookup (statistics, "agents", "u", &count));
+  g_assert_cmpuint (count, ==, 0);
+  g_assert (g_variant_lookup (statistics, "memory-temporary-authorizations-bytes", "t", &value));
+  g_assert (g_variant_lookup (statistics, "temporary-authorizations", "u", &count));
+  g_assert_cmpuint (count, ==, 0);
+  g_assert (g_variant_lookup (statistics, "rules-cache-entries", "u", &count));
+  g_assert_cmpuint (count, ==, 0);
+  g_variant_unref (statistics);
+
+  polkit_backend_js_authority_set_heap_limit (authority, 4 * 1024 * 1024);
+  polkit_backend_interactive_authority_set_temporary_authorization_limit (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                          64 * 1024);
+  statistics = get_statistics (authority);
+  g_assert (g_variant_lookup (statistics, "js-heap-limit-bytes", "t", &value));
+  g_assert_cmpuint (value, ==, 4 * 1024 * 1024);
+  g_assert (g_variant_lookup (statistics, "temporary-authorizations-limit-bytes", "t", &value));
+  g_assert_cmpuint (value, ==, 64 * 1024);
+  g_variant_unref (statistics);
+
+  g_object_unref (authority);
+}
+
+static void
+test_finalize_while_compiling (void)
+{
+  PolkitBackendJsAuthority *authority;
+
+  /* the rules being compiled are thrown away without running them */
+  authority = get_authority ();
+  polkit_backend_js_authority_start_initialize (authority);
+  g_object_unref (authority);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
+static void
+on_check_authorization_cb (GObject      *source_object,
+                           GAsyncResult *res,
+                           gpointer      user_data)
+{
+  GError **error = user_data;
+  PolkitAuthorizationResult *result;
+
+  result = polkit_backend_authority_check_authorization_finish (POLKIT_BACKEND_AUTHORITY (source_object),
+                                                                res,
+                                                                error);
+  g_assert (result == NULL);
+}
+
+static void
+test_check_deadline (void)
+{
+  PolkitBackendJsAuthority *authority;
+  PolkitSubject *caller;
+  PolkitDetails *details;
+  GVariant *statistics;
+  GError *error;
+  guint64 value;
+
+  authority = get_authority ();
+  caller = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+
+  /* a deadline in the past, the check is abandoned before doing anything */
+  details = polkit_details_new ();
+  polkit_details_insert (details, "polkit.deadline", "1");
+
+  error = NULL;
+  polkit_backend_authority_check_authorization (POLKIT_BACKEND_AUTHORITY (authority),
+                                                caller,
+                                                caller,
+                                                "net.company.productignored",
+                                                details,
+                                                POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE,
+                                                NULL, /* GCancellable* */
+                                                on_check_authorization_cb,
+                                                &error);
+  g_assert_error (error, POLKIT_ERROR, POLKIT_ERROR_CANCELLED);
+  g_error_free (error);
+  g_object_unref (details);
+
+  /* a malformed deadline is rejected */
+  details = polkit_details_new ();
+  polkit_details_insert (details, "polkit.deadline", "soon");
+
+  error = NULL;
+  polkit_backend_authority_check_authorization (POLKIT_BACKEND_AUTHORITY (authority),
+                                                caller,
+                                                caller,
+                                                "net.company.productignored",
+                                                details,
+                                                POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE,
+                                                NULL, /* GCancellable* */
+                                                on_check_authorization_cb,
+                                                &error);
+  g_assert_error (error, POLKIT_ERROR, POLKIT_ERROR_FAILED);
+  g_error_free (error);
+
+  statistics = get_statistics (authority);
+  g_assert (g_variant_lookup (statistics, "checks-abandoned-deadline", "t", &value));
+  g_assert_cmpuint (value, ==, 1);
+  g_assert (g_variant_lookup (statistics, "checks-abandoned-caller-vanished", "t", &value));
+  g_assert_cmpuint (value, ==, 0);
+  g_variant_unref (statistics);
+
+  g_object_unref (details);
+  g_object_unref (caller);
+  g_object_unref (authority);
+}
+
+static void
+test_check_caller_vanished (void)
+{
+  PolkitBackendJsAuthority *authority;
+  GDBusConnection *connection;
+  PolkitSubject *caller;
+  PolkitSubject *subject;
+  GVariant *statistics;
+  gchar *address;
+  GError *error;
+  guint64 value;
+
+  authority = get_authority ();
+
+  error = NULL;
+  address = g_dbus_address_get_for_bus_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+  g_assert_no_error (error);
+  connection = g_dbus_connection_new_for_address_sync (address,
+                                                       G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                                       G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                                       NULL, /* GDBusAuthObserver */
+                                                       NULL, /* GCancellable */
+                                                       &error);
+  g_assert_no_error (error);
+
+  caller = polkit_system_bus_name_new (g_dbus_connection_get_unique_name (connection));
+  subject = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+
+  /* the check has to wait for the slow name service */
+  g_setenv ("MOCK_LATENCY_USEC", "500000", TRUE);
+
+  polkit_backend_authority_check_authorization (POLKIT_BACKEND_AUTHORITY (authority),
+                                                caller,
+                                                subject,
+                                                "net.company.productignored",
+                                                NULL, /* details */
+                                                POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE,
+                                                NULL, /* GCancellable* */
+                                                on_check_authorization_cb,
+                                                &error);
+  g_assert_no_error (error);
+
+  /* the caller goes away while the user of the subject is looked up */
+  g_dbus_connection_close_sync (connection, NULL, &error);
+  g_assert_no_error (error);
+
+  while (error == NULL)
+    g_main_context_iteration (NULL, TRUE);
+  g_unsetenv ("MOCK_LATENCY_USEC");
+  g_assert_error (error, POLKIT_ERROR, POLKIT_ERROR_CANCELLED);
+  g_error_free (error);
+
+  statistics = get_statistics (authority);
+  g_assert (g_variant_lookup (statistics, "checks-abandoned-caller-vanished", "t", &value));
+  g_assert_cmpuint (value, ==, 1);
+  g_variant_unref (statistics);
+
+  g_object_unref (subject);
+  g_object_unref (caller);
+  g_object_unref (connection);
+  g_free (address);
+  g_object_unref (authority);
+}
+
+static void
+test_idle_time (void)
+{
+  PolkitBackendJsAuthority *authority;
+  PolkitSubject *caller;
+  gint64 idle_usec;
+
+  authority = get_authority ();
+  caller = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+
+  /* no agents or temporary authorizations, so it is idle from the start */
+  g_usleep (G_USEC_PER_SEC / 10);
+  idle_usec = polkit_backend_authority_get_idle_time (POLKIT_BACKEND_AUTHORITY (authority));
+  g_assert_cmpint (idle_usec, >=, G_USEC_PER_SEC / 10);
+
+  /* any request restarts the idle time */
+  polkit_backend_authority_check_authorization (POLKIT_BACKEND_AUTHORITY (authority),
+                                                caller,
+                                                caller,
+                                                "net.company.productignored",
+                                                NULL, /* details */
+                                                POLKIT_CHECK_AUTHORIZATION_FLAGS_NONE,
+                                                NULL, /* GCancellable* */
+                                                NULL,
+                                                NULL);
+  idle_usec = polkit_backend_authority_get_idle_time (POLKIT_BACKEND_AUTHORITY (authority));
+  g_assert_cmpint (idle_usec, >=, 0);
+  g_assert_cmpint (idle_usec, <, G_USEC_PER_SEC / 10);
+
+  g_object_unref (caller);
+  g_object_unref (authority);
+}
+
+static guint32
+get_num_temporary_authorizations (PolkitBackendJsAuthority *authority)
+{
+  GVariant *statistics;
+  guint32 count;
+
+  statistics = get_statistics (authority);
+  g_assert (g_variant_lookup (statistics, "temporary-authorizations", "u", &count));
+  g_variant_unref (statistics);
+
+  return count;
+}
+
+static void
+test_temporary_authorizations_file (void)
+{
+  PolkitBackendJsAuthority *authority;
+  PolkitSubject *process;
+  GVariantBuilder builder;
+  GVariant *value;
+  GError *error;
+  gchar *dir;
+  gchar *path;
+  gchar *saved_path;
+  gchar *process_str;
+  gchar *reused_str;
+  struct stat statbuf;
+  guint num_restored;
+  gint64 now;
+
+  error = NULL;
+  dir = g_dir_make_tmp ("polkit-test-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "temporary-authorizations", NULL);
+  saved_path = g_build_filename (dir, "saved", NULL);
+
+  process = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+  process_str = polkit_subject_to_string (process);
+  reused_str = g_strdup_printf ("unix-process:%d:1", (gint) getpid ());
+  now = g_get_real_time ();
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssssxx)"));
+  g_variant_builder_add (&builder, "(ssssxx)", "tmpauthz7", process_str, "unix-session:c1",
+                         "net.company.productignored", now - G_USEC_PER_SEC, now + 60 * G_USEC_PER_SEC);
+  /* expired */
+  g_variant_builder_add (&builder, "(ssssxx)", "tmpauthz8", process_str, "unix-session:c1",
+                         "net.company.group.only_group_users", now - 600 * G_USEC_PER_SEC, now - G_USEC_PER_SEC);
+  /* the pid has been reused by another process */
+  g_variant_builder_add (&builder, "(ssssxx)", "tmpauthz9", reused_str, "unix-session:c1",
+                         "net.company.productignored", now - G_USEC_PER_SEC, now + 60 * G_USEC_PER_SEC);
+  value = g_variant_ref_sink (g_variant_new ("(u@a(ssssxx))", 1, g_variant_builder_end (&builder)));
+  g_file_set_contents (path, g_variant_get_data (value), g_variant_get_size (value), &error);
+  g_assert_no_error (error);
+  g_variant_unref (value);
+
+  /* refuses to load a file others could have written */
+  g_assert_cmpint (g_chmod (path, 0666), ==, 0);
+  authority = get_authority ();
+  g_assert (!polkit_backend_interactive_authority_load_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                                 path,
+                                                                                 &num_restored,
+                                                                                 &error));
+  g_assert_error (error, POLKIT_ERROR, POLKIT_ERROR_FAILED);
+  g_clear_error (&error);
+  g_assert_cmpuint (get_num_temporary_authorizations (authority), ==, 0);
+
+  g_assert_cmpint (g_chmod (path, 0600), ==, 0);
+  g_assert (polkit_backend_interactive_authority_load_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                                path,
+                                                                                &num_restored,
+                                                                                &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (num_restored, ==, 1);
+  g_assert_cmpuint (get_num_temporary_authorizations (authority), ==, 1);
+
+  g_assert (polkit_backend_interactive_authority_save_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                                saved_path,
+                                                                                &error));
+  g_assert_no_error (error);
+  g_assert_cmpint (g_stat (saved_path, &statbuf), ==, 0);
+  g_assert_cmpint (statbuf.st_mode & 0777, ==, 0600);
+  g_object_unref (authority);
+
+  /* what was saved can be restored by the next instance */
+  authority = get_authority ();
+  g_assert (polkit_backend_interactive_authority_load_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                                saved_path,
+                                                                                &num_restored,
+                                                                                &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (num_restored, ==, 1);
+  g_assert_cmpuint (get_num_temporary_authorizations (authority), ==, 1);
+  g_object_unref (authority);
+
+  /* a missing file just means nothing was saved */
+  g_unlink (saved_path);
+  authority = get_authority ();
+  g_assert (polkit_backend_interactive_authority_load_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                                saved_path,
+                                                                                &num_restored,
+                                                                                &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (num_restored, ==, 0);
+  g_object_unref (authority);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (reused_str);
+  g_free (process_str);
+  g_object_unref (process);
+  g_free (saved_path);
+  g_free (path);
+  g_free (dir);
+}
+
+static gint
+sort_ids (gconstpointer a,
+          gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+/* Returns the sorted ids of the temporary authorizations in @session
+ * matching @options, separated by commas
+ */
+static gchar *
+enumerate_temporary_authorization_ids (PolkitBackendJsAuthority *authority,
+                                       PolkitSubject            *caller,
+                                       PolkitSubject            *session,
+                                       GVariant                 *options)
+{
+  GList *authorizations;
+  GList *l;
+  GPtrArray *ids;
+  GError *error;
+  gchar *ret;
+
+  error = NULL;
+  authorizations = polkit_backend_authority_enumerate_temporary_authorizations (POLKIT_BACKEND_AUTHORITY (authority),
+                                                                               caller,
+                                                                               session,
+                                                                               options,
+                                                                               &error);
+  g_assert_no_error (error);
+
+  ids = g_ptr_array_new_with_free_func (g_free);
+  for (l = authorizations; l != NULL; l = l->next)
+    g_ptr_array_add (ids, g_strdup (polkit_temporary_authorization_get_id (POLKIT_TEMPORARY_AUTHORIZATION (l->data))));
+  g_ptr_array_sort (ids, (GCompareFunc) sort_ids);
+  g_ptr_array_add (ids, NULL);
+  ret = g_strjoinv (",", (gchar **) ids->pdata);
+
+  g_ptr_array_unref (ids);
+  g_list_foreach (authorizations, (GFunc) g_object_unref, NULL);
+  g_list_free (authorizations);
+  return ret;
+}
+
+static void
+check_temporary_authorization_ids (PolkitBackendJsAuthority *authority,
+                                   PolkitSubject            *caller,
+                                   PolkitSubject            *session,
+                                   GVariant                 *options,
+                                   const gchar              *expected_ids)
+{
+  gchar *ids;
+
+  if (options != NULL)
+    g_variant_ref_sink (options);
+  ids = enumerate_temporary_authorization_ids (authority, caller, session, options);
+  g_assert_cmpstr (ids, ==, expected_ids);
+  g_free (ids);
+  if (options != NULL)
+    g_variant_unref (options);
+}
+
+static void
+revoke_temporary_authorizations (PolkitBackendJsAuthority *authority,
+                                 PolkitSubject            *caller,
+                                 PolkitSubject            *session,
+                                 GVariant                 *options)
+{
+  GError *error;
+
+  if (options != NULL)
+    g_variant_ref_sink (options);
+  error = NULL;
+  g_assert (polkit_backend_authority_revoke_temporary_authorizations (POLKIT_BACKEND_AUTHORITY (authority),
+                                                                      caller,
+                                                                      session,
+                                                                      options,
+                                                                      &error));
+  g_assert_no_error (error);
+  if (options != NULL)
+    g_variant_unref (options);
+}
+
+static void
+test_temporary_authorization_filters (void)
+{
+  PolkitBackendFakeSessions *sessions;
+  PolkitBackendJsAuthority *authority;
+  PolkitSubject *process;
+  PolkitSubject *parent;
+  PolkitSubject *session;
+  PolkitSubject *other_session;
+  GVariantBuilder builder;
+  GVariant *value;
+  GError *error;
+  GList *authorizations;
+  gchar *dir;
+  gchar *path;
+  gchar *process_str;
+  gchar *parent_str;
+  guint num_restored;
+  gint64 now;
+
+  error = NULL;
+  dir = g_dir_make_tmp ("polkit-test-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "temporary-authorizations", NULL);
+
+  process = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+  parent = polkit_unix_process_new_for_owner (getppid (), 0, getuid ());
+  session = polkit_unix_session_new ("c1");
+  other_session = polkit_unix_session_new ("c2");
+  process_str = polkit_subject_to_string (process);
+  parent_str = polkit_subject_to_string (parent);
+  now = g_get_real_time ();
+
+  /* two authorizations obtained by this process, one of them long ago, and one by its parent */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(ssssxx)"));
+  g_variant_builder_add (&builder, "(ssssxx)", "tmpauthz1", process_str, "unix-session:c1",
+                         "net.company.productignored", now - G_USEC_PER_SEC, now + 60 * G_USEC_PER_SEC);
+  g_variant_builder_add (&builder, "(ssssxx)", "tmpauthz2", process_str, "unix-session:c1",
+                         "net.company.group.only_group_users", now - 600 * G_USEC_PER_SEC, now + 60 * G_USEC_PER_SEC);
+  g_variant_builder_add (&builder, "(ssssxx)", "tmpauthz3", parent_str, "unix-session:c1",
+                         "net.company.productignored", now - G_USEC_PER_SEC, now + 60 * G_USEC_PER_SEC);
+  value = g_variant_ref_sink (g_variant_new ("(u@a(ssssxx))", 1, g_variant_builder_end (&builder)));
+  g_file_set_contents (path, g_variant_get_data (value), g_variant_get_size (value), &error);
+  g_assert_no_error (error);
+  g_variant_unref (value);
+  g_assert_cmpint (g_chmod (path, 0600), ==, 0);
+
+  /* the caller has to be in the session it asks about */
+  sessions = polkit_backend_fake_sessions_new ();
+  polkit_backend_fake_sessions_add_session (sessions, "c1", getuid (), "seat0", TRUE);
+  polkit_backend_fake_sessions_add_session (sessions, "c2", getuid (), NULL, FALSE);
+  polkit_backend_fake_sessions_add_process (sessions, getpid (), "c1");
+
+  authority = get_authority_for_sessions (sessions);
+  g_assert (polkit_backend_interactive_authority_load_temporary_authorizations (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                                                path,
+                                                                                &num_restored,
+                                                                                &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (num_restored, ==, 3);
+
+  /* no filter, either without options or with empty ones */
+  check_temporary_authorization_ids (authority, process, session, NULL,
+                                     "tmpauthz1,tmpauthz2,tmpauthz3");
+  check_temporary_authorization_ids (authority, process, session, g_variant_new ("a{sv}", NULL),
+                                     "tmpauthz1,tmpauthz2,tmpauthz3");
+
+  /* unknown keys are ignored */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "no-such-filter", g_variant_new_string ("net.company.group."));
+  check_temporary_authorization_ids (authority, process, session, g_variant_builder_end (&builder),
+                                     "tmpauthz1,tmpauthz2,tmpauthz3");
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "action-id-prefix", g_variant_new_string ("net.company.group."));
+  check_temporary_authorization_ids (authority, process, session, g_variant_builder_end (&builder),
+                                     "tmpauthz2");
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "action-id-prefix", g_variant_new_string ("org.freedesktop."));
+  check_temporary_authorization_ids (authority, process, session, g_variant_builder_end (&builder),
+                                     "");
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "subject", polkit_subject_to_gvariant (parent));
+  check_temporary_authorization_ids (authority, process, session, g_variant_builder_end (&builder),
+                                     "tmpauthz3");
+
+  /* restored authorizations were granted at most their lifetime ago */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "max-age", g_variant_new_uint64 (60));
+  check_temporary_authorization_ids (authority, process, session, g_variant_builder_end (&builder),
+                                     "tmpauthz1,tmpauthz3");
+
+  /* all filters have to match */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "action-id-prefix", g_variant_new_string ("net.company.productignored"));
+  g_variant_builder_add (&builder, "{sv}", "subject", polkit_subject_to_gvariant (process));
+  check_temporary_authorization_ids (authority, process, session, g_variant_builder_end (&builder),
+                                     "tmpauthz1");
+
+  authorizations = polkit_backend_authority_enumerate_temporary_authorizations (POLKIT_BACKEND_AUTHORITY (authority),
+                                                                               process,
+                                                                               other_session,
+                                                                               NULL,
+                                                                               &error);
+  g_assert_error (error, POLKIT_ERROR, POLKIT_ERROR_FAILED);
+  g_assert (authorizations == NULL);
+  g_clear_error (&error);
+
+  /* revoking only removes what matches */
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "action-id-prefix", g_variant_new_string ("net.company.group."));
+  revoke_temporary_authorizations (authority, process, session, g_variant_builder_end (&builder));
+  check_temporary_authorization_ids (authority, process, session, NULL, "tmpauthz1,tmpauthz3");
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  g_variant_builder_add (&builder, "{sv}", "subject", polkit_subject_to_gvariant (parent));
+  revoke_temporary_authorizations (authority, process, session, g_variant_builder_end (&builder));
+  check_temporary_authorization_ids (authority, process, session, NULL, "tmpauthz1");
+
+  revoke_temporary_authorizations (authority, process, session, NULL);
+  check_temporary_authorization_ids (authority, process, session, NULL, "");
+  g_assert_cmpuint (get_num_temporary_authorizations (authority), ==, 0);
+
+  g_object_unref (authority);
+  g_object_unref (sessions);
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (parent_str);
+  g_free (process_str);
+  g_object_unref (other_session);
+  g_object_unref (session);
+  g_object_unref (parent);
+  g_object_unref (process);
+  g_free (path);
+  g_free (dir);
+}
+
+static const gchar preload_test_policy[] =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<policyconfig>\n"
+  "  <action id=\"net.company.preload.one\">\n"
+  "    <description>One</description>\n"
+  "    <message>One</message>\n"
+  "    <defaults><allow_active>yes</allow_active></defaults>\n"
+  "  </action>\n"
+  "  <action id=\"net.company.preload.two\">\n"
+  "    <description>Two</description>\n"
+  "    <message>Two</message>\n"
+  "    <defaults><allow_active>auth_admin</allow_active></defaults>\n"
+  "  </action>\n"
+  "</policyconfig>\n";
+
+static void
+on_actions_preloaded (GObject      *source_object,
+                      GAsyncResult *res,
+                      gpointer      user_data)
+{
+  guint *num_actions = user_data;
+
+  *num_actions = polkit_backend_interactive_authority_preload_actions_finish (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (source_object),
+                                                                              res);
+}
+
+static void
+test_preload_actions (void)
+{
+  PolkitBackendJsAuthority *authority;
+  GVariant *statistics;
+  GError *error;
+  gchar *rules_dirs[2] = {0};
+  gchar *dir;
+  gchar *path;
+  guint num_actions;
+  guint32 count;
+
+  error = NULL;
+  dir = g_dir_make_tmp ("polkit-test-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "net.company.preload.policy", NULL);
+  g_file_set_contents (path, preload_test_policy, -1, &error);
+  g_assert_no_error (error);
+
+  rules_dirs[0] = polkit_test_get_data_path ("etc/polkit-1/rules.d");
+  authority = g_object_new (POLKIT_BACKEND_TYPE_JS_AUTHORITY,
+                            "rules-dirs", rules_dirs,
+                            "actions-dir", dir,
+                            NULL);
+
+  num_actions = G_MAXUINT;
+  polkit_backend_interactive_authority_preload_actions (POLKIT_BACKEND_INTERACTIVE_AUTHORITY (authority),
+                                                        on_actions_preloaded,
+                                                        &num_actions);
+  while (num_actions == G_MAXUINT)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert_cmpuint (num_actions, ==, 2);
+
+  statistics = get_statistics (authority);
+  g_assert (g_variant_lookup (statistics, "actions", "u", &count));
+  g_assert_cmpuint (count, ==, 2);
+  g_variant_unref (statistics);
+
+  g_object_unref (authority);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (rules_dirs[0]);
+  g_free (path);
+  g_free (dir);
+}
+
+static const gchar paging_test_policy[] =
+  "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+  "<policyconfig>\n"
+  "  <action id=\"net.company.other\">\n"
+  "    <description>Other</description>\n"
+  "    <message>Other</message>\n"
+  "    <defaults><allow_active>yes</allow_active></defaults>\n"
+  "  </action>\n"
+  "  <action id=\"net.company.paging.a\">\n"
+  "    <description>A</description>\n"
+  "    <message>A</message>\n"
+  "    <defaults><allow_active>yes</allow_active></defaults>\n"
+  "  </action>\n"
+  "  <action id=\"net.company.paging.b\">\n"
+  "    <description>B</description>\n"
+  "    <message>B</message>\n"
+  "    <defaults><allow_active>yes</allow_active></defaults>\n"
+  "    <annotate key=\"net.company.paging.tagged\">true</annotate>\n"
+  "  </action>\n"
+  "  <action id=\"net.company.paging.c\">\n"
+  "    <description>C</description>\n"
+  "    <message>C</message>\n"
+  "    <defaults><allow_active>yes</allow_active></defaults>\n"
+  "  </action>\n"
+  "  <action id=\"net.company.paging.d\">\n"
+  "    <description>D</description>\n"
+  "    <message>D</message>\n"
+  "    <defaults><allow_active>yes</allow_active></defaults>\n"
+  "    <annotate key=\"net.company.paging.tagged\">true</annotate>\n"
+  "  </action>\n"
+  "  <action id=\"net.company.paging.e\">\n"
+  "    <description>E</description>\n"
+  "    <message>E</message>\n"
+  "    <defaults><allow_active>yes</allow_active></defaults>\n"
+  "  </action>\n"
+  "</policyconfig>\n";
+
+/* Returns the ids of the actions the authority returns for the given
+ * filters, in the order returned and separated by commas
+ */
+static gchar *
+enumerate_action_ids (PolkitBackendJsAuthority *authority,
+                      const gchar              *action_id_prefix,
+                      gboolean                  tagged,
+                      const gchar              *start_after,
+                      guint32                   limit)
+{
+  PolkitSubject *caller;
+  GVariantBuilder builder;
+  GVariant *options;
+  GList *actions;
+  GList *l;
+  GString *str;
+  GError *error;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+  if (action_id_prefix != NULL)
+    g_variant_builder_add (&builder, "{sv}", "action-id-prefix", g_variant_new_string (action_id_prefix));
+  if (tagged)
+    {
+      GVariantBuilder annotations_builder;
+
+      g_variant_builder_init (&annotations_builder, G_VARIANT_TYPE ("a{ss}"));
+      g_variant_builder_add (&annotations_builder, "{ss}", "net.company.paging.tagged", "true");
+      g_variant_builder_add (&builder, "{sv}", "annotations", g_variant_builder_end (&annotations_builder));
+    }
+  if (start_after != NULL)
+    g_variant_builder_add (&builder, "{sv}", "start-after", g_variant_new_string (start_after));
+  g_variant_builder_add (&builder, "{sv}", "limit", g_variant_new_uint32 (limit));
+  options = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  caller = polkit_unix_process_new_for_owner (getpid (), 0, getuid ());
+  error = NULL;
+  actions = polkit_backend_authority_enumerate_actions (POLKIT_BACKEND_AUTHORITY (authority),
+                                                        caller,
+                                                        "C",
+                                                        options,
+                                                        &error);
+  g_assert_no_error (error);
+
+  str = g_string_new (NULL);
+  for (l = actions; l != NULL; l = l->next)
+    {
+      if (str->len > 0)
+        g_string_append_c (str, ',');
+      g_string_append (str, polkit_action_description_get_action_id (POLKIT_ACTION_DESCRIPTION (l->data)));
+    }
+
+  g_list_foreach (actions, (GFunc) g_object_unref, NULL);
+  g_list_free (actions);
+  g_object_unref (caller);
+  g_variant_unref (options);
+  return g_string_free (str, FALSE);
+}
+
+static void
+check_action_ids (PolkitBackendJsAuthority *authority,
+                  const gchar              *action_id_prefix,
+                  gboolean                  tagged,
+                  const gchar              *start_after,
+                  guint32                   limit,
+                  const gchar              *expected_ids)
+{
+  gchar *ids;
+
+  ids = enumerate_action_ids (authority, action_id_prefix, tagged, start_after, limit);
+  g_assert_cmpstr (ids, ==, expected_ids);
+  g_free (ids);
+}
+
+static void
+test_enumerate_actions_paging (void)
+{
+  PolkitBackendJsAuthority *authority;
+  GError *error;
+  gchar *rules_dirs[2] = {0};
+  gchar *dir;
+  gchar *path;
+
+  error = NULL;
+  dir = g_dir_make_tmp ("polkit-test-XXXXXX", &error);
+  g_assert_no_error (error);
+  path = g_build_filename (dir, "net.company.paging.policy", NULL);
+  g_file_set_contents (path, paging_test_policy, -1, &error);
+  g_assert_no_error (error);
+
+  rules_dirs[0] = polkit_test_get_data_path ("etc/polkit-1/rules.d");
+  authority = g_object_new (POLKIT_BACKEND_TYPE_JS_AUTHORITY,
+                            "rules-dirs", rules_dirs,
+                            "actions-dir", dir,
+                            NULL);
+
+  /* no limit */
+  check_action_ids (authority, NULL, FALSE, NULL, 0,
+                    "net.company.other,net.company.paging.a,net.company.paging.b,"
+                    "net.company.paging.c,net.company.paging.d,net.company.paging.e");
+
+  /* the last page is short */
+  check_action_ids (authority, "net.company.paging.", FALSE, NULL, 2,
+                    "net.company.paging.a,net.company.paging.b");
+  check_action_ids (authority, "net.company.paging.", FALSE, "net.company.paging.b", 2,
+                    "net.company.paging.c,net.company.paging.d");
+  check_action_ids (authority, "net.company.paging.", FALSE, "net.company.paging.d", 2,
+                    "net.company.paging.e");
+
+  /* when the last page is full, the page after it is empty */
+  check_action_ids (authority, "net.company.paging.", FALSE, NULL, 5,
+                    "net.company.paging.a,net.company.paging.b,net.company.paging.c,"
+                    "net.company.paging.d,net.company.paging.e");
+  check_action_ids (authority, "net.company.paging.", FALSE, "net.company.paging.e", 5, "");
+
+  /* the cursor doesn't have to be an existing action */
+  check_action_ids (authority, "net.company.paging.", FALSE, "net.company.paging.b2", 2,
+                    "net.company.paging.c,net.company.paging.d");
+  check_action_ids (authority, NULL, FALSE, "org.freedesktop.", 2, "");
+
+  /* a cursor before the prefix doesn't leave it */
+  check_action_ids (authority, "net.company.paging.", FALSE, "net.company.other", 1,
+                    "net.company.paging.a");
+
+  /* nothing matches */
+  check_action_ids (authority, "org.freedesktop.", FALSE, NULL, 2, "");
+
+  /* actions without the annotation don't count against the limit */
+  check_action_ids (authority, NULL, TRUE, NULL, 1, "net.company.paging.b");
+  check_action_ids (authority, NULL, TRUE, "net.company.paging.b", 1, "net.company.paging.d");
+  check_action_ids (authority, NULL, TRUE, "net.company.paging.d", 1, "");
+
+  g_object_unref (authority);
+
+  g_unlink (path);
+  g_rmdir (dir);
+  g_free (rules_dirs[0]);
+  g_free (path);
+  g_free (dir);
+}
+
+/* ---------------------------------------------------------------------------------------------------- */
+
 int
 main (int argc, char *argv[])
 {
+  GTestDBus *bus;
+  gint ret;
+
   setlocale (LC_ALL, "");
 
   g_type_init ();
   g_test_init (&argc, &argv, NULL);
   //polkit_test_redirect_logs ();
 
+  /* the authority watches callers on the system bus */
+  bus = g_test_dbus_new (G_TEST_DBUS_NONE);
+  g_test_dbus_up (bus);
+  g_setenv ("DBUS_SYSTEM_BUS_ADDRESS", g_test_dbus_get_bus_address (bus), TRUE);
+
   g_test_add_func ("/PolkitBackendJsAuthority/get_admin_identities", test_get_admin_identities);
+  g_test_add_func ("/PolkitBackendJsAuthority/statistics", test_statistics);
+  g_test_add_func ("/PolkitBackendJsAuthority/check_deadline", test_check_deadline);
+  g_test_add_func ("/PolkitBackendJsAuthority/check_caller_vanished", test_check_caller_vanished);
+  g_test_add_func ("/PolkitBackendJsAuthority/idle_time", test_idle_time);
+  g_test_add_func ("/PolkitBackendJsAuthority/temporary_authorizations_file", test_temporary_authorizations_file);
+  g_test_add_func ("/PolkitBackendJsAuthority/temporary_authorization_filters", test_temporary_authorization_filters);
+  g_test_add_func ("/PolkitBackendJsAuthority/preload_actions", test_preload_actions);
+  g_test_add_func ("/PolkitBackendJsAuthority/finalize_while_compiling", test_finalize_while_compiling);
+  g_test_add_func ("/PolkitBackendJsAuthority/enumerate_actions_paging", test_enumerate_actions_paging);
   add_rules_tests ();
 
-  return g_test_run ();
+  ret = g_test_run ();
+
+  g_test_dbus_down (bus);
+  g_object_unref (bus);
+
+  return ret;
 };
@@ -0,0 +1,312 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "config.h"
+#include "glib.h"
+
+#include <locale.h>
+#include <string.h>
+
+#include <polkit/polkit.h>
+#include <polkitbackend/polkitbackendresolver.h>
+
+/* see test/data/etc/{passwd,group,netgroup} */
+
+static void
+test_get_user (void)
+{
+  gchar *user_name;
+  gchar **group_names;
+  GError *error;
+
+  error = NULL;
+  g_assert (polkit_backend_resolver_get_user (500, &user_name, &group_names, &error));
+  g_assert_no_error (error);
+  g_assert_cmpstr (user_name, ==, "john");
+  g_assert_cmpuint (g_strv_length (group_names), ==, 2);
+  g_assert_cmpstr (group_names[0], ==, "users");
+  g_assert_cmpstr (group_names[1], ==, "john");
+  g_free (user_name);
+  g_strfreev (group_names);
+
+  g_assert (!polkit_backend_resolver_get_user (12345, &user_name, &group_names, &error));
+  g_assert_error (error, POLKIT_ERROR, POLKIT_ERROR_FAILED);
+  g_error_free (error);
+}
+
+static void
+test_get_group_members (void)
+{
+  gchar **user_names;
+  guint32 *uids;
+  GError *error;
+
+  error = NULL;
+  g_assert (polkit_backend_resolver_get_group_members (101, &user_names, &uids, &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (g_strv_length (user_names), ==, 2);
+  g_assert_cmpstr (user_names[0], ==, "sally");
+  g_assert_cmpuint (uids[0], ==, 502);
+  g_assert_cmpstr (user_names[1], ==, "henry");
+  g_assert_cmpuint (uids[1], ==, 503);
+  g_strfreev (user_names);
+  g_free (uids);
+}
+
+static void
+test_netgroup (void)
+{
+  gchar **user_names;
+  guint32 *uids;
+  gboolean is_member;
+  GError *error;
+
+  error = NULL;
+  g_assert (polkit_backend_resolver_get_netgroup_members ("foo", &user_names, &uids, &error));
+  g_assert_no_error (error);
+  g_assert_cmpuint (g_strv_length (user_names), ==, 1);
+  g_assert_cmpstr (user_names[0], ==, "john");
+  g_assert_cmpuint (uids[0], ==, 500);
+  g_strfreev (user_names);
+  g_free (uids);
+
+  g_assert (polkit_backend_resolver_user_is_in_netgroup ("jane", "bar", &is_member, &error));
+  g_assert (is_member);
+  g_assert (polkit_backend_resolver_user_is_in_netgroup ("jane", "foo", &is_member, &error));
+  g_assert (!is_member);
+}
+
+static void
+test_identity_from_string (void)
+{
+  PolkitIdentity *identity;
+  GError *error;
+
+  error = NULL;
+  identity = polkit_backend_resolver_identity_from_string ("unix-user:jane", &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (polkit_unix_user_get_uid (POLKIT_UNIX_USER (identity)), ==, 501);
+  g_object_unref (identity);
+
+  identity = polkit_backend_resolver_identity_from_string ("unix-group:admin", &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (polkit_unix_group_get_gid (POLKIT_UNIX_GROUP (identity)), ==, 101);
+  g_object_unref (identity);
+
+  identity = polkit_backend_resolver_identity_from_string ("unix-user:nosuchuser", &error);
+  g_assert (identity == NULL);
+  g_assert_error (error, POLKIT_ERROR, POLKIT_ERROR_FAILED);
+  g_error_free (error);
+}
+
+static void
+test_timeout (void)
+{
+  gchar *user_name;
+  gchar **group_names;
+  guint64 num_timeouts;
+  GError *error;
+
+  /* make mocklibc take longer than the timeout */
+  g_setenv ("MOCK_LATENCY_USEC", "500000", TRUE);
+  polkit_backend_resolver_set_timeout (50);
+
+  error = NULL;
+  g_assert (!polkit_backend_resolver_get_user (501, &user_name, &group_names, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+  g_error_free (error);
+
+  polkit_backend_resolver_get_statistics (NULL, &num_timeouts);
+  g_assert_cmpuint (num_timeouts, ==, 1);
+
+  g_unsetenv ("MOCK_LATENCY_USEC");
+  polkit_backend_resolver_set_timeout (5000);
+}
+
+typedef struct
+{
+  gboolean done;
+  gboolean ret;
+  gchar *user_name;
+  gchar **group_names;
+  GError *error;
+} GetUserData;
+
+static void
+on_get_user (GObject      *source_object,
+             GAsyncResult *res,
+             gpointer      user_data)
+{
+  GetUserData *data = user_data;
+
+  data->ret = polkit_backend_resolver_get_user_finish (res,
+                                                       &data->user_name,
+                                                       &data->group_names,
+                                                       &data->error);
+  data->done = TRUE;
+}
+
+static void
+get_user_async (guint32      uid,
+                GetUserData *data)
+{
+  memset (data, 0, sizeof (GetUserData));
+  polkit_backend_resolver_get_user_async (uid, on_get_user, data);
+  /* the result is always delivered from the main loop */
+  g_assert (!data->done);
+  while (!data->done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+static void
+test_get_user_async (void)
+{
+  GetUserData data;
+
+  get_user_async (500, &data);
+  g_assert (data.ret);
+  g_assert_no_error (data.error);
+  g_assert_cmpstr (data.user_name, ==, "john");
+  g_assert_cmpuint (g_strv_length (data.group_names), ==, 2);
+  g_free (data.user_name);
+  g_strfreev (data.group_names);
+
+  get_user_async (12345, &data);
+  g_assert (!data.ret);
+  g_assert_error (data.error, POLKIT_ERROR, POLKIT_ERROR_FAILED);
+  g_error_free (data.error);
+}
+
+typedef struct
+{
+  gboolean done;
+  gboolean ret;
+  gchar **user_names;
+  guint32 *uids;
+  GError *error;
+} GetMembersData;
+
+static void
+on_get_members (GObject      *source_object,
+                GAsyncResult *res,
+                gpointer      user_data)
+{
+  GetMembersData *data = user_data;
+
+  data->ret = polkit_backend_resolver_get_members_finish (res,
+                                                          &data->user_names,
+                                                          &data->uids,
+                                                          &data->error);
+  data->done = TRUE;
+}
+
+static void
+test_get_members_async (void)
+{
+  GetMembersData data;
+
+  memset (&data, 0, sizeof data);
+  polkit_backend_resolver_get_group_members_async (101, on_get_members, &data);
+  while (!data.done)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert (data.ret);
+  g_assert_no_error (data.error);
+  g_assert_cmpuint (g_strv_length (data.user_names), ==, 2);
+  g_assert_cmpstr (data.user_names[0], ==, "sally");
+  g_assert_cmpuint (data.uids[0], ==, 502);
+  g_strfreev (data.user_names);
+  g_free (data.uids);
+
+  memset (&data, 0, sizeof data);
+  polkit_backend_resolver_get_netgroup_members_async ("foo", on_get_members, &data);
+  while (!data.done)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert (data.ret);
+  g_assert_no_error (data.error);
+  g_assert_cmpuint (g_strv_length (data.user_names), ==, 1);
+  g_assert_cmpstr (data.user_names[0], ==, "john");
+  g_assert_cmpuint (data.uids[0], ==, 500);
+  g_strfreev (data.user_names);
+  g_free (data.uids);
+
+  memset (&data, 0, sizeof data);
+  polkit_backend_resolver_get_group_members_async (12345, on_get_members, &data);
+  while (!data.done)
+    g_main_context_iteration (NULL, TRUE);
+  g_assert (!data.ret);
+  g_assert_error (data.error, POLKIT_ERROR, POLKIT_ERROR_FAILED);
+  g_error_free (data.error);
+}
+
+static void
+test_timeout_async (void)
+{
+  GetUserData data;
+  gchar *user_name;
+  gchar **group_names;
+  guint64 num_timeouts_before;
+  guint64 num_timeouts;
+  gint64 start_time;
+  GError *error;
+
+  polkit_backend_resolver_get_statistics (NULL, &num_timeouts_before);
+
+  g_setenv ("MOCK_LATENCY_USEC", "500000", TRUE);
+  polkit_backend_resolver_set_timeout (50);
+
+  get_user_async (502, &data);
+  g_assert (!data.ret);
+  g_assert_error (data.error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+  g_error_free (data.error);
+
+  /* the same lookup is still stuck so it fails without waiting again */
+  start_time = g_get_monotonic_time ();
+  error = NULL;
+  g_assert (!polkit_backend_resolver_get_user (502, &user_name, &group_names, &error));
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+  g_error_free (error);
+  g_assert_cmpint (g_get_monotonic_time () - start_time, <, 50 * G_TIME_SPAN_MILLISECOND);
+
+  polkit_backend_resolver_get_statistics (NULL, &num_timeouts);
+  g_assert_cmpuint (num_timeouts - num_timeouts_before, ==, 2);
+
+  g_unsetenv ("MOCK_LATENCY_USEC");
+  polkit_backend_resolver_set_timeout (5000);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/PolkitBackendResolver/get_user", test_get_user);
+  g_test_add_func ("/PolkitBackendResolver/get_group_members", test_get_group_members);
+  g_test_add_func ("/PolkitBackendResolver/netgroup", test_netgroup);
+  g_test_add_func ("/PolkitBackendResolver/identity_from_string", test_identity_from_string);
+  g_test_add_func ("/PolkitBackendResolver/timeout", test_timeout);
+  g_test_add_func ("/PolkitBackendResolver/get_user_async", test_get_user_async);
+  g_test_add_func ("/PolkitBackendResolver/get_members_async", test_get_members_async);
+  g_test_add_func ("/PolkitBackendResolver/timeout_async", test_timeout_async);
+
+  return g_test_run ();
+}
@@ -0,0 +1,235 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "glib.h"
+
+#include <locale.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <glib/gstdio.h>
+
+#include <polkit/polkit.h>
+#include <polkitbackend/polkitbackendsessionmonitor.h>
+
+/* Tests the session monitor with fake sessions, logind and ConsoleKit
+ * are not available where the tests run.
+ */
+
+static void
+on_changed (gpointer  instance,
+            guint    *num_changed)
+{
+  (*num_changed)++;
+}
+
+static PolkitSubject *
+get_session (PolkitBackendSessionMonitor *monitor,
+             gint                         pid)
+{
+  PolkitSubject *process;
+  PolkitSubject *session;
+  GError *error;
+
+  process = polkit_unix_process_new_for_owner (pid, 1, 1000);
+  error = NULL;
+  session = polkit_backend_session_monitor_get_session_for_subject (monitor, process, &error);
+  g_assert_no_error (error);
+  g_object_unref (process);
+  return session;
+}
+
+static void
+test_api (void)
+{
+  PolkitBackendFakeSessions *sessions;
+  PolkitBackendSessionMonitor *monitor;
+  PolkitSubject *session;
+  PolkitIdentity *user;
+  GList *list;
+  GError *error;
+  guint num_changed;
+
+  sessions = polkit_backend_fake_sessions_new ();
+  monitor = polkit_backend_session_monitor_new_for_fake_sessions (sessions);
+
+  num_changed = 0;
+  g_signal_connect (monitor, "changed", G_CALLBACK (on_changed), &num_changed);
+
+  polkit_backend_fake_sessions_add_session (sessions, "c1", 1000, "seat0", TRUE);
+  polkit_backend_fake_sessions_add_session (sessions, "c2", 1001, NULL, FALSE);
+  polkit_backend_fake_sessions_add_process (sessions, 100, "c1");
+  polkit_backend_fake_sessions_add_process (sessions, 200, "c2");
+  g_assert_cmpuint (num_changed, ==, 2);
+
+  list = polkit_backend_session_monitor_get_sessions (monitor);
+  g_assert_cmpuint (g_list_length (list), ==, 2);
+  g_list_free_full (list, g_object_unref);
+
+  session = get_session (monitor, 100);
+  g_assert (session != NULL);
+  g_assert_cmpstr (polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)), ==, "c1");
+  g_assert (polkit_backend_session_monitor_is_session_local (monitor, session));
+  g_assert (polkit_backend_session_monitor_is_session_active (monitor, session));
+  error = NULL;
+  user = polkit_backend_session_monitor_get_user_for_subject (monitor, session, &error);
+  g_assert_no_error (error);
+  g_assert_cmpint (polkit_unix_user_get_uid (POLKIT_UNIX_USER (user)), ==, 1000);
+  g_object_unref (user);
+  g_object_unref (session);
+
+  session = get_session (monitor, 200);
+  g_assert (session != NULL);
+  g_assert (!polkit_backend_session_monitor_is_session_local (monitor, session));
+  g_assert (!polkit_backend_session_monitor_is_session_active (monitor, session));
+  g_assert (polkit_backend_fake_sessions_set_session_active (sessions, "c2", TRUE));
+  g_assert (polkit_backend_session_monitor_is_session_active (monitor, session));
+  g_assert_cmpuint (num_changed, ==, 3);
+  g_object_unref (session);
+
+  /* not in any session unless there is a default one */
+  g_assert (get_session (monitor, 300) == NULL);
+  polkit_backend_fake_sessions_set_default_session (sessions, "c2");
+  session = get_session (monitor, 300);
+  g_assert_cmpstr (polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)), ==, "c2");
+  g_object_unref (session);
+
+  g_assert (polkit_backend_fake_sessions_remove_session (sessions, "c1"));
+  g_assert (!polkit_backend_fake_sessions_remove_session (sessions, "c1"));
+  g_assert (get_session (monitor, 100) == NULL);
+  g_assert_cmpuint (num_changed, ==, 4);
+
+  g_object_unref (monitor);
+  g_object_unref (sessions);
+}
+
+static void
+test_file (void)
+{
+  PolkitBackendFakeSessions *sessions;
+  PolkitBackendSessionMonitor *monitor;
+  PolkitSubject *session;
+  gchar *path;
+  gchar *contents;
+  GError *error;
+  gint fd;
+
+  error = NULL;
+  fd = g_file_open_tmp ("polkit-fake-sessions-XXXXXX", &path, &error);
+  g_assert_no_error (error);
+  close (fd);
+
+  contents = g_strdup_printf ("[General]\n"
+                              "DefaultSession=c2\n"
+                              "\n"
+                              "[Session c1]\n"
+                              "Uid=1000\n"
+                              "Seat=seat0\n"
+                              "Active=true\n"
+                              "Pids=%d;4242\n"
+                              "\n"
+                              "[Session c2]\n"
+                              "Uid=1001\n"
+                              "Active=false\n",
+                              (gint) getpid ());
+  g_file_set_contents (path, contents, -1, &error);
+  g_assert_no_error (error);
+
+  /* as polkitd --fake-sessions would pick it up */
+  sessions = polkit_backend_fake_sessions_new_from_file (path, &error);
+  g_assert_no_error (error);
+  monitor = polkit_backend_session_monitor_new_for_fake_sessions (sessions);
+
+  session = get_session (monitor, getpid ());
+  g_assert_cmpstr (polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)), ==, "c1");
+  g_assert (polkit_backend_session_monitor_is_session_local (monitor, session));
+  g_assert (polkit_backend_session_monitor_is_session_active (monitor, session));
+  g_object_unref (session);
+
+  session = get_session (monitor, 4243);
+  g_assert_cmpstr (polkit_unix_session_get_session_id (POLKIT_UNIX_SESSION (session)), ==, "c2");
+  g_assert (!polkit_backend_session_monitor_is_session_local (monitor, session));
+  g_object_unref (session);
+
+  g_object_unref (monitor);
+  g_object_unref (sessions);
+
+  /* a file that isn't there is an error */
+  sessions = polkit_backend_fake_sessions_new_from_file ("/nonexistent/polkit-fake-sessions", &error);
+  g_assert (sessions == NULL);
+  g_assert (error != NULL);
+  g_clear_error (&error);
+
+  g_unlink (path);
+  g_free (path);
+  g_free (contents);
+}
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+  GMainLoop *loop = user_data;
+  g_main_loop_quit (loop);
+  return FALSE;
+}
+
+static void
+test_change_rate (void)
+{
+  PolkitBackendFakeSessions *sessions;
+  PolkitBackendSessionMonitor *monitor;
+  GMainLoop *loop;
+  guint num_changed;
+
+  sessions = polkit_backend_fake_sessions_new ();
+  monitor = polkit_backend_session_monitor_new_for_fake_sessions (sessions);
+  num_changed = 0;
+  g_signal_connect (monitor, "changed", G_CALLBACK (on_changed), &num_changed);
+
+  /* 2000 per second are emitted in bursts of two every millisecond */
+  polkit_backend_fake_sessions_set_change_rate (sessions, 2000);
+  loop = g_main_loop_new (NULL, FALSE);
+  g_timeout_add (100, on_timeout, loop);
+  g_main_loop_run (loop);
+  polkit_backend_fake_sessions_set_change_rate (sessions, 0);
+
+  g_assert_cmpuint (num_changed, >, 0);
+  g_assert_cmpuint (num_changed % 2, ==, 0);
+  g_assert_cmpuint (num_changed, ==, polkit_backend_fake_sessions_get_num_changes (sessions));
+
+  g_main_loop_unref (loop);
+  g_object_unref (monitor);
+  g_object_unref (sessions);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/PolkitBackendSessionMonitor/fake_sessions/api", test_api);
+  g_test_add_func ("/PolkitBackendSessionMonitor/fake_sessions/file", test_file);
+  g_test_add_func ("/PolkitBackendSessionMonitor/fake_sessions/change_rate", test_change_rate);
+
+  return g_test_run ();
+}
@@ -0,0 +1,155 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+#include "config.h"
+#include "glib.h"
+
+#include <locale.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#include <polkit/polkit.h>
+#include <polkitbackend/polkitbackendspawner.h>
+
+static void
+run (const gchar  *command_line,
+     guint         timeout_seconds,
+     gint         *out_exit_status,
+     gchar       **out_standard_output,
+     gchar       **out_standard_error,
+     GError      **error)
+{
+  gchar **argv;
+
+  argv = g_strsplit (command_line, " ", 0);
+  polkit_backend_spawner_run ((const gchar *const *) argv,
+                              timeout_seconds,
+                              out_exit_status,
+                              out_standard_output,
+                              out_standard_error,
+                              error);
+  g_strfreev (argv);
+}
+
+static void
+test_exit_status (void)
+{
+  GError *error = NULL;
+  gint exit_status;
+
+  run ("true", 10, &exit_status, NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (WIFEXITED (exit_status) && WEXITSTATUS (exit_status) == 0);
+
+  run ("false", 10, &exit_status, NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (WIFEXITED (exit_status) && WEXITSTATUS (exit_status) == 1);
+}
+
+static void
+test_output (void)
+{
+  GError *error = NULL;
+  gint exit_status;
+  gchar *standard_output;
+  gchar *standard_error;
+
+  run ("echo -n a test", 10, &exit_status, &standard_output, &standard_error, &error);
+  g_assert_no_error (error);
+  g_assert (WIFEXITED (exit_status) && WEXITSTATUS (exit_status) == 0);
+  g_assert_cmpstr (standard_output, ==, "a test");
+  g_assert_cmpstr (standard_error, ==, "");
+  g_free (standard_output);
+  g_free (standard_error);
+
+  run ("ls /does-not-exist", 10, &exit_status, &standard_output, &standard_error, &error);
+  g_assert_no_error (error);
+  g_assert (WIFEXITED (exit_status) && WEXITSTATUS (exit_status) != 0);
+  g_assert_cmpstr (standard_output, ==, "");
+  g_assert (strstr (standard_error, "/does-not-exist") != NULL);
+  g_free (standard_output);
+  g_free (standard_error);
+}
+
+static void
+test_not_found (void)
+{
+  GError *error = NULL;
+  gint exit_status;
+
+  run ("/path/to/non/existing/helper", 10, &exit_status, NULL, NULL, &error);
+  g_assert_error (error, G_SPAWN_ERROR, G_SPAWN_ERROR_NOENT);
+  g_clear_error (&error);
+}
+
+static void
+test_timeout (void)
+{
+  GError *error = NULL;
+  gint exit_status;
+
+  run ("sleep 20", 1, &exit_status, NULL, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT);
+  g_assert_cmpstr (error->message, ==, "Timed out after 1 seconds");
+  g_clear_error (&error);
+
+  /* the server is still usable */
+  run ("true", 10, &exit_status, NULL, NULL, &error);
+  g_assert_no_error (error);
+  g_assert (WIFEXITED (exit_status) && WEXITSTATUS (exit_status) == 0);
+}
+
+static void
+test_stopped (void)
+{
+  GError *error = NULL;
+  gint exit_status;
+
+  polkit_backend_spawner_stop ();
+  g_assert (!polkit_backend_spawner_is_running ());
+
+  run ("true", 10, &exit_status, NULL, NULL, &error);
+  g_assert_error (error, G_IO_ERROR, G_IO_ERROR_NOT_CONNECTED);
+  g_clear_error (&error);
+}
+
+int
+main (int argc, char *argv[])
+{
+  GError *error = NULL;
+
+  setlocale (LC_ALL, "");
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  /* the spawn server has to be forked before any threads are started */
+  polkit_backend_spawner_start (&error);
+  g_assert_no_error (error);
+  g_assert (polkit_backend_spawner_is_running ());
+
+  g_test_add_func ("/PolkitBackendSpawner/exit_status", test_exit_status);
+  g_test_add_func ("/PolkitBackendSpawner/output", test_output);
+  g_test_add_func ("/PolkitBackendSpawner/not_found", test_not_found);
+  g_test_add_func ("/PolkitBackendSpawner/timeout", test_timeout);
+  g_test_add_func ("/PolkitBackendSpawner/stopped", test_stopped);
+
+  return g_test_run ();
+}
@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2016 Red Hat, Inc.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General
+ * Public License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place, Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include "config.h"
+#include "glib.h"
+
+#include <locale.h>
+
+#include <polkit/polkit.h>
+#include <polkitbackend/polkitbackendwatchdog.h>
+
+#define THRESHOLD_MSEC 200
+
+static gboolean
+on_timeout (gpointer user_data)
+{
+  GMainLoop *loop = user_data;
+  g_main_loop_quit (loop);
+  return FALSE; /* remove source */
+}
+
+static void
+run_main_loop (guint msec)
+{
+  GMainLoop *loop;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  g_timeout_add (msec, on_timeout, loop);
+  g_main_loop_run (loop);
+  g_main_loop_unref (loop);
+}
+
+static void
+test_no_stall (void)
+{
+  guint threshold_msec;
+  guint64 num_stalls;
+
+  polkit_backend_watchdog_start (THRESHOLD_MSEC, FALSE);
+  g_assert (polkit_backend_watchdog_is_running ());
+  run_main_loop (2 * THRESHOLD_MSEC);
+  polkit_backend_watchdog_stop ();
+  g_assert (!polkit_backend_watchdog_is_running ());
+
+  polkit_backend_watchdog_get_statistics (&threshold_msec, &num_stalls, NULL, NULL);
+  g_assert_cmpuint (threshold_msec, ==, THRESHOLD_MSEC);
+  g_assert_cmpuint (num_stalls, ==, 0);
+}
+
+static void
+test_stall (void)
+{
+  guint64 num_stalls;
+  guint64 longest_stall_msec;
+  guint64 total_stall_msec;
+
+  polkit_backend_watchdog_start (THRESHOLD_MSEC, FALSE);
+  run_main_loop (THRESHOLD_MSEC / 2);
+
+  polkit_backend_watchdog_set_activity ("CheckAuthorization", ":1.42", "org.freedesktop.policykit.exec");
+  polkit_backend_watchdog_set_stage ("rules");
+  /* block the main loop, the stall is counted when it runs again */
+  g_usleep (3 * THRESHOLD_MSEC * 1000);
+  polkit_backend_watchdog_clear_activity ();
+  run_main_loop (THRESHOLD_MSEC / 2);
+
+  polkit_backend_watchdog_stop ();
+
+  polkit_backend_watchdog_get_statistics (NULL, &num_stalls, &longest_stall_msec, &total_stall_msec);
+  g_assert_cmpuint (num_stalls, ==, 1);
+  g_assert_cmpuint (longest_stall_msec, >=, 2 * THRESHOLD_MSEC);
+  g_assert_cmpuint (total_stall_msec, ==, longest_stall_msec);
+}
+
+static void
+test_not_running (void)
+{
+  guint64 num_stalls;
+
+  /* the activity is ignored and the statistics are kept when not running */
+  polkit_backend_watchdog_set_activity ("CheckAuthorization", NULL, NULL);
+  polkit_backend_watchdog_set_stage ("rules");
+  polkit_backend_watchdog_clear_activity ();
+  polkit_backend_watchdog_stop ();
+
+  polkit_backend_watchdog_get_statistics (NULL, &num_stalls, NULL, NULL);
+  g_assert_cmpuint (num_stalls, ==, 1);
+}
+
+int
+main (int argc, char *argv[])
+{
+  setlocale (LC_ALL, "");
+
+  g_type_init ();
+  g_test_init (&argc, &argv, NULL);
+
+  /* the watchdog is global so the order of these matters */
+  g_test_add_func ("/PolkitBackendWatchdog/no_stall", test_no_stall);
+  g_test_add_func ("/PolkitBackendWatchdog/stall", test_stall);
+  g_test_add_func ("/PolkitBackendWatchdog/not_running", test_not_running);
+
+  return g_test_run ();
+}